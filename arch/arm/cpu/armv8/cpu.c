@@ -14,6 +14,7 @@
 #include <command.h>
 #include <cpu_func.h>
 #include <irq_func.h>
+#include <mp_work.h>
 #include <asm/system.h>
 #include <asm/secure.h>
 #include <linux/compiler.h>
@@ -45,6 +46,9 @@ int cleanup_before_linux(void)
 
 	board_cleanup_before_linux();
 
+	/* secondary CPUs must be parked while our caches are still on */
+	mp_work_park();
+
 	disable_interrupts();
 
 	/*
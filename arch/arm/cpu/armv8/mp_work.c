@@ -0,0 +1,408 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Running jobs on secondary CPUs
+ *
+ * Secondary CPUs listed in the device tree are released with PSCI CPU_ON or
+ * through the spin table. They enter mp_work_secondary_entry with the MMU
+ * off, take over the boot CPU's page tables and then wait on a mailbox for
+ * jobs. Before an OS is started they are turned off again (PSCI) or sent
+ * back to the spin table, so the OS finds them as the firmware left them.
+ * The same is done when a boot fails, and they are started again the next
+ * time there is work for them.
+ *
+ * The mailboxes are plain memory: each state change has a single writer, so
+ * no exclusive accesses are needed and the code works with the data cache on
+ * or off.
+ */
+
+#include <common.h>
+#include <cpu_func.h>
+#include <fdt_support.h>
+#include <fdtdec.h>
+#include <malloc.h>
+#include <mp_work.h>
+#include <watchdog.h>
+#include <asm/cache.h>
+#include <asm/mp_work.h>
+#include <asm/psci.h>
+#include <asm/spin_table.h>
+#include <asm/system.h>
+#include <linux/compiler.h>
+#include <linux/libfdt.h>
+#include <linux/sizes.h>
+
+DECLARE_GLOBAL_DATA_PTR;
+
+#define MP_WORK_STACK_SIZE	SZ_16K
+#define MP_WORK_TIMEOUT_MS	100
+#define MP_WORK_NO_CPU		(~0ULL)
+#define MP_WORK_MPIDR_MASK	0xff00ffffffULL
+
+/* Mailbox states; who writes each one is given in brackets */
+enum {
+	MP_WORK_OFF,		/* not started yet [boot CPU] */
+	MP_WORK_IDLE,		/* waiting for a job [secondary] */
+	MP_WORK_BUSY,		/* running @job [boot CPU] */
+	MP_WORK_DONE,		/* finished @job [secondary] */
+	MP_WORK_PARK,		/* asked to park [boot CPU] */
+	MP_WORK_PARKED,		/* about to turn off or spin [secondary] */
+};
+
+enum mp_work_method {
+	MP_WORK_PSCI_SMC,
+	MP_WORK_PSCI_HVC,
+	MP_WORK_SPIN_TABLE,
+};
+
+struct mp_work_cpu mp_work_cpus[MP_WORK_MAX_CPUS];
+struct mp_work_regs mp_work_regs;
+
+static struct {
+	bool tried;		/* secondaries were started, or could not be */
+	bool parked;		/* secondaries are in the relocated spin table */
+	ulong stacks;		/* stacks for all secondaries */
+	int count;		/* number of mailboxes in use */
+	enum mp_work_method method;
+	bool up[MP_WORK_MAX_CPUS];	/* CPU reached its mailbox */
+	int nr_up;
+} mp_work;
+
+static void mp_work_sev(void)
+{
+	dsb();
+	asm volatile ("sev");
+}
+
+static unsigned long mp_work_psci(u32 fn, unsigned long arg0,
+				  unsigned long arg1, unsigned long arg2)
+{
+	struct pt_regs regs;
+
+	regs.regs[0] = fn;
+	regs.regs[1] = arg0;
+	regs.regs[2] = arg1;
+	regs.regs[3] = arg2;
+	if (mp_work.method == MP_WORK_PSCI_HVC)
+		hvc_call(&regs);
+	else
+		smc_call(&regs);
+
+	return regs.regs[0];
+}
+
+void __noreturn mp_work_secondary(struct mp_work_cpu *cpu)
+{
+	struct mp_job *job;
+	u32 state;
+
+	WRITE_ONCE(cpu->state, MP_WORK_IDLE);
+	for (;;) {
+		while (state = READ_ONCE(cpu->state),
+		       state != MP_WORK_BUSY && state != MP_WORK_PARK)
+			asm volatile ("wfe");
+		if (state == MP_WORK_PARK)
+			break;
+
+		dmb();
+		job = cpu->job;
+		job->ret = job->func(job->arg);
+		dmb();
+		WRITE_ONCE(cpu->state, MP_WORK_DONE);
+	}
+
+	WRITE_ONCE(cpu->state, MP_WORK_PARKED);
+	dsb();
+	if (mp_work.method == MP_WORK_SPIN_TABLE) {
+#ifdef CONFIG_ARMV8_SPIN_TABLE
+		mp_work_spin_park();
+#endif
+	} else {
+		mp_work_psci(ARM_PSCI_0_2_FN_CPU_OFF, 0, 0, 0);
+	}
+
+	while (1)
+		asm volatile ("wfe");
+}
+
+/* Work out how the secondary CPUs in the device tree can be started */
+static int mp_work_get_method(const void *blob, const char *enable_method)
+{
+	const char *conduit;
+	int node;
+
+	if (!strcmp(enable_method, "spin-table")) {
+		if (!IS_ENABLED(CONFIG_ARMV8_SPIN_TABLE))
+			return -ENOSYS;
+		return MP_WORK_SPIN_TABLE;
+	}
+	if (strcmp(enable_method, "psci") || current_el() == 3)
+		return -ENOSYS;
+
+	node = fdt_path_offset(blob, "/psci");
+	if (node < 0 || (fdt_node_check_compatible(blob, node, "arm,psci-0.2") &&
+			 fdt_node_check_compatible(blob, node, "arm,psci-1.0")))
+		return -ENOSYS;
+	conduit = fdt_getprop(blob, node, "method", NULL);
+	if (conduit && !strcmp(conduit, "hvc"))
+		return MP_WORK_PSCI_HVC;
+
+	return MP_WORK_PSCI_SMC;
+}
+
+/* Fill in a mailbox for every other CPU that can be started */
+static int mp_work_find_cpus(const void *blob)
+{
+	u64 self = read_mpidr() & MP_WORK_MPIDR_MASK;
+	const char *prop;
+	const fdt32_t *reg;
+	int cpus, node, ac, len, method;
+	int count = 0;
+	u64 mpidr;
+
+	cpus = fdt_path_offset(blob, "/cpus");
+	if (cpus < 0)
+		return -ENODEV;
+	ac = fdt_address_cells(blob, cpus);
+
+	fdt_for_each_subnode(node, blob, cpus) {
+		if (count == MP_WORK_MAX_CPUS)
+			break;
+		prop = fdt_getprop(blob, node, "device_type", NULL);
+		if (!prop || strcmp(prop, "cpu"))
+			continue;
+		reg = fdt_getprop(blob, node, "reg", &len);
+		if (!reg || len < ac * (int)sizeof(*reg))
+			continue;
+		mpidr = fdt_read_number(reg, ac);
+		if (mpidr == self || !fdtdec_get_is_enabled(blob, node))
+			continue;
+
+		prop = fdt_getprop(blob, node, "enable-method", NULL);
+		if (!prop)
+			continue;
+		method = mp_work_get_method(blob, prop);
+		if (method < 0 || (count && method != mp_work.method))
+			continue;
+
+		mp_work.method = method;
+		mp_work_cpus[count++].mpidr = mpidr;
+	}
+
+	return count;
+}
+
+static void mp_work_release(void)
+{
+	ulong entry = (ulong)mp_work_secondary_entry;
+	int i;
+
+	if (mp_work.method != MP_WORK_SPIN_TABLE) {
+		for (i = 0; i < mp_work.count; i++)
+			mp_work_psci(ARM_PSCI_0_2_FN64_CPU_ON,
+				     mp_work_cpus[i].mpidr, entry, 0);
+		return;
+	}
+#ifdef CONFIG_ARMV8_SPIN_TABLE
+	{
+		/*
+		 * The secondaries are still polling the release address in
+		 * the copy of U-Boot they were started in, unless they were
+		 * parked by this one
+		 */
+		u64 *release = &spin_table_cpu_release_addr;
+
+		if (!mp_work.parked)
+			release = (void *)release - gd->reloc_off;
+
+		*release = entry;
+		flush_dcache_range((ulong)release & ~(ARCH_DMA_MINALIGN - 1),
+				   ALIGN((ulong)(release + 1),
+					 ARCH_DMA_MINALIGN));
+		mp_work_sev();
+	}
+#endif
+}
+
+static void mp_work_start(void)
+{
+	ulong start;
+	int i, count;
+
+	mp_work.tried = true;
+	if (!gd->fdt_blob)
+		return;
+
+	for (i = 0; i < MP_WORK_MAX_CPUS; i++) {
+		mp_work_cpus[i].mpidr = MP_WORK_NO_CPU;
+		mp_work_cpus[i].state = MP_WORK_OFF;
+	}
+	count = mp_work_find_cpus(gd->fdt_blob);
+	if (count <= 0)
+		return;
+	/* the device tree does not change, so neither does the count */
+	if (!mp_work.stacks)
+		mp_work.stacks = (ulong)memalign(ARCH_DMA_MINALIGN,
+						 count * MP_WORK_STACK_SIZE);
+	if (!mp_work.stacks)
+		return;
+	for (i = 0; i < count; i++)
+		mp_work_cpus[i].stack = mp_work.stacks +
+					(i + 1) * MP_WORK_STACK_SIZE;
+	mp_work.count = count;
+
+	/* secondaries read all this with their MMU off */
+	mp_work_save_regs(&mp_work_regs);
+	flush_dcache_range((ulong)mp_work_cpus,
+			   (ulong)mp_work_cpus + sizeof(mp_work_cpus));
+	flush_dcache_range((ulong)&mp_work_regs & ~(ARCH_DMA_MINALIGN - 1),
+			   ALIGN((ulong)(&mp_work_regs + 1),
+				 ARCH_DMA_MINALIGN));
+	mp_work_release();
+
+	start = get_timer(0);
+	while (mp_work.nr_up < count &&
+	       get_timer(start) < MP_WORK_TIMEOUT_MS) {
+		for (i = 0; i < count; i++) {
+			if (!mp_work.up[i] &&
+			    READ_ONCE(mp_work_cpus[i].state) != MP_WORK_OFF) {
+				mp_work.up[i] = true;
+				mp_work.nr_up++;
+			}
+		}
+	}
+	debug("%s: %d of %d secondary CPUs started\n", __func__,
+	      mp_work.nr_up, count);
+}
+
+int mp_work_run(struct mp_job *jobs, int count)
+{
+	struct mp_work_cpu *cpu;
+	struct mp_job *job;
+	int next, i;
+
+	BUILD_BUG_ON(offsetof(struct mp_work_cpu, stack) != MP_WORK_CPU_STACK);
+	BUILD_BUG_ON(sizeof(struct mp_work_cpu) != MP_WORK_CPU_SIZE);
+	BUILD_BUG_ON(offsetof(struct mp_work_regs, vbar) != MP_WORK_REGS_VBAR);
+
+	if (count > 1 && !mp_work.tried)
+		mp_work_start();
+
+	for (next = 0; next < count;) {
+		for (i = 0; i < mp_work.count && next < count; i++) {
+			cpu = &mp_work_cpus[i];
+			if (!mp_work.up[i] ||
+			    READ_ONCE(cpu->state) == MP_WORK_BUSY)
+				continue;
+			cpu->job = &jobs[next++];
+			dmb();
+			WRITE_ONCE(cpu->state, MP_WORK_BUSY);
+		}
+		mp_work_sev();
+
+		/* all secondaries are busy, so take the next job ourselves */
+		if (next < count) {
+			job = &jobs[next++];
+			job->ret = job->func(job->arg);
+		}
+	}
+
+	for (i = 0; i < mp_work.count; i++) {
+		while (mp_work.up[i] &&
+		       READ_ONCE(mp_work_cpus[i].state) == MP_WORK_BUSY)
+			WATCHDOG_RESET();
+	}
+	dmb();
+
+	return mp_work.nr_up;
+}
+
+void mp_work_queue(struct mp_job *job)
+{
+	struct mp_work_cpu *cpu;
+	int i;
+
+	if (!mp_work.tried)
+		mp_work_start();
+
+	for (i = 0; i < mp_work.count; i++) {
+		cpu = &mp_work_cpus[i];
+		if (!mp_work.up[i] || READ_ONCE(cpu->state) == MP_WORK_BUSY)
+			continue;
+		cpu->job = job;
+		dmb();
+		WRITE_ONCE(cpu->state, MP_WORK_BUSY);
+		mp_work_sev();
+		return;
+	}
+
+	/* no secondary CPU is free, so run the job now */
+	job->ret = job->func(job->arg);
+}
+
+void mp_work_wait(struct mp_job *job)
+{
+	struct mp_work_cpu *cpu;
+	int i;
+
+	for (i = 0; i < mp_work.count; i++) {
+		cpu = &mp_work_cpus[i];
+		while (mp_work.up[i] && cpu->job == job &&
+		       READ_ONCE(cpu->state) == MP_WORK_BUSY)
+			WATCHDOG_RESET();
+	}
+	dmb();
+}
+
+void mp_work_park(void)
+{
+	ulong start;
+	int i;
+
+	if (!mp_work.count)
+		return;
+
+#ifdef CONFIG_ARMV8_SPIN_TABLE
+	/* this is the release address the OS is told about */
+	if (mp_work.method == MP_WORK_SPIN_TABLE) {
+		spin_table_cpu_release_addr = 0;
+		flush_dcache_range((ulong)&spin_table_cpu_release_addr &
+				   ~(ARCH_DMA_MINALIGN - 1),
+				   ALIGN((ulong)(&spin_table_cpu_release_addr + 1),
+					 ARCH_DMA_MINALIGN));
+	}
+#endif
+
+	/* this includes any CPU that turned up after mp_work_start() gave up */
+	for (i = 0; i < mp_work.count; i++) {
+		mp_work.up[i] = READ_ONCE(mp_work_cpus[i].state) != MP_WORK_OFF;
+		if (!mp_work.up[i])
+			continue;
+		/* let a job from mp_work_queue() finish, as nobody waited */
+		while (READ_ONCE(mp_work_cpus[i].state) == MP_WORK_BUSY)
+			WATCHDOG_RESET();
+		WRITE_ONCE(mp_work_cpus[i].state, MP_WORK_PARK);
+	}
+	mp_work_sev();
+
+	start = get_timer(0);
+	for (i = 0; i < mp_work.count; i++) {
+		if (!mp_work.up[i])
+			continue;
+		while (READ_ONCE(mp_work_cpus[i].state) != MP_WORK_PARKED &&
+		       get_timer(start) < MP_WORK_TIMEOUT_MS)
+			;
+		/* the OS cannot start a CPU that PSCI still reports as on */
+		while (mp_work.method != MP_WORK_SPIN_TABLE &&
+		       mp_work_psci(ARM_PSCI_0_2_FN64_AFFINITY_INFO,
+				    mp_work_cpus[i].mpidr, 0, 0) != 1 &&
+		       get_timer(start) < MP_WORK_TIMEOUT_MS)
+			;
+		mp_work.up[i] = false;
+	}
+	mp_work.count = 0;
+	mp_work.nr_up = 0;
+
+	/* if we get control back, e.g. after a failed boot, start again */
+	mp_work.tried = false;
+	mp_work.parked = true;
+}
@@ -0,0 +1,31 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * SHA-1 using the ARMv8 Crypto Extensions, if the CPU implements them
+ */
+
+#include <common.h>
+#include <errno.h>
+#include <u-boot/sha1.h>
+#include <asm/armv8/cpu.h>
+
+void sha1_armv8_ce_process(uint32_t state[5], const uint8_t *data,
+			   uint32_t blocks);
+
+int sha1_process_arch(sha1_context *ctx, const unsigned char *data,
+		      unsigned int blocks)
+{
+	uint32_t state[5];
+	int i;
+
+	if (!blocks || !has_ce_sha1())
+		return -ENOSYS;
+
+	/* the context holds the state as unsigned long */
+	for (i = 0; i < 5; i++)
+		state[i] = ctx->state[i];
+	sha1_armv8_ce_process(state, data, blocks);
+	for (i = 0; i < 5; i++)
+		ctx->state[i] = state[i];
+
+	return 0;
+}
@@ -0,0 +1,23 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * SHA-256 using the ARMv8 Crypto Extensions, if the CPU implements them
+ */
+
+#include <common.h>
+#include <errno.h>
+#include <u-boot/sha256.h>
+#include <asm/armv8/cpu.h>
+
+void sha256_armv8_ce_process(uint32_t state[8], const uint8_t *data,
+			     uint32_t blocks);
+
+int sha256_process_arch(sha256_context *ctx, const uint8_t *data,
+			uint32_t blocks)
+{
+	if (!blocks || !has_ce_sha2())
+		return -ENOSYS;
+
+	sha256_armv8_ce_process(ctx->state, data, blocks);
+
+	return 0;
+}
@@ -24,3 +24,21 @@ static inline unsigned int read_midr(void)
 			 MIDR_PARTNUM_SHIFT) == MIDR_PARTNUM_CORTEX_A53)
 #define is_cortex_a72() (((read_midr() & MIDR_PARTNUM_MASK) >>\
 			 MIDR_PARTNUM_SHIFT) == MIDR_PARTNUM_CORTEX_A72)
+
+#define ID_AA64ISAR0_SHA1_SHIFT		8
+#define ID_AA64ISAR0_SHA2_SHIFT		12
+#define ID_AA64ISAR0_FIELD_MASK		0xf
+
+static inline unsigned long read_id_aa64isar0(void)
+{
+	unsigned long val;
+
+	asm volatile("mrs %0, id_aa64isar0_el1" : "=r" (val));
+
+	return val;
+}
+
+#define has_ce_sha1() ((read_id_aa64isar0() >> ID_AA64ISAR0_SHA1_SHIFT) & \
+		       ID_AA64ISAR0_FIELD_MASK)
+#define has_ce_sha2() ((read_id_aa64isar0() >> ID_AA64ISAR0_SHA2_SHIFT) & \
+		       ID_AA64ISAR0_FIELD_MASK)
@@ -0,0 +1,79 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ * Data shared between the boot CPU and secondary CPUs running jobs, see
+ * arch/arm/cpu/armv8/mp_work.c
+ */
+
+#ifndef __ASM_MP_WORK_H
+#define __ASM_MP_WORK_H
+
+#define MP_WORK_MAX_CPUS	16
+
+/* Offsets into struct mp_work_cpu */
+#define MP_WORK_CPU_MPIDR	0
+#define MP_WORK_CPU_STACK	8
+#define MP_WORK_CPU_SIZE	64
+
+/* Offsets into struct mp_work_regs */
+#define MP_WORK_REGS_EL		0
+#define MP_WORK_REGS_SCTLR	8
+#define MP_WORK_REGS_TCR	16
+#define MP_WORK_REGS_TTBR0	24
+#define MP_WORK_REGS_MAIR	32
+#define MP_WORK_REGS_VBAR	40
+
+#ifndef __ASSEMBLY__
+
+struct mp_job;
+
+/**
+ * struct mp_work_cpu - mailbox for one secondary CPU
+ *
+ * Each mailbox has its own cache line, so that CPUs polling their state do
+ * not disturb each other.
+ *
+ * @mpidr:	Affinity of the CPU, ~0 if the slot is unused
+ * @stack:	Initial stack pointer
+ * @state:	MP_WORK_... state, see mp_work.c
+ * @job:	Job to run once @state is MP_WORK_BUSY
+ */
+struct mp_work_cpu {
+	u64 mpidr;
+	u64 stack;
+	u32 state;
+	struct mp_job *job;
+} __aligned(MP_WORK_CPU_SIZE);
+
+/**
+ * struct mp_work_regs - translation setup of the boot CPU
+ *
+ * Secondary CPUs copy this before turning on their MMU, so that they see
+ * memory exactly as the boot CPU does.
+ *
+ * @el:		Value of CurrentEL
+ * @sctlr:	SCTLR_ELx
+ * @tcr:	TCR_ELx
+ * @ttbr0:	TTBR0_ELx
+ * @mair:	MAIR_ELx
+ * @vbar:	VBAR_ELx
+ */
+struct mp_work_regs {
+	u64 el;
+	u64 sctlr;
+	u64 tcr;
+	u64 ttbr0;
+	u64 mair;
+	u64 vbar;
+};
+
+extern struct mp_work_cpu mp_work_cpus[MP_WORK_MAX_CPUS];
+extern struct mp_work_regs mp_work_regs;
+
+void mp_work_save_regs(struct mp_work_regs *regs);
+void mp_work_secondary_entry(void);
+void __noreturn mp_work_secondary(struct mp_work_cpu *cpu);
+void __noreturn mp_work_spin_park(void);
+
+#endif /* __ASSEMBLY__ */
+
+#endif /* __ASM_MP_WORK_H */
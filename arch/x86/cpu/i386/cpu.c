@@ -241,6 +241,14 @@ static bool has_mtrr(void)
 	return cpuid_edx(0x00000001) & (1 << 12) ? true : false;
 }
 
+/* SSE together with FXSAVE/FXRSTOR */
+static bool has_sse(void)
+{
+	const u32 mask = (1 << 24) | (1 << 25);
+
+	return has_cpuid() && (cpuid_edx(0x00000001) & mask) == mask;
+}
+
 #ifndef CONFIG_TPL_BUILD
 static int build_vendor_name(char *vendor_name)
 {
@@ -348,7 +356,7 @@ u32 cpu_get_stepping(void)
 	return gd->arch.x86_mask;
 }
 
-/* initialise FPU, reset EM, set MP and NE */
+/* initialise FPU, reset EM, set MP and NE, enable SSE if present */
 static void setup_cpu_features(void)
 {
 	const u32 em_rst = ~X86_CR0_EM;
@@ -360,6 +368,10 @@ static void setup_cpu_features(void)
 	"orl  %1, %%eax\n" \
 	"movl %%eax, %%cr0\n" \
 	: : "i" (em_rst), "i" (mp_ne_set) : "eax");
+
+	/* SSE is used by the SHA extensions and expected by EFI apps */
+	if (has_sse())
+		write_cr4(read_cr4() | X86_CR4_OSFXSR | X86_CR4_OSXMMEXCPT);
 }
 
 static void setup_identity(void)
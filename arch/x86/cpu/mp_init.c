@@ -507,6 +507,7 @@ int mp_init_cpu(struct udevice *cpu, void *unused)
 	 */
 	cpu->req_seq = fdtdec_get_int(gd->fdt_blob, dev_of_offset(cpu), "reg",
 				      -1);
+	device_reindex(cpu);
 	plat->ucode_version = microcode_read_rev();
 	plat->device_id = gd->arch.x86_device;
 
@@ -0,0 +1,434 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * SHA-1 and SHA-256 using the x86 SHA extensions (SHA-NI)
+ *
+ * The round sequences follow Intel's reference code, as used in Linux's
+ * arch/x86/crypto/sha1_ni_asm.S and sha256_ni_asm.S. Only %xmm0-7 are used
+ * so that the same code builds for 32-bit and 64-bit U-Boot.
+ */
+
+#include <common.h>
+#include <errno.h>
+#include <u-boot/sha1.h>
+#include <u-boot/sha256.h>
+#include <asm/control_regs.h>
+#include <asm/cpu.h>
+#include <asm/processor-flags.h>
+
+#define CPUID_1_ECX_SSSE3	(1 << 9)
+#define CPUID_1_ECX_SSE4_1	(1 << 19)
+#define CPUID_7_EBX_SHA		(1 << 29)
+
+/*
+ * U-Boot is built without SSE, so the compiler never keeps anything in %xmm
+ * registers and does not accept them as clobbers either
+ */
+#ifdef __SSE__
+#define SHA_NI_CLOBBERS	, "xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "xmm5", \
+			"xmm6", "xmm7"
+#else
+#define SHA_NI_CLOBBERS
+#endif
+
+/**
+ * sha_ni_available() - Check whether the SHA extensions can be used
+ *
+ * Besides the SHA instructions, the code needs SSSE3 and SSE4.1, and SSE
+ * must have been enabled in CR4.
+ *
+ * @return true if the SHA extensions can be used
+ */
+static bool sha_ni_available(void)
+{
+	const u32 ecx = CPUID_1_ECX_SSSE3 | CPUID_1_ECX_SSE4_1;
+
+	if (!(read_cr4() & X86_CR4_OSFXSR))
+		return false;
+	if (cpuid_eax(0) < 7)
+		return false;
+	if ((cpuid_ecx(1) & ecx) != ecx)
+		return false;
+
+	return cpuid_ext(7, 0).ebx & CPUID_7_EBX_SHA;
+}
+
+#ifdef CONFIG_SHA1
+static const u8 sha1_ni_mask[16] __aligned(16) = {
+	15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0
+};
+
+int sha1_process_arch(sha1_context *ctx, const unsigned char *data,
+		      unsigned int blocks)
+{
+	const unsigned char *end = data + blocks * 64;
+	u32 state[5];
+	u8 save[2][16];
+	int i;
+
+	if (!blocks || !sha_ni_available())
+		return -ENOSYS;
+
+	/* the context holds the state as unsigned long */
+	for (i = 0; i < 5; i++)
+		state[i] = ctx->state[i];
+
+	asm volatile(
+		"pxor %%xmm1, %%xmm1\n"
+		"pinsrd $3, 16(%[state]), %%xmm1\n"
+		"movdqu (%[state]), %%xmm0\n"
+		"pshufd $0x1b, %%xmm0, %%xmm0\n"
+		"movdqa 0(%[k]), %%xmm7\n"
+		"1:\n"
+		"movdqu %%xmm1, %[save0]\n"
+		"movdqu %%xmm0, %[save1]\n"
+		"movdqu 0(%[data]), %%xmm3\n"
+		"pshufb %%xmm7, %%xmm3\n"
+		"paddd %%xmm3, %%xmm1\n"
+		"movdqa %%xmm0, %%xmm2\n"
+		"sha1rnds4 $0, %%xmm1, %%xmm0\n"
+		"movdqu 16(%[data]), %%xmm4\n"
+		"pshufb %%xmm7, %%xmm4\n"
+		"sha1nexte %%xmm4, %%xmm2\n"
+		"movdqa %%xmm0, %%xmm1\n"
+		"sha1rnds4 $0, %%xmm2, %%xmm0\n"
+		"sha1msg1 %%xmm4, %%xmm3\n"
+		"movdqu 32(%[data]), %%xmm5\n"
+		"pshufb %%xmm7, %%xmm5\n"
+		"sha1nexte %%xmm5, %%xmm1\n"
+		"movdqa %%xmm0, %%xmm2\n"
+		"sha1rnds4 $0, %%xmm1, %%xmm0\n"
+		"sha1msg1 %%xmm5, %%xmm4\n"
+		"pxor %%xmm5, %%xmm3\n"
+		"movdqu 48(%[data]), %%xmm6\n"
+		"pshufb %%xmm7, %%xmm6\n"
+		"sha1nexte %%xmm6, %%xmm2\n"
+		"movdqa %%xmm0, %%xmm1\n"
+		"sha1msg2 %%xmm6, %%xmm3\n"
+		"sha1rnds4 $0, %%xmm2, %%xmm0\n"
+		"sha1msg1 %%xmm6, %%xmm5\n"
+		"pxor %%xmm6, %%xmm4\n"
+		"sha1nexte %%xmm3, %%xmm1\n"
+		"movdqa %%xmm0, %%xmm2\n"
+		"sha1msg2 %%xmm3, %%xmm4\n"
+		"sha1rnds4 $0, %%xmm1, %%xmm0\n"
+		"sha1msg1 %%xmm3, %%xmm6\n"
+		"pxor %%xmm3, %%xmm5\n"
+		"sha1nexte %%xmm4, %%xmm2\n"
+		"movdqa %%xmm0, %%xmm1\n"
+		"sha1msg2 %%xmm4, %%xmm5\n"
+		"sha1rnds4 $1, %%xmm2, %%xmm0\n"
+		"sha1msg1 %%xmm4, %%xmm3\n"
+		"pxor %%xmm4, %%xmm6\n"
+		"sha1nexte %%xmm5, %%xmm1\n"
+		"movdqa %%xmm0, %%xmm2\n"
+		"sha1msg2 %%xmm5, %%xmm6\n"
+		"sha1rnds4 $1, %%xmm1, %%xmm0\n"
+		"sha1msg1 %%xmm5, %%xmm4\n"
+		"pxor %%xmm5, %%xmm3\n"
+		"sha1nexte %%xmm6, %%xmm2\n"
+		"movdqa %%xmm0, %%xmm1\n"
+		"sha1msg2 %%xmm6, %%xmm3\n"
+		"sha1rnds4 $1, %%xmm2, %%xmm0\n"
+		"sha1msg1 %%xmm6, %%xmm5\n"
+		"pxor %%xmm6, %%xmm4\n"
+		"sha1nexte %%xmm3, %%xmm1\n"
+		"movdqa %%xmm0, %%xmm2\n"
+		"sha1msg2 %%xmm3, %%xmm4\n"
+		"sha1rnds4 $1, %%xmm1, %%xmm0\n"
+		"sha1msg1 %%xmm3, %%xmm6\n"
+		"pxor %%xmm3, %%xmm5\n"
+		"sha1nexte %%xmm4, %%xmm2\n"
+		"movdqa %%xmm0, %%xmm1\n"
+		"sha1msg2 %%xmm4, %%xmm5\n"
+		"sha1rnds4 $1, %%xmm2, %%xmm0\n"
+		"sha1msg1 %%xmm4, %%xmm3\n"
+		"pxor %%xmm4, %%xmm6\n"
+		"sha1nexte %%xmm5, %%xmm1\n"
+		"movdqa %%xmm0, %%xmm2\n"
+		"sha1msg2 %%xmm5, %%xmm6\n"
+		"sha1rnds4 $2, %%xmm1, %%xmm0\n"
+		"sha1msg1 %%xmm5, %%xmm4\n"
+		"pxor %%xmm5, %%xmm3\n"
+		"sha1nexte %%xmm6, %%xmm2\n"
+		"movdqa %%xmm0, %%xmm1\n"
+		"sha1msg2 %%xmm6, %%xmm3\n"
+		"sha1rnds4 $2, %%xmm2, %%xmm0\n"
+		"sha1msg1 %%xmm6, %%xmm5\n"
+		"pxor %%xmm6, %%xmm4\n"
+		"sha1nexte %%xmm3, %%xmm1\n"
+		"movdqa %%xmm0, %%xmm2\n"
+		"sha1msg2 %%xmm3, %%xmm4\n"
+		"sha1rnds4 $2, %%xmm1, %%xmm0\n"
+		"sha1msg1 %%xmm3, %%xmm6\n"
+		"pxor %%xmm3, %%xmm5\n"
+		"sha1nexte %%xmm4, %%xmm2\n"
+		"movdqa %%xmm0, %%xmm1\n"
+		"sha1msg2 %%xmm4, %%xmm5\n"
+		"sha1rnds4 $2, %%xmm2, %%xmm0\n"
+		"sha1msg1 %%xmm4, %%xmm3\n"
+		"pxor %%xmm4, %%xmm6\n"
+		"sha1nexte %%xmm5, %%xmm1\n"
+		"movdqa %%xmm0, %%xmm2\n"
+		"sha1msg2 %%xmm5, %%xmm6\n"
+		"sha1rnds4 $2, %%xmm1, %%xmm0\n"
+		"sha1msg1 %%xmm5, %%xmm4\n"
+		"pxor %%xmm5, %%xmm3\n"
+		"sha1nexte %%xmm6, %%xmm2\n"
+		"movdqa %%xmm0, %%xmm1\n"
+		"sha1msg2 %%xmm6, %%xmm3\n"
+		"sha1rnds4 $3, %%xmm2, %%xmm0\n"
+		"sha1msg1 %%xmm6, %%xmm5\n"
+		"pxor %%xmm6, %%xmm4\n"
+		"sha1nexte %%xmm3, %%xmm1\n"
+		"movdqa %%xmm0, %%xmm2\n"
+		"sha1msg2 %%xmm3, %%xmm4\n"
+		"sha1rnds4 $3, %%xmm1, %%xmm0\n"
+		"sha1msg1 %%xmm3, %%xmm6\n"
+		"pxor %%xmm3, %%xmm5\n"
+		"sha1nexte %%xmm4, %%xmm2\n"
+		"movdqa %%xmm0, %%xmm1\n"
+		"sha1msg2 %%xmm4, %%xmm5\n"
+		"sha1rnds4 $3, %%xmm2, %%xmm0\n"
+		"pxor %%xmm4, %%xmm6\n"
+		"sha1nexte %%xmm5, %%xmm1\n"
+		"movdqa %%xmm0, %%xmm2\n"
+		"sha1msg2 %%xmm5, %%xmm6\n"
+		"sha1rnds4 $3, %%xmm1, %%xmm0\n"
+		"sha1nexte %%xmm6, %%xmm2\n"
+		"movdqa %%xmm0, %%xmm1\n"
+		"sha1rnds4 $3, %%xmm2, %%xmm0\n"
+		"movdqu %[save0], %%xmm3\n"
+		"sha1nexte %%xmm3, %%xmm1\n"
+		"movdqu %[save1], %%xmm4\n"
+		"paddd %%xmm4, %%xmm0\n"
+		"add $64, %[data]\n"
+		"cmp %[end], %[data]\n"
+		"jne 1b\n"
+		"pshufd $0x1b, %%xmm0, %%xmm0\n"
+		"movdqu %%xmm0, (%[state])\n"
+		"pextrd $3, %%xmm1, 16(%[state])\n"
+		: [data] "+r" (data), [save0] "=m" (save[0]),
+		  [save1] "=m" (save[1])
+		: [state] "r" (state), [end] "r" (end), [k] "r" (sha1_ni_mask)
+		: "memory", "cc" SHA_NI_CLOBBERS);
+
+	for (i = 0; i < 5; i++)
+		ctx->state[i] = state[i];
+
+	return 0;
+}
+#endif
+
+#ifdef CONFIG_SHA256
+/* The round constants followed by the byte swap mask */
+static const u32 sha256_ni_k[64 + 4] __aligned(16) = {
+	0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5,
+	0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+	0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+	0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+	0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc,
+	0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+	0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
+	0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+	0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+	0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+	0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3,
+	0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+	0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5,
+	0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+	0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+	0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+	0x00010203, 0x04050607, 0x08090a0b, 0x0c0d0e0f
+};
+
+int sha256_process_arch(sha256_context *ctx, const uint8_t *data,
+			uint32_t blocks)
+{
+	const uint8_t *end = data + blocks * 64;
+	u8 save[2][16];
+
+	if (!blocks || !sha_ni_available())
+		return -ENOSYS;
+
+	asm volatile(
+		"movdqu (%[state]), %%xmm1\n"
+		"movdqu 16(%[state]), %%xmm2\n"
+		"pshufd $0xb1, %%xmm1, %%xmm1\n"
+		"pshufd $0x1b, %%xmm2, %%xmm2\n"
+		"movdqa %%xmm1, %%xmm7\n"
+		"palignr $8, %%xmm2, %%xmm1\n"
+		"pblendw $0xf0, %%xmm7, %%xmm2\n"
+		"1:\n"
+		"movdqu %%xmm1, %[save0]\n"
+		"movdqu %%xmm2, %[save1]\n"
+		"movdqa 256(%[k]), %%xmm7\n"
+		"movdqu 0(%[data]), %%xmm0\n"
+		"pshufb %%xmm7, %%xmm0\n"
+		"movdqa %%xmm0, %%xmm3\n"
+		"paddd 0(%[k]), %%xmm0\n"
+		"sha256rnds2 %%xmm1, %%xmm2\n"
+		"pshufd $0x0e, %%xmm0, %%xmm0\n"
+		"sha256rnds2 %%xmm2, %%xmm1\n"
+		"movdqu 16(%[data]), %%xmm0\n"
+		"pshufb %%xmm7, %%xmm0\n"
+		"movdqa %%xmm0, %%xmm4\n"
+		"paddd 16(%[k]), %%xmm0\n"
+		"sha256rnds2 %%xmm1, %%xmm2\n"
+		"pshufd $0x0e, %%xmm0, %%xmm0\n"
+		"sha256rnds2 %%xmm2, %%xmm1\n"
+		"sha256msg1 %%xmm4, %%xmm3\n"
+		"movdqu 32(%[data]), %%xmm0\n"
+		"pshufb %%xmm7, %%xmm0\n"
+		"movdqa %%xmm0, %%xmm5\n"
+		"paddd 32(%[k]), %%xmm0\n"
+		"sha256rnds2 %%xmm1, %%xmm2\n"
+		"pshufd $0x0e, %%xmm0, %%xmm0\n"
+		"sha256rnds2 %%xmm2, %%xmm1\n"
+		"sha256msg1 %%xmm5, %%xmm4\n"
+		"movdqu 48(%[data]), %%xmm0\n"
+		"pshufb %%xmm7, %%xmm0\n"
+		"movdqa %%xmm0, %%xmm6\n"
+		"paddd 48(%[k]), %%xmm0\n"
+		"sha256rnds2 %%xmm1, %%xmm2\n"
+		"movdqa %%xmm6, %%xmm7\n"
+		"palignr $4, %%xmm5, %%xmm7\n"
+		"paddd %%xmm7, %%xmm3\n"
+		"sha256msg2 %%xmm6, %%xmm3\n"
+		"pshufd $0x0e, %%xmm0, %%xmm0\n"
+		"sha256rnds2 %%xmm2, %%xmm1\n"
+		"sha256msg1 %%xmm6, %%xmm5\n"
+		"movdqa %%xmm3, %%xmm0\n"
+		"paddd 64(%[k]), %%xmm0\n"
+		"sha256rnds2 %%xmm1, %%xmm2\n"
+		"movdqa %%xmm3, %%xmm7\n"
+		"palignr $4, %%xmm6, %%xmm7\n"
+		"paddd %%xmm7, %%xmm4\n"
+		"sha256msg2 %%xmm3, %%xmm4\n"
+		"pshufd $0x0e, %%xmm0, %%xmm0\n"
+		"sha256rnds2 %%xmm2, %%xmm1\n"
+		"sha256msg1 %%xmm3, %%xmm6\n"
+		"movdqa %%xmm4, %%xmm0\n"
+		"paddd 80(%[k]), %%xmm0\n"
+		"sha256rnds2 %%xmm1, %%xmm2\n"
+		"movdqa %%xmm4, %%xmm7\n"
+		"palignr $4, %%xmm3, %%xmm7\n"
+		"paddd %%xmm7, %%xmm5\n"
+		"sha256msg2 %%xmm4, %%xmm5\n"
+		"pshufd $0x0e, %%xmm0, %%xmm0\n"
+		"sha256rnds2 %%xmm2, %%xmm1\n"
+		"sha256msg1 %%xmm4, %%xmm3\n"
+		"movdqa %%xmm5, %%xmm0\n"
+		"paddd 96(%[k]), %%xmm0\n"
+		"sha256rnds2 %%xmm1, %%xmm2\n"
+		"movdqa %%xmm5, %%xmm7\n"
+		"palignr $4, %%xmm4, %%xmm7\n"
+		"paddd %%xmm7, %%xmm6\n"
+		"sha256msg2 %%xmm5, %%xmm6\n"
+		"pshufd $0x0e, %%xmm0, %%xmm0\n"
+		"sha256rnds2 %%xmm2, %%xmm1\n"
+		"sha256msg1 %%xmm5, %%xmm4\n"
+		"movdqa %%xmm6, %%xmm0\n"
+		"paddd 112(%[k]), %%xmm0\n"
+		"sha256rnds2 %%xmm1, %%xmm2\n"
+		"movdqa %%xmm6, %%xmm7\n"
+		"palignr $4, %%xmm5, %%xmm7\n"
+		"paddd %%xmm7, %%xmm3\n"
+		"sha256msg2 %%xmm6, %%xmm3\n"
+		"pshufd $0x0e, %%xmm0, %%xmm0\n"
+		"sha256rnds2 %%xmm2, %%xmm1\n"
+		"sha256msg1 %%xmm6, %%xmm5\n"
+		"movdqa %%xmm3, %%xmm0\n"
+		"paddd 128(%[k]), %%xmm0\n"
+		"sha256rnds2 %%xmm1, %%xmm2\n"
+		"movdqa %%xmm3, %%xmm7\n"
+		"palignr $4, %%xmm6, %%xmm7\n"
+		"paddd %%xmm7, %%xmm4\n"
+		"sha256msg2 %%xmm3, %%xmm4\n"
+		"pshufd $0x0e, %%xmm0, %%xmm0\n"
+		"sha256rnds2 %%xmm2, %%xmm1\n"
+		"sha256msg1 %%xmm3, %%xmm6\n"
+		"movdqa %%xmm4, %%xmm0\n"
+		"paddd 144(%[k]), %%xmm0\n"
+		"sha256rnds2 %%xmm1, %%xmm2\n"
+		"movdqa %%xmm4, %%xmm7\n"
+		"palignr $4, %%xmm3, %%xmm7\n"
+		"paddd %%xmm7, %%xmm5\n"
+		"sha256msg2 %%xmm4, %%xmm5\n"
+		"pshufd $0x0e, %%xmm0, %%xmm0\n"
+		"sha256rnds2 %%xmm2, %%xmm1\n"
+		"sha256msg1 %%xmm4, %%xmm3\n"
+		"movdqa %%xmm5, %%xmm0\n"
+		"paddd 160(%[k]), %%xmm0\n"
+		"sha256rnds2 %%xmm1, %%xmm2\n"
+		"movdqa %%xmm5, %%xmm7\n"
+		"palignr $4, %%xmm4, %%xmm7\n"
+		"paddd %%xmm7, %%xmm6\n"
+		"sha256msg2 %%xmm5, %%xmm6\n"
+		"pshufd $0x0e, %%xmm0, %%xmm0\n"
+		"sha256rnds2 %%xmm2, %%xmm1\n"
+		"sha256msg1 %%xmm5, %%xmm4\n"
+		"movdqa %%xmm6, %%xmm0\n"
+		"paddd 176(%[k]), %%xmm0\n"
+		"sha256rnds2 %%xmm1, %%xmm2\n"
+		"movdqa %%xmm6, %%xmm7\n"
+		"palignr $4, %%xmm5, %%xmm7\n"
+		"paddd %%xmm7, %%xmm3\n"
+		"sha256msg2 %%xmm6, %%xmm3\n"
+		"pshufd $0x0e, %%xmm0, %%xmm0\n"
+		"sha256rnds2 %%xmm2, %%xmm1\n"
+		"sha256msg1 %%xmm6, %%xmm5\n"
+		"movdqa %%xmm3, %%xmm0\n"
+		"paddd 192(%[k]), %%xmm0\n"
+		"sha256rnds2 %%xmm1, %%xmm2\n"
+		"movdqa %%xmm3, %%xmm7\n"
+		"palignr $4, %%xmm6, %%xmm7\n"
+		"paddd %%xmm7, %%xmm4\n"
+		"sha256msg2 %%xmm3, %%xmm4\n"
+		"pshufd $0x0e, %%xmm0, %%xmm0\n"
+		"sha256rnds2 %%xmm2, %%xmm1\n"
+		"sha256msg1 %%xmm3, %%xmm6\n"
+		"movdqa %%xmm4, %%xmm0\n"
+		"paddd 208(%[k]), %%xmm0\n"
+		"sha256rnds2 %%xmm1, %%xmm2\n"
+		"movdqa %%xmm4, %%xmm7\n"
+		"palignr $4, %%xmm3, %%xmm7\n"
+		"paddd %%xmm7, %%xmm5\n"
+		"sha256msg2 %%xmm4, %%xmm5\n"
+		"pshufd $0x0e, %%xmm0, %%xmm0\n"
+		"sha256rnds2 %%xmm2, %%xmm1\n"
+		"movdqa %%xmm5, %%xmm0\n"
+		"paddd 224(%[k]), %%xmm0\n"
+		"sha256rnds2 %%xmm1, %%xmm2\n"
+		"movdqa %%xmm5, %%xmm7\n"
+		"palignr $4, %%xmm4, %%xmm7\n"
+		"paddd %%xmm7, %%xmm6\n"
+		"sha256msg2 %%xmm5, %%xmm6\n"
+		"pshufd $0x0e, %%xmm0, %%xmm0\n"
+		"sha256rnds2 %%xmm2, %%xmm1\n"
+		"movdqa %%xmm6, %%xmm0\n"
+		"paddd 240(%[k]), %%xmm0\n"
+		"sha256rnds2 %%xmm1, %%xmm2\n"
+		"pshufd $0x0e, %%xmm0, %%xmm0\n"
+		"sha256rnds2 %%xmm2, %%xmm1\n"
+		"movdqu %[save0], %%xmm3\n"
+		"paddd %%xmm3, %%xmm1\n"
+		"movdqu %[save1], %%xmm4\n"
+		"paddd %%xmm4, %%xmm2\n"
+		"add $64, %[data]\n"
+		"cmp %[end], %[data]\n"
+		"jne 1b\n"
+		"pshufd $0x1b, %%xmm1, %%xmm1\n"
+		"pshufd $0xb1, %%xmm2, %%xmm2\n"
+		"movdqa %%xmm1, %%xmm7\n"
+		"pblendw $0xf0, %%xmm2, %%xmm1\n"
+		"palignr $8, %%xmm7, %%xmm2\n"
+		"movdqu %%xmm1, (%[state])\n"
+		"movdqu %%xmm2, 16(%[state])\n"
+		: [data] "+r" (data), [save0] "=m" (save[0]),
+		  [save1] "=m" (save[1])
+		: [state] "r" (ctx->state), [end] "r" (end), [k] "r" (sha256_ni_k)
+		: "memory", "cc" SHA_NI_CLOBBERS);
+
+	return 0;
+}
+#endif
@@ -18,7 +18,7 @@ static int blkc_show(cmd_tbl_t *cmdtp, int flag,
 	printf("hits: %u\n"
 	       "misses: %u\n"
 	       "entries: %u\n"
-	       "max blocks/entry: %u\n"
+	       "max blocks/request: %u\n"
 	       "max cache entries: %u\n",
 	       stats.hits, stats.misses, stats.entries,
 	       stats.max_blocks_per_entry, stats.max_entries);
@@ -35,14 +35,24 @@ static int blkc_configure(cmd_tbl_t *cmdtp, int flag,
 	blocks_per_entry = simple_strtoul(argv[1], 0, 0);
 	max_entries = simple_strtoul(argv[2], 0, 0);
 	blkcache_configure(blocks_per_entry, max_entries);
-	printf("changed to max of %u entries of %u blocks each\n",
-	       max_entries, blocks_per_entry);
+	printf("changed to max of %u entries, caching requests of up to "
+	       "%u blocks\n", max_entries, blocks_per_entry);
+	return 0;
+}
+
+static int blkc_flush(cmd_tbl_t *cmdtp, int flag,
+		      int argc, char * const argv[])
+{
+	if (blkcache_flush_all())
+		return CMD_RET_FAILURE;
+
 	return 0;
 }
 
 static cmd_tbl_t cmd_blkc_sub[] = {
 	U_BOOT_CMD_MKENT(show, 0, 0, blkc_show, "", ""),
 	U_BOOT_CMD_MKENT(configure, 3, 0, blkc_configure, "", ""),
+	U_BOOT_CMD_MKENT(flush, 0, 0, blkc_flush, "", ""),
 };
 
 static __maybe_unused void blkc_reloc(void)
@@ -83,4 +93,5 @@ U_BOOT_CMD(
 	"block cache diagnostics and control",
 	"show - show and reset statistics\n"
 	"blkcache configure blocks entries\n"
+	"blkcache flush - write back cached writes\n"
 );
@@ -16,6 +16,7 @@
 #include <linux/libfdt.h>
 #include <fdt_support.h>
 #include <mapmem.h>
+#include <of_live.h>
 #include <asm/io.h>
 
 #define MAX_LEVEL	32		/* how deeply nested we will go */
@@ -448,6 +449,31 @@ static int do_fdt(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
 			}
 		}
 
+#ifdef CONFIG_OF_LIVE_IMAGE
+	/*
+	 * Make a live-tree image of the control fdt
+	 */
+	} else if (strncmp(argv[1], "live", 4) == 0) {
+		ulong addr, size = ULONG_MAX;
+		int ret;
+
+		if (argc < 3)
+			return CMD_RET_USAGE;
+		addr = simple_strtoul(argv[2], NULL, 16);
+		if (argc > 3)
+			size = simple_strtoul(argv[3], NULL, 16);
+		ret = of_live_image_make(gd->fdt_blob, map_sysmem(addr, 0),
+					 &size);
+		if (ret) {
+			printf("Cannot make live-tree image (err=%d)\n", ret);
+			if (ret == -ENOSPC)
+				printf("It needs %#lx bytes\n", size);
+			return CMD_RET_FAILURE;
+		}
+		printf("Live-tree image: %#lx bytes\n", size);
+		env_set_hex("filesize", size);
+#endif
+
 	/*
 	 * Print (recursive) / List (single level)
 	 */
@@ -1116,6 +1142,9 @@ static char fdt_help_text[] =
 #endif
 #ifdef CONFIG_OF_SYSTEM_SETUP
 	"fdt systemsetup                     - Do system-specific set up\n"
+#endif
+#ifdef CONFIG_OF_LIVE_IMAGE
+	"fdt liveimage <addr> [<length>]     - Write a live-tree image of the control fdt to <addr>\n"
 #endif
 	"fdt move   <fdt> <newaddr> <length> - Copy the fdt to <addr> and make it active\n"
 	"fdt resize [<extrasize>]            - Resize fdt to size + padding to 4k addr + some optional <extrasize> if needed\n"
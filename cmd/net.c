@@ -12,6 +12,7 @@
 #include <env.h>
 #include <image.h>
 #include <net.h>
+#include <net/wget.h>
 
 static int netboot_common(enum proto_t, cmd_tbl_t *, int, char * const []);
 
@@ -115,6 +116,52 @@ U_BOOT_CMD(
 );
 #endif
 
+#if defined(CONFIG_CMD_WGET)
+static int do_wget(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
+{
+	struct blk_desc *desc;
+	lbaint_t blk;
+	int ret;
+
+	if (argc < 2 || strcmp(argv[1], "-b")) {
+		if (argc > 3)
+			return CMD_RET_USAGE;
+		return netboot_common(WGET, cmdtp, argc, argv);
+	}
+
+	/* Stream the file to a block device */
+	if (argc < 5 || argc > 6)
+		return CMD_RET_USAGE;
+	if (blk_get_device_by_str(argv[2], argv[3], &desc) < 0)
+		return CMD_RET_FAILURE;
+	blk = simple_strtoul(argv[4], NULL, 16);
+
+	if (argc == 6) {
+		net_boot_file_name_explicit = true;
+		copy_filename(net_boot_file_name, argv[5],
+			      sizeof(net_boot_file_name));
+	} else {
+		net_boot_file_name_explicit = false;
+		copy_filename(net_boot_file_name, env_get("bootfile"),
+			      sizeof(net_boot_file_name));
+	}
+
+	wget_set_blk_target(desc, blk);
+	ret = net_loop(WGET);
+	wget_set_blk_target(NULL, 0);
+
+	return ret < 0 ? CMD_RET_FAILURE : CMD_RET_SUCCESS;
+}
+
+U_BOOT_CMD(
+	wget,	6,	1,	do_wget,
+	"load a file via network using HTTP",
+	"[loadAddress] [[hostIPaddr:]path]\n"
+	"wget -b <interface> <dev[.hwpart]> <blk#> [[hostIPaddr:]path]\n"
+	"    - write the file to a block device, starting at block blk# (hex)"
+);
+#endif
+
 static void netboot_update_env(void)
 {
 	char tmp[22];
@@ -6,6 +6,7 @@
 
 #include <common.h>
 #include <command.h>
+#include <decomp_write.h>
 #include <env.h>
 #include <gzip.h>
 
@@ -51,6 +52,7 @@ static int do_gzwrite(cmd_tbl_t *cmdtp, int flag,
 	unsigned long writebuf = 1<<20;
 	u64 startoffs = 0;
 	u64 szexpected = 0;
+	int comp;
 
 	if (argc < 5)
 		return CMD_RET_USAGE;
@@ -71,7 +73,18 @@ static int do_gzwrite(cmd_tbl_t *cmdtp, int flag,
 		}
 	}
 
-	ret = gzwrite(addr, length, bdev, writebuf, startoffs, szexpected);
+	if (!strcmp(cmdtp->name, "gzwrite")) {
+		ret = gzwrite(addr, length, bdev, writebuf, startoffs,
+			      szexpected);
+	} else {
+		comp = decomp_write_detect(addr, length);
+		if (comp < 0) {
+			puts("Unknown compression format\n");
+			return CMD_RET_FAILURE;
+		}
+		ret = decomp_write(comp, addr, length, bdev, writebuf,
+				   startoffs, szexpected);
+	}
 
 	return ret ? CMD_RET_FAILURE : CMD_RET_SUCCESS;
 }
@@ -87,3 +100,11 @@ U_BOOT_CMD(
 	"\t\tand is required for files with uncompressed lengths\n"
 	"\t\t4 GiB or larger\n"
 );
+
+U_BOOT_CMD(
+	decompwrite, 8, 0, do_gzwrite,
+	"decompress and write memory to block device",
+	"<interface> <dev> <addr> length [wbuf=1M [offs=0 [outsize=0]]]\n"
+	"\tas gzwrite, for gzip, zstd, lz4, lzma or bzip2 images;\n"
+	"\tthe format is worked out from the image\n"
+);
@@ -308,6 +308,7 @@ static int initr_dm(void)
 	/* Save the pre-reloc driver model and start a new one */
 	gd->dm_root_f = gd->dm_root;
 	gd->dm_root = NULL;
+	gd->driver_index = NULL;
 #ifdef CONFIG_TIMER
 	gd->timer = NULL;
 #endif
@@ -6,6 +6,7 @@
 
 #ifndef USE_HOSTCC
 #include <common.h>
+#include <blk.h>
 #include <bootstage.h>
 #include <cpu_func.h>
 #include <env.h>
@@ -15,6 +16,7 @@
 #include <lmb.h>
 #include <malloc.h>
 #include <mapmem.h>
+#include <mp_work.h>
 #include <asm/io.h>
 #if defined(CONFIG_CMD_USB)
 #include <usb.h>
@@ -245,7 +247,7 @@ int bootm_find_images(int flag, int argc, char * const argv[])
 			       &images.rd_start, &images.rd_end);
 	if (ret) {
 		puts("Ramdisk image is corrupt or invalid\n");
-		return 1;
+		goto err;
 	}
 
 #if IMAGE_ENABLE_OF_LIBFDT
@@ -254,7 +256,7 @@ int bootm_find_images(int flag, int argc, char * const argv[])
 			   &images.ft_addr, &images.ft_len);
 	if (ret) {
 		puts("Could not find a valid device tree\n");
-		return 1;
+		goto err;
 	}
 	if (CONFIG_IS_ENABLED(CMD_FDT))
 		set_working_fdt_addr(map_to_sysmem(images.ft_addr));
@@ -267,7 +269,7 @@ int bootm_find_images(int flag, int argc, char * const argv[])
 			    NULL, NULL);
 	if (ret) {
 		printf("FPGA image is corrupted or invalid\n");
-		return 1;
+		goto err;
 	}
 #endif
 
@@ -276,11 +278,15 @@ int bootm_find_images(int flag, int argc, char * const argv[])
 			       NULL, NULL);
 	if (ret) {
 		printf("Loadable(s) is corrupt or invalid\n");
-		return 1;
+		goto err;
 	}
 #endif
 
-	return 0;
+err:
+	/* parallel hash results are only for the images loaded above */
+	fit_prehash_clear(&images);
+
+	return ret ? 1 : 0;
 }
 
 static int bootm_find_other(cmd_tbl_t *cmdtp, int flag, int argc,
@@ -293,6 +299,8 @@ static int bootm_find_other(cmd_tbl_t *cmdtp, int flag, int argc,
 		 images.os.os == IH_OS_VXWORKS))
 		return bootm_find_images(flag, argc, argv);
 
+	fit_prehash_clear(&images);
+
 	return 0;
 }
 #endif /* USE_HOSTC */
@@ -338,6 +346,87 @@ static int handle_decomp_error(int comp_type, size_t uncomp_size, int ret)
 #endif
 
 #ifndef USE_HOSTCC
+#ifdef CONFIG_FIT_STREAM_VERIFY
+/**
+ * bootm_verify_os() - Check the OS hashes, if fit_image_load() deferred it
+ *
+ * This is used if the OS was not loaded by bootm_load_os(), which normally
+ * checks the hashes.
+ *
+ * @images:	Images being booted
+ * @return 0 if OK, -EACCES if the OS image is corrupted
+ */
+static int bootm_verify_os(bootm_headers_t *images)
+{
+	if (!images->fit_os_hash_pending)
+		return 0;
+
+	puts("   Verifying Hash Integrity ... ");
+	if (!fit_image_verify(images->fit_hdr_os, images->fit_noffset_os)) {
+		puts("Bad Data Hash\n");
+		bootstage_error(BOOTSTAGE_ID_FIT_KERNEL_START +
+				BOOTSTAGE_SUB_HASH);
+		return -EACCES;
+	}
+	puts("OK\n");
+	images->fit_os_hash_pending = 0;
+
+	return 0;
+}
+
+/**
+ * bootm_decomp_hashed() - Load the OS, checking its hashes at the same time
+ *
+ * The OS image data is read once, to hash and decompress it together.
+ *
+ * @images:	Images being booted
+ * @load_buf:	Place to decompress to
+ * @image_buf:	OS image data
+ * @load_end:	Returns the end of the loaded OS
+ * @return 0 if OK, -EACCES if the OS image is corrupted, other -ve value on
+ *	decompression error
+ */
+static int bootm_decomp_hashed(bootm_headers_t *images, void *load_buf,
+			       void *image_buf, ulong *load_end)
+{
+	image_info_t *os = &images->os;
+	struct fit_hash_stream hs;
+	int err, ret;
+
+	*load_end = os->load;
+	if (fit_image_hash_stream_start(images->fit_hdr_os,
+					images->fit_noffset_os, &hs)) {
+		err = bootm_verify_os(images);
+		if (err)
+			return err;
+		return image_decomp(os->comp, os->load, os->image_start,
+				    os->type, load_buf, image_buf,
+				    os->image_len, CONFIG_SYS_BOOTM_LEN,
+				    load_end);
+	}
+
+	err = image_decomp_hashed(os->comp, os->load, os->image_start,
+				  os->type, load_buf, image_buf, os->image_len,
+				  CONFIG_SYS_BOOTM_LEN, load_end, &hs);
+	puts("   Verifying Hash Integrity ... ");
+	ret = fit_image_hash_stream_finish(&hs);
+	if (err) {
+		puts("\n");
+		return err;
+	}
+	if (ret) {
+		puts("Bad Data Hash\n");
+		bootstage_error(BOOTSTAGE_ID_FIT_KERNEL_START +
+				BOOTSTAGE_SUB_HASH);
+		return -EACCES;
+	}
+	puts("OK\n");
+	images->fit_os_hash_pending = 0;
+
+	return 0;
+}
+#endif
+
 static int bootm_load_os(bootm_headers_t *images, int boot_progress)
 {
 	image_info_t os = images->os;
@@ -354,6 +443,14 @@ static int bootm_load_os(bootm_headers_t *images, int boot_progress)
 
 	load_buf = map_sysmem(load, 0);
 	image_buf = map_sysmem(os.image_start, image_len);
+#ifdef CONFIG_FIT_STREAM_VERIFY
+	if (images->fit_os_hash_pending) {
+		err = bootm_decomp_hashed(images, load_buf, image_buf,
+					  &load_end);
+		if (err == -EACCES)
+			return err;
+	} else
+#endif
 	err = image_decomp(os.comp, load, os.image_start, os.type,
 			   load_buf, image_buf, image_len,
 			   CONFIG_SYS_BOOTM_LEN, &load_end);
@@ -430,6 +527,9 @@ ulong bootm_disable_interrupts(void)
 	 */
 	usb_stop();
 #endif
+	/* Blocks held back by the block cache must reach the device now */
+	blkcache_flush_all();
+
 	return iflag;
 }
 
@@ -588,6 +688,15 @@ int do_bootm_states(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[],
 	}
 
 
+#ifdef CONFIG_FIT_STREAM_VERIFY
+	/* Never start an OS whose hashes have not been checked */
+	if (need_boot_fn) {
+		ret = bootm_verify_os(images);
+		if (ret)
+			goto err;
+	}
+#endif
+
 	/* Call various other states that are not generally used */
 	if (!ret && (states & BOOTM_STATE_OS_CMDLINE))
 		ret = boot_fn(BOOTM_STATE_OS_CMDLINE, argc, argv, images);
@@ -626,6 +735,9 @@ int do_bootm_states(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[],
 
 	/* Deal with any fallout */
 err:
+	fit_prehash_clear(images);
+	/* don't leave secondary CPUs running U-Boot code */
+	mp_work_park();
 	if (iflag)
 		enable_interrupts();
 
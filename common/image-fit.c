@@ -18,6 +18,7 @@
 #include <common.h>
 #include <errno.h>
 #include <mapmem.h>
+#include <mp_work.h>
 #include <asm/io.h>
 #include <malloc.h>
 DECLARE_GLOBAL_DATA_PTR;
@@ -30,6 +31,7 @@ DECLARE_GLOBAL_DATA_PTR;
 #include <u-boot/md5.h>
 #include <u-boot/sha1.h>
 #include <u-boot/sha256.h>
+#include <u-boot/sha512.h>
 
 /*****************************************************************************/
 /* New uImage format routines */
@@ -1204,6 +1206,14 @@ int calculate_hash(const void *data, int data_len, const char *algo,
 		sha256_csum_wd((unsigned char *)data, data_len,
 			       (unsigned char *)value, CHUNKSZ_SHA256);
 		*value_len = SHA256_SUM_LEN;
+	} else if (IMAGE_ENABLE_SHA384 && strcmp(algo, "sha384") == 0) {
+		sha384_csum_wd((unsigned char *)data, data_len,
+			       (unsigned char *)value, CHUNKSZ_SHA384);
+		*value_len = SHA384_SUM_LEN;
+	} else if (IMAGE_ENABLE_SHA512 && strcmp(algo, "sha512") == 0) {
+		sha512_csum_wd((unsigned char *)data, data_len,
+			       (unsigned char *)value, CHUNKSZ_SHA512);
+		*value_len = SHA512_SUM_LEN;
 	} else if (IMAGE_ENABLE_MD5 && strcmp(algo, "md5") == 0) {
 		md5_wd((unsigned char *)data, data_len, value, CHUNKSZ_MD5);
 		*value_len = 16;
@@ -1214,31 +1224,15 @@ int calculate_hash(const void *data, int data_len, const char *algo,
 	return 0;
 }
 
-static int fit_image_check_hash(const void *fit, int noffset, const void *data,
-				size_t size, char **err_msgp)
+/* Compare the hash in a hash node against the data, without printing */
+static int fit_image_compare_hash(const void *fit, int noffset,
+				  const char *algo, const void *data,
+				  size_t size, char **err_msgp)
 {
 	uint8_t value[FIT_MAX_HASH_LEN];
 	int value_len;
-	char *algo;
 	uint8_t *fit_value;
 	int fit_value_len;
-	int ignore;
-
-	*err_msgp = NULL;
-
-	if (fit_image_hash_get_algo(fit, noffset, &algo)) {
-		*err_msgp = "Can't get hash algo property";
-		return -1;
-	}
-	printf("%s", algo);
-
-	if (IMAGE_ENABLE_IGNORE) {
-		fit_image_hash_get_ignore(fit, noffset, &ignore);
-		if (ignore) {
-			printf("-skipped ");
-			return 0;
-		}
-	}
 
 	if (fit_image_hash_get_value(fit, noffset, &fit_value,
 				     &fit_value_len)) {
@@ -1262,6 +1256,32 @@ static int fit_image_check_hash(const void *fit, int noffset, const void *data,
 	return 0;
 }
 
+static int fit_image_check_hash(const void *fit, int noffset, const void *data,
+				size_t size, char **err_msgp)
+{
+	char *algo;
+	int ignore;
+
+	*err_msgp = NULL;
+
+	if (fit_image_hash_get_algo(fit, noffset, &algo)) {
+		*err_msgp = "Can't get hash algo property";
+		return -1;
+	}
+	printf("%s", algo);
+
+	if (IMAGE_ENABLE_IGNORE) {
+		fit_image_hash_get_ignore(fit, noffset, &ignore);
+		if (ignore) {
+			printf("-skipped ");
+			return 0;
+		}
+	}
+
+	return fit_image_compare_hash(fit, noffset, algo, data, size,
+				      err_msgp);
+}
+
 int fit_image_verify_with_data(const void *fit, int image_noffset,
 			       const void *data, size_t size)
 {
@@ -1358,6 +1378,311 @@ int fit_image_verify(const void *fit, int image_noffset)
 	return fit_image_verify_with_data(fit, image_noffset, data, size);
 }
 
+#if (defined(CONFIG_FIT_STREAM_VERIFY) || \
+     defined(CONFIG_FIT_PARALLEL_VERIFY)) && !defined(USE_HOSTCC)
+/* Check for keys which require every image to be signed */
+static bool fit_image_sigs_required(void)
+{
+	const void *sig_blob = gd_fdt_blob();
+	int sig_node, noffset;
+
+	if (!IMAGE_ENABLE_VERIFY || !sig_blob)
+		return false;
+	sig_node = fdt_subnode_offset(sig_blob, 0, FIT_SIG_NODENAME);
+	if (sig_node < 0)
+		return false;
+	fdt_for_each_subnode(noffset, sig_blob, sig_node) {
+		const char *required;
+
+		required = fdt_getprop(sig_blob, noffset, FIT_KEY_REQUIRED,
+				       NULL);
+		if (required && !strcmp(required, "image"))
+			return true;
+	}
+
+	return false;
+}
+#endif
+
+#if defined(CONFIG_FIT_STREAM_VERIFY) && !defined(USE_HOSTCC)
+bool fit_image_hash_stream_supported(const void *fit, int image_noffset)
+{
+	struct hash_algo *algo;
+	int noffset, count = 0;
+	int ignore;
+	char *name;
+
+	if (fit_image_sigs_required())
+		return false;
+
+	fdt_for_each_subnode(noffset, fit, image_noffset) {
+		const char *node = fit_get_name(fit, noffset, NULL);
+
+		if (!strncmp(node, FIT_SIG_NODENAME,
+			     strlen(FIT_SIG_NODENAME)) ||
+		    !strncmp(node, FIT_CIPHER_NODENAME,
+			     strlen(FIT_CIPHER_NODENAME)))
+			return false;
+		if (strncmp(node, FIT_HASH_NODENAME, strlen(FIT_HASH_NODENAME)))
+			continue;
+		fit_image_hash_get_ignore(fit, noffset, &ignore);
+		if (ignore)
+			continue;
+		if (fit_image_hash_get_algo(fit, noffset, &name) ||
+		    hash_progressive_lookup_algo(name, &algo) ||
+		    ++count > FIT_HASH_STREAM_MAX)
+			return false;
+	}
+
+	return count > 0;
+}
+
+int fit_image_hash_stream_start(const void *fit, int image_noffset,
+				struct fit_hash_stream *hs)
+{
+	int noffset;
+	int ignore;
+	char *name;
+
+	if (!fit_image_hash_stream_supported(fit, image_noffset))
+		return -ENOSYS;
+
+	memset(hs, '\0', sizeof(*hs));
+	hs->fit = fit;
+	fdt_for_each_subnode(noffset, fit, image_noffset) {
+		const char *node = fit_get_name(fit, noffset, NULL);
+		struct hash_algo *algo;
+
+		if (strncmp(node, FIT_HASH_NODENAME, strlen(FIT_HASH_NODENAME)))
+			continue;
+		fit_image_hash_get_ignore(fit, noffset, &ignore);
+		if (ignore)
+			continue;
+		fit_image_hash_get_algo(fit, noffset, &name);
+		hash_progressive_lookup_algo(name, &algo);
+		if (algo->hash_init(algo, &hs->ctx[hs->count]))
+			hs->err = -EIO;
+		hs->noffset[hs->count] = noffset;
+		hs->algo[hs->count] = algo;
+		hs->count++;
+	}
+
+	return 0;
+}
+
+void fit_image_hash_stream_update(struct fit_hash_stream *hs, const void *buf,
+				  ulong len)
+{
+	struct hash_algo *algo;
+	int i;
+
+	for (i = 0; i < hs->count; i++) {
+		algo = hs->algo[i];
+		if (hs->ctx[i] &&
+		    algo->hash_update(algo, hs->ctx[i], buf, len, 0))
+			hs->err = -EIO;
+	}
+}
+
+int fit_image_hash_stream_finish(struct fit_hash_stream *hs)
+{
+	uint8_t value[FIT_MAX_HASH_LEN];
+	uint8_t *fit_value;
+	int fit_value_len;
+	struct hash_algo *algo;
+	int ret = hs->err;
+	int i;
+
+	for (i = 0; i < hs->count; i++) {
+		algo = hs->algo[i];
+		printf("%s", algo->name);
+		if (!hs->ctx[i] ||
+		    algo->hash_finish(algo, hs->ctx[i], value, sizeof(value)) ||
+		    fit_image_hash_get_value(hs->fit, hs->noffset[i],
+					     &fit_value, &fit_value_len)) {
+			ret = -EIO;
+			continue;
+		}
+		/* FIT stores CRC32 values in big-endian order */
+		if (!strcmp(algo->name, "crc32"))
+			*(uint32_t *)value = cpu_to_uimage(*(uint32_t *)value);
+		if (fit_value_len != algo->digest_size ||
+		    memcmp(value, fit_value, fit_value_len)) {
+			puts("- ");
+			ret = -EACCES;
+		} else {
+			puts("+ ");
+		}
+	}
+
+	return ret ? -EACCES : 0;
+}
+#endif /* CONFIG_FIT_STREAM_VERIFY && !USE_HOSTCC */
+
+#if defined(CONFIG_FIT_PARALLEL_VERIFY) && !defined(USE_HOSTCC) && \
+	!defined(CONFIG_SPL_BUILD)
+struct fit_prehash_job {
+	const void *fit;
+	int noffset;
+};
+
+/* Check whether an image can be verified by a job on another CPU */
+static bool fit_image_prehash_supported(const void *fit, int image_noffset)
+{
+	int noffset, count = 0;
+	int ignore;
+
+	fdt_for_each_subnode(noffset, fit, image_noffset) {
+		const char *node = fit_get_name(fit, noffset, NULL);
+
+		if (!strncmp(node, FIT_SIG_NODENAME,
+			     strlen(FIT_SIG_NODENAME)) ||
+		    !strncmp(node, FIT_CIPHER_NODENAME,
+			     strlen(FIT_CIPHER_NODENAME)))
+			return false;
+		if (strncmp(node, FIT_HASH_NODENAME, strlen(FIT_HASH_NODENAME)))
+			continue;
+		fit_image_hash_get_ignore(fit, noffset, &ignore);
+		if (!ignore)
+			count++;
+	}
+
+	return count > 0;
+}
+
+/* Job which checks all hashes of an image, see struct mp_job for the rules */
+static int fit_prehash_image(void *arg)
+{
+	struct fit_prehash_job *job = arg;
+	const void *data;
+	char *err_msg;
+	size_t size;
+	int noffset;
+	int ignore;
+	char *algo;
+
+	if (fit_image_get_data_and_size(job->fit, job->noffset, &data, &size))
+		return -ENOENT;
+
+	fdt_for_each_subnode(noffset, job->fit, job->noffset) {
+		const char *node = fit_get_name(job->fit, noffset, NULL);
+
+		if (strncmp(node, FIT_HASH_NODENAME, strlen(FIT_HASH_NODENAME)))
+			continue;
+		fit_image_hash_get_ignore(job->fit, noffset, &ignore);
+		if (ignore)
+			continue;
+		if (fit_image_hash_get_algo(job->fit, noffset, &algo) ||
+		    fit_image_compare_hash(job->fit, noffset, algo, data, size,
+					   &err_msg))
+			return -EACCES;
+	}
+
+	return 0;
+}
+
+/**
+ * fit_conf_prehash() - check the images of a configuration in parallel
+ *
+ * The kernel, ramdisk, FDT and loadable images of the configuration are
+ * hashed at the same time on different CPUs. Images that pass are recorded
+ * so that fit_image_load() does not hash them again. Images that fail, or
+ * that need a signature check, are left for fit_image_load() to verify as
+ * usual, which also reports any error.
+ *
+ * The results are kept in @images, which only lives for one boot attempt,
+ * and bootm drops them once the images of the configuration are loaded.
+ *
+ * @images:	Images being booted
+ * @fit:	FIT to check
+ * @cfg_noffset: Offset of configuration node
+ */
+static void fit_conf_prehash(bootm_headers_t *images, const void *fit,
+			     int cfg_noffset)
+{
+	static const char *const props[] = {
+		FIT_KERNEL_PROP, FIT_RAMDISK_PROP, FIT_FDT_PROP,
+		FIT_LOADABLE_PROP,
+	};
+	struct fit_prehash_job args[FIT_PREHASH_MAX];
+	struct mp_job jobs[FIT_PREHASH_MAX];
+	int count = 0;
+	struct fit_prehashed *entry;
+	int noffset, i, j, n;
+
+	fit_prehash_clear(images);
+	if (fit_image_sigs_required())
+		return;
+
+	for (i = 0; i < ARRAY_SIZE(props); i++) {
+		n = fit_conf_get_prop_node_count(fit, cfg_noffset, props[i]);
+		for (j = 0; j < n && count < FIT_PREHASH_MAX; j++) {
+			noffset = fit_conf_get_prop_node_index(fit, cfg_noffset,
+							       props[i], j);
+			if (noffset < 0 ||
+			    !fit_image_prehash_supported(fit, noffset))
+				continue;
+			args[count].fit = fit;
+			args[count].noffset = noffset;
+			jobs[count].func = fit_prehash_image;
+			jobs[count].arg = &args[count];
+			count++;
+		}
+	}
+
+	/* with a single image there is nothing to overlap */
+	if (count < 2)
+		return;
+	mp_work_run(jobs, count);
+
+	for (i = 0; i < count; i++) {
+		if (jobs[i].ret)
+			continue;
+		entry = &images->fit_prehashed[images->fit_prehashed_count++];
+		entry->noffset = args[i].noffset;
+		fit_image_get_data_and_size(fit, entry->noffset, &entry->data,
+					    &entry->size);
+	}
+}
+
+/*
+ * Check for (and use up) a result from fit_conf_prehash(). The image data
+ * must be the same as what was hashed, not just the node.
+ */
+static bool fit_image_prehashed(bootm_headers_t *images, const void *fit,
+				int noffset)
+{
+	struct fit_prehashed *entry;
+	const void *data;
+	size_t size;
+	int i;
+
+	if (fit_image_get_data_and_size(fit, noffset, &data, &size))
+		return false;
+	for (i = 0; i < images->fit_prehashed_count; i++) {
+		entry = &images->fit_prehashed[i];
+		if (entry->noffset == noffset && entry->data == data &&
+		    entry->size == size) {
+			entry->noffset = -1;
+			return true;
+		}
+	}
+
+	return false;
+}
+#else
+static inline void fit_conf_prehash(bootm_headers_t *images, const void *fit,
+				    int cfg_noffset)
+{
+}
+
+static inline bool fit_image_prehashed(bootm_headers_t *images,
+				       const void *fit, int noffset)
+{
+	return false;
+}
+#endif /* CONFIG_FIT_PARALLEL_VERIFY && !USE_HOSTCC && !CONFIG_SPL_BUILD */
+
 /**
  * fit_all_image_verify - verify data integrity for all images
  * @fit: pointer to the FIT format image header
@@ -1887,6 +2212,8 @@ int fit_image_load(bootm_headers_t *images, ulong addr,
 	uint8_t os_arch;
 #endif
 	const char *prop_name;
+	bool prehashed;
+	int verify;
 	int ret;
 
 	fit = map_sysmem(addr, 0);
@@ -1895,6 +2222,9 @@ int fit_image_load(bootm_headers_t *images, ulong addr,
 	fit_base_uname_config = NULL;
 	prop_name = fit_get_image_type_property(image_type);
 	printf("## Loading %s from FIT Image at %08lx ...\n", prop_name, addr);
+	/* results for a previous kernel must not be used */
+	if (image_type == IH_TYPE_KERNEL)
+		fit_prehash_clear(images);
 
 	bootstage_mark(bootstage_id + BOOTSTAGE_SUB_FORMAT);
 	if (!fit_check_format(fit)) {
@@ -1943,6 +2273,8 @@ int fit_image_load(bootm_headers_t *images, ulong addr,
 			}
 			puts("OK\n");
 		}
+		if (image_type == IH_TYPE_KERNEL && images->verify)
+			fit_conf_prehash(images, fit, cfg_noffset);
 
 		bootstage_mark(BOOTSTAGE_ID_FIT_CONFIG);
 
@@ -1958,11 +2290,35 @@ int fit_image_load(bootm_headers_t *images, ulong addr,
 
 	printf("   Trying '%s' %s subimage\n", fit_uname, prop_name);
 
-	ret = fit_image_select(fit, noffset, images->verify);
+	verify = images->verify;
+	prehashed = verify && fit_image_prehashed(images, fit, noffset);
+	if (prehashed)
+		verify = 0;
+#if defined(CONFIG_FIT_STREAM_VERIFY) && !defined(USE_HOSTCC) && \
+	!defined(CONFIG_SPL_BUILD)
+	/*
+	 * Kernel images are copied or decompressed later by bootm_load_os(),
+	 * which can check their hashes while doing so. That saves a separate
+	 * pass over the image data here.
+	 */
+	if (image_type == IH_TYPE_KERNEL && load_op == FIT_LOAD_IGNORED) {
+		images->fit_os_hash_pending = verify &&
+			fit_image_check_type(fit, noffset, IH_TYPE_KERNEL) &&
+			fit_image_hash_stream_supported(fit, noffset);
+		if (images->fit_os_hash_pending)
+			verify = 0;
+	}
+#endif
+
+	ret = fit_image_select(fit, noffset, verify);
 	if (ret) {
 		bootstage_error(bootstage_id + BOOTSTAGE_SUB_HASH);
 		return ret;
 	}
+	if (prehashed)
+		puts("   Verifying Hash Integrity ... OK (in parallel)\n");
+	else if (verify != images->verify)
+		puts("   Hash Integrity will be verified while loading\n");
 
 	bootstage_mark(bootstage_id + BOOTSTAGE_SUB_CHECK_ARCH);
 #if !defined(USE_HOSTCC) && !defined(CONFIG_SANDBOX)
@@ -24,6 +24,7 @@
 #include <image.h>
 #include <lz4.h>
 #include <mapmem.h>
+#include <zstd.h>
 
 #if IMAGE_ENABLE_FIT || IMAGE_ENABLE_OF_LIBFDT
 #include <linux/libfdt.h>
@@ -194,6 +195,7 @@ static const table_entry_t uimage_comp[] = {
 	{	IH_COMP_LZMA,	"lzma",		"lzma compressed",	},
 	{	IH_COMP_LZO,	"lzo",		"lzo compressed",	},
 	{	IH_COMP_LZ4,	"lz4",		"lz4 compressed",	},
+	{	IH_COMP_ZSTD,	"zstd",		"zstd compressed",	},
 	{	-1,		"",		"",			},
 };
 
@@ -455,11 +457,20 @@ int image_decomp(int comp, ulong load, ulong image_start, int type,
 #endif /* CONFIG_BZIP2 */
 #ifdef CONFIG_LZMA
 	case IH_COMP_LZMA: {
-		SizeT lzma_len = unc_len;
-
-		ret = lzmaBuffToBuffDecompress(load_buf, &lzma_len,
-					       image_buf, image_len);
-		image_len = lzma_len;
+		struct lzma_stream ls;
+		ulong pos, chunk;
+		SizeT size;
+
+		/* the output buffer is the dictionary, whatever the header says */
+		lzma_stream_init(&ls, load_buf, unc_len);
+		for (pos = 0; pos < image_len && !ret; pos += chunk) {
+			chunk = min(image_len - pos, (ulong)CHUNKSZ);
+			ret = lzma_stream_feed(&ls, image_buf + pos, chunk);
+			WATCHDOG_RESET();
+		}
+		if (lzma_stream_finish(&ls, &size) && !ret)
+			ret = -EINVAL;
+		image_len = size;
 		break;
 	}
 #endif /* CONFIG_LZMA */
@@ -481,6 +492,15 @@ int image_decomp(int comp, ulong load, ulong image_start, int type,
 		break;
 	}
 #endif /* CONFIG_LZ4 */
+#if CONFIG_IS_ENABLED(ZSTD)
+	case IH_COMP_ZSTD: {
+		size_t size = unc_len;
+
+		ret = zstd_decompress(load_buf, &size, image_buf, image_len);
+		image_len = size;
+		break;
+	}
+#endif /* CONFIG_ZSTD */
 	default:
 		printf("Unimplemented compression type %d\n", comp);
 		return -ENOSYS;
@@ -491,6 +511,110 @@ int image_decomp(int comp, ulong load, ulong image_start, int type,
 	return ret;
 }
 
+#if defined(CONFIG_FIT_STREAM_VERIFY) && !defined(USE_HOSTCC)
+static void image_hash_piece(void *priv, const void *buf, ulong len)
+{
+	fit_image_hash_stream_update(priv, buf, len);
+}
+
+int image_decomp_hashed(int comp, ulong load, ulong image_start, int type,
+			void *load_buf, void *image_buf, ulong image_len,
+			uint unc_len, ulong *load_end,
+			struct fit_hash_stream *hs)
+{
+	char *dst = load_buf, *src = image_buf;
+	ulong pos, chunk;
+
+	switch (comp) {
+	case IH_COMP_NONE:
+		/* Hash and copy a chunk at a time unless the regions overlap */
+		if (load == image_start || image_len > unc_len ||
+		    (dst < src + image_len && src < dst + image_len))
+			break;
+		print_decomp_msg(comp, type, false);
+		for (pos = 0; pos < image_len; pos += chunk) {
+			chunk = min(image_len - pos, (ulong)CHUNKSZ);
+			fit_image_hash_stream_update(hs, src + pos, chunk);
+			memcpy(dst + pos, src + pos, chunk);
+			WATCHDOG_RESET();
+		}
+		*load_end = load + image_len;
+		return 0;
+#ifdef CONFIG_GZIP
+	case IH_COMP_GZIP: {
+		int ret;
+
+		*load_end = load;
+		print_decomp_msg(comp, type, false);
+		ret = gunzip_hook(load_buf, unc_len, image_buf, &image_len,
+				  image_hash_piece, hs);
+		*load_end = load + image_len;
+
+		return ret;
+	}
+#endif
+#if CONFIG_IS_ENABLED(ZSTD)
+	case IH_COMP_ZSTD: {
+		struct zstd_stream zs;
+		size_t size;
+		int ret;
+
+		/*
+		 * With other CPUs to share out the frames, decompressing them
+		 * in parallel after hashing is quicker
+		 */
+		if (CONFIG_IS_ENABLED(MP_WORK))
+			break;
+		*load_end = load;
+		print_decomp_msg(comp, type, false);
+		ret = zstd_stream_init(&zs, load_buf, unc_len);
+		if (ret)
+			return ret;
+		for (pos = 0; pos < image_len && !ret; pos += chunk) {
+			chunk = min(image_len - pos, (ulong)CHUNKSZ);
+			fit_image_hash_stream_update(hs, src + pos, chunk);
+			ret = zstd_stream_feed(&zs, src + pos, chunk);
+			WATCHDOG_RESET();
+		}
+		if (zstd_stream_finish(&zs, &size) && !ret)
+			ret = -EINVAL;
+		*load_end = load + size;
+
+		return ret;
+	}
+#endif
+#ifdef CONFIG_LZMA
+	case IH_COMP_LZMA: {
+		struct lzma_stream ls;
+		SizeT size;
+		int ret = 0;
+
+		*load_end = load;
+		print_decomp_msg(comp, type, false);
+		lzma_stream_init(&ls, load_buf, unc_len);
+		for (pos = 0; pos < image_len && !ret; pos += chunk) {
+			chunk = min(image_len - pos, (ulong)CHUNKSZ);
+			fit_image_hash_stream_update(hs, src + pos, chunk);
+			ret = lzma_stream_feed(&ls, src + pos, chunk);
+			WATCHDOG_RESET();
+		}
+		if (lzma_stream_finish(&ls, &size) && !ret)
+			ret = -EINVAL;
+		*load_end = load + size;
+
+		return ret;
+	}
+#endif
+	}
+
+	/* Otherwise hash everything first, then decompress in one go */
+	fit_image_hash_stream_update(hs, image_buf, image_len);
+
+	return image_decomp(comp, load, image_start, type, load_buf,
+			    image_buf, image_len, unc_len, load_end);
+}
+#endif
+
 
 #ifndef USE_HOSTCC
 #if CONFIG_IS_ENABLED(LEGACY_IMAGE_FORMAT)
@@ -6,167 +6,498 @@
  */
 #include <config.h>
 #include <common.h>
+#include <blk.h>
+#include <dm.h>
 #include <malloc.h>
 #include <part.h>
 #include <linux/ctype.h>
 #include <linux/list.h>
 
-struct block_cache_node {
+/*
+ * The cache holds single blocks. Blocks are hashed into sets of
+ * BLKCACHE_WAYS entries, each kept in most-recently-used order, so that a
+ * lookup only looks at a handful of entries. Each device also keeps a list
+ * of its own entries so that it can be flushed or invalidated without
+ * walking the whole cache.
+ *
+ * Devices are keyed by hardware partition as well, since each one has its
+ * own block numbering. Dirty blocks are written back through the block
+ * device, which writes to the partition that is currently selected, so they
+ * must be flushed before the partition is switched.
+ */
+#define BLKCACHE_WAYS		8
+
+/* Largest run of dirty blocks written back with a single request */
+#define BLKCACHE_FLUSH_BLOCKS	32
+
+struct block_cache_dev {
 	struct list_head lh;
+	struct list_head nodes;
+	struct blk_desc *desc;	/* for write-back, NULL if never written */
 	int iftype;
 	int devnum;
-	lbaint_t start;
-	lbaint_t blkcnt;
+	int hwpart;
+};
+
+struct block_cache_node {
+	struct list_head set_lh;
+	struct list_head dev_lh;
+	struct block_cache_dev *dev;
+	lbaint_t block;
 	unsigned long blksz;
+	bool dirty;
 	char *cache;
 };
 
+struct block_cache_set {
+	struct list_head nodes;
+	unsigned int count;
+};
+
 #ifndef CONFIG_M68K
-static LIST_HEAD(block_cache);
+static LIST_HEAD(block_cache_devs);
 #else
-static struct list_head block_cache;
+static struct list_head block_cache_devs;
 #endif
 
+static struct block_cache_set *block_cache_sets;
+static unsigned int block_cache_nsets;
+
 static struct block_cache_stats _stats = {
 	.max_blocks_per_entry = 8,
-	.max_entries = 32
+	.max_entries = CONFIG_BLOCK_CACHE_ENTRIES,
 };
 
 #ifdef CONFIG_M68K
 int blkcache_init(void)
 {
-	INIT_LIST_HEAD(&block_cache);
+	INIT_LIST_HEAD(&block_cache_devs);
 
 	return 0;
 }
 #endif
 
-static struct block_cache_node *cache_find(int iftype, int devnum,
-					   lbaint_t start, lbaint_t blkcnt,
-					   unsigned long blksz)
+static int cache_setup(void)
+{
+	unsigned int i;
+
+	if (block_cache_sets)
+		return 0;
+	if (!_stats.max_entries)
+		return -ENOSPC;
+
+	block_cache_nsets = DIV_ROUND_UP(_stats.max_entries, BLKCACHE_WAYS);
+	block_cache_sets = calloc(block_cache_nsets, sizeof(*block_cache_sets));
+	if (!block_cache_sets)
+		return -ENOMEM;
+	for (i = 0; i < block_cache_nsets; i++)
+		INIT_LIST_HEAD(&block_cache_sets[i].nodes);
+
+	return 0;
+}
+
+static struct block_cache_set *cache_set(struct block_cache_dev *dev,
+					 lbaint_t block)
+{
+	/* Consecutive blocks go to consecutive sets */
+	unsigned long hash = block + dev->devnum * 0x9e37 + dev->iftype * 0x79b9 +
+			     dev->hwpart * 0x3c6ef;
+
+	return &block_cache_sets[hash % block_cache_nsets];
+}
+
+static struct block_cache_dev *cache_find_dev(struct blk_desc *block_dev,
+					      bool create)
+{
+	struct block_cache_dev *dev;
+
+	list_for_each_entry(dev, &block_cache_devs, lh)
+		if (dev->iftype == block_dev->if_type &&
+		    dev->devnum == block_dev->devnum &&
+		    dev->hwpart == block_dev->hwpart)
+			return dev;
+
+	if (!create)
+		return NULL;
+
+	dev = calloc(1, sizeof(*dev));
+	if (!dev)
+		return NULL;
+	dev->iftype = block_dev->if_type;
+	dev->devnum = block_dev->devnum;
+	dev->hwpart = block_dev->hwpart;
+	INIT_LIST_HEAD(&dev->nodes);
+	list_add(&dev->lh, &block_cache_devs);
+
+	return dev;
+}
+
+static struct block_cache_node *cache_lookup(struct block_cache_dev *dev,
+					     lbaint_t block,
+					     unsigned long blksz)
 {
+	struct block_cache_set *set = cache_set(dev, block);
 	struct block_cache_node *node;
 
-	list_for_each_entry(node, &block_cache, lh)
-		if ((node->iftype == iftype) &&
-		    (node->devnum == devnum) &&
-		    (node->blksz == blksz) &&
-		    (node->start <= start) &&
-		    (node->start + node->blkcnt >= start + blkcnt)) {
-			if (block_cache.next != &node->lh) {
-				/* maintain MRU ordering */
-				list_del(&node->lh);
-				list_add(&node->lh, &block_cache);
-			}
+	list_for_each_entry(node, &set->nodes, set_lh)
+		if (node->dev == dev && node->block == block &&
+		    node->blksz == blksz)
 			return node;
-		}
-	return 0;
+
+	return NULL;
 }
 
-int blkcache_read(int iftype, int devnum,
-		  lbaint_t start, lbaint_t blkcnt,
-		  unsigned long blksz, void *buffer)
+static struct block_cache_node *cache_find(struct block_cache_dev *dev,
+					   lbaint_t block, unsigned long blksz)
 {
-	struct block_cache_node *node = cache_find(iftype, devnum, start,
-						   blkcnt, blksz);
+	struct block_cache_node *node = cache_lookup(dev, block, blksz);
+
 	if (node) {
-		const char *src = node->cache + (start - node->start) * blksz;
-		memcpy(buffer, src, blksz * blkcnt);
-		debug("hit: start " LBAF ", count " LBAFU "\n",
-		      start, blkcnt);
-		++_stats.hits;
-		return 1;
+		/* maintain MRU ordering */
+		list_move(&node->set_lh, &cache_set(dev, block)->nodes);
+		list_move(&node->dev_lh, &dev->nodes);
 	}
 
-	debug("miss: start " LBAF ", count " LBAFU "\n",
-	      start, blkcnt);
-	++_stats.misses;
-	return 0;
+	return node;
 }
 
-void blkcache_fill(int iftype, int devnum,
-		   lbaint_t start, lbaint_t blkcnt,
-		   unsigned long blksz, void const *buffer)
+static ulong cache_dev_write(struct blk_desc *desc, lbaint_t start,
+			     lbaint_t blkcnt, const void *buffer)
 {
-	lbaint_t bytes;
-	struct block_cache_node *node;
+#if CONFIG_IS_ENABLED(BLK)
+	const struct blk_ops *ops = blk_get_ops(desc->bdev);
 
-	/* don't cache big stuff */
-	if (blkcnt > _stats.max_blocks_per_entry)
-		return;
+	if (!ops->write)
+		return -ENOSYS;
 
-	if (_stats.max_entries == 0)
-		return;
+	return ops->write(desc->bdev, start, blkcnt, buffer);
+#else
+	return desc->block_write(desc, start, blkcnt, buffer);
+#endif
+}
+
+static int cache_write_back(struct block_cache_node *node)
+{
+	struct blk_desc *desc = node->dev->desc;
+
+	if (!node->dirty)
+		return 0;
+
+	node->dirty = false;
+	if (cache_dev_write(desc, node->block, 1, node->cache) != 1) {
+		printf("blkcache: write-back of block " LBAFU " failed\n",
+		       node->block);
+		return -EIO;
+	}
+
+	return 0;
+}
+
+static void cache_drop(struct block_cache_node *node)
+{
+	list_del(&node->set_lh);
+	list_del(&node->dev_lh);
+	cache_set(node->dev, node->block)->count--;
+	_stats.entries--;
+	free(node->cache);
+	free(node);
+}
+
+/*
+ * Get an entry for a block which is not in the cache, reusing the least
+ * recently used entry of its set if the set is full. A dirty entry is
+ * written back before it is reused.
+ */
+static struct block_cache_node *cache_alloc(struct block_cache_dev *dev,
+					    lbaint_t block,
+					    unsigned long blksz)
+{
+	struct block_cache_set *set = cache_set(dev, block);
+	struct block_cache_node *node;
 
-	bytes = blksz * blkcnt;
-	if (_stats.max_entries <= _stats.entries) {
+	if (set->count < BLKCACHE_WAYS) {
+		node = calloc(1, sizeof(*node));
+		if (!node)
+			return NULL;
+		set->count++;
+		_stats.entries++;
+	} else {
 		/* pop LRU */
-		node = (struct block_cache_node *)block_cache.prev;
-		list_del(&node->lh);
-		_stats.entries--;
-		debug("drop: start " LBAF ", count " LBAFU "\n",
-		      node->start, node->blkcnt);
-		if (node->blkcnt * node->blksz < bytes) {
+		node = list_last_entry(&set->nodes, struct block_cache_node,
+				       set_lh);
+		debug("drop: block " LBAFU "\n", node->block);
+		cache_write_back(node);
+		list_del(&node->set_lh);
+		list_del(&node->dev_lh);
+		if (node->blksz != blksz) {
 			free(node->cache);
-			node->cache = 0;
+			node->cache = NULL;
 		}
-	} else {
-		node = malloc(sizeof(*node));
-		if (!node)
-			return;
-		node->cache = 0;
 	}
 
 	if (!node->cache) {
-		node->cache = malloc(bytes);
+		node->cache = malloc(blksz);
 		if (!node->cache) {
 			free(node);
+			set->count--;
+			_stats.entries--;
+			return NULL;
+		}
+	}
+
+	node->dev = dev;
+	node->block = block;
+	node->blksz = blksz;
+	node->dirty = false;
+	list_add(&node->set_lh, &set->nodes);
+	list_add(&node->dev_lh, &dev->nodes);
+
+	return node;
+}
+
+static int cache_flush_dev(struct block_cache_dev *dev);
+
+/*
+ * The caller reads a missed request from the device, so any dirty blocks it
+ * covers must get there first
+ */
+static void cache_miss_write_back(struct block_cache_dev *dev, lbaint_t start,
+				  lbaint_t blkcnt)
+{
+	struct block_cache_node *node;
+
+	list_for_each_entry(node, &dev->nodes, dev_lh) {
+		if (node->dirty && node->block >= start &&
+		    node->block - start < blkcnt) {
+			cache_flush_dev(dev);
 			return;
 		}
 	}
+}
+
+int blkcache_read(struct blk_desc *block_dev, lbaint_t start,
+		  lbaint_t blkcnt, void *buffer)
+{
+	unsigned long blksz = block_dev->blksz;
+	struct block_cache_node *node;
+	struct block_cache_dev *dev;
+	lbaint_t i;
+
+	dev = cache_find_dev(block_dev, false);
+	if (!dev || blkcnt > _stats.max_blocks_per_entry)
+		goto miss;
+
+	/*
+	 * Only a request which is fully cached is served from the cache. On a
+	 * miss the caller reads the whole request into @buffer from the
+	 * device, so blocks already copied there do no harm.
+	 */
+	for (i = 0; i < blkcnt; i++) {
+		node = cache_find(dev, start + i, blksz);
+		if (!node)
+			goto miss;
+		memcpy(buffer + i * blksz, node->cache, blksz);
+	}
+	debug("hit: start " LBAF ", count " LBAFU "\n",
+	      start, blkcnt);
+	++_stats.hits;
+	return 1;
+
+miss:
+	if (IS_ENABLED(CONFIG_BLOCK_CACHE_WRITEBACK) && dev)
+		cache_miss_write_back(dev, start, blkcnt);
+	debug("miss: start " LBAF ", count " LBAFU "\n",
+	      start, blkcnt);
+	++_stats.misses;
+	return 0;
+}
+
+void blkcache_fill(struct blk_desc *block_dev, lbaint_t start,
+		   lbaint_t blkcnt, void const *buffer)
+{
+	unsigned long blksz = block_dev->blksz;
+	struct block_cache_node *node;
+	struct block_cache_dev *dev;
+	lbaint_t i;
+
+	/* don't cache big stuff */
+	if (blkcnt > _stats.max_blocks_per_entry)
+		return;
+
+	if (cache_setup())
+		return;
+
+	dev = cache_find_dev(block_dev, true);
+	if (!dev)
+		return;
 
 	debug("fill: start " LBAF ", count " LBAFU "\n",
 	      start, blkcnt);
 
-	node->iftype = iftype;
-	node->devnum = devnum;
-	node->start = start;
-	node->blkcnt = blkcnt;
-	node->blksz = blksz;
-	memcpy(node->cache, buffer, bytes);
-	list_add(&node->lh, &block_cache);
-	_stats.entries++;
+	for (i = 0; i < blkcnt; i++) {
+		node = cache_find(dev, start + i, blksz);
+		/* a dirty entry is newer than what is on the device */
+		if (node && node->dirty)
+			continue;
+		if (!node)
+			node = cache_alloc(dev, start + i, blksz);
+		if (!node)
+			return;
+		memcpy(node->cache, buffer + i * blksz, blksz);
+	}
 }
 
-void blkcache_invalidate(int iftype, int devnum)
+int blkcache_write(struct blk_desc *block_dev, lbaint_t start,
+		   lbaint_t blkcnt, void const *buffer)
 {
-	struct list_head *entry, *n;
+	unsigned long blksz = block_dev->blksz;
 	struct block_cache_node *node;
+	struct block_cache_dev *dev;
+	bool absorb;
+	lbaint_t i;
 
-	list_for_each_safe(entry, n, &block_cache) {
-		node = (struct block_cache_node *)entry;
-		if ((node->iftype == iftype) &&
-		    (node->devnum == devnum)) {
-			list_del(entry);
-			free(node->cache);
-			free(node);
-			--_stats.entries;
+	absorb = IS_ENABLED(CONFIG_BLOCK_CACHE_WRITEBACK) &&
+		 blkcnt <= _stats.max_blocks_per_entry && !cache_setup();
+	dev = cache_find_dev(block_dev, absorb);
+	if (!dev)
+		return 0;
+	dev->desc = block_dev;
+
+	/*
+	 * Small writes are kept in the cache until the next flush. Otherwise
+	 * update any cached copies and let the caller write the data through
+	 * to the device.
+	 */
+	for (i = 0; i < blkcnt; i++) {
+		node = cache_find(dev, start + i, blksz);
+		if (!node && absorb) {
+			node = cache_alloc(dev, start + i, blksz);
+			/* blocks already taken stay dirty, which is harmless */
+			absorb = node;
+		}
+		if (!node)
+			continue;
+		memcpy(node->cache, buffer + i * blksz, blksz);
+		node->dirty = absorb;
+	}
+
+	return absorb;
+}
+
+/*
+ * Write back the dirty blocks of a device, merging runs of consecutive
+ * blocks into a single request
+ */
+static int cache_flush_dev(struct block_cache_dev *dev)
+{
+	struct block_cache_node *node, *next;
+	unsigned long blksz;
+	lbaint_t start, count;
+	int ret = 0;
+	char *buf;
+
+	list_for_each_entry(node, &dev->nodes, dev_lh) {
+		blksz = node->blksz;
+		while (node->dirty) {
+			buf = malloc(BLKCACHE_FLUSH_BLOCKS * blksz);
+			if (!buf) {
+				if (cache_write_back(node))
+					ret = -EIO;
+				break;
+			}
+
+			/* find the first dirty block of this run */
+			start = node->block;
+			while (start > 0) {
+				next = cache_lookup(dev, start - 1, blksz);
+				if (!next || !next->dirty)
+					break;
+				start--;
+			}
+
+			count = 0;
+			while (count < BLKCACHE_FLUSH_BLOCKS) {
+				next = cache_lookup(dev, start + count, blksz);
+				if (!next || !next->dirty)
+					break;
+				memcpy(buf + count * blksz, next->cache, blksz);
+				next->dirty = false;
+				count++;
+			}
+
+			debug("flush: start " LBAF ", count " LBAFU "\n",
+			      start, count);
+			if (cache_dev_write(dev->desc, start, count, buf) !=
+			    count) {
+				printf("blkcache: write-back of blocks " LBAFU
+				       "+" LBAFU " failed\n", start, count);
+				ret = -EIO;
+			}
+			free(buf);
 		}
 	}
+
+	return ret;
+}
+
+int blkcache_flush(int iftype, int devnum)
+{
+	struct block_cache_dev *dev;
+	int ret = 0;
+
+	list_for_each_entry(dev, &block_cache_devs, lh)
+		if (dev->iftype == iftype && dev->devnum == devnum &&
+		    cache_flush_dev(dev))
+			ret = -EIO;
+
+	return ret;
+}
+
+int blkcache_flush_all(void)
+{
+	struct block_cache_dev *dev;
+	int ret = 0;
+
+	list_for_each_entry(dev, &block_cache_devs, lh)
+		if (cache_flush_dev(dev))
+			ret = -EIO;
+
+	return ret;
+}
+
+static void cache_invalidate_dev(struct block_cache_dev *dev)
+{
+	struct block_cache_node *node, *n;
+
+	/* don't lose data which only lives in the cache */
+	cache_flush_dev(dev);
+
+	list_for_each_entry_safe(node, n, &dev->nodes, dev_lh)
+		cache_drop(node);
+	list_del(&dev->lh);
+	free(dev);
+}
+
+void blkcache_invalidate(int iftype, int devnum)
+{
+	struct block_cache_dev *dev, *n;
+
+	list_for_each_entry_safe(dev, n, &block_cache_devs, lh)
+		if (dev->iftype == iftype && dev->devnum == devnum)
+			cache_invalidate_dev(dev);
 }
 
 void blkcache_configure(unsigned blocks, unsigned entries)
 {
-	struct block_cache_node *node;
+	struct block_cache_dev *dev, *n;
+
 	if ((blocks != _stats.max_blocks_per_entry) ||
 	    (entries != _stats.max_entries)) {
 		/* invalidate cache */
-		while (!list_empty(&block_cache)) {
-			node = (struct block_cache_node *)block_cache.next;
-			list_del(&node->lh);
-			free(node->cache);
-			free(node);
-		}
+		list_for_each_entry_safe(dev, n, &block_cache_devs, lh)
+			cache_invalidate_dev(dev);
+		free(block_cache_sets);
+		block_cache_sets = NULL;
 		_stats.entries = 0;
 	}
 
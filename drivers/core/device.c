@@ -22,6 +22,7 @@
 #include <dm/pinctrl.h>
 #include <dm/platdata.h>
 #include <dm/read.h>
+#include <dm/root.h>
 #include <dm/uclass.h>
 #include <dm/uclass-internal.h>
 #include <dm/util.h>
@@ -45,6 +46,10 @@ static int device_bind_common(struct udevice *parent, const struct driver *drv,
 	if (!name)
 		return -EINVAL;
 
+	/* Looking up the uclass must not bind the node on demand as well */
+	if (ofnode_valid(node))
+		dm_lazy_forget_node(node);
+
 	ret = uclass_get(drv->id, &uc);
 	if (ret) {
 		debug("Missing uclass for driver %s\n", drv->name);
@@ -170,6 +175,9 @@ static int device_bind_common(struct udevice *parent, const struct driver *drv,
 			goto fail_uclass_post_bind;
 	}
 
+	/* The methods above may have set the sequence number or node */
+	device_reindex(dev);
+
 	if (parent)
 		pr_debug("Bound device %s to %s\n", dev->name, parent->name);
 	if (devp)
@@ -216,6 +224,7 @@ fail_alloc2:
 	}
 fail_alloc1:
 	devres_release_all(dev);
+	dm_lazy_forget(dev);
 
 	free(dev);
 
@@ -418,6 +427,7 @@ int device_probe(struct udevice *dev)
 		goto fail;
 	}
 	dev->seq = seq;
+	device_reindex(dev);
 
 	dev->flags |= DM_FLAG_ACTIVATED;
 
@@ -482,6 +492,7 @@ fail:
 	dev->flags &= ~DM_FLAG_ACTIVATED;
 
 	dev->seq = -1;
+	device_reindex(dev);
 	device_free(dev);
 
 	return ret;
@@ -700,6 +711,7 @@ static struct udevice *_device_find_global_by_ofnode(struct udevice *parent,
 
 int device_find_global_by_ofnode(ofnode ofnode, struct udevice **devp)
 {
+	dm_lazy_bind_ofnode(ofnode);
 	*devp = _device_find_global_by_ofnode(gd->dm_root, ofnode);
 
 	return *devp ? 0 : -ENOENT;
@@ -709,6 +721,7 @@ int device_get_global_by_ofnode(ofnode ofnode, struct udevice **devp)
 {
 	struct udevice *dev;
 
+	dm_lazy_bind_ofnode(ofnode);
 	dev = _device_find_global_by_ofnode(gd->dm_root, ofnode);
 	return device_get_device_tail(dev, dev ? 0 : -ENOENT, devp);
 }
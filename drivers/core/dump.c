@@ -46,7 +46,14 @@ static void show_devices(struct udevice *dev, int depth, int last_flag)
 void dm_dump_all(void)
 {
 	struct udevice *root;
+	uint deferred, bound;
 
+	dm_lazy_stats(&deferred, &bound);
+	if (deferred) {
+		printf("%u of %u nodes were bound on demand\n", bound,
+		       deferred);
+		dm_lazy_bind_all();
+	}
 	root = dm_root();
 	if (root) {
 		printf(" Class     Index  Probed  Driver                Name\n");
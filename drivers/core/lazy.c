@@ -0,0 +1,322 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Binding devices from the device tree on demand
+ *
+ * Rather than binding every node when the device tree is scanned, each node
+ * is recorded along with the uclasses of the drivers for it and the nodes
+ * below it. The node is bound when one of those uclasses is first used, or
+ * when something looks for the node itself. Subnodes scanned as the node is
+ * bound (e.g. by a bus uclass's post_bind() method) are recorded in turn, so
+ * only the branches leading to the devices that are used are ever bound.
+ */
+
+#define LOG_CATEGORY LOGC_DM
+
+#include <common.h>
+#include <bootstage.h>
+#include <dm.h>
+#include <errno.h>
+#include <malloc.h>
+#include <dm/device-internal.h>
+#include <dm/lists.h>
+#include <dm/of_access.h>
+#include <dm/root.h>
+#include <dm/util.h>
+#include <linux/bitops.h>
+#include <linux/libfdt.h>
+#include <linux/list.h>
+
+DECLARE_GLOBAL_DATA_PTR;
+
+/**
+ * struct dm_lazy_node - a device-tree node waiting to be bound
+ *
+ * @sibling_node: Next node in the list of nodes waiting to be bound
+ * @parent: Device to bind the node's device to
+ * @node: Node to bind
+ * @end: For a flat tree, offset of the first node past the node's subtree
+ * @uclasses: Uclasses of the drivers for the node and the nodes below it
+ */
+struct dm_lazy_node {
+	struct list_head sibling_node;
+	struct udevice *parent;
+	ofnode node;
+	int end;
+	ulong uclasses[BITS_TO_LONGS(UCLASS_COUNT)];
+};
+
+/**
+ * struct dm_lazy - state of on-demand binding
+ *
+ * @pending: Nodes waiting to be bound (struct dm_lazy_node)
+ * @uclasses: Uclasses of all nodes in @pending
+ * @binding: true while nodes are being bound, to stop recursion
+ * @deferred: Number of nodes recorded so far
+ * @bound: Number of those which have been bound
+ */
+struct dm_lazy {
+	struct list_head pending;
+	ulong uclasses[BITS_TO_LONGS(UCLASS_COUNT)];
+	bool binding;
+	uint deferred;
+	uint bound;
+};
+
+/* Add the uclasses of the drivers for @node to @uclasses */
+static void dm_lazy_add_uclasses(ofnode node, ulong *uclasses)
+{
+	const struct udevice_id *of_id;
+	const char *compat_list;
+	struct driver *drv;
+	int len, i;
+
+	compat_list = ofnode_get_property(node, "compatible", &len);
+	for (i = 0; compat_list && i < len;
+	     i += strlen(compat_list + i) + 1) {
+		drv = lists_driver_lookup_compatible(compat_list + i, &of_id);
+		if (drv)
+			generic_set_bit(drv->id, uclasses);
+	}
+}
+
+#if CONFIG_IS_ENABLED(OF_LIVE)
+static void dm_lazy_add_live(const struct device_node *np, ulong *uclasses)
+{
+	for (np = np->child; np; np = np->sibling) {
+		dm_lazy_add_uclasses(np_to_ofnode(np), uclasses);
+		dm_lazy_add_live(np, uclasses);
+	}
+}
+#endif
+
+/* Look through the subtree of @entry->node for the uclasses it may use */
+static void dm_lazy_scan(struct dm_lazy_node *entry)
+{
+	const void *blob = gd->fdt_blob;
+	int offset, depth = 0;
+
+	dm_lazy_add_uclasses(entry->node, entry->uclasses);
+#if CONFIG_IS_ENABLED(OF_LIVE)
+	if (ofnode_is_np(entry->node)) {
+		dm_lazy_add_live(ofnode_to_np(entry->node), entry->uclasses);
+		return;
+	}
+#endif
+	offset = ofnode_to_offset(entry->node);
+	for (offset = fdt_next_node(blob, offset, &depth);
+	     offset >= 0 && depth > 0;
+	     offset = fdt_next_node(blob, offset, &depth)) {
+		dm_lazy_add_uclasses(offset_to_ofnode(offset),
+				     entry->uclasses);
+	}
+	entry->end = offset >= 0 ? offset : INT_MAX;
+}
+
+/* Check whether @node is @entry->node or below it */
+static bool dm_lazy_holds(struct dm_lazy_node *entry, ofnode node)
+{
+	int offset;
+
+#if CONFIG_IS_ENABLED(OF_LIVE)
+	if (ofnode_is_np(node)) {
+		const struct device_node *np;
+
+		for (np = ofnode_to_np(node); np; np = np->parent) {
+			if (np == ofnode_to_np(entry->node))
+				return true;
+		}
+
+		return false;
+	}
+#endif
+	offset = ofnode_to_offset(node);
+
+	return offset >= ofnode_to_offset(entry->node) && offset < entry->end;
+}
+
+int dm_lazy_init(void)
+{
+	struct dm_lazy *lazy;
+
+	if (gd->dm_lazy)
+		return 0;
+	lazy = calloc(1, sizeof(*lazy));
+	if (!lazy)
+		return -ENOMEM;
+	INIT_LIST_HEAD(&lazy->pending);
+	gd->dm_lazy = lazy;
+
+	return 0;
+}
+
+void dm_lazy_uninit(void)
+{
+	struct dm_lazy *lazy = gd->dm_lazy;
+	struct dm_lazy_node *entry, *next;
+
+	if (!lazy)
+		return;
+	list_for_each_entry_safe(entry, next, &lazy->pending, sibling_node)
+		free(entry);
+	free(lazy);
+	gd->dm_lazy = NULL;
+}
+
+int dm_lazy_add(struct udevice *parent, ofnode node)
+{
+	struct dm_lazy *lazy = gd->dm_lazy;
+	struct dm_lazy_node *entry;
+	int i;
+
+	/*
+	 * A driver which scans its subnodes in probe() expects to find them
+	 * bound straight afterwards, so only defer the top-level nodes and
+	 * those scanned while binding nodes on demand
+	 */
+	if (!lazy || (parent != gd->dm_root && !lazy->binding))
+		return -ENOSYS;
+	entry = calloc(1, sizeof(*entry));
+	if (!entry)
+		return -ENOMEM;
+	entry->parent = parent;
+	entry->node = node;
+	dm_lazy_scan(entry);
+
+	/* Nothing would be bound for the node, so it can be dropped now */
+	for (i = 0; i < ARRAY_SIZE(entry->uclasses); i++) {
+		if (entry->uclasses[i])
+			break;
+	}
+	if (i == ARRAY_SIZE(entry->uclasses)) {
+		free(entry);
+		return 0;
+	}
+
+	list_add_tail(&entry->sibling_node, &lazy->pending);
+	for (i = 0; i < ARRAY_SIZE(lazy->uclasses); i++)
+		lazy->uclasses[i] |= entry->uclasses[i];
+	lazy->deferred++;
+
+	return 0;
+}
+
+/* Check whether @entry is to be bound by dm_lazy_bind() */
+static bool dm_lazy_wanted(struct dm_lazy_node *entry, enum uclass_id id,
+			   ofnode node)
+{
+	if (id != UCLASS_INVALID)
+		return test_bit(id, entry->uclasses);
+
+	return !ofnode_valid(node) || dm_lazy_holds(entry, node);
+}
+
+/*
+ * Bind the nodes which hold a device in uclass @id, or which hold @node, or
+ * all of them if @id is UCLASS_INVALID and @node is not valid.
+ */
+static void dm_lazy_bind(struct dm_lazy *lazy, enum uclass_id id, ofnode node)
+{
+	struct dm_lazy_node *entry;
+	bool found;
+	int i, ret;
+
+	bootstage_start(BOOTSTAGE_ID_ACCUM_DM_LAZY, "dm_lazy");
+	lazy->binding = true;
+	do {
+		/*
+		 * Binding a node may record or drop other nodes, so start
+		 * from the top each time
+		 */
+		found = false;
+		list_for_each_entry(entry, &lazy->pending, sibling_node) {
+			if (dm_lazy_wanted(entry, id, node)) {
+				found = true;
+				break;
+			}
+		}
+		if (!found)
+			break;
+
+		list_del(&entry->sibling_node);
+		log_debug("bind %s for uclass %d\n",
+			  ofnode_get_name(entry->node), id);
+		ret = lists_bind_fdt(entry->parent, entry->node, NULL, false);
+		if (ret)
+			dm_warn("Failed to bind node '%s': %d\n",
+				ofnode_get_name(entry->node), ret);
+		free(entry);
+		lazy->bound++;
+	} while (true);
+	lazy->binding = false;
+
+	memset(lazy->uclasses, '\0', sizeof(lazy->uclasses));
+	list_for_each_entry(entry, &lazy->pending, sibling_node) {
+		for (i = 0; i < ARRAY_SIZE(lazy->uclasses); i++)
+			lazy->uclasses[i] |= entry->uclasses[i];
+	}
+	bootstage_accum(BOOTSTAGE_ID_ACCUM_DM_LAZY);
+}
+
+void dm_lazy_bind_uclass(enum uclass_id id)
+{
+	struct dm_lazy *lazy = gd->dm_lazy;
+
+	if (lazy && !lazy->binding && id >= 0 && id < UCLASS_COUNT &&
+	    test_bit(id, lazy->uclasses))
+		dm_lazy_bind(lazy, id, ofnode_null());
+}
+
+void dm_lazy_bind_ofnode(ofnode node)
+{
+	struct dm_lazy *lazy = gd->dm_lazy;
+
+	if (lazy && !lazy->binding && ofnode_valid(node))
+		dm_lazy_bind(lazy, UCLASS_INVALID, node);
+}
+
+void dm_lazy_bind_all(void)
+{
+	struct dm_lazy *lazy = gd->dm_lazy;
+
+	if (lazy && !lazy->binding)
+		dm_lazy_bind(lazy, UCLASS_INVALID, ofnode_null());
+}
+
+void dm_lazy_forget(struct udevice *parent)
+{
+	struct dm_lazy *lazy = gd->dm_lazy;
+	struct dm_lazy_node *entry, *next;
+
+	if (!lazy)
+		return;
+	list_for_each_entry_safe(entry, next, &lazy->pending, sibling_node) {
+		if (entry->parent == parent) {
+			list_del(&entry->sibling_node);
+			free(entry);
+		}
+	}
+}
+
+void dm_lazy_forget_node(ofnode node)
+{
+	struct dm_lazy *lazy = gd->dm_lazy;
+	struct dm_lazy_node *entry, *next;
+
+	if (!lazy)
+		return;
+	list_for_each_entry_safe(entry, next, &lazy->pending, sibling_node) {
+		if (ofnode_equal(entry->node, node)) {
+			list_del(&entry->sibling_node);
+			free(entry);
+			lazy->bound++;
+		}
+	}
+}
+
+void dm_lazy_stats(uint *deferred, uint *bound)
+{
+	struct dm_lazy *lazy = gd->dm_lazy;
+
+	*deferred = lazy ? lazy->deferred : 0;
+	*bound = lazy ? lazy->bound : 0;
+}
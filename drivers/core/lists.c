@@ -10,6 +10,7 @@
 
 #include <common.h>
 #include <errno.h>
+#include <malloc.h>
 #include <dm/device.h>
 #include <dm/device-internal.h>
 #include <dm/lists.h>
@@ -18,6 +19,157 @@
 #include <dm/util.h>
 #include <fdtdec.h>
 #include <linux/compiler.h>
+#include <linux/log2.h>
+
+DECLARE_GLOBAL_DATA_PTR;
+
+#if CONFIG_IS_ENABLED(DM_DRIVER_INDEX)
+/* Marks an empty slot in the driver index */
+#define DRIVER_INDEX_EMPTY	0xffff
+
+/**
+ * struct driver_compat - a compatible string in the driver index
+ *
+ * @drv: Number of the driver in the driver linker list
+ * @id: Number of the string in the driver's of_match list
+ */
+struct driver_compat {
+	u16 drv;
+	u16 id;
+};
+
+/**
+ * struct driver_index - hash tables to find a driver quickly
+ *
+ * Each table has a power-of-two number of slots, at least twice as many as
+ * there are entries, and an entry which collides goes in the next free slot.
+ * Where several drivers have the same name or compatible string only the
+ * first in the linker list is entered, so a lookup finds the same driver as
+ * walking the list would.
+ *
+ * @name_mask: Number of slots in @name, less one
+ * @compat_mask: Number of slots in @compat, less one
+ * @name: Number of the driver with the name in each slot
+ * @compat: Compatible string in each slot
+ */
+struct driver_index {
+	uint name_mask;
+	uint compat_mask;
+	u16 *name;
+	struct driver_compat *compat;
+};
+
+static uint driver_index_hash(const char *str)
+{
+	uint hash = 5381;
+
+	while (*str)
+		hash = hash * 33 + (u8)*str++;
+
+	return hash;
+}
+
+/* Find the slot holding @name, or else the empty slot where it would go */
+static uint driver_index_find_name(struct driver_index *idx,
+				   struct driver *driver, const char *name)
+{
+	uint slot = driver_index_hash(name) & idx->name_mask;
+
+	while (idx->name[slot] != DRIVER_INDEX_EMPTY &&
+	       strcmp(driver[idx->name[slot]].name, name))
+		slot = (slot + 1) & idx->name_mask;
+
+	return slot;
+}
+
+#if CONFIG_IS_ENABLED(OF_CONTROL) && !CONFIG_IS_ENABLED(OF_PLATDATA)
+/* Find the slot holding @compat, or else the empty slot where it would go */
+static uint driver_index_find_compat(struct driver_index *idx,
+				     struct driver *driver, const char *compat)
+{
+	uint slot = driver_index_hash(compat) & idx->compat_mask;
+	struct driver_compat *entry;
+
+	for (;; slot = (slot + 1) & idx->compat_mask) {
+		entry = &idx->compat[slot];
+		if (entry->drv == DRIVER_INDEX_EMPTY ||
+		    !strcmp(driver[entry->drv].of_match[entry->id].compatible,
+			    compat))
+			return slot;
+	}
+}
+#endif
+
+/**
+ * driver_index_get() - Get the driver index, building it if needed
+ *
+ * The index is built in the first call once the full malloc() area is
+ * available. Before that, drivers are found by walking the driver list, so
+ * that the small early malloc() area is left for devices.
+ *
+ * @return index, or NULL if there is not enough memory for it
+ */
+static struct driver_index *driver_index_get(void)
+{
+	struct driver *driver = ll_entry_start(struct driver, driver);
+	const int n_ents = ll_entry_count(struct driver, driver);
+	struct driver_index *idx = gd->driver_index;
+	const struct udevice_id *of_id;
+	uint name_slots, compat_slots = 1, slot;
+	int n_compat = 0;
+	size_t size;
+	int i;
+
+	if (idx || n_ents >= DRIVER_INDEX_EMPTY ||
+	    !(gd->flags & GD_FLG_FULL_MALLOC_INIT))
+		return idx;
+
+	if (CONFIG_IS_ENABLED(OF_CONTROL) &&
+	    !CONFIG_IS_ENABLED(OF_PLATDATA)) {
+		for (i = 0; i < n_ents; i++) {
+			for (of_id = driver[i].of_match;
+			     of_id && of_id->compatible; of_id++)
+				n_compat++;
+		}
+		compat_slots = roundup_pow_of_two(n_compat * 2 + 1);
+	}
+	name_slots = roundup_pow_of_two(n_ents * 2 + 1);
+	size = sizeof(*idx) + compat_slots * sizeof(*idx->compat) +
+		name_slots * sizeof(*idx->name);
+	idx = malloc(size);
+	if (!idx)
+		return NULL;
+	idx->name_mask = name_slots - 1;
+	idx->compat_mask = compat_slots - 1;
+	idx->compat = (struct driver_compat *)(idx + 1);
+	idx->name = (u16 *)(idx->compat + compat_slots);
+	memset(idx->compat, 0xff, compat_slots * sizeof(*idx->compat));
+	memset(idx->name, 0xff, name_slots * sizeof(*idx->name));
+
+	for (i = 0; i < n_ents; i++) {
+		slot = driver_index_find_name(idx, driver, driver[i].name);
+		if (idx->name[slot] == DRIVER_INDEX_EMPTY)
+			idx->name[slot] = i;
+#if CONFIG_IS_ENABLED(OF_CONTROL) && !CONFIG_IS_ENABLED(OF_PLATDATA)
+		for (of_id = driver[i].of_match; of_id && of_id->compatible;
+		     of_id++) {
+			slot = driver_index_find_compat(idx, driver,
+							of_id->compatible);
+			if (idx->compat[slot].drv == DRIVER_INDEX_EMPTY) {
+				idx->compat[slot].drv = i;
+				idx->compat[slot].id = of_id -
+					driver[i].of_match;
+			}
+		}
+#endif
+	}
+	gd->driver_index = idx;
+	log_debug("indexed %d drivers, %d compatible strings\n", n_ents,
+		  n_compat);
+
+	return idx;
+}
+#endif
 
 struct driver *lists_driver_lookup_name(const char *name)
 {
@@ -26,6 +178,18 @@ struct driver *lists_driver_lookup_name(const char *name)
 	const int n_ents = ll_entry_count(struct driver, driver);
 	struct driver *entry;
 
+#if CONFIG_IS_ENABLED(DM_DRIVER_INDEX)
+	struct driver_index *idx = driver_index_get();
+	uint slot;
+
+	if (idx) {
+		slot = driver_index_find_name(idx, drv, name);
+		if (idx->name[slot] == DRIVER_INDEX_EMPTY)
+			return NULL;
+
+		return drv + idx->name[slot];
+	}
+#endif
 	for (entry = drv; entry != drv + n_ents; entry++) {
 		if (!strcmp(name, entry->name))
 			return entry;
@@ -124,11 +288,39 @@ static int driver_check_compatible(const struct udevice_id *of_match,
 	return -ENOENT;
 }
 
-int lists_bind_fdt(struct udevice *parent, ofnode node, struct udevice **devp,
-		   bool pre_reloc_only)
+struct driver *lists_driver_lookup_compatible(const char *compat,
+					      const struct udevice_id **of_idp)
 {
 	struct driver *driver = ll_entry_start(struct driver, driver);
 	const int n_ents = ll_entry_count(struct driver, driver);
+	struct driver *entry;
+
+#if CONFIG_IS_ENABLED(DM_DRIVER_INDEX)
+	struct driver_index *idx = driver_index_get();
+	struct driver_compat *found;
+
+	if (idx) {
+		found = &idx->compat[driver_index_find_compat(idx, driver,
+							      compat)];
+		if (found->drv == DRIVER_INDEX_EMPTY)
+			return NULL;
+		entry = driver + found->drv;
+		*of_idp = entry->of_match + found->id;
+
+		return entry;
+	}
+#endif
+	for (entry = driver; entry != driver + n_ents; entry++) {
+		if (!driver_check_compatible(entry->of_match, of_idp, compat))
+			return entry;
+	}
+
+	return NULL;
+}
+
+int lists_bind_fdt(struct udevice *parent, ofnode node, struct udevice **devp,
+		   bool pre_reloc_only)
+{
 	const struct udevice_id *id;
 	struct driver *entry;
 	struct udevice *dev;
@@ -165,13 +357,8 @@ int lists_bind_fdt(struct udevice *parent, ofnode node, struct udevice **devp,
 		log_debug("   - attempt to match compatible string '%s'\n",
 			  compat);
 
-		for (entry = driver; entry != driver + n_ents; entry++) {
-			ret = driver_check_compatible(entry->of_match, &id,
-						      compat);
-			if (!ret)
-				break;
-		}
-		if (entry == driver + n_ents)
+		entry = lists_driver_lookup_compatible(compat, &id);
+		if (!entry)
 			continue;
 
 		if (pre_reloc_only) {
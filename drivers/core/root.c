@@ -138,6 +138,8 @@ int dm_init(bool of_live)
 		return -EINVAL;
 	}
 	INIT_LIST_HEAD(&DM_UCLASS_ROOT_NON_CONST);
+	/* Nodes recorded for an earlier tree must not be bound to this one */
+	dm_lazy_uninit();
 
 #if defined(CONFIG_NEEDS_MANUAL_RELOC)
 	fix_drivers();
@@ -151,10 +153,10 @@ int dm_init(bool of_live)
 #if CONFIG_IS_ENABLED(OF_CONTROL)
 # if CONFIG_IS_ENABLED(OF_LIVE)
 	if (of_live)
-		DM_ROOT_NON_CONST->node = np_to_ofnode(gd->of_root);
+		dev_set_ofnode(DM_ROOT_NON_CONST, np_to_ofnode(gd->of_root));
 	else
 #endif
-		DM_ROOT_NON_CONST->node = offset_to_ofnode(0);
+		dev_set_ofnode(DM_ROOT_NON_CONST, offset_to_ofnode(0));
 #endif
 	ret = device_probe(DM_ROOT_NON_CONST);
 	if (ret)
@@ -168,6 +170,7 @@ int dm_uninit(void)
 	device_remove(dm_root(), DM_REMOVE_NORMAL);
 	device_unbind(dm_root());
 	gd->dm_root = NULL;
+	dm_lazy_uninit();
 
 	return 0;
 }
@@ -217,6 +220,14 @@ static int dm_scan_fdt_live(struct udevice *parent,
 			pr_debug("   - ignoring disabled device\n");
 			continue;
 		}
+		if (!pre_reloc_only) {
+			err = dm_lazy_add(parent, np_to_ofnode(np));
+			if (err != -ENOSYS) {
+				if (err && !ret)
+					ret = err;
+				continue;
+			}
+		}
 		err = lists_bind_fdt(parent, np_to_ofnode(np), NULL,
 				     pre_reloc_only);
 		if (err && !ret) {
@@ -275,6 +286,14 @@ static int dm_scan_fdt_node(struct udevice *parent, const void *blob,
 			pr_debug("   - ignoring disabled device\n");
 			continue;
 		}
+		if (!pre_reloc_only) {
+			err = dm_lazy_add(parent, offset_to_ofnode(offset));
+			if (err != -ENOSYS) {
+				if (err && !ret)
+					ret = err;
+				continue;
+			}
+		}
 		err = lists_bind_fdt(parent, offset_to_ofnode(offset), NULL,
 				     pre_reloc_only);
 		if (err && !ret) {
@@ -376,6 +395,11 @@ int dm_init_and_scan(bool pre_reloc_only)
 	}
 
 	if (CONFIG_IS_ENABLED(OF_CONTROL) && !CONFIG_IS_ENABLED(OF_PLATDATA)) {
+		if (!pre_reloc_only) {
+			ret = dm_lazy_init();
+			if (ret)
+				return ret;
+		}
 		ret = dm_extended_scan_fdt(gd->fdt_blob, pre_reloc_only);
 		if (ret) {
 			debug("dm_extended_scan_dt() failed: %d\n", ret);
@@ -15,12 +15,182 @@
 #include <dm/device.h>
 #include <dm/device-internal.h>
 #include <dm/lists.h>
+#include <dm/root.h>
 #include <dm/uclass.h>
 #include <dm/uclass-internal.h>
 #include <dm/util.h>
 
 DECLARE_GLOBAL_DATA_PTR;
 
+#if CONFIG_IS_ENABLED(DM_UCLASS_INDEX)
+/* Number of buckets in each table when a uclass is created */
+#define UCLASS_INDEX_MIN	16
+
+static inline bool uclass_indexed(struct uclass *uc)
+{
+	return uc->index;
+}
+
+static struct hlist_head *uclass_index_bucket(struct uclass *uc,
+					      enum dm_index_t type, ulong key)
+{
+	uint hash = (u64)key * 0x9e3779b97f4a7c15ULL >> 32;
+
+	return &uc->index[type * (uc->index_mask + 1) +
+			  (hash & uc->index_mask)];
+}
+
+/* Get the key to file @dev under in the @type table, if it has one */
+static bool uclass_index_key(struct udevice *dev, enum dm_index_t type,
+			     ulong *keyp)
+{
+	switch (type) {
+	case DM_INDEX_SEQ:
+		*keyp = dev->seq;
+		return dev->seq != -1;
+	case DM_INDEX_REQ_SEQ:
+		*keyp = dev->req_seq;
+		return dev->req_seq != -1;
+	case DM_INDEX_OFNODE:
+		if (!ofnode_valid(dev->node))
+			return false;
+		*keyp = ofnode_is_np(dev->node) ?
+			(ulong)ofnode_to_np(dev->node) :
+			(ulong)ofnode_to_offset(dev->node);
+		return true;
+#if CONFIG_IS_ENABLED(OF_CONTROL)
+	case DM_INDEX_PHANDLE:
+		if (!ofnode_valid(dev->node))
+			return false;
+		*keyp = dev_read_phandle(dev);
+		return *keyp > 0;
+#endif
+	default:
+		return false;
+	}
+}
+
+/*
+ * Add @dev to a table, after any devices already there with the same key, so
+ * that lookups find the first one bound, as a search of the list would
+ */
+static void uclass_index_add(struct uclass *uc, struct udevice *dev,
+			     enum dm_index_t type, ulong key)
+{
+	struct dm_index_node *entry = &dev->index_node[type];
+	struct hlist_head *head = uclass_index_bucket(uc, type, key);
+	struct hlist_node *last;
+
+	entry->key = key;
+	if (!head->first) {
+		hlist_add_head(&entry->node, head);
+		return;
+	}
+	for (last = head->first; last->next; last = last->next)
+		;
+	hlist_add_after(last, &entry->node);
+}
+
+/* File @dev under its current keys, leaving alone those which are unchanged */
+static void uclass_index_dev(struct uclass *uc, struct udevice *dev)
+{
+	enum dm_index_t type;
+	ulong key;
+
+	for (type = 0; type < DM_INDEX_COUNT; type++) {
+		struct dm_index_node *entry = &dev->index_node[type];
+		bool valid = uclass_index_key(dev, type, &key);
+
+		if (!hlist_unhashed(&entry->node)) {
+			if (valid && entry->key == key)
+				continue;
+			hlist_del_init(&entry->node);
+		}
+		if (valid)
+			uclass_index_add(uc, dev, type, key);
+	}
+}
+
+/* Double the size of the tables if they hold more devices than buckets */
+static void uclass_index_grow(struct uclass *uc)
+{
+	struct hlist_head *old = uc->index;
+	struct udevice *dev;
+	enum dm_index_t type;
+	uint size;
+
+	if (uc->dev_count <= uc->index_mask + 1)
+		return;
+	size = (uc->index_mask + 1) * 2;
+	uc->index = calloc(DM_INDEX_COUNT * size, sizeof(struct hlist_head));
+	if (!uc->index) {
+		/* Carry on with longer chains */
+		uc->index = old;
+		return;
+	}
+	uc->index_mask = size - 1;
+	free(old);
+
+	/* The list is in bind order, so duplicate keys keep their order */
+	uclass_foreach_dev(dev, uc) {
+		for (type = 0; type < DM_INDEX_COUNT; type++) {
+			struct dm_index_node *entry = &dev->index_node[type];
+
+			if (!hlist_unhashed(&entry->node))
+				uclass_index_add(uc, dev, type, entry->key);
+		}
+	}
+}
+
+static struct udevice *uclass_index_find(struct uclass *uc,
+					 enum dm_index_t type, ulong key)
+{
+	struct hlist_node *pos;
+
+	hlist_for_each(pos, uclass_index_bucket(uc, type, key)) {
+		struct dm_index_node *entry;
+
+		entry = hlist_entry(pos, struct dm_index_node, node);
+		if (entry->key == key)
+			return container_of(entry - type, struct udevice,
+					    index_node[0]);
+	}
+
+	return NULL;
+}
+
+static void uclass_unindex_dev(struct udevice *dev)
+{
+	enum dm_index_t type;
+
+	for (type = 0; type < DM_INDEX_COUNT; type++)
+		hlist_del_init(&dev->index_node[type].node);
+	dev->uclass->dev_count--;
+}
+
+void device_reindex(struct udevice *dev)
+{
+	struct uclass *uc = dev->uclass;
+
+	if (uc->index && !list_empty(&dev->uclass_node))
+		uclass_index_dev(uc, dev);
+}
+#else
+static inline void uclass_unindex_dev(struct udevice *dev) {}
+
+static inline bool uclass_indexed(struct uclass *uc)
+{
+	return false;
+}
+
+static inline struct udevice *uclass_index_find(struct uclass *uc,
+						enum dm_index_t type,
+						ulong key)
+{
+	return NULL;
+}
+#endif
+
 struct uclass *uclass_find(enum uclass_id key)
 {
 	struct uclass *uc;
@@ -77,6 +247,18 @@ static int uclass_add(enum uclass_id id, struct uclass **ucp)
 			goto fail_mem;
 		}
 	}
+#if CONFIG_IS_ENABLED(DM_UCLASS_INDEX)
+	/*
+	 * Devices bound before relocation are bound again afterwards, so do
+	 * not spend the early malloc() area on them. Without tables the list
+	 * is searched instead.
+	 */
+	if (gd->flags & GD_FLG_FULL_MALLOC_INIT) {
+		uc->index = calloc(DM_INDEX_COUNT * UCLASS_INDEX_MIN,
+				   sizeof(struct hlist_head));
+		uc->index_mask = UCLASS_INDEX_MIN - 1;
+	}
+#endif
 	uc->uc_drv = uc_drv;
 	INIT_LIST_HEAD(&uc->sibling_node);
 	INIT_LIST_HEAD(&uc->dev_head);
@@ -98,6 +280,9 @@ fail:
 	}
 	list_del(&uc->sibling_node);
 fail_mem:
+#if CONFIG_IS_ENABLED(DM_UCLASS_INDEX)
+	free(uc->index);
+#endif
 	free(uc);
 
 	return ret;
@@ -132,6 +317,9 @@ int uclass_destroy(struct uclass *uc)
 	list_del(&uc->sibling_node);
 	if (uc_drv->priv_auto_alloc_size)
 		free(uc->priv);
+#if CONFIG_IS_ENABLED(DM_UCLASS_INDEX)
+	free(uc->index);
+#endif
 	free(uc);
 
 	return 0;
@@ -142,6 +330,7 @@ int uclass_get(enum uclass_id id, struct uclass **ucp)
 	struct uclass *uc;
 
 	*ucp = NULL;
+	dm_lazy_bind_uclass(id);
 	uc = uclass_find(id);
 	if (!uc)
 		return uclass_add(id, ucp);
@@ -308,6 +497,14 @@ int uclass_find_device_by_seq(enum uclass_id id, int seq_or_req_seq,
 	if (ret)
 		return ret;
 
+	if (uclass_indexed(uc)) {
+		*devp = uclass_index_find(uc, find_req_seq ? DM_INDEX_REQ_SEQ :
+					  DM_INDEX_SEQ, seq_or_req_seq);
+		log_debug("   - %s\n", *devp ? "found" : "not found");
+
+		return *devp ? 0 : -ENODEV;
+	}
+
 	uclass_foreach_dev(dev, uc) {
 		log_debug("   - %d %d '%s'\n",
 			  dev->req_seq, dev->seq, dev->name);
@@ -362,6 +559,16 @@ int uclass_find_device_by_ofnode(enum uclass_id id, ofnode node,
 	if (ret)
 		return ret;
 
+	if (uclass_indexed(uc)) {
+		ulong key = ofnode_is_np(node) ? (ulong)ofnode_to_np(node) :
+			(ulong)ofnode_to_offset(node);
+
+		*devp = uclass_index_find(uc, DM_INDEX_OFNODE, key);
+		if (!*devp)
+			ret = -ENODEV;
+		goto done;
+	}
+
 	uclass_foreach_dev(dev, uc) {
 		log(LOGC_DM, LOGL_DEBUG_CONTENT, "      - checking %s\n",
 		    dev->name);
@@ -395,6 +602,12 @@ int uclass_find_device_by_phandle(enum uclass_id id, struct udevice *parent,
 	if (ret)
 		return ret;
 
+	if (uclass_indexed(uc)) {
+		*devp = uclass_index_find(uc, DM_INDEX_PHANDLE, find_phandle);
+
+		return *devp ? 0 : -ENODEV;
+	}
+
 	uclass_foreach_dev(dev, uc) {
 		uint phandle;
 
@@ -522,6 +735,12 @@ int uclass_get_device_by_phandle_id(enum uclass_id id, uint phandle_id,
 	if (ret)
 		return ret;
 
+	if (uclass_indexed(uc) && phandle_id) {
+		dev = uclass_index_find(uc, DM_INDEX_PHANDLE, phandle_id);
+
+		return dev ? uclass_get_device_tail(dev, ret, devp) : -ENODEV;
+	}
+
 	uclass_foreach_dev(dev, uc) {
 		uint phandle;
 
@@ -649,6 +868,13 @@ int uclass_bind_device(struct udevice *dev)
 
 	uc = dev->uclass;
 	list_add_tail(&dev->uclass_node, &uc->dev_head);
+#if CONFIG_IS_ENABLED(DM_UCLASS_INDEX)
+	uc->dev_count++;
+	if (uc->index) {
+		uclass_index_grow(uc);
+		uclass_index_dev(uc, dev);
+	}
+#endif
 
 	if (dev->parent) {
 		struct uclass_driver *uc_drv = dev->parent->uclass->uc_drv;
@@ -663,6 +889,7 @@ int uclass_bind_device(struct udevice *dev)
 	return 0;
 err:
 	/* There is no need to undo the parent's post_bind call */
+	uclass_unindex_dev(dev);
 	list_del(&dev->uclass_node);
 
 	return ret;
@@ -681,6 +908,7 @@ int uclass_unbind_device(struct udevice *dev)
 			return ret;
 	}
 
+	uclass_unindex_dev(dev);
 	list_del(&dev->uclass_node);
 	return 0;
 }
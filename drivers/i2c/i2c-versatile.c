@@ -255,6 +255,7 @@ static int versatile_i2c_probe(struct udevice *dev)
 	 * sequence numbers to devices
 	 */
 	dev->req_seq = 1;
+	device_reindex(dev);
 
 	return 0;
 }
@@ -282,6 +282,7 @@ static int lpc32xx_i2c_probe(struct udevice *bus)
 {
 	struct lpc32xx_i2c_dev *dev = dev_get_platdata(bus);
 	bus->seq = dev->index;
+	device_reindex(bus);
 
 	__i2c_init(dev->base, dev->speed, 0, dev->index);
 	return 0;
@@ -399,11 +399,12 @@ static int mmc_select_hwpart(struct udevice *bdev, int hwpart)
 	if (mmc->part_config == MMCPART_NOAVAILABLE)
 		return -EMEDIUMTYPE;
 
-	ret = mmc_switch_part(mmc, hwpart);
-	if (!ret)
-		blkcache_invalidate(desc->if_type, desc->devnum);
+	/* dirty blocks must reach the partition they were written to */
+	ret = blkcache_flush(desc->if_type, desc->devnum);
+	if (ret)
+		return ret;
 
-	return ret;
+	return mmc_switch_part(mmc, hwpart);
 }
 
 static int mmc_blk_probe(struct udevice *dev)
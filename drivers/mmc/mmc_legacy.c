@@ -233,6 +233,10 @@ static int mmc_select_hwpartp(struct blk_desc *desc, int hwpart)
 	if (mmc->part_config == MMCPART_NOAVAILABLE)
 		return -EMEDIUMTYPE;
 
+	ret = blkcache_flush(desc->if_type, desc->devnum);
+	if (ret)
+		return ret;
+
 	ret = mmc_switch_part(mmc, hwpart);
 	if (ret)
 		return ret;
@@ -217,6 +217,8 @@ static void rx_descs_init(struct dw_eth_dev *priv)
 
 	writel((ulong)&desc_table_p[0], &dma_p->rxdesclistaddr);
 	priv->rx_currdescnum = 0;
+	priv->rx_pending = 0;
+	priv->rx_refilled = false;
 }
 
 static int _dw_write_hwaddr(struct dw_eth_dev *priv, u8 *mac_id)
@@ -424,6 +426,18 @@ static int _dw_eth_send(struct dw_eth_dev *priv, void *packet, int length)
 	return 0;
 }
 
+/*
+ * Resume the receive DMA if descriptors were given back since the last
+ * call. It suspends when it runs into a descriptor owned by the CPU.
+ */
+static void _dw_eth_rx_poll(struct dw_eth_dev *priv)
+{
+	if (priv->rx_refilled) {
+		writel(POLL_DATA, &priv->dma_regs_p->rxpolldemand);
+		priv->rx_refilled = false;
+	}
+}
+
 static int _dw_eth_recv(struct dw_eth_dev *priv, uchar **packetp)
 {
 	u32 status, desc_num = priv->rx_currdescnum;
@@ -435,6 +449,10 @@ static int _dw_eth_recv(struct dw_eth_dev *priv, uchar **packetp)
 	ulong data_start = desc_p->dmamac_addr;
 	ulong data_end;
 
+	/* All descriptors are owned by the CPU and still in use */
+	if (priv->rx_pending >= CONFIG_RX_DESCR_NUM)
+		return -EAGAIN;
+
 	/* Invalidate entire buffer descriptor */
 	invalidate_dcache_range(desc_start, desc_end);
 
@@ -450,32 +468,39 @@ static int _dw_eth_recv(struct dw_eth_dev *priv, uchar **packetp)
 		data_end = data_start + roundup(length, ARCH_DMA_MINALIGN);
 		invalidate_dcache_range(data_start, data_end);
 		*packetp = (uchar *)(ulong)desc_p->dmamac_addr;
+
+		/*
+		 * Go to the next descriptor now; this one is given back to
+		 * the DMA by _dw_free_pkt() based on the buffer address.
+		 */
+		if (++desc_num >= CONFIG_RX_DESCR_NUM)
+			desc_num = 0;
+		priv->rx_currdescnum = desc_num;
+		priv->rx_pending++;
 	}
 
 	return length;
 }
 
-static int _dw_free_pkt(struct dw_eth_dev *priv)
+static int _dw_free_pkt(struct dw_eth_dev *priv, uchar *packet)
 {
-	u32 desc_num = priv->rx_currdescnum;
+	u32 desc_num = (packet - (uchar *)priv->rxbuffs) / CONFIG_ETH_BUFSIZE;
 	struct dmamacdescr *desc_p = &priv->rx_mac_descrtable[desc_num];
 	ulong desc_start = (ulong)desc_p;
 	ulong desc_end = desc_start +
 		roundup(sizeof(*desc_p), ARCH_DMA_MINALIGN);
 
-	/*
-	 * Make the current descriptor valid again and go to
-	 * the next one
-	 */
+	if (desc_num >= CONFIG_RX_DESCR_NUM || !priv->rx_pending)
+		return -EINVAL;
+
+	/* Make the descriptor valid again */
 	desc_p->txrx_status |= DESC_RXSTS_OWNBYDMA;
 
 	/* Flush only status field - others weren't changed */
 	flush_dcache_range(desc_start, desc_end);
 
-	/* Test the wrap-around condition. */
-	if (++desc_num >= CONFIG_RX_DESCR_NUM)
-		desc_num = 0;
-	priv->rx_currdescnum = desc_num;
+	priv->rx_pending--;
+	priv->rx_refilled = true;
 
 	return 0;
 }
@@ -529,12 +554,13 @@ static int dw_eth_recv(struct eth_device *dev)
 	uchar *packet;
 	int length;
 
+	_dw_eth_rx_poll(dev->priv);
 	length = _dw_eth_recv(dev->priv, &packet);
 	if (length == -EAGAIN)
 		return 0;
 	net_process_received_packet(packet, length);
 
-	_dw_free_pkt(dev->priv);
+	_dw_free_pkt(dev->priv, packet);
 
 	return 0;
 }
@@ -631,14 +657,35 @@ int designware_eth_recv(struct udevice *dev, int flags, uchar **packetp)
 {
 	struct dw_eth_dev *priv = dev_get_priv(dev);
 
+	if (flags & ETH_RECV_CHECK_DEVICE)
+		_dw_eth_rx_poll(priv);
+
 	return _dw_eth_recv(priv, packetp);
 }
 
+int designware_eth_recv_batch(struct udevice *dev, int flags, uchar **packets,
+			      int *lengths, int max)
+{
+	struct dw_eth_dev *priv = dev_get_priv(dev);
+	int count, length;
+
+	_dw_eth_rx_poll(priv);
+
+	for (count = 0; count < max; count++) {
+		length = _dw_eth_recv(priv, &packets[count]);
+		if (length < 0)
+			break;
+		lengths[count] = length;
+	}
+
+	return count;
+}
+
 int designware_eth_free_pkt(struct udevice *dev, uchar *packet, int length)
 {
 	struct dw_eth_dev *priv = dev_get_priv(dev);
 
-	return _dw_free_pkt(priv);
+	return _dw_free_pkt(priv, packet);
 }
 
 void designware_eth_stop(struct udevice *dev)
@@ -801,6 +848,7 @@ const struct eth_ops designware_eth_ops = {
 	.start			= designware_eth_start,
 	.send			= designware_eth_send,
 	.recv			= designware_eth_recv,
+	.recv_batch		= designware_eth_recv_batch,
 	.free_pkt		= designware_eth_free_pkt,
 	.stop			= designware_eth_stop,
 	.write_hwaddr		= designware_eth_write_hwaddr,
@@ -16,13 +16,12 @@
 #include <linux/compat.h>
 #include "nvme.h"
 
-#define NVME_Q_DEPTH		2
+#define NVME_Q_DEPTH		CONFIG_NVME_IO_QUEUE_DEPTH
 #define NVME_AQ_DEPTH		2
 #define NVME_SQ_SIZE(depth)	(depth * sizeof(struct nvme_command))
 #define NVME_CQ_SIZE(depth)	(depth * sizeof(struct nvme_completion))
 #define ADMIN_TIMEOUT		60
 #define IO_TIMEOUT		30
-#define MAX_PRP_POOL		512
 
 enum nvme_queue_id {
 	NVME_ADMIN_Q,
@@ -69,8 +68,8 @@ static int nvme_wait_ready(struct nvme_dev *dev, bool enabled)
 	return -ETIME;
 }
 
-static int nvme_setup_prps(struct nvme_dev *dev, u64 *prp2,
-			   int total_len, u64 dma_addr)
+static int nvme_setup_prps(struct nvme_dev *dev, struct nvme_io_slot *slot,
+			   u64 *prp2, int total_len, u64 dma_addr)
 {
 	u32 page_size = dev->page_size;
 	int offset = dma_addr & (page_size - 1);
@@ -98,37 +97,38 @@ static int nvme_setup_prps(struct nvme_dev *dev, u64 *prp2,
 	nprps = DIV_ROUND_UP(length, page_size);
 	num_pages = DIV_ROUND_UP(nprps, prps_per_page);
 
-	if (nprps > dev->prp_entry_num) {
-		free(dev->prp_pool);
+	if (nprps > slot->prp_entry_num) {
+		free(slot->prp_pool);
 		/*
 		 * Always increase in increments of pages.  It doesn't waste
 		 * much memory and reduces the number of allocations.
 		 */
-		dev->prp_pool = memalign(page_size, num_pages * page_size);
-		if (!dev->prp_pool) {
+		slot->prp_pool = memalign(page_size, num_pages * page_size);
+		if (!slot->prp_pool) {
+			slot->prp_entry_num = 0;
 			printf("Error: malloc prp_pool fail\n");
 			return -ENOMEM;
 		}
-		dev->prp_entry_num = prps_per_page * num_pages;
+		slot->prp_entry_num = prps_per_page * num_pages;
 	}
 
-	prp_pool = dev->prp_pool;
+	prp_pool = slot->prp_pool;
 	i = 0;
 	while (nprps) {
 		if (i == ((page_size >> 3) - 1)) {
 			*(prp_pool + i) = cpu_to_le64((ulong)prp_pool +
 					page_size);
 			i = 0;
-			prp_pool += page_size;
+			prp_pool += page_size >> 3;
 		}
 		*(prp_pool + i++) = cpu_to_le64(dma_addr);
 		dma_addr += page_size;
 		nprps--;
 	}
-	*prp2 = (ulong)dev->prp_pool;
+	*prp2 = (ulong)slot->prp_pool;
 
-	flush_dcache_range((ulong)dev->prp_pool, (ulong)dev->prp_pool +
-			   dev->prp_entry_num * sizeof(u64));
+	flush_dcache_range((ulong)slot->prp_pool, (ulong)slot->prp_pool +
+			   num_pages * page_size);
 
 	return 0;
 }
@@ -151,12 +151,16 @@ static u16 nvme_read_completion_status(struct nvme_queue *nvmeq, u16 index)
 }
 
 /**
- * nvme_submit_cmd() - copy a command into a queue and ring the doorbell
+ * nvme_queue_cmd() - copy a command into a queue without ringing the doorbell
+ *
+ * The command is only seen by the controller once nvme_ring_sq_doorbell()
+ * is called, which allows several commands to be posted with one doorbell
+ * write.
  *
  * @nvmeq:	The queue to use
  * @cmd:	The command to send
  */
-static void nvme_submit_cmd(struct nvme_queue *nvmeq, struct nvme_command *cmd)
+static void nvme_queue_cmd(struct nvme_queue *nvmeq, struct nvme_command *cmd)
 {
 	u16 tail = nvmeq->sq_tail;
 
@@ -166,10 +170,26 @@ static void nvme_submit_cmd(struct nvme_queue *nvmeq, struct nvme_command *cmd)
 
 	if (++tail == nvmeq->q_depth)
 		tail = 0;
-	writel(tail, nvmeq->q_db);
 	nvmeq->sq_tail = tail;
 }
 
+static void nvme_ring_sq_doorbell(struct nvme_queue *nvmeq)
+{
+	writel(nvmeq->sq_tail, nvmeq->q_db);
+}
+
+/**
+ * nvme_submit_cmd() - copy a command into a queue and ring the doorbell
+ *
+ * @nvmeq:	The queue to use
+ * @cmd:	The command to send
+ */
+static void nvme_submit_cmd(struct nvme_queue *nvmeq, struct nvme_command *cmd)
+{
+	nvme_queue_cmd(nvmeq, cmd);
+	nvme_ring_sq_doorbell(nvmeq);
+}
+
 static int nvme_submit_sync_cmd(struct nvme_queue *nvmeq,
 				struct nvme_command *cmd,
 				u32 *result, unsigned timeout)
@@ -224,6 +244,68 @@ static int nvme_submit_sync_cmd(struct nvme_queue *nvmeq,
 	return status;
 }
 
+/**
+ * nvme_reap_io_cmds() - collect a batch of I/O command completions
+ *
+ * Wait for at least one completion on @nvmeq, then consume every further
+ * completion entry that is already posted and update the completion queue
+ * head doorbell once for the whole batch.
+ *
+ * @nvmeq:	The I/O queue to poll
+ * @slots:	Per-command state, indexed by command identifier
+ * @err_lba:	Updated with the lowest starting LBA of a failed command
+ * @timeout:	Timeout, in the same units as nvme_submit_sync_cmd()
+ * @return number of completions reaped, or -ETIMEDOUT
+ */
+static int nvme_reap_io_cmds(struct nvme_queue *nvmeq,
+			     struct nvme_io_slot *slots, u64 *err_lba,
+			     unsigned timeout)
+{
+	u16 head = nvmeq->cq_head;
+	u16 phase = nvmeq->cq_phase;
+	u16 status;
+	ulong start_time;
+	ulong timeout_us = timeout * 100000;
+	int reaped = 0;
+
+	start_time = timer_get_us();
+
+	for (;;) {
+		status = nvme_read_completion_status(nvmeq, head);
+		if ((status & 0x01) == phase)
+			break;
+		if (timeout_us > 0 && (timer_get_us() - start_time)
+		    >= timeout_us)
+			return -ETIMEDOUT;
+	}
+
+	do {
+		u16 cmdid = le16_to_cpu(readw(&nvmeq->cqes[head].command_id));
+
+		if (cmdid < nvmeq->q_depth && slots[cmdid].busy) {
+			slots[cmdid].busy = false;
+			if (status >> 1) {
+				printf("ERROR: status = %x, phase = %d, head = %d\n",
+				       status >> 1, phase, head);
+				*err_lba = min(*err_lba, slots[cmdid].slba);
+			}
+		}
+		reaped++;
+
+		if (++head == nvmeq->q_depth) {
+			head = 0;
+			phase = !phase;
+		}
+		status = nvme_read_completion_status(nvmeq, head);
+	} while ((status & 0x01) == phase);
+
+	writel(head, nvmeq->q_db + nvmeq->dev->db_stride);
+	nvmeq->cq_head = head;
+	nvmeq->cq_phase = phase;
+
+	return reaped;
+}
+
 static int nvme_submit_admin_cmd(struct nvme_dev *dev, struct nvme_command *cmd,
 				 u32 *result)
 {
@@ -327,6 +409,19 @@ static void nvme_free_queues(struct nvme_dev *dev, int lowest)
 	}
 }
 
+static void nvme_free_io_slots(struct nvme_dev *dev)
+{
+	int i;
+
+	if (!dev->io_slots)
+		return;
+
+	for (i = 0; i < dev->q_depth; i++)
+		free(dev->io_slots[i].prp_pool);
+	free(dev->io_slots);
+	dev->io_slots = NULL;
+}
+
 static void nvme_init_queue(struct nvme_queue *nvmeq, u16 qid)
 {
 	struct nvme_dev *dev = nvmeq->dev;
@@ -708,25 +803,44 @@ static int nvme_blk_probe(struct udevice *udev)
 	return 0;
 }
 
+/*
+ * Reads and writes are split into chunks of at most the controller's
+ * maximum data transfer size. As many chunks as the I/O queue can hold are
+ * posted with a single doorbell write, and completions are then reaped in
+ * batches, refilling the queue as slots become free.
+ */
 static ulong nvme_blk_rw(struct udevice *udev, lbaint_t blknr,
 			 lbaint_t blkcnt, void *buffer, bool read)
 {
 	struct nvme_ns *ns = dev_get_priv(udev);
 	struct nvme_dev *dev = ns->dev;
+	struct nvme_queue *nvmeq = dev->queues[NVME_IO_Q];
+	struct nvme_io_slot *slots = dev->io_slots;
 	struct nvme_command c;
 	struct blk_desc *desc = dev_get_uclass_platdata(udev);
-	int status;
+	void *start = buffer;
+	int max_inflight = nvmeq->q_depth - 1;
+	int inflight = 0;
+	int next_slot = 0;
+	int ret;
 	u64 prp2;
 	u64 total_len = blkcnt << desc->log2blksz;
-	u64 temp_len = total_len;
 
 	u64 slba = blknr;
-	u16 lbas = 1 << (dev->max_transfer_shift - ns->lba_shift);
+	u64 end_lba = blknr + blkcnt;
+	u64 err_lba = end_lba;
+	u32 max_lbas = 1 << (dev->max_transfer_shift - ns->lba_shift);
+	u32 lbas;
 	u64 total_lbas = blkcnt;
 
+	/* The command length field is 16 bits wide */
+	max_lbas = min_t(u32, max_lbas, 0x10000);
+
 	flush_dcache_range((unsigned long)buffer,
 			   (unsigned long)buffer + total_len);
 
+	memset(&c, 0, sizeof(c));
+
 	c.rw.opcode = read ? nvme_cmd_read : nvme_cmd_write;
 	c.rw.flags = 0;
 	c.rw.nsid = cpu_to_le32(ns->ns_id);
@@ -737,35 +851,72 @@ static ulong nvme_blk_rw(struct udevice *udev, lbaint_t blknr,
 	c.rw.appmask = 0;
 	c.rw.metadata = 0;
 
-	while (total_lbas) {
-		if (total_lbas < lbas) {
-			lbas = (u16)total_lbas;
-			total_lbas = 0;
-		} else {
+	while (total_lbas || inflight) {
+		bool queued = false;
+
+		/* Fill the submission queue, then ring the doorbell once */
+		while (total_lbas && inflight < max_inflight &&
+		       err_lba == end_lba) {
+			struct nvme_io_slot *slot;
+
+			while (slots[next_slot].busy)
+				next_slot = (next_slot + 1) % max_inflight;
+			slot = &slots[next_slot];
+
+			lbas = min_t(u64, total_lbas, max_lbas);
+			if (nvme_setup_prps(dev, slot, &prp2,
+					    lbas << ns->lba_shift,
+					    (ulong)buffer)) {
+				err_lba = slba;
+				break;
+			}
+
+			c.rw.command_id = cpu_to_le16(next_slot);
+			c.rw.slba = cpu_to_le64(slba);
+			c.rw.length = cpu_to_le16(lbas - 1);
+			c.rw.prp1 = cpu_to_le64((ulong)buffer);
+			c.rw.prp2 = cpu_to_le64(prp2);
+			nvme_queue_cmd(nvmeq, &c);
+
+			slot->slba = slba;
+			slot->busy = true;
+			inflight++;
+			queued = true;
+
+			slba += lbas;
 			total_lbas -= lbas;
+			buffer += (u64)lbas << ns->lba_shift;
 		}
 
-		if (nvme_setup_prps(dev, &prp2,
-				    lbas << ns->lba_shift, (ulong)buffer))
-			return -EIO;
-		c.rw.slba = cpu_to_le64(slba);
-		slba += lbas;
-		c.rw.length = cpu_to_le16(lbas - 1);
-		c.rw.prp1 = cpu_to_le64((ulong)buffer);
-		c.rw.prp2 = cpu_to_le64(prp2);
-		status = nvme_submit_sync_cmd(dev->queues[NVME_IO_Q],
-				&c, NULL, IO_TIMEOUT);
-		if (status)
+		if (queued)
+			nvme_ring_sq_doorbell(nvmeq);
+
+		/* Stop submitting after an error, but drain what is queued */
+		if (err_lba != end_lba)
+			total_lbas = 0;
+		if (!inflight)
+			break;
+
+		ret = nvme_reap_io_cmds(nvmeq, slots, &err_lba, IO_TIMEOUT);
+		if (ret < 0) {
+			printf("Error: %s: I/O timeout\n", udev->name);
+			for (next_slot = 0; next_slot < max_inflight;
+			     next_slot++) {
+				if (!slots[next_slot].busy)
+					continue;
+				err_lba = min(err_lba, slots[next_slot].slba);
+				slots[next_slot].busy = false;
+			}
 			break;
-		temp_len -= (u32)lbas << ns->lba_shift;
-		buffer += lbas << ns->lba_shift;
+		}
+		inflight -= ret;
 	}
 
 	if (read)
-		invalidate_dcache_range((unsigned long)buffer,
-					(unsigned long)buffer + total_len);
+		invalidate_dcache_range((unsigned long)start,
+					(unsigned long)start + total_len);
 
-	return (total_len - temp_len) >> desc->log2blksz;
+	return err_lba - blknr;
 }
 
 static ulong nvme_blk_read(struct udevice *udev, lbaint_t blknr,
@@ -836,34 +987,51 @@ static int nvme_probe(struct udevice *udev)
 	if (ret)
 		goto free_queue;
 
-	/* Allocate after the page size is known */
-	ndev->prp_pool = memalign(ndev->page_size, MAX_PRP_POOL);
-	if (!ndev->prp_pool) {
+	/* PRP lists are allocated per slot on first use */
+	ndev->io_slots = calloc(ndev->q_depth, sizeof(struct nvme_io_slot));
+	if (!ndev->io_slots) {
 		ret = -ENOMEM;
 		printf("Error: %s: Out of memory!\n", udev->name);
-		goto free_nvme;
+		goto free_queue;
 	}
-	ndev->prp_entry_num = MAX_PRP_POOL >> 3;
 
 	ret = nvme_setup_io_queues(ndev);
 	if (ret)
-		goto free_queue;
+		goto free_slots;
 
 	nvme_get_info_from_identify(ndev);
 
 	return 0;
 
+free_slots:
+	nvme_free_io_slots(ndev);
 free_queue:
+	nvme_free_queues(ndev, 0);
 	free((void *)ndev->queues);
+	ndev->queues = NULL;
 free_nvme:
 	return ret;
 }
 
+static int nvme_remove(struct udevice *udev)
+{
+	struct nvme_dev *ndev = dev_get_priv(udev);
+
+	nvme_disable_ctrl(ndev);
+	nvme_free_io_slots(ndev);
+	nvme_free_queues(ndev, 0);
+	free((void *)ndev->queues);
+	ndev->queues = NULL;
+
+	return 0;
+}
+
 U_BOOT_DRIVER(nvme) = {
 	.name	= "nvme",
 	.id	= UCLASS_NVME,
 	.bind	= nvme_bind,
 	.probe	= nvme_probe,
+	.remove	= nvme_remove,
 	.priv_auto_alloc_size = sizeof(struct nvme_dev),
 };
 
@@ -624,9 +624,20 @@ struct nvme_dev {
 	u32 stripe_size;
 	u32 page_size;
 	u8 vwc;
+	struct nvme_io_slot *io_slots;
+	u32 nn;
+};
+
+/*
+ * Per-command state of the I/O queue. Each submission queue slot owns its
+ * own PRP list so that several read/write commands can be in flight at the
+ * same time.
+ */
+struct nvme_io_slot {
 	u64 *prp_pool;
 	u32 prp_entry_num;
-	u32 nn;
+	u64 slba;
+	bool busy;
 };
 
 /*
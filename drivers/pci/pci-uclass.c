@@ -986,6 +986,7 @@ static int pci_uclass_pre_probe(struct udevice *bus)
 	 */
 	if (bus->seq == -1) {
 		bus->seq = uclass_find_next_free_req_seq(UCLASS_PCI);
+		device_reindex(bus);
 	}
 
 	/* For bridges, use the top-level PCI controller */
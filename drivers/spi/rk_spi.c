@@ -185,6 +185,7 @@ static int conv_of_platdata(struct udevice *dev)
 	if (ret < 0)
 		return ret;
 	dev->req_seq = 0;
+	device_reindex(dev);
 
 	return 0;
 }
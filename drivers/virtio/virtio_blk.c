@@ -10,48 +10,153 @@
 #include <virtio_types.h>
 #include <virtio.h>
 #include <virtio_ring.h>
+#include <dm/devres.h>
+#include <linux/sizes.h>
 #include "virtio_blk.h"
 
+/*
+ * Header and status of a request. Requests are identified on completion by
+ * the address of their header, which is their first buffer.
+ */
+struct virtio_blk_req {
+	struct virtio_blk_outhdr out_hdr;
+	u8 status;
+	bool busy;
+	u64 sector;
+};
+
 struct virtio_blk_priv {
 	struct virtqueue *vq;
+	struct virtio_blk_req *reqs;	/* one per ring entry */
+	unsigned int num_reqs;
+	u32 seg_max;			/* data buffers per request */
+	u32 size_max;			/* bytes per data buffer */
 };
 
-static ulong virtio_blk_do_req(struct udevice *dev, u64 sector,
-			       lbaint_t blkcnt, void *buffer, u32 type)
+/* Most data buffers put in a single request */
+#define VIRTIO_BLK_MAX_SEGS	64
+
+static struct virtio_blk_req *virtio_blk_get_req(struct virtio_blk_priv *priv)
+{
+	unsigned int i;
+
+	for (i = 0; i < priv->num_reqs; i++) {
+		if (!priv->reqs[i].busy) {
+			priv->reqs[i].busy = true;
+			return &priv->reqs[i];
+		}
+	}
+
+	return NULL;
+}
+
+/*
+ * Queue one request covering as much of the buffer as the segment limits
+ * allow, without kicking the device
+ *
+ * @return number of sectors queued, 0 if the queue is full
+ */
+static lbaint_t virtio_blk_queue_req(struct udevice *dev, u64 sector,
+				     lbaint_t blkcnt, void *buffer, u32 type)
 {
 	struct virtio_blk_priv *priv = dev_get_priv(dev);
-	unsigned int num_out = 0, num_in = 0;
-	struct virtio_sg *sgs[3];
-	u8 status;
-	int ret;
+	struct virtio_sg sg[VIRTIO_BLK_MAX_SEGS + 2];
+	struct virtio_sg *sgs[VIRTIO_BLK_MAX_SEGS + 2];
+	unsigned int num_out = 0, num_in = 0, nsegs, i;
+	struct virtio_blk_req *req;
+	u64 len;
 
-	struct virtio_blk_outhdr out_hdr = {
-		.type = cpu_to_virtio32(dev, type),
-		.sector = cpu_to_virtio64(dev, sector),
-	};
-	struct virtio_sg hdr_sg = { &out_hdr, sizeof(out_hdr) };
-	struct virtio_sg data_sg = { buffer, blkcnt * 512 };
-	struct virtio_sg status_sg = { &status, sizeof(status) };
+	len = min_t(u64, (u64)blkcnt * 512, (u64)priv->seg_max * priv->size_max);
+	nsegs = DIV_ROUND_UP(len, priv->size_max);
+	if (priv->vq->num_free < (priv->vq->indirect ? 1 : nsegs + 2))
+		return 0;
 
-	sgs[num_out++] = &hdr_sg;
+	req = virtio_blk_get_req(priv);
+	if (!req)
+		return 0;
 
-	if (type & VIRTIO_BLK_T_OUT)
-		sgs[num_out++] = &data_sg;
-	else
-		sgs[num_out + num_in++] = &data_sg;
+	req->out_hdr.type = cpu_to_virtio32(dev, type);
+	req->out_hdr.ioprio = 0;
+	req->out_hdr.sector = cpu_to_virtio64(dev, sector);
+	req->sector = sector;
+	sg[0].addr = &req->out_hdr;
+	sg[0].length = sizeof(req->out_hdr);
+	for (i = 0; i < nsegs; i++) {
+		sg[i + 1].addr = buffer + (u64)i * priv->size_max;
+		sg[i + 1].length = min_t(u64, len - (u64)i * priv->size_max,
+					 priv->size_max);
+	}
+	sg[nsegs + 1].addr = &req->status;
+	sg[nsegs + 1].length = sizeof(req->status);
 
-	sgs[num_out + num_in++] = &status_sg;
+	sgs[num_out++] = &sg[0];
+	for (i = 1; i <= nsegs; i++) {
+		if (type & VIRTIO_BLK_T_OUT)
+			sgs[num_out++] = &sg[i];
+		else
+			sgs[num_out + num_in++] = &sg[i];
+	}
+	sgs[num_out + num_in++] = &sg[nsegs + 1];
 
-	ret = virtqueue_add(priv->vq, sgs, num_out, num_in);
-	if (ret)
-		return ret;
+	if (virtqueue_add(priv->vq, sgs, num_out, num_in)) {
+		req->busy = false;
+		return 0;
+	}
 
-	virtqueue_kick(priv->vq);
+	return len / 512;
+}
+
+/*
+ * Large transfers are split into several requests which are all queued
+ * before the device is kicked, so that it works on them in one go rather
+ * than waiting for a round trip per request.
+ */
+static ulong virtio_blk_do_req(struct udevice *dev, u64 sector,
+			       lbaint_t blkcnt, void *buffer, u32 type)
+{
+	struct virtio_blk_priv *priv = dev_get_priv(dev);
+	u64 err_sector = sector + blkcnt;
+	unsigned int inflight = 0;
+	struct virtio_blk_req *req;
+	lbaint_t done = 0, n;
+	void *buf;
+
+	while (done < blkcnt || inflight) {
+		/* Fill the queue, stopping early once a request failed */
+		while (done < blkcnt && sector + done < err_sector) {
+			n = virtio_blk_queue_req(dev, sector + done,
+						 blkcnt - done,
+						 buffer + done * 512, type);
+			if (!n)
+				break;
+			done += n;
+			inflight++;
+		}
+		if (!inflight)
+			break;
+		virtqueue_kick(priv->vq);
+
+		/* Reap at least one request, and any others already done */
+		do {
+			while (!(buf = virtqueue_get_buf(priv->vq, NULL)))
+				;
+			req = container_of(buf, struct virtio_blk_req, out_hdr);
+			if (req->status != VIRTIO_BLK_S_OK &&
+			    req->sector < err_sector)
+				err_sector = req->sector;
+			req->busy = false;
+			inflight--;
+		} while (inflight && virtqueue_poll(priv->vq,
+						    priv->vq->last_used_idx));
+	}
 
-	while (!virtqueue_get_buf(priv->vq, NULL))
-		;
+	/* Anything that could not be queued was not transferred either */
+	if (sector + done < err_sector)
+		err_sector = sector + done;
+	if (err_sector == sector)
+		return -EIO;
 
-	return status == VIRTIO_BLK_S_OK ? blkcnt : -EIO;
+	return err_sector - sector;
 }
 
 static ulong virtio_blk_read(struct udevice *dev, lbaint_t start,
@@ -68,6 +173,11 @@ static ulong virtio_blk_write(struct udevice *dev, lbaint_t start,
 				 VIRTIO_BLK_T_OUT);
 }
 
+static const u32 feature[] = {
+	VIRTIO_BLK_F_SIZE_MAX,
+	VIRTIO_BLK_F_SEG_MAX,
+};
+
 static int virtio_blk_bind(struct udevice *dev)
 {
 	struct virtio_dev_priv *uc_priv = dev_get_uclass_priv(dev->parent);
@@ -97,7 +207,8 @@ static int virtio_blk_bind(struct udevice *dev)
 	desc->bdev = dev;
 
 	/* Indicate what driver features we support */
-	virtio_driver_features_init(uc_priv, NULL, 0, NULL, 0);
+	virtio_driver_features_init(uc_priv, feature, ARRAY_SIZE(feature),
+				    NULL, 0);
 
 	return 0;
 }
@@ -106,6 +217,7 @@ static int virtio_blk_probe(struct udevice *dev)
 {
 	struct virtio_blk_priv *priv = dev_get_priv(dev);
 	struct blk_desc *desc = dev_get_uclass_platdata(dev);
+	unsigned int num;
 	u64 cap;
 	int ret;
 
@@ -117,6 +229,40 @@ static int virtio_blk_probe(struct udevice *dev)
 	virtio_cread(dev, struct virtio_blk_config, capacity, &cap);
 	desc->lba = cap;
 
+	/*
+	 * A request must fit in the ring along with its header and status.
+	 * Without indirect descriptors its buffers take ring entries too, so
+	 * keep requests small enough for several to be in flight at once.
+	 */
+	num = virtqueue_get_vring_size(priv->vq);
+	priv->seg_max = min_t(u32, VIRTIO_BLK_MAX_SEGS, num - 2);
+	if (virtio_has_feature(dev, VIRTIO_BLK_F_SEG_MAX)) {
+		u32 seg_max;
+
+		virtio_cread(dev, struct virtio_blk_config, seg_max, &seg_max);
+		if (seg_max)
+			priv->seg_max = min(priv->seg_max, seg_max);
+	}
+	if (!priv->vq->indirect)
+		priv->seg_max = min_t(u32, priv->seg_max, num / 4);
+
+	/* Buffers hold whole sectors */
+	priv->size_max = SZ_4M;
+	if (virtio_has_feature(dev, VIRTIO_BLK_F_SIZE_MAX)) {
+		u32 size_max;
+
+		virtio_cread(dev, struct virtio_blk_config, size_max,
+			     &size_max);
+		if (size_max >= 512)
+			priv->size_max = min_t(u32, priv->size_max,
+					       size_max & ~511);
+	}
+
+	priv->num_reqs = num;
+	priv->reqs = devm_kcalloc(dev, num, sizeof(*priv->reqs), 0);
+	if (!priv->reqs)
+		return -ENOMEM;
+
 	return 0;
 }
 
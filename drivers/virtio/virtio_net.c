@@ -12,8 +12,15 @@
 #include <virtio_ring.h>
 #include "virtio_net.h"
 
-/* Amount of buffers to keep in the RX virtqueue */
+/*
+ * Amount of buffers to keep in the RX virtqueue. Buffers that do not fit in
+ * the virtqueue are simply left unused.
+ */
+#if PKTBUFSRX > 32
+#define VIRTIO_NET_NUM_RX_BUFS	PKTBUFSRX
+#else
 #define VIRTIO_NET_NUM_RX_BUFS	32
+#endif
 
 /*
  * This value comes from the VirtIO spec: 1500 for maximum packet size,
@@ -32,6 +39,7 @@ struct virtio_net_priv {
 
 	char rx_buff[VIRTIO_NET_NUM_RX_BUFS][VIRTIO_NET_RX_BUF_SIZE];
 	bool rx_running;
+	bool rx_refilled;
 	int net_hdr_len;
 };
 
@@ -62,7 +70,8 @@ static int virtio_net_start(struct udevice *dev)
 		/* setup the receive buffer address */
 		for (i = 0; i < VIRTIO_NET_NUM_RX_BUFS; i++) {
 			sg.addr = priv->rx_buff[i];
-			virtqueue_add(priv->rx_vq, sgs, 0, 1);
+			if (virtqueue_add(priv->rx_vq, sgs, 0, 1))
+				break;
 		}
 
 		virtqueue_kick(priv->rx_vq);
@@ -106,12 +115,27 @@ static int virtio_net_send(struct udevice *dev, void *packet, int length)
 	return 0;
 }
 
+/*
+ * Notify the device about the buffers put back by virtio_net_free_pkt()
+ * since the last call, so that it is done once per batch of packets.
+ */
+static void virtio_net_refill(struct virtio_net_priv *priv)
+{
+	if (priv->rx_refilled) {
+		virtqueue_kick(priv->rx_vq);
+		priv->rx_refilled = false;
+	}
+}
+
 static int virtio_net_recv(struct udevice *dev, int flags, uchar **packetp)
 {
 	struct virtio_net_priv *priv = dev_get_priv(dev);
 	unsigned int len;
 	void *buf;
 
+	if (flags & ETH_RECV_CHECK_DEVICE)
+		virtio_net_refill(priv);
+
 	buf = virtqueue_get_buf(priv->rx_vq, &len);
 	if (!buf)
 		return -EAGAIN;
@@ -120,6 +144,28 @@ static int virtio_net_recv(struct udevice *dev, int flags, uchar **packetp)
 	return len - priv->net_hdr_len;
 }
 
+static int virtio_net_recv_batch(struct udevice *dev, int flags,
+				 uchar **packets, int *lengths, int max)
+{
+	struct virtio_net_priv *priv = dev_get_priv(dev);
+	unsigned int len;
+	void *buf;
+	int count;
+
+	virtio_net_refill(priv);
+
+	for (count = 0; count < max; count++) {
+		buf = virtqueue_get_buf(priv->rx_vq, &len);
+		if (!buf)
+			break;
+
+		packets[count] = buf + priv->net_hdr_len;
+		lengths[count] = len - priv->net_hdr_len;
+	}
+
+	return count;
+}
+
 static int virtio_net_free_pkt(struct udevice *dev, uchar *packet, int length)
 {
 	struct virtio_net_priv *priv = dev_get_priv(dev);
@@ -127,8 +173,9 @@ static int virtio_net_free_pkt(struct udevice *dev, uchar *packet, int length)
 	struct virtio_sg sg = { buf, VIRTIO_NET_RX_BUF_SIZE };
 	struct virtio_sg *sgs[] = { &sg };
 
-	/* Put the buffer back to the rx ring */
+	/* Put the buffer back to the rx ring, the device is kicked later */
 	virtqueue_add(priv->rx_vq, sgs, 0, 1);
+	priv->rx_refilled = true;
 
 	return 0;
 }
@@ -220,6 +267,7 @@ static const struct eth_ops virtio_net_ops = {
 	.start = virtio_net_start,
 	.send = virtio_net_send,
 	.recv = virtio_net_recv,
+	.recv_batch = virtio_net_recv_batch,
 	.free_pkt = virtio_net_free_pkt,
 	.stop = virtio_net_stop,
 	.write_hwaddr = virtio_net_write_hwaddr,
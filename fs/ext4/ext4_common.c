@@ -1563,6 +1563,175 @@ static struct ext4_extent_header *ext4fs_get_extent_block
 	}
 }
 
+/* Context used while turning the extent tree of a file into runs */
+struct ext4_run_ctx {
+	struct ext4_extent_run *runs;
+	int nr_runs;
+	int max_runs;
+	uint32_t first;
+	uint32_t last;
+	int blksz;
+	int log2_blksz;
+};
+
+static uint64_t ext4fs_idx_pblock(struct ext4_extent_idx *index)
+{
+	uint64_t block = le16_to_cpu(index->ei_leaf_hi);
+
+	return (block << 32) + le32_to_cpu(index->ei_leaf_lo);
+}
+
+static int ext4fs_add_run(struct ext4_run_ctx *ctx, uint32_t lblk,
+			  uint64_t pblk, uint32_t len)
+{
+	struct ext4_extent_run *run;
+
+	/* Merge with the previous run if it is contiguous on disk too */
+	if (ctx->nr_runs) {
+		run = &ctx->runs[ctx->nr_runs - 1];
+		if (run->lblk + run->len == lblk &&
+		    ((!run->pblk && !pblk) ||
+		     (run->pblk && pblk && run->pblk + run->len == pblk))) {
+			run->len += len;
+			return 0;
+		}
+	}
+
+	if (ctx->nr_runs == ctx->max_runs) {
+		int max_runs = ctx->max_runs ? ctx->max_runs * 2 : 16;
+
+		run = realloc(ctx->runs, max_runs * sizeof(*run));
+		if (!run)
+			return -ENOMEM;
+		ctx->runs = run;
+		ctx->max_runs = max_runs;
+	}
+
+	run = &ctx->runs[ctx->nr_runs++];
+	run->lblk = lblk;
+	run->pblk = pblk;
+	run->len = len;
+
+	return 0;
+}
+
+static int ext4fs_collect_runs(struct ext4_run_ctx *ctx,
+			       struct ext4_extent_header *ext_block, int level)
+{
+	int entries = le16_to_cpu(ext_block->eh_entries);
+	struct ext4_extent_idx *index;
+	int i, j, n, ret;
+
+	if (le16_to_cpu(ext_block->eh_magic) != EXT4_EXT_MAGIC ||
+	    level > EXT4_EXT_MAX_DEPTH)
+		return -EINVAL;
+
+	if (ext_block->eh_depth == 0) {
+		struct ext4_extent *extent;
+
+		extent = (struct ext4_extent *)(ext_block + 1);
+		for (i = 0; i < entries; i++) {
+			uint32_t lblk = le32_to_cpu(extent[i].ee_block);
+			uint32_t len = le16_to_cpu(extent[i].ee_len);
+			uint64_t pblk = le16_to_cpu(extent[i].ee_start_hi);
+
+			pblk = (pblk << 32) + le32_to_cpu(extent[i].ee_start_lo);
+			/* Unwritten extents read back as zeroes */
+			if (len > EXT_INIT_MAX_LEN) {
+				len -= EXT_INIT_MAX_LEN;
+				pblk = 0;
+			}
+
+			if (lblk >= ctx->last)
+				break;
+			if (lblk + len <= ctx->first)
+				continue;
+			if (lblk < ctx->first) {
+				if (pblk)
+					pblk += ctx->first - lblk;
+				len -= ctx->first - lblk;
+				lblk = ctx->first;
+			}
+			if (lblk + len > ctx->last)
+				len = ctx->last - lblk;
+
+			ret = ext4fs_add_run(ctx, lblk, pblk, len);
+			if (ret)
+				return ret;
+		}
+
+		return 0;
+	}
+
+	index = (struct ext4_extent_idx *)(ext_block + 1);
+	for (i = 0; i < entries; i += n) {
+		uint64_t start = ext4fs_idx_pblock(&index[i]);
+		char *buf;
+
+		n = 1;
+		if (le32_to_cpu(index[i].ei_block) >= ctx->last)
+			break;
+		if (i + 1 < entries &&
+		    le32_to_cpu(index[i + 1].ei_block) <= ctx->first)
+			continue;
+
+		/*
+		 * Read ahead the following leaves in the same request as long
+		 * as they are needed and adjacent on disk
+		 */
+		while (i + n < entries && n < EXT4_EXT_READAHEAD &&
+		       le32_to_cpu(index[i + n].ei_block) < ctx->last &&
+		       ext4fs_idx_pblock(&index[i + n]) == start + n)
+			n++;
+
+		buf = memalign(ARCH_DMA_MINALIGN, n * ctx->blksz);
+		if (!buf)
+			return -ENOMEM;
+		if (!ext4fs_devread((lbaint_t)start << ctx->log2_blksz, 0,
+				    n * ctx->blksz, buf)) {
+			free(buf);
+			return -EIO;
+		}
+
+		ret = 0;
+		for (j = 0; j < n && !ret; j++)
+			ret = ext4fs_collect_runs(ctx,
+				(struct ext4_extent_header *)
+				(buf + j * ctx->blksz), level + 1);
+		free(buf);
+		if (ret)
+			return ret;
+	}
+
+	return 0;
+}
+
+int ext4fs_get_extent_runs(struct ext2_inode *inode, uint32_t first,
+			   uint32_t last, struct ext4_extent_run **runsp)
+{
+	struct ext4_run_ctx ctx;
+	int ret;
+
+	memset(&ctx, 0, sizeof(ctx));
+	ctx.first = first;
+	ctx.last = last;
+	ctx.blksz = EXT2_BLOCK_SIZE(ext4fs_root);
+	ctx.log2_blksz = LOG2_BLOCK_SIZE(ext4fs_root) -
+		get_fs()->dev_desc->log2blksz;
+
+	ret = ext4fs_collect_runs(&ctx, (struct ext4_extent_header *)
+				  inode->b.blocks.dir_blocks, 0);
+	if (ret) {
+		printf("invalid extent block\n");
+		free(ctx.runs);
+		return ret;
+	}
+
+	*runsp = ctx.runs;
+
+	return ctx.nr_runs;
+}
+
 static int ext4fs_blockgroup
 	(struct ext2_data *data, int group, struct ext2_block_group *blkgrp)
 {
@@ -40,6 +40,23 @@
 #define SUPERBLOCK_SIZE	1024
 #define F_FILE			1
 
+/* Maximum depth of an extent tree */
+#define EXT4_EXT_MAX_DEPTH	5
+/* Number of adjacent extent tree blocks read in one request */
+#define EXT4_EXT_READAHEAD	8
+/* Extents longer than this are unwritten */
+#define EXT_INIT_MAX_LEN	(1UL << 15)
+
+/*
+ * A range of file blocks that maps to consecutive disk blocks. A physical
+ * block of 0 stands for a range that reads back as zeroes.
+ */
+struct ext4_extent_run {
+	uint32_t lblk;
+	uint64_t pblk;
+	uint32_t len;
+};
+
 static inline void *zalloc(size_t size)
 {
 	void *p = memalign(ARCH_DMA_MINALIGN, size);
@@ -51,6 +68,8 @@ int ext4fs_read_inode(struct ext2_data *data, int ino,
 		      struct ext2_inode *inode);
 int ext4fs_read_file(struct ext2fs_node *node, loff_t pos, loff_t len,
 		     char *buf, loff_t *actread);
+int ext4fs_get_extent_runs(struct ext2_inode *inode, uint32_t first,
+			   uint32_t last, struct ext4_extent_run **runsp);
 int ext4fs_find_file(const char *path, struct ext2fs_node *rootnode,
 			struct ext2fs_node **foundnode, int expecttype);
 int ext4fs_iterate_dir(struct ext2fs_node *dir, char *name,
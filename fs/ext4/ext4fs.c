@@ -26,6 +26,7 @@
 #include "ext4_common.h"
 #include <div64.h>
 #include <malloc.h>
+#include <linux/sizes.h>
 
 int ext4fs_symlinknest;
 struct ext_filesystem ext_fs;
@@ -41,6 +42,79 @@ void ext4fs_free_node(struct ext2fs_node *node, struct ext2fs_node *currroot)
 		free(node);
 }
 
+/*
+ * Read a file that uses extents. The extent tree is walked once to map the
+ * requested range into runs of consecutive disk blocks, and each run is
+ * then read with as few device reads as possible.
+ */
+static int ext4fs_read_extents(struct ext2fs_node *node, loff_t pos,
+			       loff_t len, char *buf)
+{
+	struct ext_filesystem *fs = get_fs();
+	int log2blksz = fs->dev_desc->log2blksz;
+	int log2_fs_blocksize = LOG2_BLOCK_SIZE(node->data) - log2blksz;
+	int shift = log2_fs_blocksize + log2blksz;
+	struct ext4_extent_run *runs = NULL;
+	loff_t end = pos + len;
+	int nr_runs, i;
+
+	nr_runs = ext4fs_get_extent_runs(&node->inode, pos >> shift,
+					 (end + (1 << shift) - 1) >> shift,
+					 &runs);
+	if (nr_runs < 0)
+		return -1;
+
+	for (i = 0; i <= nr_runs; i++) {
+		loff_t run_start = end;
+		loff_t run_end = end;
+		loff_t off;
+
+		if (i < nr_runs) {
+			run_start = (loff_t)runs[i].lblk << shift;
+			run_end = min(end, run_start +
+				      ((loff_t)runs[i].len << shift));
+		}
+
+		/* Holes between runs read back as zeroes */
+		if (run_start > pos) {
+			memset(buf, 0, run_start - pos);
+			buf += run_start - pos;
+			pos = run_start;
+		}
+		if (i == nr_runs)
+			break;
+
+		if (!runs[i].pblk) {
+			memset(buf, 0, run_end - pos);
+			buf += run_end - pos;
+			pos = run_end;
+			continue;
+		}
+
+		off = pos - run_start;
+		while (pos < run_end) {
+			int n = min_t(loff_t, run_end - pos, SZ_1G);
+			lbaint_t sector;
+
+			sector = (runs[i].pblk << log2_fs_blocksize) +
+				 (off >> log2blksz);
+			if (!ext4fs_devread(sector,
+					    off & ((1 << log2blksz) - 1),
+					    n, buf)) {
+				free(runs);
+				return -1;
+			}
+			off += n;
+			pos += n;
+			buf += n;
+		}
+	}
+
+	free(runs);
+
+	return 0;
+}
+
 /*
  * Taken from openmoko-kernel mailing list: By Andy green
  * Optimized read file API : collects and defers contiguous sector
@@ -77,6 +151,14 @@ int ext4fs_read_file(struct ext2fs_node *node, loff_t pos,
 		return -1;
 	}
 
+	if (le32_to_cpu(node->inode.flags) & EXT4_EXTENTS_FL) {
+		ext_cache_fini(&cache);
+		if (ext4fs_read_extents(node, pos, len, buf))
+			return -1;
+		*actread = len;
+		return 0;
+	}
+
 	blockcnt = lldiv(((len + pos) + blocksize - 1), blocksize);
 
 	for (i = lldiv(pos, blocksize); i < blockcnt; i++) {
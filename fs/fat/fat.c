@@ -155,6 +155,102 @@ int flush_dirty_fat_buffer(fsdata *mydata)
 }
 #endif
 
+/*
+ * Set up the FAT cache, within the CONFIG_FS_FAT_CACHE_SIZE budget. The
+ * cache is optional, so it is silently left out if memory is short.
+ */
+static void fat_cache_init(fsdata *mydata)
+{
+	__u32 chunksize = FATCACHE_BLOCKS * mydata->sect_size;
+	__u32 slots;
+
+	mydata->fatcache = NULL;
+	if (IS_ENABLED(CONFIG_SPL_BUILD))
+		return;
+
+	slots = min(CONFIG_FS_FAT_CACHE_SIZE * 1024 / chunksize,
+		    DIV_ROUND_UP(mydata->fatlength, FATCACHE_BLOCKS));
+	if (!slots)
+		return;
+
+	mydata->fatcache = malloc_cache_aligned(slots * chunksize +
+						slots * sizeof(__u32));
+	if (!mydata->fatcache)
+		return;
+	mydata->fatcache_tag = (__u32 *)(mydata->fatcache + slots * chunksize);
+	mydata->fatcache_slots = slots;
+	memset(mydata->fatcache_tag, 0xff, slots * sizeof(__u32));
+}
+
+/*
+ * Get a pointer to byte 'off' of the FAT through the FAT cache, reading the
+ * chunk which holds it on a miss. The cache is direct mapped, so a FAT no
+ * larger than the cache is read at most once.
+ * On failure NULL is returned.
+ */
+static __u8 *fat_cache_get(fsdata *mydata, __u32 off)
+{
+	__u32 chunksize = FATCACHE_BLOCKS * mydata->sect_size;
+	__u32 chunk = off / chunksize;
+	__u32 slot = chunk % mydata->fatcache_slots;
+	__u8 *bufptr = mydata->fatcache + slot * chunksize;
+
+	if (mydata->fatcache_tag[slot] != chunk) {
+		__u32 startblock = chunk * FATCACHE_BLOCKS;
+		__u32 getsize = min((__u32)FATCACHE_BLOCKS,
+				    mydata->fatlength - startblock);
+
+		if (disk_read(mydata->fat_sect + startblock, getsize,
+			      bufptr) < 0) {
+			debug("Error reading FAT blocks\n");
+			mydata->fatcache_tag[slot] = ~0;
+			return NULL;
+		}
+		mydata->fatcache_tag[slot] = chunk;
+	}
+
+	return bufptr + off % chunksize;
+}
+
+static __u32 get_fatent_cached(fsdata *mydata, __u32 entry)
+{
+	__u8 *lo, *hi;
+	__u32 off8;
+	__u32 ret = 0x00;
+
+	switch (mydata->fatsize) {
+	case 32:
+		lo = fat_cache_get(mydata, entry * 4);
+		if (lo)
+			ret = FAT2CPU32(*(__u32 *)lo);
+		break;
+	case 16:
+		lo = fat_cache_get(mydata, entry * 2);
+		if (lo)
+			ret = FAT2CPU16(*(__u16 *)lo);
+		break;
+	case 12:
+		off8 = (entry * 3) / 2;
+		/* The two bytes may sit in different chunks */
+		lo = fat_cache_get(mydata, off8);
+		if (!lo)
+			break;
+		ret = *lo;
+		hi = fat_cache_get(mydata, off8 + 1);
+		if (!hi)
+			return 0x00;
+		ret += *hi << 8;
+
+		if (entry & 0x1)
+			ret >>= 4;
+		ret &= 0xfff;
+	}
+	debug("FAT%d: ret: 0x%08x, entry: 0x%08x (cached)\n",
+	      mydata->fatsize, ret, entry);
+
+	return ret;
+}
+
 /*
  * Get the entry at index 'entry' in a FAT (12/16/32) table.
  * On failure 0x00 is returned.
@@ -170,6 +266,9 @@ static __u32 get_fatent(fsdata *mydata, __u32 entry)
 		return ret;
 	}
 
+	if (mydata->fatcache)
+		return get_fatent_cached(mydata, entry);
+
 	switch (mydata->fatsize) {
 	case 32:
 		bufnum = entry / FAT32BUFSIZE;
@@ -628,6 +727,7 @@ static int get_fs_info(fsdata *mydata)
 		debug("Error: allocating memory\n");
 		return -1;
 	}
+	fat_cache_init(mydata);
 
 	debug("FAT%d, fat_sect: %d, fatlength: %d\n",
 	       mydata->fatsize, mydata->fat_sect, mydata->fatlength);
@@ -1150,6 +1250,7 @@ int fat_exists(const char *filename)
 
 	ret = fat_itr_resolve(itr, filename, TYPE_ANY);
 	free(fsdata.fatbuf);
+	free(fsdata.fatcache);
 out:
 	free(itr);
 	return ret == 0;
@@ -1175,6 +1276,7 @@ int fat_size(const char *filename, loff_t *size)
 		 * expected to fail if passed a directory path:
 		 */
 		free(fsdata.fatbuf);
+		free(fsdata.fatcache);
 		ret = fat_itr_root(itr, &fsdata);
 		if (ret)
 			goto out_free_itr;
@@ -1187,6 +1289,7 @@ int fat_size(const char *filename, loff_t *size)
 	*size = FAT2CPU32(itr->dent->size);
 out_free_both:
 	free(fsdata.fatbuf);
+	free(fsdata.fatcache);
 out_free_itr:
 	free(itr);
 	return ret;
@@ -1219,6 +1322,7 @@ int file_fat_read_at(const char *filename, loff_t pos, void *buffer,
 
 out_free_both:
 	free(fsdata.fatbuf);
+	free(fsdata.fatcache);
 out_free_itr:
 	free(itr);
 	return ret;
@@ -1278,6 +1382,7 @@ int fat_opendir(const char *filename, struct fs_dir_stream **dirsp)
 
 fail_free_both:
 	free(dir->fsdata.fatbuf);
+	free(dir->fsdata.fatcache);
 fail_free_dir:
 	free(dir);
 	return ret;
@@ -1310,6 +1415,7 @@ void fat_closedir(struct fs_dir_stream *dirs)
 {
 	fat_dir *dir = (fat_dir *)dirs;
 	free(dir->fsdata.fatbuf);
+	free(dir->fsdata.fatcache);
 	free(dir);
 }
 
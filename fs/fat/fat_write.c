@@ -267,6 +267,12 @@ static int set_fatent_value(fsdata *mydata, __u32 entry, __u32 entry_value)
 	__u32 bufnum, offset, off16;
 	__u16 val1, val2;
 
+	/* The FAT cache is read-only, stop using it once the FAT changes */
+	if (mydata->fatcache) {
+		free(mydata->fatcache);
+		mydata->fatcache = NULL;
+	}
+
 	switch (mydata->fatsize) {
 	case 32:
 		bufnum = entry / FAT32BUFSIZE;
@@ -1207,6 +1213,7 @@ int file_fat_write_at(const char *filename, loff_t pos, void *buffer,
 exit:
 	free(filename_copy);
 	free(mydata->fatbuf);
+	free(mydata->fatcache);
 	free(itr);
 	return ret;
 }
@@ -1243,6 +1250,8 @@ static int fat_dir_entries(fat_itr *itr)
 		goto exit;
 	}
 	fsdata.fatbufnum = -1;
+	/* the FAT cache belongs to the parent iterator */
+	fsdata.fatcache = NULL;
 	dirs->fsdata = &fsdata;
 
 	for (count = 0; fat_itr_next(dirs); count++)
@@ -1348,6 +1357,7 @@ int fat_unlink(const char *filename)
 
 exit:
 	free(fsdata.fatbuf);
+	free(fsdata.fatcache);
 	free(itr);
 	free(filename_copy);
 
@@ -1484,6 +1494,7 @@ int fat_mkdir(const char *new_dirname)
 exit:
 	free(dirname_copy);
 	free(mydata->fatbuf);
+	free(mydata->fatcache);
 	free(itr);
 	free(dotdent);
 	return ret;
@@ -67,6 +67,8 @@ typedef struct global_data {
 	struct udevice	*dm_root;	/* Root instance for Driver Model */
 	struct udevice	*dm_root_f;	/* Pre-relocation root instance */
 	struct list_head uclass_root;	/* Head of core tree */
+	struct driver_index *driver_index; /* Drivers by name, compatible */
+	struct dm_lazy	*dm_lazy;	/* Nodes waiting to be bound */
 #endif
 #ifdef CONFIG_TIMER
 	struct udevice	*timer;		/* Timer instance for Driver Model */
@@ -75,6 +77,7 @@ typedef struct global_data {
 	const void *fdt_blob;		/* Our device tree, NULL if none */
 	void *new_fdt;			/* Relocated FDT */
 	unsigned long fdt_size;		/* Space reserved for relocated FDT */
+	struct fdtdec_cache *fdt_cache;	/* Lookups in fdt_blob */
 #ifdef CONFIG_OF_LIVE
 	struct device_node *of_root;
 #endif
@@ -122,38 +122,72 @@ int blkcache_init(void);
 /**
  * blkcache_read() - attempt to read a set of blocks from cache
  *
- * @param iftype - IF_TYPE_x for type of device
- * @param dev - device index of particular type
+ * Blocks are cached per hardware partition of the device.
+ *
+ * @param block_dev - block device being read
  * @param start - starting block number
  * @param blkcnt - number of blocks to read
- * @param blksz - size in bytes of each block
  * @param buf - buffer to contain cached data
  *
  * @return - 1 if block returned from cache, 0 otherwise.
  */
-int blkcache_read(int iftype, int dev,
-		  lbaint_t start, lbaint_t blkcnt,
-		  unsigned long blksz, void *buffer);
+int blkcache_read(struct blk_desc *block_dev, lbaint_t start,
+		  lbaint_t blkcnt, void *buffer);
 
 /**
  * blkcache_fill() - make data read from a block device available
  * to the block cache
  *
- * @param iftype - IF_TYPE_x for type of device
- * @param dev - device index of particular type
+ * @param block_dev - block device which was read
  * @param start - starting block number
  * @param blkcnt - number of blocks available
- * @param blksz - size in bytes of each block
  * @param buf - buffer containing data to cache
  *
  */
-void blkcache_fill(int iftype, int dev,
-		   lbaint_t start, lbaint_t blkcnt,
-		   unsigned long blksz, void const *buffer);
+void blkcache_fill(struct blk_desc *block_dev, lbaint_t start,
+		   lbaint_t blkcnt, void const *buffer);
+
+/**
+ * blkcache_write() - update the block cache for a write to a block device
+ *
+ * With CONFIG_BLOCK_CACHE_WRITEBACK, small writes are only stored in the
+ * cache and reach the device on the next flush. Otherwise cached copies of
+ * the blocks are updated and the caller writes the data to the device.
+ *
+ * @param block_dev - block device being written
+ * @param start - starting block number
+ * @param blkcnt - number of blocks to write
+ * @param buf - buffer containing the data to write
+ *
+ * @return - 1 if the write was taken by the cache, 0 otherwise.
+ */
+int blkcache_write(struct blk_desc *block_dev, lbaint_t start,
+		   lbaint_t blkcnt, void const *buffer);
+
+/**
+ * blkcache_flush() - write back the dirty blocks of a device
+ *
+ * This must be called before switching the hardware partition of the
+ * device, since blocks are written back to the selected partition.
+ *
+ * @param iftype - IF_TYPE_x for type of device
+ * @param dev - device index of particular type
+ *
+ * @return - 0 on success, -EIO if a write failed
+ */
+int blkcache_flush(int iftype, int dev);
+
+/**
+ * blkcache_flush_all() - write back the dirty blocks of all devices
+ *
+ * @return - 0 on success, -EIO if a write failed
+ */
+int blkcache_flush_all(void);
 
 /**
  * blkcache_invalidate() - discard the cache for a set of blocks
- * because of a write or device (re)initialization.
+ * because of an erase or device (re)initialization. Dirty blocks are
+ * written back first.
  *
  * @param iftype - IF_TYPE_x for type of device
  * @param dev - device index of particular type
@@ -163,8 +197,8 @@ void blkcache_invalidate(int iftype, int dev);
 /**
  * blkcache_configure() - configure block cache
  *
- * @param blocks - maximum blocks per entry
- * @param entries - maximum entries in cache
+ * @param blocks - maximum blocks per read or write kept in the cache
+ * @param entries - maximum blocks in cache
  */
 void blkcache_configure(unsigned blocks, unsigned entries);
 
@@ -174,9 +208,9 @@ void blkcache_configure(unsigned blocks, unsigned entries);
 struct block_cache_stats {
 	unsigned hits;
 	unsigned misses;
-	unsigned entries; /* current entry count */
-	unsigned max_blocks_per_entry;
-	unsigned max_entries;
+	unsigned entries; /* current number of cached blocks */
+	unsigned max_blocks_per_entry; /* largest request that is cached */
+	unsigned max_entries; /* maximum number of cached blocks */
 };
 
 /**
@@ -188,16 +222,30 @@ void blkcache_stats(struct block_cache_stats *stats);
 
 #else
 
-static inline int blkcache_read(int iftype, int dev,
-				lbaint_t start, lbaint_t blkcnt,
-				unsigned long blksz, void *buffer)
+static inline int blkcache_read(struct blk_desc *block_dev, lbaint_t start,
+				lbaint_t blkcnt, void *buffer)
+{
+	return 0;
+}
+
+static inline void blkcache_fill(struct blk_desc *block_dev, lbaint_t start,
+				 lbaint_t blkcnt, void const *buffer) {}
+
+static inline int blkcache_write(struct blk_desc *block_dev, lbaint_t start,
+				 lbaint_t blkcnt, void const *buffer)
+{
+	return 0;
+}
+
+static inline int blkcache_flush(int iftype, int dev)
 {
 	return 0;
 }
 
-static inline void blkcache_fill(int iftype, int dev,
-				 lbaint_t start, lbaint_t blkcnt,
-				 unsigned long blksz, void const *buffer) {}
+static inline int blkcache_flush_all(void)
+{
+	return 0;
+}
 
 static inline void blkcache_invalidate(int iftype, int dev) {}
 
@@ -435,8 +483,7 @@ static inline ulong blk_dread(struct blk_desc *block_dev, lbaint_t start,
 			      lbaint_t blkcnt, void *buffer)
 {
 	ulong blks_read;
-	if (blkcache_read(block_dev->if_type, block_dev->devnum,
-			  start, blkcnt, block_dev->blksz, buffer))
+	if (blkcache_read(block_dev, start, blkcnt, buffer))
 		return blkcnt;
 
 	/*
@@ -446,8 +493,7 @@ static inline ulong blk_dread(struct blk_desc *block_dev, lbaint_t start,
 	 */
 	blks_read = block_dev->block_read(block_dev, start, blkcnt, buffer);
 	if (blks_read == blkcnt)
-		blkcache_fill(block_dev->if_type, block_dev->devnum,
-			      start, blkcnt, block_dev->blksz, buffer);
+		blkcache_fill(block_dev, start, blkcnt, buffer);
 
 	return blks_read;
 }
@@ -455,8 +501,16 @@ static inline ulong blk_dread(struct blk_desc *block_dev, lbaint_t start,
 static inline ulong blk_dwrite(struct blk_desc *block_dev, lbaint_t start,
 			       lbaint_t blkcnt, const void *buffer)
 {
-	blkcache_invalidate(block_dev->if_type, block_dev->devnum);
-	return block_dev->block_write(block_dev, start, blkcnt, buffer);
+	ulong blks_written;
+
+	if (blkcache_write(block_dev, start, blkcnt, buffer))
+		return blkcnt;
+
+	blks_written = block_dev->block_write(block_dev, start, blkcnt, buffer);
+	if (blks_written != blkcnt)
+		blkcache_invalidate(block_dev->if_type, block_dev->devnum);
+
+	return blks_written;
 }
 
 static inline ulong blk_derase(struct blk_desc *block_dev, lbaint_t start,
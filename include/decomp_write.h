@@ -0,0 +1,68 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ * Decompressing an image from memory straight to a block device
+ */
+
+#ifndef __DECOMP_WRITE_H
+#define __DECOMP_WRITE_H
+
+struct blk_desc;
+
+/**
+ * decomp_write_detect() - Work out how an image is compressed
+ *
+ * gzip, zstd, LZ4 and bzip2 images are recognised by their magic number.
+ * LZMA has none, so an image is taken to be LZMA if its header holds the
+ * default properties, as written by the lzma and "xz --format=lzma" tools.
+ *
+ * @src:	Compressed image
+ * @len:	Length of @src in bytes
+ * @return IH_COMP_... value, or -EPROTONOSUPPORT if not recognised
+ */
+int decomp_write_detect(const void *src, ulong len);
+
+/**
+ * decomp_write() - Decompress an image from memory to a block device
+ *
+ * The image is decompressed a write buffer at a time, so it may be much
+ * larger than memory. With CONFIG_MP_WORK the next buffer is decompressed on
+ * another CPU while the last one is written.
+ *
+ * @comp:	Compression used for the image (IH_COMP_...)
+ * @src:	Compressed image
+ * @len:	Length of @src in bytes
+ * @dev:	Block device to write to
+ * @szwritebuf:	Bytes per write, a multiple of the block size (pad to the
+ *		erase size)
+ * @startoffs:	Offset in bytes of the first write, a multiple of the block
+ *		size
+ * @szexpected:	Expected uncompressed length, or zero to use the length
+ *		recorded in the image, if any
+ * @return 0 if OK, -EPROTONOSUPPORT if @comp is not supported, -ENOSPC if
+ *	the image does not fit on the device, -ENOMEM if out of memory, -EIO
+ *	on a write error, -EINTR if interrupted, -EINVAL if the image is
+ *	corrupt, has the wrong length or the arguments are not valid
+ */
+int decomp_write(int comp, const void *src, ulong len, struct blk_desc *dev,
+		 ulong szwritebuf, u64 startoffs, u64 szexpected);
+
+/**
+ * decomp_write progress indicators: defined weak to allow board-specific
+ * overrides:
+ *
+ *	decomp_write_progress_init called on startup
+ *	decomp_write_progress called after each write
+ *	decomp_write_progress_finish called at the end to indicate success
+ *		(retcode=0) or failure
+ *
+ * The total size is zero if the image does not record it and no expected
+ * size was given.
+ */
+void decomp_write_progress_init(u64 expected_size);
+
+void decomp_write_progress(int iteration, u64 bytes_written, u64 total_bytes);
+
+void decomp_write_progress_finish(int retcode, u64 totalwritten,
+				  u64 totalsize);
+
+#endif
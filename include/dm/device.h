@@ -94,6 +94,34 @@ enum {
 	DM_REMOVE_ACTIVE_ALL = DM_REMOVE_ACTIVE_DMA | DM_REMOVE_OS_PREPARE,
 };
 
+/**
+ * enum dm_index_t - Keys by which a uclass can look up its devices
+ *
+ * @DM_INDEX_SEQ: Sequence number (udevice->seq)
+ * @DM_INDEX_REQ_SEQ: Requested sequence number (udevice->req_seq)
+ * @DM_INDEX_OFNODE: Device-tree node (udevice->node)
+ * @DM_INDEX_PHANDLE: Phandle of the device-tree node
+ */
+enum dm_index_t {
+	DM_INDEX_SEQ,
+	DM_INDEX_REQ_SEQ,
+	DM_INDEX_OFNODE,
+	DM_INDEX_PHANDLE,
+
+	DM_INDEX_COUNT,
+};
+
+/**
+ * struct dm_index_node - A device's entry in one of its uclass's lookup tables
+ *
+ * @node: Link in the hash bucket, unhashed if the device has no such key
+ * @key: Key the device is filed under
+ */
+struct dm_index_node {
+	struct hlist_node node;
+	ulong key;
+};
+
 /**
  * struct udevice - An instance of a driver
  *
@@ -135,6 +163,8 @@ enum {
  *		When CONFIG_DEVRES is enabled, devm_kmalloc() and friends will
  *		add to this list. Memory so-allocated will be freed
  *		automatically when the device is removed / unbound
+ * @index_node: Entries in the uclass's lookup tables for this device, with
+ *		CONFIG_DM_UCLASS_INDEX (see enum dm_index_t)
  */
 struct udevice {
 	const struct driver *driver;
@@ -158,6 +188,9 @@ struct udevice {
 #ifdef CONFIG_DEVRES
 	struct list_head devres_head;
 #endif
+#if CONFIG_IS_ENABLED(DM_UCLASS_INDEX)
+	struct dm_index_node index_node[DM_INDEX_COUNT];
+#endif
 };
 
 /* Maximum sequence number supported */
@@ -174,9 +207,31 @@ static inline int dev_of_offset(const struct udevice *dev)
 	return ofnode_to_offset(dev->node);
 }
 
+/**
+ * device_reindex() - Update the uclass's lookup tables for a device
+ *
+ * With CONFIG_DM_UCLASS_INDEX each uclass keeps hash tables for finding its
+ * devices by sequence number, device-tree node and phandle. These are
+ * updated by device_bind() and device_probe(). Anything which changes the
+ * seq, req_seq or node of a device after that must call this function.
+ *
+ * @dev: Device to update
+ */
+#if CONFIG_IS_ENABLED(DM_UCLASS_INDEX)
+void device_reindex(struct udevice *dev);
+#else
+static inline void device_reindex(struct udevice *dev) {}
+#endif
+
+static inline void dev_set_ofnode(struct udevice *dev, ofnode node)
+{
+	dev->node = node;
+	device_reindex(dev);
+}
+
 static inline void dev_set_of_offset(struct udevice *dev, int of_offset)
 {
-	dev->node = offset_to_ofnode(of_offset);
+	dev_set_ofnode(dev, offset_to_ofnode(of_offset));
 }
 
 static inline bool dev_has_of_node(struct udevice *dev)
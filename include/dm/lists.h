@@ -12,6 +12,8 @@
 #include <dm/ofnode.h>
 #include <dm/uclass-id.h>
 
+struct udevice_id;
+
 /**
  * lists_driver_lookup_name() - Return u_boot_driver corresponding to name
  *
@@ -23,6 +25,19 @@
  */
 struct driver *lists_driver_lookup_name(const char *name);
 
+/**
+ * lists_driver_lookup_compatible() - Find the driver for a compatible string
+ *
+ * Where several drivers list the same string, the first in the linker list
+ * is returned.
+ *
+ * @compat: Compatible string to look up
+ * @of_idp: Returns the driver's of_match entry for @compat
+ * @return pointer to driver, or NULL if not found
+ */
+struct driver *lists_driver_lookup_compatible(const char *compat,
+					      const struct udevice_id **of_idp);
+
 /**
  * lists_uclass_lookup() - Return uclass_driver based on ID of the class
  * id:		ID of the class
@@ -9,6 +9,9 @@
 #ifndef _DM_ROOT_H_
 #define _DM_ROOT_H_
 
+#include <dm/ofnode.h>
+#include <dm/uclass-id.h>
+
 struct udevice;
 
 /**
@@ -114,6 +117,105 @@ int dm_init(bool of_live);
  */
 int dm_uninit(void);
 
+#if CONFIG_IS_ENABLED(DM_LAZY_BIND)
+/**
+ * dm_lazy_init() - Start binding devices from the device tree on demand
+ *
+ * After this, scanning the device tree records each node instead of binding
+ * it. A node is bound when a uclass used by its driver or a driver below it
+ * is first looked up, when its node is looked up, or on dm_lazy_bind_all().
+ *
+ * @return 0 if OK, -ENOMEM if out of memory
+ */
+int dm_lazy_init(void);
+
+/**
+ * dm_lazy_uninit() - Stop binding on demand and forget all recorded nodes
+ */
+void dm_lazy_uninit(void);
+
+/**
+ * dm_lazy_add() - Record a node to be bound on demand
+ *
+ * Only subnodes of the root node, and nodes scanned while binding recorded
+ * nodes, are recorded. Other nodes are scanned by a driver which expects them
+ * to be bound straight away. Nodes without a driver for them are dropped,
+ * since they would not be bound anyway.
+ *
+ * @parent: Device to bind the node's device to
+ * @node: Node to record
+ * @return 0 if OK, -ENOSYS if the node is not to be bound on demand, so should
+ *	be bound now, -ENOMEM if out of memory
+ */
+int dm_lazy_add(struct udevice *parent, ofnode node);
+
+/**
+ * dm_lazy_bind_uclass() - Bind the recorded nodes for a uclass
+ *
+ * This binds the nodes which may hold a device in uclass @id, and is called
+ * whenever a uclass is looked up.
+ *
+ * @id: Uclass that is about to be used
+ */
+void dm_lazy_bind_uclass(enum uclass_id id);
+
+/**
+ * dm_lazy_bind_ofnode() - Bind the recorded nodes leading to a node
+ *
+ * @node: Node whose device is about to be looked up
+ */
+void dm_lazy_bind_ofnode(ofnode node);
+
+/**
+ * dm_lazy_bind_all() - Bind all recorded nodes
+ */
+void dm_lazy_bind_all(void);
+
+/**
+ * dm_lazy_forget() - Forget the recorded nodes to be bound to a device
+ *
+ * @parent: Device which is going away
+ */
+void dm_lazy_forget(struct udevice *parent);
+
+/**
+ * dm_lazy_forget_node() - Forget a recorded node which is being bound
+ *
+ * This is called when a device is bound to a node in some other way, e.g.
+ * with the bind command, so that the node is not bound a second time. The
+ * node counts as bound in dm_lazy_stats().
+ *
+ * @node: Node which is being bound
+ */
+void dm_lazy_forget_node(ofnode node);
+
+/**
+ * dm_lazy_stats() - Get the number of nodes bound on demand
+ *
+ * @deferred: Returns the number of nodes recorded to be bound on demand
+ * @bound: Returns the number of those which have been bound so far
+ */
+void dm_lazy_stats(uint *deferred, uint *bound);
+#else
+static inline int dm_lazy_init(void) { return 0; }
+static inline void dm_lazy_uninit(void) {}
+static inline int dm_lazy_add(struct udevice *parent, ofnode node)
+{
+	return -ENOSYS;
+}
+
+static inline void dm_lazy_bind_uclass(enum uclass_id id) {}
+static inline void dm_lazy_bind_ofnode(ofnode node) {}
+static inline void dm_lazy_bind_all(void) {}
+static inline void dm_lazy_forget(struct udevice *parent) {}
+static inline void dm_lazy_forget_node(ofnode node) {}
+static inline void dm_lazy_stats(uint *deferred, uint *bound)
+{
+	*deferred = 0;
+	*bound = 0;
+}
+#endif
+
 #if CONFIG_IS_ENABLED(DM_DEVICE_REMOVE)
 /**
  * dm_remove_devices_flags - Call remove function of all drivers with
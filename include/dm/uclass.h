@@ -30,12 +30,22 @@
  * @dev_head: List of devices in this uclass (devices are attached to their
  * uclass when their bind method is called)
  * @sibling_node: Next uclass in the linked list of uclasses
+ * @index: With CONFIG_DM_UCLASS_INDEX, hash tables for looking up devices in
+ * this uclass, DM_INDEX_COUNT tables of @index_mask + 1 buckets each, or NULL
+ * to search @dev_head instead
+ * @index_mask: Number of buckets in each table, less one
+ * @dev_count: Number of devices in @dev_head
  */
 struct uclass {
 	void *priv;
 	struct uclass_driver *uc_drv;
 	struct list_head dev_head;
 	struct list_head sibling_node;
+#if CONFIG_IS_ENABLED(DM_UCLASS_INDEX)
+	struct hlist_head *index;
+	uint index_mask;
+	uint dev_count;
+#endif
 };
 
 struct driver;
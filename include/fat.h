@@ -29,6 +29,9 @@
 #define FAT16BUFSIZE	(FATBUFSIZE/2)
 #define FAT32BUFSIZE	(FATBUFSIZE/4)
 
+/* Number of sectors per chunk of the FAT cache */
+#define FATCACHE_BLOCKS	64
+
 /* Maximum number of entry for long file name according to spec */
 #define MAX_LFN_SLOT	20
 
@@ -175,6 +178,9 @@ typedef struct {
 	__u32	root_cluster;	/* First cluster of root dir for FAT32 */
 	u32	total_sect;	/* Number of sectors */
 	int	fats;		/* Number of FATs */
+	__u8	*fatcache;	/* FAT cache, NULL if not used */
+	__u32	*fatcache_tag;	/* FAT chunk held by each cache slot */
+	__u32	fatcache_slots;	/* Number of cache slots */
 } fsdata;
 
 static inline u32 clust_to_sect(fsdata *fsdata, u32 clust)
@@ -661,6 +661,47 @@ const char *fdtdec_get_compatible(enum fdt_compat_id id);
  */
 int fdtdec_lookup_phandle(const void *blob, int node, const char *prop_name);
 
+/**
+ * fdtdec_node_offset_by_phandle() - Find a node by its phandle
+ *
+ * This is the same as fdt_node_offset_by_phandle(). For the control FDT
+ * (gd->fdt_blob) with CONFIG_OF_LOOKUP_CACHE, it uses a table of phandles
+ * built on first use instead of scanning the whole tree each time.
+ *
+ * @param blob		FDT blob
+ * @param phandle	Phandle to look for
+ * @return node offset if found, -ve FDT_ERR_... on error
+ */
+#if CONFIG_IS_ENABLED(OF_LOOKUP_CACHE)
+int fdtdec_node_offset_by_phandle(const void *blob, uint32_t phandle);
+#else
+static inline int fdtdec_node_offset_by_phandle(const void *blob,
+						uint32_t phandle)
+{
+	return fdt_node_offset_by_phandle(blob, phandle);
+}
+#endif
+
+/**
+ * fdtdec_path_offset() - Find a node by its path or alias
+ *
+ * This is the same as fdt_path_offset(). For the control FDT (gd->fdt_blob)
+ * with CONFIG_OF_LOOKUP_CACHE, the results of recent lookups are kept, so
+ * that paths such as "/aliases" and "/chosen" are only looked up once.
+ *
+ * @param blob		FDT blob
+ * @param path		Full path of the node, or an alias
+ * @return node offset if found, -ve FDT_ERR_... on error
+ */
+#if CONFIG_IS_ENABLED(OF_LOOKUP_CACHE)
+int fdtdec_path_offset(const void *blob, const char *path);
+#else
+static inline int fdtdec_path_offset(const void *blob, const char *path)
+{
+	return fdt_path_offset(blob, path);
+}
+#endif
+
 /**
  * Look up a property in a node and return its contents in an integer
  * array of given length. The property must have at least enough data for
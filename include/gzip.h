@@ -29,6 +29,25 @@ int gzip_parse_header(const unsigned char *src, unsigned long len);
  */
 int gunzip(void *dst, int dstlen, unsigned char *src, unsigned long *lenp);
 
+/**
+ * gunzip_hook() - Decompress gzipped data, passing the input to a hook
+ *
+ * This works like gunzip(), but reads the input in pieces and passes each
+ * piece to @hook just before it is decompressed. This allows the input to be
+ * hashed while it is in the cache, without reading it twice.
+ *
+ * @dst: Destination for uncompressed data
+ * @dstlen: Size of destination buffer
+ * @src: Source data to decompress
+ * @lenp: On entry, length of data at @src. Returns length of uncompressed
+ *	data
+ * @hook: Function to call with each piece of the input, in order
+ * @priv: Private data for @hook
+ * @return 0 if OK, -1 on error
+ */
+int gunzip_hook(void *dst, int dstlen, unsigned char *src, unsigned long *lenp,
+		void (*hook)(void *priv, const void *buf, ulong len), void *priv);
+
 /**
  * zunzip() - Uncompress blocks compressed with zlib without headers
  *
@@ -43,25 +62,12 @@ int gunzip(void *dst, int dstlen, unsigned char *src, unsigned long *lenp);
 int zunzip(void *dst, int dstlen, unsigned char *src, unsigned long *lenp,
 	   int stoponerr, int offset);
 
-/**
- * gzwrite progress indicators: defined weak to allow board-specific
- * overrides:
- *
- *	gzwrite_progress_init called on startup
- *	gzwrite_progress called during decompress/write loop
- *	gzwrite_progress_finish called at end of loop to
- *		indicate success (retcode=0) or failure
- */
-void gzwrite_progress_init(u64 expected_size);
-
-void gzwrite_progress(int iteration, u64 bytes_written, u64 total_bytes);
-
-void gzwrite_progress_finish(int retcode, u64 totalwritten, u64 totalsize,
-			     u32 expected_crc, u32 calculated_crc);
-
 /**
  * gzwrite() - decompress and write gzipped image from memory to block device
  *
+ * This is decomp_write() for gzip images; progress is reported through the
+ * decomp_write_progress...() hooks.
+ *
  * @src:	compressed image address
  * @len:	compressed image length in bytes
  * @dev:	block device descriptor
@@ -32,8 +32,12 @@ struct fdt_region;
 #define CONFIG_FIT_VERBOSE	1 /* enable fit_format_{error,warning}() */
 #define CONFIG_FIT_ENABLE_RSASSA_PSS_SUPPORT 1
 #define CONFIG_FIT_ENABLE_SHA256_SUPPORT
+#define CONFIG_FIT_ENABLE_SHA384_SUPPORT
+#define CONFIG_FIT_ENABLE_SHA512_SUPPORT
 #define CONFIG_SHA1
 #define CONFIG_SHA256
+#define CONFIG_SHA384
+#define CONFIG_SHA512
 
 #define IMAGE_ENABLE_IGNORE	0
 #define IMAGE_INDENT_STRING	""
@@ -92,6 +96,20 @@ struct fdt_region;
 #define IMAGE_ENABLE_SHA256	0
 #endif
 
+#if defined(CONFIG_FIT_ENABLE_SHA384_SUPPORT) || \
+	defined(CONFIG_SPL_SHA384_SUPPORT)
+#define IMAGE_ENABLE_SHA384	1
+#else
+#define IMAGE_ENABLE_SHA384	0
+#endif
+
+#if defined(CONFIG_FIT_ENABLE_SHA512_SUPPORT) || \
+	defined(CONFIG_SPL_SHA512_SUPPORT)
+#define IMAGE_ENABLE_SHA512	1
+#else
+#define IMAGE_ENABLE_SHA512	0
+#endif
+
 #endif /* IMAGE_ENABLE_FIT */
 
 #ifdef CONFIG_SYS_BOOT_GET_CMDLINE
@@ -309,6 +327,7 @@ enum {
 	IH_COMP_LZMA,			/* lzma  Compression Used	*/
 	IH_COMP_LZO,			/* lzo   Compression Used	*/
 	IH_COMP_LZ4,			/* lz4   Compression Used	*/
+	IH_COMP_ZSTD,			/* zstd  Compression Used	*/
 
 	IH_COMP_COUNT,
 };
@@ -347,6 +366,9 @@ typedef struct image_info {
 	uint8_t		arch;			/* CPU architecture */
 } image_info_t;
 
+/* Most images of a FIT configuration that are hashed in parallel */
+#define FIT_PREHASH_MAX		8
+
 /*
  * Legacy and FIT format headers used by do_bootm() and do_bootm_<os>()
  * routines.
@@ -367,6 +389,7 @@ typedef struct bootm_headers {
 	void		*fit_hdr_os;	/* os FIT image header */
 	const char	*fit_uname_os;	/* os subimage node unit name */
 	int		fit_noffset_os;	/* os subimage node offset */
+	int		fit_os_hash_pending; /* os hashes not yet checked */
 
 	void		*fit_hdr_rd;	/* init ramdisk FIT image header */
 	const char	*fit_uname_rd;	/* init ramdisk subimage node unit name */
@@ -381,6 +404,16 @@ typedef struct bootm_headers {
 	int		fit_noffset_setup;/* x86 setup subimage node offset */
 #endif
 
+#if defined(CONFIG_FIT_PARALLEL_VERIFY) && !defined(USE_HOSTCC)
+	/* images whose hashes were checked by fit_conf_prehash() */
+	struct fit_prehashed {
+		const void	*data;	/* image data which was checked */
+		size_t		size;
+		int		noffset;
+	} fit_prehashed[FIT_PREHASH_MAX];
+	int		fit_prehashed_count;
+#endif
+
 #ifndef USE_HOSTCC
 	image_info_t	os;		/* os image info */
 	ulong		ep;		/* entry point of OS */
@@ -675,6 +708,25 @@ int fit_image_load(bootm_headers_t *images, ulong addr,
 		   int arch, int image_type, int bootstage_id,
 		   enum fit_load_op load_op, ulong *datap, ulong *lenp);
 
+/**
+ * fit_prehash_clear() - Drop the hash results of fit_conf_prehash()
+ *
+ * This must be called once the images of a configuration have been loaded,
+ * or loading failed, so that the results are not used for another image.
+ *
+ * @images:	Images being booted
+ */
+#if defined(CONFIG_FIT_PARALLEL_VERIFY) && !defined(USE_HOSTCC)
+static inline void fit_prehash_clear(bootm_headers_t *images)
+{
+	images->fit_prehashed_count = 0;
+}
+#else
+static inline void fit_prehash_clear(bootm_headers_t *images)
+{
+}
+#endif
+
 /**
  * image_source_script() - Execute a script
  *
@@ -886,6 +938,25 @@ int image_decomp(int comp, ulong load, ulong image_start, int type,
 		 void *load_buf, void *image_buf, ulong image_len,
 		 uint unc_len, ulong *load_end);
 
+struct fit_hash_stream;
+
+/**
+ * image_decomp_hashed() - decompress an image while checking its hashes
+ *
+ * This is the same as image_decomp(), except that the image data is also
+ * added to @hs. Where the compression format allows, this is done piece by
+ * piece just before the data is decompressed, so that it is only read from
+ * memory once. The caller must check the result with
+ * fit_image_hash_stream_finish() before using the decompressed image.
+ *
+ * @hs:		Hash state, see fit_image_hash_stream_start()
+ * Other parameters and return value are as for image_decomp()
+ */
+int image_decomp_hashed(int comp, ulong load, ulong image_start, int type,
+			void *load_buf, void *image_buf, ulong image_len,
+			uint unc_len, ulong *load_end,
+			struct fit_hash_stream *hs);
+
 /**
  * Set up properties in the FDT
  *
@@ -1085,6 +1156,75 @@ int fit_add_verification_data(const char *keydir, void *keydest, void *fit,
 int fit_image_verify_with_data(const void *fit, int image_noffset,
 			       const void *data, size_t size);
 int fit_image_verify(const void *fit, int noffset);
+
+/* Maximum number of hash nodes checked by a struct fit_hash_stream */
+#define FIT_HASH_STREAM_MAX	4
+
+/**
+ * struct fit_hash_stream - Check the hashes of an image while reading it
+ *
+ * This allows image data to be hashed as it is copied or decompressed, rather
+ * than in a separate pass beforehand.
+ *
+ * @fit:	FIT containing the image
+ * @count:	Number of hash nodes being calculated
+ * @noffset:	Offset of each hash node
+ * @algo:	Hash algorithm of each hash node
+ * @ctx:	Progressive hash context of each hash node
+ * @err:	Set if a hash update failed
+ */
+struct fit_hash_stream {
+	const void *fit;
+	int count;
+	int noffset[FIT_HASH_STREAM_MAX];
+	struct hash_algo *algo[FIT_HASH_STREAM_MAX];
+	void *ctx[FIT_HASH_STREAM_MAX];
+	int err;
+};
+
+/**
+ * fit_image_hash_stream_supported() - Check if an image can be hashed in pieces
+ *
+ * This is possible if all of the image's hashes support progressive hashing
+ * and the image has no signatures or ciphers, which need all the data at once.
+ *
+ * @fit:		FIT containing the image
+ * @image_noffset:	Offset of the image node
+ * @return true if fit_image_hash_stream_start() can be used for this image
+ */
+bool fit_image_hash_stream_supported(const void *fit, int image_noffset);
+
+/**
+ * fit_image_hash_stream_start() - Start checking the hashes of an image
+ *
+ * @fit:		FIT containing the image
+ * @image_noffset:	Offset of the image node
+ * @hs:			Returns the hash state
+ * @return 0 if OK, -ENOSYS if the image cannot be hashed in pieces
+ */
+int fit_image_hash_stream_start(const void *fit, int image_noffset,
+				struct fit_hash_stream *hs);
+
+/**
+ * fit_image_hash_stream_update() - Add image data to the hashes
+ *
+ * @hs:		Hash state
+ * @buf:	Next piece of image data
+ * @len:	Length of @buf in bytes
+ */
+void fit_image_hash_stream_update(struct fit_hash_stream *hs, const void *buf,
+				  ulong len);
+
+/**
+ * fit_image_hash_stream_finish() - Compare the hashes with those in the FIT
+ *
+ * This must be called once all the image data has been added, and also on
+ * error paths, since it frees the hash state.
+ *
+ * @hs:		Hash state
+ * @return 0 if all hashes match, -EACCES if not
+ */
+int fit_image_hash_stream_finish(struct fit_hash_stream *hs);
 int fit_config_verify(const void *fit, int conf_noffset);
 int fit_all_image_verify(const void *fit);
 int fit_config_decrypt(const void *fit, int conf_noffset);
@@ -13,22 +13,51 @@
  * Copyright 2021 NXP
  */
 
-#define MAX_LMB_REGIONS 16
-
+/**
+ * struct lmb_property - Description of one region
+ *
+ * @base:	Base address of the region
+ * @size:	Size of the region
+ */
 struct lmb_property {
 	phys_addr_t base;
 	phys_size_t size;
 };
 
+/**
+ * struct lmb_region - Description of a set of regions
+ *
+ * The regions are kept sorted by address and never overlap, so they can be
+ * looked up with a binary search.
+ *
+ * @cnt:	Number of regions in use
+ * @max:	Number of entries available in @region
+ * @size:	Unused
+ * @region:	Array of the regions, in address order
+ */
 struct lmb_region {
 	unsigned long cnt;
+	unsigned long max;
 	phys_size_t size;
-	struct lmb_property region[MAX_LMB_REGIONS+1];
+	struct lmb_property *region;
 };
 
+/**
+ * struct lmb - Logical memory block handle
+ *
+ * The storage for the regions is part of the handle, so lmb_init() must be
+ * called again after the handle has been copied.
+ *
+ * @memory:		Description of the memory regions
+ * @reserved:		Description of the reserved regions
+ * @memory_regions:	Storage for the memory regions
+ * @reserved_regions:	Storage for the reserved regions
+ */
 struct lmb {
 	struct lmb_region memory;
 	struct lmb_region reserved;
+	struct lmb_property memory_regions[CONFIG_LMB_MEMORY_REGIONS];
+	struct lmb_property reserved_regions[CONFIG_LMB_RESERVED_REGIONS];
 };
 
 extern void lmb_init(struct lmb *lmb);
@@ -21,4 +21,46 @@
  */
 int ulz4fn(const void *src, size_t srcn, void *dst, size_t *dstn);
 
+/**
+ * struct ulz4_stream - LZ4 data being decompressed a block at a time
+ *
+ * @in: Next block header
+ * @end: End of the input
+ * @has_block_checksum: true if each block is followed by a checksum
+ * @block_max: Largest uncompressed size of a block, 0 if not valid
+ * @content_size: Uncompressed size recorded in the header, 0 if not recorded
+ * @done: true once the end mark has been read
+ */
+struct ulz4_stream {
+	const void *in;
+	const void *end;
+	bool has_block_checksum;
+	size_t block_max;
+	u64 content_size;
+	bool done;
+};
+
+/**
+ * ulz4fn_init() - Start decompressing LZ4 data a block at a time
+ *
+ * @s: Stream to set up
+ * @src: Source data to decompress, which must stay in place
+ * @srcn: Length of source data
+ * @return 0 if OK, or an error as for ulz4fn()
+ */
+int ulz4fn_init(struct ulz4_stream *s, const void *src, size_t srcn);
+
+/**
+ * ulz4fn_block() - Decompress the next block of LZ4 data
+ *
+ * Once the end mark is reached, @s->done is set and *@dstn is 0.
+ *
+ * @s: Stream to decompress from
+ * @dst: Destination for uncompressed data; the block is only sure to fit
+ *	if this is @s->block_max bytes
+ * @dstn: On entry, size of @dst. Returns length of uncompressed data
+ * @return 0 if OK, or an error as for ulz4fn()
+ */
+int ulz4fn_block(struct ulz4_stream *s, void *dst, size_t *dstn);
+
 #endif
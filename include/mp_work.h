@@ -0,0 +1,93 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ * Running independent jobs on secondary CPUs
+ */
+
+#ifndef __MP_WORK_H
+#define __MP_WORK_H
+
+/**
+ * struct mp_job - a piece of work that may run on another CPU
+ *
+ * A job runs without global data, so it must not use the console, malloc(),
+ * driver model or anything else that needs gd. Hashing or decompressing a
+ * buffer in memory is fine.
+ *
+ * @func:	Function to call
+ * @arg:	Argument to pass to @func
+ * @ret:	Return value of @func, valid once mp_work_run() or mp_work_wait()
+ *		returns
+ */
+struct mp_job {
+	int (*func)(void *arg);
+	void *arg;
+	int ret;
+};
+
+#if defined(CONFIG_MP_WORK) && !defined(CONFIG_SPL_BUILD)
+/**
+ * mp_work_run() - run a set of jobs, using secondary CPUs where possible
+ *
+ * The secondary CPUs are started on first use. Jobs are handed out in order;
+ * the calling CPU runs a job itself whenever no secondary CPU is free. If no
+ * secondary CPU can be started, all jobs run on the calling CPU.
+ *
+ * @jobs:	Jobs to run
+ * @count:	Number of jobs
+ * @return number of secondary CPUs available to run jobs
+ */
+int mp_work_run(struct mp_job *jobs, int count);
+
+/**
+ * mp_work_queue() - start a job in the background
+ *
+ * The job is handed to a free secondary CPU, so the caller can get on with
+ * something else, e.g. writing out the results of the previous job. If no
+ * secondary CPU is free the job runs on the calling CPU before this returns.
+ *
+ * @job:	Job to run; this must stay in place until mp_work_wait()
+ */
+void mp_work_queue(struct mp_job *job);
+
+/**
+ * mp_work_wait() - wait for a job started by mp_work_queue() to finish
+ *
+ * @job:	Job to wait for
+ */
+void mp_work_wait(struct mp_job *job);
+
+/**
+ * mp_work_park() - return the secondary CPUs to the state we found them in
+ *
+ * This is called before handing over to an OS, and when a boot attempt
+ * fails. CPUs released by PSCI are turned off again and spin-table CPUs go
+ * back to waiting on the release address advertised in the device tree. They
+ * are started again when there is more work for them.
+ */
+void mp_work_park(void);
+#else
+static inline int mp_work_run(struct mp_job *jobs, int count)
+{
+	int i;
+
+	for (i = 0; i < count; i++)
+		jobs[i].ret = jobs[i].func(jobs[i].arg);
+
+	return 0;
+}
+
+static inline void mp_work_queue(struct mp_job *job)
+{
+	job->ret = job->func(job->arg);
+}
+
+static inline void mp_work_wait(struct mp_job *job)
+{
+}
+
+static inline void mp_work_park(void)
+{
+}
+#endif
+
+#endif /* __MP_WORK_H */
@@ -0,0 +1,171 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ * Minimal TCP client for U-Boot
+ *
+ * Only a single active-open connection is supported at a time. Data sent
+ * by the peer is handed to the caller strictly in order; segments that
+ * arrive ahead of a hole are kept in the receive window and delivered once
+ * the hole has been filled. SACK is not used, so the peer recovers losses
+ * from duplicate ACKs or its retransmission timer.
+ */
+
+#ifndef __TCP_H__
+#define __TCP_H__
+
+/*
+ *	Internet Protocol (IP) + TCP header.
+ */
+struct ip_tcp_hdr {
+	u8		ip_hl_v;	/* header length and version	*/
+	u8		ip_tos;		/* type of service		*/
+	u16		ip_len;		/* total length			*/
+	u16		ip_id;		/* identification		*/
+	u16		ip_off;		/* fragment offset field	*/
+	u8		ip_ttl;		/* time to live			*/
+	u8		ip_p;		/* protocol			*/
+	u16		ip_sum;		/* checksum			*/
+	struct in_addr	ip_src;		/* Source IP address		*/
+	struct in_addr	ip_dst;		/* Destination IP address	*/
+	u16		tcp_src;	/* TCP source port		*/
+	u16		tcp_dst;	/* TCP destination port		*/
+	u32		tcp_seq;	/* Sequence number		*/
+	u32		tcp_ack;	/* Acknowledgment number	*/
+	u8		tcp_hlen;	/* 4 bits header length, 4 rsvd	*/
+	u8		tcp_flags;	/* Control flags		*/
+	u16		tcp_win;	/* Receive window		*/
+	u16		tcp_xsum;	/* Checksum			*/
+	u16		tcp_urg;	/* Urgent pointer		*/
+} __attribute__((packed));
+
+#define IP_TCP_HDR_SIZE		(sizeof(struct ip_tcp_hdr))
+#define TCP_HDR_SIZE		(IP_TCP_HDR_SIZE - IP_HDR_SIZE)
+
+/* Control flags */
+#define TCP_FIN		0x01
+#define TCP_SYN		0x02
+#define TCP_RST		0x04
+#define TCP_PUSH	0x08
+#define TCP_ACK		0x10
+
+/* Options */
+#define TCP_O_END	0
+#define TCP_O_NOP	1
+#define TCP_O_MSS	2
+#define TCP_O_WS	3
+
+/* Largest segment that fits a 1500 byte Ethernet MTU */
+#define TCP_MSS		(1500 - IP_TCP_HDR_SIZE)
+
+enum tcp_state {
+	TCP_CLOSED,
+	TCP_SYN_SENT,
+	TCP_ESTABLISHED,
+	TCP_FIN_WAIT_1,
+	TCP_FIN_WAIT_2,
+	TCP_CLOSING,
+	TCP_CLOSE_WAIT,
+	TCP_LAST_ACK,
+};
+
+enum tcp_event {
+	TCP_EV_CONNECTED,	/* Handshake completed */
+	TCP_EV_PEER_CLOSED,	/* Peer sent FIN, all its data delivered */
+	TCP_EV_CLOSED,		/* Both directions closed */
+	TCP_EV_RESET,		/* Peer reset the connection */
+	TCP_EV_TIMEOUT,		/* Peer stopped responding */
+};
+
+/**
+ * typedef tcp_rx_f - Called with data received from the peer
+ *
+ * Data is always passed in order and each byte is passed exactly once.
+ *
+ * @data:	Received data
+ * @len:	Number of bytes at @data
+ * @return 0 to continue, or -ve to reset the connection
+ */
+typedef int tcp_rx_f(const uchar *data, unsigned int len);
+
+/**
+ * typedef tcp_event_f - Called when the connection changes state
+ *
+ * The handler may call tcp_send(), tcp_close() or tcp_abort().
+ *
+ * @event:	What happened
+ */
+typedef void tcp_event_f(enum tcp_event event);
+
+/**
+ * tcp_open() - Open a connection to a remote TCP port
+ *
+ * This sends the SYN and returns at once; @event is called with
+ * TCP_EV_CONNECTED from net_loop() once the peer has answered. Any
+ * previous connection is forgotten.
+ *
+ * @dest:	Remote IP address
+ * @dport:	Remote port
+ * @rx:	Handler for received data
+ * @event:	Handler for state changes
+ * @return 0 if OK, -ve on error
+ */
+int tcp_open(struct in_addr dest, int dport, tcp_rx_f *rx,
+	     tcp_event_f *event);
+
+/**
+ * tcp_send() - Send data on an established connection
+ *
+ * Only one segment may be outstanding, so @len must not exceed TCP_MSS and
+ * earlier data must have been acknowledged. This is enough for request /
+ * response protocols where the client sends little.
+ *
+ * @data:	Data to send
+ * @len:	Number of bytes to send
+ * @return 0 if OK, -EBUSY if data is still in flight, -ve on other error
+ */
+int tcp_send(const void *data, int len);
+
+/**
+ * tcp_close() - Close our direction of the connection by sending FIN
+ */
+void tcp_close(void);
+
+/**
+ * tcp_abort() - Reset the connection and forget about it
+ */
+void tcp_abort(void);
+
+/**
+ * tcp_get_state() - Get the state of the current connection
+ *
+ * @return connection state
+ */
+enum tcp_state tcp_get_state(void);
+
+/**
+ * tcp_set_tcp_header() - Fill in the IP and TCP headers of a segment
+ *
+ * This is called by net_send_ip_packet() for IPPROTO_TCP.
+ *
+ * @pkt:	Start of the IP header
+ * @dest:	Destination IP address
+ * @dport:	Destination port
+ * @sport:	Source port
+ * @payload_len:	Number of data bytes following the TCP header
+ * @action:	TCP control flags
+ * @tcp_seq_num:	Sequence number
+ * @tcp_ack_num:	Acknowledgment number
+ * @return size of the IP and TCP headers, including TCP options
+ */
+int tcp_set_tcp_header(uchar *pkt, struct in_addr dest, int dport, int sport,
+		       int payload_len, u8 action, u32 tcp_seq_num,
+		       u32 tcp_ack_num);
+
+/**
+ * tcp_receive() - Process a received TCP segment
+ *
+ * @ip:	IP header of the received segment
+ * @len:	Length of the IP datagram
+ */
+void tcp_receive(struct ip_tcp_hdr *ip, int len);
+
+#endif /* __TCP_H__ */
@@ -0,0 +1,26 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ * HTTP download over TCP
+ */
+
+#ifndef __WGET_H__
+#define __WGET_H__
+
+#include <blk.h>
+
+/* wget.c */
+void wget_start(void);	/* Begin HTTP GET */
+
+/**
+ * wget_set_blk_target() - Write the next download to a block device
+ *
+ * The file is streamed to consecutive blocks of @desc starting at @start
+ * instead of to memory at image_load_addr. The last block is padded with
+ * zeroes. Pass NULL to go back to loading into memory.
+ *
+ * @desc:	Block device to write to, or NULL
+ * @start:	First block to write
+ */
+void wget_set_blk_target(struct blk_desc *desc, lbaint_t start);
+
+#endif /* __WGET_H__ */
@@ -11,6 +11,50 @@
 
 struct device_node;
 
+#define OF_LIVE_IMAGE_MAGIC	0x6f666c69	/* "ofli" */
+#define OF_LIVE_IMAGE_VERSION	1
+
+/**
+ * struct of_live_image - header of a live-tree image
+ *
+ * The header is followed by the tree, laid out as unflatten_device_tree()
+ * lays it out, with the root node first. Each pointer in it holds one of
+ * enum of_live_ptr in its bottom two bits and an offset or index above them.
+ *
+ * @magic: OF_LIVE_IMAGE_MAGIC
+ * @version: OF_LIVE_IMAGE_VERSION
+ * @ptr_size: sizeof(void *) of the U-Boot that made the image
+ * @node_size: sizeof(struct device_node) of the U-Boot that made the image
+ * @prop_size: sizeof(struct property) of the U-Boot that made the image
+ * @size: Size of the tree in bytes
+ * @crc: CRC32 of the tree
+ * @fdt_size: Total size of the flat tree the image was made from
+ * @fdt_crc: CRC32 of that flat tree
+ */
+struct of_live_image {
+	u32 magic;
+	u32 version;
+	u32 ptr_size;
+	u32 node_size;
+	u32 prop_size;
+	u32 size;
+	u32 crc;
+	u32 fdt_size;
+	u32 fdt_crc;
+	u32 reserved[3];
+};
+
+/* What the pointers in a live-tree image point to */
+enum of_live_ptr {
+	OF_LIVE_PTR_NULL,	/* nothing */
+	OF_LIVE_PTR_TREE,	/* offset into the tree */
+	OF_LIVE_PTR_FDT,	/* offset into the flat tree */
+	OF_LIVE_PTR_STR,	/* index of a string held by U-Boot */
+
+	OF_LIVE_PTR_MASK	= 3,
+	OF_LIVE_PTR_SHIFT	= 2,
+};
+
 /**
  * of_live_build() - build a live (hierarchical) tree from a flat DT
  *
@@ -20,4 +64,44 @@ struct device_node;
  */
 int of_live_build(const void *fdt_blob, struct device_node **rootp);
 
+/**
+ * of_live_image_make() - make a live-tree image from a flat DT
+ *
+ * The image holds the tree as of_live_build() would build it, with pointers
+ * replaced by offsets, so that of_live_image_load() only has to copy it and
+ * fix up the pointers. It refers to the flat tree for property names and
+ * values, so it can only be used with the same flat tree.
+ *
+ * @fdt_blob: Flat tree to make the image from
+ * @buf: Buffer for the image
+ * @sizep: On entry, size of @buf. Returns the size of the image, also when
+ *	@buf is too small
+ * @return 0 if OK, -ENOSPC if @buf is too small, other -ve on error
+ */
+int of_live_image_make(const void *fdt_blob, void *buf, ulong *sizep);
+
+/**
+ * of_live_image_load() - build a live tree from a live-tree image
+ *
+ * @fdt_blob: Flat tree the image was made from
+ * @image: Image made by of_live_image_make()
+ * @rootp: Returns live tree that was created
+ * @return 0 if OK, -EPROTONOSUPPORT if @image is not an image made by this
+ *	U-Boot, -ESTALE if it was made from another flat tree, -EINVAL if it is
+ *	corrupt, -ENOMEM if out of memory
+ */
+int of_live_image_load(const void *fdt_blob, const void *image,
+		       struct device_node **rootp);
+
+/**
+ * board_of_live_image() - find the live-tree image to boot with
+ *
+ * of_live_build() uses this image, if it matches the flat tree, instead of
+ * unflattening the tree. The default returns CONFIG_OF_LIVE_IMAGE_ADDR, if
+ * set. Boards which load the image some other way may override it.
+ *
+ * @return pointer to image, or NULL if none
+ */
+const void *board_of_live_image(void);
+
 #endif
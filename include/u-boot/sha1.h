@@ -94,6 +94,22 @@ void sha1_hmac(const unsigned char *key, int keylen,
 		const unsigned char *input, unsigned int ilen,
 		unsigned char *output);
 
+/**
+ * \brief	   Hash whole blocks using CPU instructions
+ *
+ * Provided by architectures which select CONFIG_SHA1_ARCH. sha1_update()
+ * falls back to the C implementation if this fails.
+ *
+ * \param ctx	   SHA-1 context whose state is updated
+ * \param data	   input data, blocks * 64 bytes
+ * \param blocks   number of 64-byte blocks to hash
+ *
+ * \return	   0 if successful, -ENOSYS if the CPU does not support
+ *		   the instructions
+ */
+int sha1_process_arch(sha1_context *ctx, const unsigned char *data,
+		      unsigned int blocks);
+
 /**
  * \brief	   Checkup routine
  *
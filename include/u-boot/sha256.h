@@ -22,4 +22,18 @@ void sha256_finish(sha256_context * ctx, uint8_t digest[SHA256_SUM_LEN]);
 void sha256_csum_wd(const unsigned char *input, unsigned int ilen,
 		unsigned char *output, unsigned int chunk_sz);
 
+/**
+ * sha256_process_arch() - Hash whole blocks using CPU instructions
+ *
+ * Provided by architectures which select CONFIG_SHA256_ARCH. sha256_update()
+ * falls back to the C implementation if this fails.
+ *
+ * @ctx:	SHA-256 context whose state is updated
+ * @data:	Input data, @blocks * 64 bytes
+ * @blocks:	Number of 64-byte blocks to hash
+ * @return 0 if OK, -ENOSYS if the CPU does not support the instructions
+ */
+int sha256_process_arch(sha256_context *ctx, const uint8_t *data,
+			uint32_t blocks);
+
 #endif /* _SHA256_H */
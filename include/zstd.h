@@ -0,0 +1,91 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ * Decompressing zstd images into memory
+ */
+
+#ifndef __ZSTD_H
+#define __ZSTD_H
+
+#include <linux/zstd.h>
+
+/**
+ * zstd_decompress() - Decompress zstd data made of one or more frames
+ *
+ * When the data holds several frames whose sizes are all recorded in their
+ * headers (e.g. as written by "zstd -T0 --block-size=..."), each frame is
+ * decompressed on its own and, with CONFIG_MP_WORK, the frames are shared
+ * out between the available CPUs.
+ *
+ * @dst: Destination for uncompressed data
+ * @dstn: On entry, size of @dst. Returns length of uncompressed data
+ * @src: Source data to decompress
+ * @srcn: Length of source data
+ * @return 0 if OK, -ENOSPC if @dst is too small, -ENOMEM if out of memory,
+ *	-EINVAL if the data is corrupt
+ */
+int zstd_decompress(void *dst, size_t *dstn, const void *src, size_t srcn);
+
+/**
+ * struct zstd_stream - zstd data being decompressed a piece at a time
+ *
+ * The input may be split anywhere; the output is written to one contiguous
+ * buffer, so no window buffer is needed.
+ *
+ * @workspace: Memory for @dctx and @held
+ * @dctx: Decompression context
+ * @held: Holds a part of the next input unit when it spans two pieces
+ * @held_len: Number of bytes in @held
+ * @skip: Number of bytes of a skippable frame still to be skipped
+ * @between: true if at the start of a frame
+ * @frames: Number of frames completed
+ * @dst: Destination for uncompressed data
+ * @dst_len: Size of @dst
+ * @pos: Number of bytes written to @dst so far
+ */
+struct zstd_stream {
+	void *workspace;
+	ZSTD_DCtx *dctx;
+	u8 *held;
+	size_t held_len;
+	size_t skip;
+	bool between;
+	uint frames;
+	u8 *dst;
+	size_t dst_len;
+	size_t pos;
+};
+
+/**
+ * zstd_stream_init() - Start decompressing zstd data a piece at a time
+ *
+ * @zs: Stream to set up
+ * @dst: Destination for uncompressed data
+ * @dst_len: Size of @dst
+ * @return 0 if OK, -ENOMEM if out of memory
+ */
+int zstd_stream_init(struct zstd_stream *zs, void *dst, size_t dst_len);
+
+/**
+ * zstd_stream_feed() - Decompress the next piece of a zstd stream
+ *
+ * @zs: Stream to decompress into
+ * @src: Next piece of the input
+ * @len: Length of @src, which may be of any size
+ * @return 0 if OK, -ENOSPC if the destination is too small, -EINVAL if the
+ *	data is corrupt
+ */
+int zstd_stream_feed(struct zstd_stream *zs, const void *src, size_t len);
+
+/**
+ * zstd_stream_finish() - Finish decompressing a zstd stream
+ *
+ * This must be called once for each successful zstd_stream_init(), also
+ * after an error, to free the stream's memory.
+ *
+ * @zs: Stream to finish
+ * @dst_len: Returns the length of the uncompressed data
+ * @return 0 if OK, -EINVAL if the input stopped part way through a frame
+ */
+int zstd_stream_finish(struct zstd_stream *zs, size_t *dst_len);
+
+#endif
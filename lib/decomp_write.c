@@ -0,0 +1,783 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Decompressing an image from memory straight to a block device
+ *
+ * Images are decompressed a write buffer at a time, so they can be much
+ * larger than memory. There are two write buffers: while one is written to
+ * the device the other is filled, on another CPU if CONFIG_MP_WORK is
+ * enabled. A codec's fill() method may therefore run without global data,
+ * so it must not print or allocate memory. The first buffer is always
+ * filled on the calling CPU, so that codecs which allocate their window on
+ * first use (e.g. zlib and bzip2) do so there.
+ */
+
+#include <common.h>
+#include <blk.h>
+#include <bzlib.h>
+#include <console.h>
+#include <decomp_write.h>
+#include <div64.h>
+#include <gzip.h>
+#include <image.h>
+#include <lz4.h>
+#include <malloc.h>
+#include <memalign.h>
+#include <mp_work.h>
+#include <watchdog.h>
+#include <zstd.h>
+#include <asm/unaligned.h>
+#include <linux/sizes.h>
+#include <lzma/LzmaTypes.h>
+#include <lzma/LzmaDec.h>
+#include <lzma/LzmaTools.h>
+#include <u-boot/crc.h>
+#include <u-boot/zlib.h>
+
+/* Most input passed to a codec at once, as some count it in 32 bits */
+#define DW_MAX_IN		SZ_1G
+
+/* lc=3, lp=0, pb=2, the default for all LZMA tools */
+#define DW_LZMA_DEFAULT_PROPS	0x5d
+
+/* bzip2 allocates its state and then its block-sorting table */
+#define DW_BZIP2_ALLOCS		2
+
+struct decomp_write;
+
+/**
+ * struct decomp_codec - a compression format that can be streamed
+ *
+ * @comp:	IH_COMP_... value
+ * @init:	Set up decompression, printing a message on error. This may
+ *		set @dw->expected if the image records its uncompressed size
+ * @fill:	Decompress up to @size bytes to @buf, setting *@filled. Less
+ *		than @size is only returned at the end, with @dw->done set
+ * @finish:	Check the end of the image and free memory. This is called
+ *		if @init succeeds, also after an error (in @ret)
+ */
+struct decomp_codec {
+	int comp;
+	int (*init)(struct decomp_write *dw);
+	int (*fill)(struct decomp_write *dw, void *buf, ulong size,
+		    ulong *filled);
+	int (*finish)(struct decomp_write *dw, int ret);
+};
+
+/**
+ * struct decomp_write - an image being decompressed
+ *
+ * @src:	Compressed image
+ * @len:	Length of the compressed data in @src
+ * @pos:	Offset in @src of the next byte to pass to the codec
+ * @expected:	Expected uncompressed size, 0 if not known
+ * @done:	true once the codec has reached the end of the image
+ */
+struct decomp_write {
+	const u8 *src;
+	ulong len;
+	ulong pos;
+	u64 expected;
+	bool done;
+	union {
+		struct {
+			z_stream s;
+			u32 crc;
+			u32 expected_crc;
+		} gz;
+		struct {
+			void *workspace;
+			ZSTD_DStream *ds;
+		} zstd;
+		struct {
+			struct ulz4_stream s;
+			u8 *block;
+			size_t block_len;
+			size_t block_pos;
+		} lz4;
+		struct {
+			CLzmaDec dec;
+			ISzAlloc alloc;
+			u64 left;
+			bool known;
+		} lzma;
+		struct {
+			bz_stream s;
+			void *cache[DW_BZIP2_ALLOCS];
+			int cache_size[DW_BZIP2_ALLOCS];
+			bool in_use[DW_BZIP2_ALLOCS];
+			bool started;
+		} bz;
+	};
+};
+
+/**
+ * struct decomp_job - filling a write buffer
+ *
+ * @dw:		Image being decompressed
+ * @codec:	Codec to use
+ * @buf:	Buffer to fill
+ * @size:	Size of @buf
+ * @filled:	Returns the number of bytes put in @buf
+ */
+struct decomp_job {
+	struct decomp_write *dw;
+	const struct decomp_codec *codec;
+	void *buf;
+	ulong size;
+	ulong filled;
+};
+
+/* Return how much of the rest of the input to pass to the codec next */
+static ulong dw_next_in(struct decomp_write *dw)
+{
+	return min_t(ulong, dw->len - dw->pos, DW_MAX_IN);
+}
+
+#ifdef CONFIG_GZIP
+static int dw_gzip_init(struct decomp_write *dw)
+{
+	u32 size;
+	int i, r;
+
+	if (dw->len < 18) {
+		puts("Error: gunzip out of data in header\n");
+		return -EINVAL;
+	}
+	i = gzip_parse_header(dw->src, dw->len - 8);
+	if (i < 0)
+		return -EINVAL;
+
+	dw->gz.expected_crc = get_unaligned_le32(dw->src + dw->len - 8);
+	size = get_unaligned_le32(dw->src + dw->len - 4);
+	if (!dw->expected) {
+		dw->expected = size;
+	} else if (size != (u32)dw->expected) {
+		printf("size of %llx doesn't match trailer low bits %x\n",
+		       dw->expected, size);
+		return -EINVAL;
+	}
+
+	dw->gz.s.zalloc = gzalloc;
+	dw->gz.s.zfree = gzfree;
+	r = inflateInit2(&dw->gz.s, -MAX_WBITS);
+	if (r != Z_OK) {
+		printf("Error: inflateInit2() returned %d\n", r);
+		return -ENOMEM;
+	}
+	dw->pos = i;
+	dw->len -= 8;
+
+	return 0;
+}
+
+static int dw_gzip_fill(struct decomp_write *dw, void *buf, ulong size,
+			ulong *filled)
+{
+	z_stream *s = &dw->gz.s;
+	int r;
+
+	s->next_out = buf;
+	s->avail_out = size;
+	while (s->avail_out) {
+		if (!s->avail_in) {
+			s->next_in = (u8 *)dw->src + dw->pos;
+			s->avail_in = dw_next_in(dw);
+			dw->pos += s->avail_in;
+		}
+		r = inflate(s, Z_SYNC_FLUSH);
+		if (r == Z_STREAM_END) {
+			dw->done = true;
+			break;
+		}
+		/* Z_BUF_ERROR means that no progress could be made */
+		if (r != Z_OK)
+			return -EINVAL;
+	}
+	*filled = size - s->avail_out;
+	dw->gz.crc = crc32(dw->gz.crc, buf, *filled);
+
+	return 0;
+}
+
+static int dw_gzip_finish(struct decomp_write *dw, int ret)
+{
+	inflateEnd(&dw->gz.s);
+	if (!ret && dw->gz.crc != dw->gz.expected_crc) {
+		printf("\tcrcs == 0x%08x/0x%08x\n", dw->gz.expected_crc,
+		       dw->gz.crc);
+		ret = -EINVAL;
+	}
+
+	return ret;
+}
+#endif
+
+#ifdef CONFIG_ZSTD
+static int dw_zstd_init(struct decomp_write *dw)
+{
+	size_t window = 1U << ZSTD_WINDOWLOG_MIN;
+	ZSTD_frameParams params;
+	unsigned long long size;
+	size_t frame_len, wsize;
+	ulong pos;
+
+	/* The window must be big enough for every frame */
+	for (pos = 0; pos < dw->len; pos += frame_len) {
+		frame_len = ZSTD_findFrameCompressedSize(dw->src + pos,
+							 dw->len - pos);
+		if (ZSTD_isError(frame_len) ||
+		    ZSTD_getFrameParams(&params, dw->src + pos, frame_len)) {
+			puts("Error: bad zstd data\n");
+			return -EINVAL;
+		}
+		window = max_t(size_t, window, params.windowSize);
+	}
+
+	size = ZSTD_findDecompressedSize(dw->src, dw->len);
+	if (!dw->expected && size < ZSTD_CONTENTSIZE_ERROR)
+		dw->expected = size;
+
+	wsize = ZSTD_DStreamWorkspaceBound(window);
+	dw->zstd.workspace = malloc(wsize);
+	if (!dw->zstd.workspace) {
+		printf("Error: no memory for a %lu KiB zstd window\n",
+		       (ulong)window / 1024);
+		return -ENOMEM;
+	}
+	dw->zstd.ds = ZSTD_initDStream(window, dw->zstd.workspace, wsize);
+	if (!dw->zstd.ds) {
+		free(dw->zstd.workspace);
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+static int dw_zstd_fill(struct decomp_write *dw, void *buf, ulong size,
+			ulong *filled)
+{
+	ZSTD_outBuffer out = { buf, size, 0 };
+	ZSTD_inBuffer in;
+	size_t before, r;
+
+	while (out.pos < out.size) {
+		in.src = dw->src + dw->pos;
+		in.size = dw_next_in(dw);
+		in.pos = 0;
+		before = out.pos;
+		r = ZSTD_decompressStream(dw->zstd.ds, &out, &in);
+		dw->pos += in.pos;
+		if (ZSTD_isError(r))
+			return -EINVAL;
+		/* a frame ended; another may follow */
+		if (!r && dw->pos == dw->len) {
+			dw->done = true;
+			break;
+		}
+		if (!in.pos && out.pos == before)
+			return -EINVAL;		/* out of data */
+	}
+	*filled = out.pos;
+
+	return 0;
+}
+
+static int dw_zstd_finish(struct decomp_write *dw, int ret)
+{
+	free(dw->zstd.workspace);
+
+	return ret;
+}
+#endif
+
+#ifdef CONFIG_LZ4
+static int dw_lz4_init(struct decomp_write *dw)
+{
+	int ret;
+
+	ret = ulz4fn_init(&dw->lz4.s, dw->src, dw->len);
+	if (ret || !dw->lz4.s.block_max) {
+		puts("Error: bad or unsupported LZ4 data\n");
+		return ret ? ret : -EINVAL;
+	}
+	if (!dw->expected)
+		dw->expected = dw->lz4.s.content_size;
+
+	/* Only used for a block that does not fit in the write buffer */
+	dw->lz4.block = malloc(dw->lz4.s.block_max);
+	if (!dw->lz4.block)
+		return -ENOMEM;
+
+	return 0;
+}
+
+static int dw_lz4_fill(struct decomp_write *dw, void *buf, ulong size,
+		       ulong *filled)
+{
+	u8 *out = buf;
+	ulong left = size;
+	size_t n;
+	int ret;
+
+	while (left) {
+		if (dw->lz4.block_pos < dw->lz4.block_len) {
+			n = min_t(size_t, left,
+				  dw->lz4.block_len - dw->lz4.block_pos);
+			memcpy(out, dw->lz4.block + dw->lz4.block_pos, n);
+			dw->lz4.block_pos += n;
+		} else if (dw->lz4.s.done) {
+			dw->done = true;
+			break;
+		} else if (left >= dw->lz4.s.block_max) {
+			n = left;
+			ret = ulz4fn_block(&dw->lz4.s, out, &n);
+			if (ret)
+				return ret;
+		} else {
+			n = dw->lz4.s.block_max;
+			ret = ulz4fn_block(&dw->lz4.s, dw->lz4.block, &n);
+			if (ret)
+				return ret;
+			dw->lz4.block_len = n;
+			dw->lz4.block_pos = 0;
+			n = 0;
+		}
+		out += n;
+		left -= n;
+	}
+	*filled = size - left;
+
+	return 0;
+}
+
+static int dw_lz4_finish(struct decomp_write *dw, int ret)
+{
+	free(dw->lz4.block);
+
+	return ret;
+}
+#endif
+
+#ifdef CONFIG_LZMA
+static void *dw_lzma_alloc(void *p, size_t size)
+{
+	return malloc(size);
+}
+
+static void dw_lzma_free(void *p, void *address)
+{
+	free(address);
+}
+
+static int dw_lzma_init(struct decomp_write *dw)
+{
+	u64 dict_size;
+	SRes res;
+
+	if (dw->len < LZMA_HEADER_SIZE) {
+		puts("Error: LZMA header too short\n");
+		return -EINVAL;
+	}
+	dw->lzma.left = get_unaligned_le64(dw->src + LZMA_PROPS_SIZE);
+	dw->lzma.known = dw->lzma.left != ~0ULL;
+	if (!dw->expected && dw->lzma.known)
+		dw->expected = dw->lzma.left;
+
+	dw->lzma.alloc.Alloc = dw_lzma_alloc;
+	dw->lzma.alloc.Free = dw_lzma_free;
+	LzmaDec_Construct(&dw->lzma.dec);
+	res = LzmaDec_AllocateProbs(&dw->lzma.dec, dw->src, LZMA_PROPS_SIZE,
+				    &dw->lzma.alloc);
+	if (res != SZ_OK) {
+		printf("Error: LzmaDec_AllocateProbs() returned %d\n", res);
+		return res == SZ_ERROR_MEM ? -ENOMEM : -EINVAL;
+	}
+
+	/*
+	 * The dictionary never needs to be larger than the data, which is
+	 * often much smaller than the dictionary size the tool recorded
+	 */
+	dict_size = dw->lzma.dec.prop.dicSize;
+	if (dw->lzma.known)
+		dict_size = max_t(u64, min(dict_size, dw->lzma.left), 1);
+	dw->lzma.dec.dic = malloc(dict_size);
+	if (!dw->lzma.dec.dic) {
+		printf("Error: no memory for a %lu KiB LZMA dictionary\n",
+		       (ulong)dict_size / 1024);
+		LzmaDec_FreeProbs(&dw->lzma.dec, &dw->lzma.alloc);
+		return -ENOMEM;
+	}
+	dw->lzma.dec.dicBufSize = dict_size;
+	LzmaDec_Init(&dw->lzma.dec);
+	dw->pos = LZMA_HEADER_SIZE;
+
+	return 0;
+}
+
+static int dw_lzma_fill(struct decomp_write *dw, void *buf, ulong size,
+			ulong *filled)
+{
+	ELzmaFinishMode mode;
+	ELzmaStatus status;
+	SizeT out_len, in_len;
+	u8 *out = buf;
+	ulong left = size;
+	SRes res;
+
+	while (left) {
+		out_len = left;
+		in_len = dw_next_in(dw);
+		mode = LZMA_FINISH_ANY;
+		if (dw->lzma.known && out_len >= dw->lzma.left) {
+			out_len = dw->lzma.left;
+			mode = LZMA_FINISH_END;
+		}
+		res = LzmaDec_DecodeToBuf(&dw->lzma.dec, out, &out_len,
+					  dw->src + dw->pos, &in_len, mode,
+					  &status);
+		dw->pos += in_len;
+		out += out_len;
+		left -= out_len;
+		if (dw->lzma.known)
+			dw->lzma.left -= out_len;
+		if (res != SZ_OK)
+			return -EINVAL;
+		if (status == LZMA_STATUS_FINISHED_WITH_MARK ||
+		    (dw->lzma.known && !dw->lzma.left)) {
+			dw->done = true;
+			break;
+		}
+		if (!in_len && !out_len)
+			return -EINVAL;		/* out of data */
+	}
+	*filled = size - left;
+
+	return 0;
+}
+
+static int dw_lzma_finish(struct decomp_write *dw, int ret)
+{
+	LzmaDec_Free(&dw->lzma.dec, &dw->lzma.alloc);
+
+	return ret;
+}
+#endif
+
+#ifdef CONFIG_BZIP2
+/*
+ * Images from parallel bzip2 tools are made of many streams, and starting
+ * each one allocates memory again. The memory is kept when a stream ends, so
+ * that streams started while filling a buffer on another CPU can reuse it.
+ */
+static void *dw_bzip2_alloc(void *opaque, int items, int size)
+{
+	struct decomp_write *dw = opaque;
+	int want = items * size;
+	int best = -1;
+	int i;
+
+	for (i = 0; i < DW_BZIP2_ALLOCS; i++) {
+		if (dw->bz.in_use[i] || dw->bz.cache_size[i] < want)
+			continue;
+		if (best < 0 || dw->bz.cache_size[i] < dw->bz.cache_size[best])
+			best = i;
+	}
+	if (best < 0 && !dw->bz.started) {
+		for (i = 0; i < DW_BZIP2_ALLOCS; i++) {
+			if (dw->bz.in_use[i])
+				continue;
+			free(dw->bz.cache[i]);
+			dw->bz.cache[i] = malloc(want);
+			dw->bz.cache_size[i] = dw->bz.cache[i] ? want : 0;
+			best = i;
+			break;
+		}
+	}
+	if (best < 0 || !dw->bz.cache[best])
+		return NULL;
+	dw->bz.in_use[best] = true;
+
+	return dw->bz.cache[best];
+}
+
+static void dw_bzip2_free(void *opaque, void *addr)
+{
+	struct decomp_write *dw = opaque;
+	int i;
+
+	for (i = 0; i < DW_BZIP2_ALLOCS; i++) {
+		if (dw->bz.cache[i] == addr)
+			dw->bz.in_use[i] = false;
+	}
+}
+
+static int dw_bzip2_init(struct decomp_write *dw)
+{
+	int r;
+
+	dw->bz.s.bzalloc = dw_bzip2_alloc;
+	dw->bz.s.bzfree = dw_bzip2_free;
+	dw->bz.s.opaque = dw;
+	r = BZ2_bzDecompressInit(&dw->bz.s, 0, 0);
+	if (r != BZ_OK) {
+		printf("Error: BZ2_bzDecompressInit() returned %d\n", r);
+		return r == BZ_MEM_ERROR ? -ENOMEM : -EINVAL;
+	}
+
+	return 0;
+}
+
+static int dw_bzip2_fill(struct decomp_write *dw, void *buf, ulong size,
+			 ulong *filled)
+{
+	bz_stream *s = &dw->bz.s;
+	uint in, out;
+	int r;
+
+	s->next_out = buf;
+	s->avail_out = size;
+	while (s->avail_out) {
+		if (!s->avail_in) {
+			s->next_in = (char *)dw->src + dw->pos;
+			s->avail_in = dw_next_in(dw);
+			dw->pos += s->avail_in;
+		}
+		in = s->avail_in;
+		out = s->avail_out;
+		r = BZ2_bzDecompress(s);
+		if (r == BZ_STREAM_END) {
+			if (!s->avail_in && dw->pos == dw->len) {
+				dw->done = true;
+				break;
+			}
+			/* another stream follows */
+			BZ2_bzDecompressEnd(s);
+			r = BZ2_bzDecompressInit(s, 0, 0);
+			if (r != BZ_OK)
+				return -ENOMEM;
+			continue;
+		}
+		if (r != BZ_OK)
+			return r == BZ_MEM_ERROR ? -ENOMEM : -EINVAL;
+		if (s->avail_in == in && s->avail_out == out)
+			return -EINVAL;		/* out of data */
+	}
+	*filled = size - s->avail_out;
+	dw->bz.started = true;
+
+	return 0;
+}
+
+static int dw_bzip2_finish(struct decomp_write *dw, int ret)
+{
+	int i;
+
+	BZ2_bzDecompressEnd(&dw->bz.s);
+	for (i = 0; i < DW_BZIP2_ALLOCS; i++)
+		free(dw->bz.cache[i]);
+
+	return ret;
+}
+#endif
+
+static const struct decomp_codec decomp_codecs[] = {
+#ifdef CONFIG_GZIP
+	{ IH_COMP_GZIP, dw_gzip_init, dw_gzip_fill, dw_gzip_finish },
+#endif
+#ifdef CONFIG_ZSTD
+	{ IH_COMP_ZSTD, dw_zstd_init, dw_zstd_fill, dw_zstd_finish },
+#endif
+#ifdef CONFIG_LZ4
+	{ IH_COMP_LZ4, dw_lz4_init, dw_lz4_fill, dw_lz4_finish },
+#endif
+#ifdef CONFIG_LZMA
+	{ IH_COMP_LZMA, dw_lzma_init, dw_lzma_fill, dw_lzma_finish },
+#endif
+#ifdef CONFIG_BZIP2
+	{ IH_COMP_BZIP2, dw_bzip2_init, dw_bzip2_fill, dw_bzip2_finish },
+#endif
+};
+
+int decomp_write_detect(const void *src, ulong len)
+{
+	const u8 *p = src;
+	u32 magic;
+
+	if (len < LZMA_HEADER_SIZE)
+		return -EPROTONOSUPPORT;
+
+	magic = get_unaligned_le32(p);
+	if (p[0] == 0x1f && p[1] == 0x8b)
+		return IH_COMP_GZIP;
+	if (magic == ZSTD_MAGICNUMBER ||
+	    (magic & 0xfffffff0) == ZSTD_MAGIC_SKIPPABLE_START)
+		return IH_COMP_ZSTD;
+	if (magic == LZ4F_MAGIC)
+		return IH_COMP_LZ4;
+	if (p[0] == 'B' && p[1] == 'Z' && p[2] == 'h')
+		return IH_COMP_BZIP2;
+	if (p[0] == DW_LZMA_DEFAULT_PROPS)
+		return IH_COMP_LZMA;
+
+	return -EPROTONOSUPPORT;
+}
+
+static int decomp_write_job(void *arg)
+{
+	struct decomp_job *job = arg;
+
+	return job->codec->fill(job->dw, job->buf, job->size, &job->filled);
+}
+
+__weak void decomp_write_progress_init(u64 expected_size)
+{
+	putc('\n');
+}
+
+__weak void decomp_write_progress(int iteration, u64 bytes_written,
+				  u64 total_bytes)
+{
+	if (!(iteration & 3))
+		printf("%llu/%llu\r", bytes_written, total_bytes);
+}
+
+__weak void decomp_write_progress_finish(int retcode, u64 totalwritten,
+					 u64 totalsize)
+{
+	if (!retcode)
+		printf("\n\t%llu bytes\n", totalwritten);
+	else
+		printf("\n\tuncompressed %llu of %llu\n", totalwritten,
+		       totalsize);
+}
+
+int decomp_write(int comp, const void *src, ulong len, struct blk_desc *dev,
+		 ulong szwritebuf, u64 startoffs, u64 szexpected)
+{
+	const struct decomp_codec *codec = NULL;
+	struct decomp_job jobs[2];
+	struct mp_job mp_job;
+	struct decomp_write dw;
+	struct decomp_job *cur, *next;
+	lbaint_t outblock, blocks;
+	ulong tail;
+	u64 total = 0;
+	int iteration = 0;
+	bool queued;
+	int ret, i;
+
+	if (!szwritebuf || szwritebuf % dev->blksz) {
+		printf("%s: size %lu not a multiple of %lu\n", __func__,
+		       szwritebuf, dev->blksz);
+		return -EINVAL;
+	}
+	if (startoffs & (dev->blksz - 1)) {
+		printf("%s: start offset %llu not a multiple of %lu\n",
+		       __func__, startoffs, dev->blksz);
+		return -EINVAL;
+	}
+
+	for (i = 0; i < ARRAY_SIZE(decomp_codecs); i++) {
+		if (decomp_codecs[i].comp == comp)
+			codec = &decomp_codecs[i];
+	}
+	if (!codec) {
+		printf("%s: %s images are not supported\n", __func__,
+		       genimg_get_comp_name(comp));
+		return -EPROTONOSUPPORT;
+	}
+
+	memset(&dw, '\0', sizeof(dw));
+	dw.src = src;
+	dw.len = len;
+	dw.expected = szexpected;
+	ret = codec->init(&dw);
+	if (ret)
+		return ret;
+
+	outblock = lldiv(startoffs, dev->blksz);
+	if (lldiv(dw.expected, dev->blksz) > dev->lba - outblock) {
+		printf("%s: uncompressed size %llu exceeds device size\n",
+		       __func__, dw.expected);
+		ret = -ENOSPC;
+		goto out_codec;
+	}
+
+	memset(jobs, '\0', sizeof(jobs));
+	for (i = 0; i < 2; i++) {
+		jobs[i].dw = &dw;
+		jobs[i].codec = codec;
+		jobs[i].size = szwritebuf;
+		jobs[i].buf = malloc_cache_aligned(szwritebuf);
+		if (!jobs[i].buf) {
+			ret = -ENOMEM;
+			goto out;
+		}
+	}
+	mp_job.func = decomp_write_job;
+
+	decomp_write_progress_init(dw.expected);
+	cur = &jobs[0];
+	next = &jobs[1];
+	ret = decomp_write_job(cur);
+	while (!ret && cur->filled) {
+		/* fill the next buffer while this one is written */
+		queued = !dw.done;
+		next->filled = 0;
+		if (queued) {
+			mp_job.arg = next;
+			mp_work_queue(&mp_job);
+		}
+
+		blocks = DIV_ROUND_UP(cur->filled, dev->blksz);
+		tail = cur->filled % dev->blksz;
+		if (tail)
+			memset(cur->buf + cur->filled, '\0', dev->blksz - tail);
+		if (blocks > dev->lba - outblock) {
+			/* the image did not record its size */
+			printf("%s: uncompressed data exceeds device size\n",
+			       __func__);
+			ret = -ENOSPC;
+		} else if (blk_dwrite(dev, outblock, blocks, cur->buf) !=
+			   blocks) {
+			printf("%s: write failed at block " LBAF "\n", __func__,
+			       outblock);
+			ret = -EIO;
+		}
+		outblock += blocks;
+		total += cur->filled;
+		decomp_write_progress(iteration++, total, dw.expected);
+		if (!ret && ctrlc()) {
+			puts("abort\n");
+			ret = -EINTR;
+		}
+		WATCHDOG_RESET();
+
+		if (queued) {
+			mp_work_wait(&mp_job);
+			if (!ret)
+				ret = mp_job.ret;
+		}
+		swap(cur, next);
+	}
+
+	/* a write-back block cache may still hold the last blocks */
+	if (blkcache_flush(dev->if_type, dev->devnum) && !ret) {
+		printf("%s: write failed\n", __func__);
+		ret = -EIO;
+	}
+
+	if (!ret && dw.expected && total != dw.expected)
+		ret = -EINVAL;
+	if (ret == -EINVAL)
+		printf("%s: error in %s data\n", __func__,
+		       genimg_get_comp_name(comp));
+out:
+	free(jobs[0].buf);
+	free(jobs[1].buf);
+out_codec:
+	ret = codec->finish(&dw, ret);
+	decomp_write_progress_finish(ret, total, dw.expected);
+
+	return ret;
+}
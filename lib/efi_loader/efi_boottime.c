@@ -6,6 +6,7 @@
  */
 
 #include <common.h>
+#include <blk.h>
 #include <div64.h>
 #include <efi_loader.h>
 #include <irq_func.h>
@@ -1989,6 +1990,9 @@ static efi_status_t EFIAPI efi_exit_boot_services(efi_handle_t image_handle,
 
 	board_quiesce_devices();
 
+	/* Write back blocks held by the block cache */
+	blkcache_flush_all();
+
 	/* Patch out unsupported runtime function */
 	efi_runtime_detach();
 
@@ -11,7 +11,7 @@
 #include <malloc.h>
 #include <mapmem.h>
 #include <watchdog.h>
-#include <linux/list_sort.h>
+#include <linux/rbtree.h>
 #include <linux/sizes.h>
 
 DECLARE_GLOBAL_DATA_PTR;
@@ -21,17 +21,28 @@ DECLARE_GLOBAL_DATA_PTR;
 
 efi_uintn_t efi_memory_map_key;
 
+/**
+ * struct efi_mem_list - memory map entry
+ *
+ * @node:	node in efi_mem, ordered by address
+ * @free_node:	node in efi_free_mem, only used for EFI_CONVENTIONAL_MEMORY
+ * @desc:	memory descriptor
+ */
 struct efi_mem_list {
-	struct list_head link;
+	struct rb_node node;
+	struct rb_node free_node;
 	struct efi_mem_desc desc;
 };
 
-#define EFI_CARVE_NO_OVERLAP		-1
-#define EFI_CARVE_LOOP_AGAIN		-2
-#define EFI_CARVE_OVERLAPS_NONRAM	-3
-
-/* This list contains all memory map items */
-LIST_HEAD(efi_mem);
+/*
+ * The memory map is kept in a tree ordered by address, in which entries never
+ * overlap and neighbouring entries of the same type are always merged. The
+ * free memory is additionally indexed in a tree of its own, so that finding
+ * free pages does not have to walk past all the allocated entries.
+ */
+static struct rb_root efi_mem = RB_ROOT;
+static struct rb_root efi_free_mem = RB_ROOT;
+static efi_uintn_t efi_mem_entries;
 
 #ifdef CONFIG_EFI_LOADER_BOUNCE_BUFFER
 void *efi_bounce_buffer;
@@ -40,13 +51,14 @@ void *efi_bounce_buffer;
 /**
  * struct efi_pool_allocation - memory block allocated from pool
  *
- * @num_pages:	number of pages allocated
+ * @num_pages:	number of pages allocated, 0 if allocated from a pool page
  * @checksum:	checksum
  * @data:	allocated pool memory
  *
- * U-Boot services each UEFI AllocatePool() request as a separate
- * (multiple) page allocation. We have to track the number of pages
- * to be able to free the correct amount later.
+ * Large UEFI AllocatePool() requests are serviced as a separate (multiple)
+ * page allocation. We have to track the number of pages to be able to free
+ * the correct amount later. Small requests are serviced from a slot in a
+ * pool page, see struct efi_pool_page.
  *
  * The checksum calculated in function checksum() is used in FreePool() to avoid
  * freeing memory not allocated by AllocatePool() and duplicate freeing.
@@ -60,6 +72,53 @@ struct efi_pool_allocation {
 	char data[] __aligned(ARCH_DMA_MINALIGN);
 };
 
+/* Smallest pool page slot, further size classes double in size */
+#define EFI_POOL_MIN_SLOT	(2 * sizeof(struct efi_pool_allocation))
+/* Upper bounds for the number of slots in a page and of size classes */
+#define EFI_POOL_MAX_SLOTS	(EFI_PAGE_SIZE / EFI_POOL_MIN_SLOT)
+#define EFI_POOL_CLASSES	8
+
+/**
+ * struct efi_pool_page - page shared by small pool allocations
+ *
+ * Pool allocations which are small enough that at least two of them fit into
+ * a page are placed in fixed-size slots of a page of the requested memory
+ * type. This saves memory and keeps the memory map short when an application
+ * makes many small allocations.
+ *
+ * The header is stored at the start of the page, followed by the slots. Each
+ * slot starts with a struct efi_pool_allocation, as for page allocations.
+ * Free slots are tracked in a bitmap so that the contents of a freed slot
+ * are left alone.
+ *
+ * @link:	entry in the list of pages of the same type and size with
+ *		free slots
+ * @checksum:	checksum identifying a pool page
+ * @memory_type:	memory type of the page
+ * @class:	size class
+ * @slot_size:	size of each slot, including the allocation header
+ * @num_slots:	number of slots in the page
+ * @used:	number of slots in use
+ * @map:	bitmap of the slots in use
+ */
+struct efi_pool_page {
+	struct list_head link;
+	u64 checksum;
+	u16 memory_type;
+	u16 class;
+	u16 slot_size;
+	u8 num_slots;
+	u8 used;
+	u32 map[DIV_ROUND_UP(EFI_POOL_MAX_SLOTS, 32)];
+};
+
+/* Offset of the first slot in a pool page */
+#define EFI_POOL_PAGE_HDR	roundup(sizeof(struct efi_pool_page), \
+					sizeof(struct efi_pool_allocation))
+
+/* Pool pages with free slots, by memory type and size class */
+static struct list_head efi_pool_pages[EFI_MAX_MEMORY_TYPE][EFI_POOL_CLASSES];
+
 /**
  * checksum() - calculate checksum for memory allocated from pool
  *
@@ -76,24 +135,18 @@ static u64 checksum(struct efi_pool_allocation *alloc)
 	return ret;
 }
 
-/*
- * Sorts the memory list from highest address to lowest address
+/**
+ * pool_page_checksum() - calculate checksum for a pool page
  *
- * When allocating memory we should always start from the highest
- * address chunk, so sort the memory list such that the first list
- * iterator gets the highest address and goes lower from there.
+ * @page:	pool page
+ * Return:	checksum
  */
-static int efi_mem_cmp(void *priv, struct list_head *a, struct list_head *b)
+static u64 pool_page_checksum(struct efi_pool_page *page)
 {
-	struct efi_mem_list *mema = list_entry(a, struct efi_mem_list, link);
-	struct efi_mem_list *memb = list_entry(b, struct efi_mem_list, link);
-
-	if (mema->desc.physical_start == memb->desc.physical_start)
-		return 0;
-	else if (mema->desc.physical_start < memb->desc.physical_start)
-		return 1;
-	else
-		return -1;
+	u64 addr = (uintptr_t)page;
+
+	return (addr >> 32) ^ (addr << 32) ^ page->slot_size ^
+	       ~EFI_ALLOC_POOL_MAGIC;
 }
 
 static uint64_t desc_get_end(struct efi_mem_desc *desc)
@@ -101,131 +154,205 @@ static uint64_t desc_get_end(struct efi_mem_desc *desc)
 	return desc->physical_start + (desc->num_pages << EFI_PAGE_SHIFT);
 }
 
-static void efi_mem_sort(void)
+static struct efi_mem_list *efi_mem_first(void)
 {
-	struct list_head *lhandle;
-	struct efi_mem_list *prevmem = NULL;
-	bool merge_again = true;
-
-	list_sort(NULL, &efi_mem, efi_mem_cmp);
-
-	/* Now merge entries that can be merged */
-	while (merge_again) {
-		merge_again = false;
-		list_for_each(lhandle, &efi_mem) {
-			struct efi_mem_list *lmem;
-			struct efi_mem_desc *prev = &prevmem->desc;
-			struct efi_mem_desc *cur;
-			uint64_t pages;
-
-			lmem = list_entry(lhandle, struct efi_mem_list, link);
-			if (!prevmem) {
-				prevmem = lmem;
-				continue;
-			}
+	return rb_entry_safe(rb_first(&efi_mem), struct efi_mem_list, node);
+}
 
-			cur = &lmem->desc;
-
-			if ((desc_get_end(cur) == prev->physical_start) &&
-			    (prev->type == cur->type) &&
-			    (prev->attribute == cur->attribute)) {
-				/* There is an existing map before, reuse it */
-				pages = cur->num_pages;
-				prev->num_pages += pages;
-				prev->physical_start -= pages << EFI_PAGE_SHIFT;
-				prev->virtual_start -= pages << EFI_PAGE_SHIFT;
-				list_del(&lmem->link);
-				free(lmem);
-
-				merge_again = true;
-				break;
-			}
+static struct efi_mem_list *efi_mem_next(struct efi_mem_list *item)
+{
+	return rb_entry_safe(rb_next(&item->node), struct efi_mem_list, node);
+}
 
-			prevmem = lmem;
+static struct efi_mem_list *efi_mem_prev(struct efi_mem_list *item)
+{
+	return rb_entry_safe(rb_prev(&item->node), struct efi_mem_list, node);
+}
+
+/**
+ * efi_mem_find() - find the memory map entry at or below an address
+ *
+ * @addr:	address
+ * Return:	entry with the highest start address not above @addr, or NULL
+ */
+static struct efi_mem_list *efi_mem_find(u64 addr)
+{
+	struct rb_node *n = efi_mem.rb_node;
+	struct efi_mem_list *found = NULL;
+
+	while (n) {
+		struct efi_mem_list *item = rb_entry(n, struct efi_mem_list,
+						     node);
+
+		if (item->desc.physical_start <= addr) {
+			found = item;
+			n = n->rb_right;
+		} else {
+			n = n->rb_left;
 		}
 	}
+
+	return found;
 }
 
-/** efi_mem_carve_out - unmap memory region
- *
- * @map:		memory map
- * @carve_desc:		memory region to unmap
- * @overlap_only_ram:	the carved out region may only overlap RAM
- * Return Value:	the number of overlapping pages which have been
- *			removed from the map,
- *			EFI_CARVE_NO_OVERLAP, if the regions don't overlap,
- *			EFI_CARVE_OVERLAPS_NONRAM, if the carve and map overlap,
- *			and the map contains anything but free ram
- *			(only when overlap_only_ram is true),
- *			EFI_CARVE_LOOP_AGAIN, if the mapping list should be
- *			traversed again, as it has been altered.
- *
- * Unmaps all memory occupied by the carve_desc region from the list entry
- * pointed to by map.
- *
- * In case of EFI_CARVE_OVERLAPS_NONRAM it is the callers responsibility
- * to re-add the already carved out pages to the mapping.
+/**
+ * efi_free_mem_find() - find the free memory entry at or below an address
+ *
+ * @addr:	address
+ * Return:	free entry with the highest start address not above @addr,
+ *		or NULL
  */
-static s64 efi_mem_carve_out(struct efi_mem_list *map,
-			     struct efi_mem_desc *carve_desc,
-			     bool overlap_only_ram)
+static struct efi_mem_list *efi_free_mem_find(u64 addr)
 {
-	struct efi_mem_list *newmap;
-	struct efi_mem_desc *map_desc = &map->desc;
-	uint64_t map_start = map_desc->physical_start;
-	uint64_t map_end = map_start + (map_desc->num_pages << EFI_PAGE_SHIFT);
-	uint64_t carve_start = carve_desc->physical_start;
-	uint64_t carve_end = carve_start +
-			     (carve_desc->num_pages << EFI_PAGE_SHIFT);
-
-	/* check whether we're overlapping */
-	if ((carve_end <= map_start) || (carve_start >= map_end))
-		return EFI_CARVE_NO_OVERLAP;
-
-	/* We're overlapping with non-RAM, warn the caller if desired */
-	if (overlap_only_ram && (map_desc->type != EFI_CONVENTIONAL_MEMORY))
-		return EFI_CARVE_OVERLAPS_NONRAM;
-
-	/* Sanitize carve_start and carve_end to lie within our bounds */
-	carve_start = max(carve_start, map_start);
-	carve_end = min(carve_end, map_end);
-
-	/* Carving at the beginning of our map? Just move it! */
-	if (carve_start == map_start) {
-		if (map_end == carve_end) {
-			/* Full overlap, just remove map */
-			list_del(&map->link);
-			free(map);
+	struct rb_node *n = efi_free_mem.rb_node;
+	struct efi_mem_list *found = NULL;
+
+	while (n) {
+		struct efi_mem_list *item = rb_entry(n, struct efi_mem_list,
+						     free_node);
+
+		if (item->desc.physical_start <= addr) {
+			found = item;
+			n = n->rb_right;
 		} else {
-			map->desc.physical_start = carve_end;
-			map->desc.virtual_start = carve_end;
-			map->desc.num_pages = (map_end - carve_end)
-					      >> EFI_PAGE_SHIFT;
+			n = n->rb_left;
 		}
+	}
 
-		return (carve_end - carve_start) >> EFI_PAGE_SHIFT;
+	return found;
+}
+
+static void efi_mem_link(struct rb_root *root, struct rb_node *node,
+			 size_t offset, u64 start)
+{
+	struct rb_node **p = &root->rb_node, *parent = NULL;
+
+	while (*p) {
+		struct efi_mem_list *item = (void *)*p - offset;
+
+		parent = *p;
+		if (start < item->desc.physical_start)
+			p = &parent->rb_left;
+		else
+			p = &parent->rb_right;
 	}
+	rb_link_node(node, parent, p);
+	rb_insert_color(node, root);
+}
 
-	/*
-	 * Overlapping maps, just split the list map at carve_start,
-	 * it will get moved or removed in the next iteration.
-	 *
-	 * [ map_desc |__carve_start__| newmap ]
-	 */
+/**
+ * efi_mem_insert() - add an entry to the memory map
+ *
+ * The entry must not overlap any other entry.
+ *
+ * @item:	entry to add
+ */
+static void efi_mem_insert(struct efi_mem_list *item)
+{
+	u64 start = item->desc.physical_start;
+
+	efi_mem_link(&efi_mem, &item->node,
+		     offsetof(struct efi_mem_list, node), start);
+	if (item->desc.type == EFI_CONVENTIONAL_MEMORY)
+		efi_mem_link(&efi_free_mem, &item->free_node,
+			     offsetof(struct efi_mem_list, free_node), start);
+	efi_mem_entries++;
+}
+
+/**
+ * efi_mem_remove() - remove an entry from the memory map and free it
+ *
+ * @item:	entry to remove
+ */
+static void efi_mem_remove(struct efi_mem_list *item)
+{
+	rb_erase(&item->node, &efi_mem);
+	if (item->desc.type == EFI_CONVENTIONAL_MEMORY)
+		rb_erase(&item->free_node, &efi_free_mem);
+	efi_mem_entries--;
+	free(item);
+}
 
-	/* Create a new map from [ carve_start ... map_end ] */
-	newmap = calloc(1, sizeof(*newmap));
-	newmap->desc = map->desc;
-	newmap->desc.physical_start = carve_start;
-	newmap->desc.virtual_start = carve_start;
-	newmap->desc.num_pages = (map_end - carve_start) >> EFI_PAGE_SHIFT;
-	/* Insert before current entry (descending address order) */
-	list_add_tail(&newmap->link, &map->link);
+/**
+ * efi_mem_can_merge() - check if two neighbouring entries can be merged
+ *
+ * @lower:	entry at the lower address
+ * @upper:	entry at the higher address
+ * Return:	true if @upper directly follows @lower and both are alike
+ */
+static bool efi_mem_can_merge(struct efi_mem_list *lower,
+			      struct efi_mem_list *upper)
+{
+	return lower && upper &&
+	       desc_get_end(&lower->desc) == upper->desc.physical_start &&
+	       lower->desc.type == upper->desc.type &&
+	       lower->desc.attribute == upper->desc.attribute;
+}
 
-	/* Shrink the map to [ map_start ... carve_start ] */
-	map_desc->num_pages = (carve_start - map_start) >> EFI_PAGE_SHIFT;
+/**
+ * efi_mem_merge() - merge an entry with its neighbours where possible
+ *
+ * @item:	entry which was just added
+ */
+static void efi_mem_merge(struct efi_mem_list *item)
+{
+	struct efi_mem_list *prev = efi_mem_prev(item);
+	struct efi_mem_list *next = efi_mem_next(item);
 
-	return EFI_CARVE_LOOP_AGAIN;
+	if (efi_mem_can_merge(prev, item)) {
+		prev->desc.num_pages += item->desc.num_pages;
+		efi_mem_remove(item);
+		item = prev;
+	}
+	if (efi_mem_can_merge(item, next)) {
+		item->desc.num_pages += next->desc.num_pages;
+		efi_mem_remove(next);
+	}
+}
+
+/**
+ * efi_mem_carve_out() - unmap memory region
+ *
+ * Removes all memory in the range from the map. Entries which partly overlap
+ * the range are trimmed, an entry which covers both ends is split.
+ *
+ * @item:	first entry overlapping the range
+ * @start:	start of the range
+ * @end:	end of the range
+ */
+static void efi_mem_carve_out(struct efi_mem_list *item, u64 start, u64 end)
+{
+	while (item && item->desc.physical_start < end) {
+		struct efi_mem_list *next = efi_mem_next(item);
+		struct efi_mem_desc *desc = &item->desc;
+		u64 map_start = desc->physical_start;
+		u64 map_end = desc_get_end(desc);
+
+		if (map_start < start) {
+			if (map_end > end) {
+				/* Split, [ item | carve | newmap ] */
+				struct efi_mem_list *newmap;
+
+				newmap = calloc(1, sizeof(*newmap));
+				newmap->desc = *desc;
+				newmap->desc.physical_start = end;
+				newmap->desc.virtual_start = end;
+				newmap->desc.num_pages = (map_end - end) >>
+							 EFI_PAGE_SHIFT;
+				efi_mem_insert(newmap);
+			}
+			desc->num_pages = (start - map_start) >> EFI_PAGE_SHIFT;
+		} else if (map_end > end) {
+			/* Carving at the beginning of our map? Just move it! */
+			desc->physical_start = end;
+			desc->virtual_start = end;
+			desc->num_pages = (map_end - end) >> EFI_PAGE_SHIFT;
+		} else {
+			/* Full overlap, just remove map */
+			efi_mem_remove(item);
+		}
+		item = next;
+	}
 }
 
 /**
@@ -240,10 +367,8 @@ static s64 efi_mem_carve_out(struct efi_mem_list *map,
 efi_status_t efi_add_memory_map(uint64_t start, uint64_t pages, int memory_type,
 				bool overlap_only_ram)
 {
-	struct list_head *lhandle;
-	struct efi_mem_list *newlist;
-	bool carve_again;
-	uint64_t carved_pages = 0;
+	struct efi_mem_list *newlist, *item;
+	uint64_t end = start + (pages << EFI_PAGE_SHIFT);
 	struct efi_event *evt;
 
 	EFI_PRINT("%s: 0x%llx 0x%llx %d %s\n", __func__,
@@ -255,6 +380,32 @@ efi_status_t efi_add_memory_map(uint64_t start, uint64_t pages, int memory_type,
 	if (!pages)
 		return EFI_SUCCESS;
 
+	/* Find the first entry overlapping the new one */
+	item = efi_mem_find(start);
+	if (!item)
+		item = efi_mem_first();
+	else if (desc_get_end(&item->desc) <= start)
+		item = efi_mem_next(item);
+
+	if (overlap_only_ram) {
+		struct efi_mem_list *pos;
+		uint64_t covered = start;
+
+		/*
+		 * The payload wants to have RAM overlaps only. Check this
+		 * before changing anything, so that nothing needs undoing.
+		 */
+		for (pos = item; pos && pos->desc.physical_start < end;
+		     pos = efi_mem_next(pos)) {
+			if (pos->desc.physical_start > covered ||
+			    pos->desc.type != EFI_CONVENTIONAL_MEMORY)
+				return EFI_NO_MAPPING;
+			covered = desc_get_end(&pos->desc);
+		}
+		if (covered < end)
+			return EFI_NO_MAPPING;
+	}
+
 	++efi_memory_map_key;
 	newlist = calloc(1, sizeof(*newlist));
 	newlist->desc.type = memory_type;
@@ -275,60 +426,12 @@ efi_status_t efi_add_memory_map(uint64_t start, uint64_t pages, int memory_type,
 		break;
 	}
 
-	/* Add our new map */
-	do {
-		carve_again = false;
-		list_for_each(lhandle, &efi_mem) {
-			struct efi_mem_list *lmem;
-			s64 r;
-
-			lmem = list_entry(lhandle, struct efi_mem_list, link);
-			r = efi_mem_carve_out(lmem, &newlist->desc,
-					      overlap_only_ram);
-			switch (r) {
-			case EFI_CARVE_OVERLAPS_NONRAM:
-				/*
-				 * The user requested to only have RAM overlaps,
-				 * but we hit a non-RAM region. Error out.
-				 */
-				return EFI_NO_MAPPING;
-			case EFI_CARVE_NO_OVERLAP:
-				/* Just ignore this list entry */
-				break;
-			case EFI_CARVE_LOOP_AGAIN:
-				/*
-				 * We split an entry, but need to loop through
-				 * the list again to actually carve it.
-				 */
-				carve_again = true;
-				break;
-			default:
-				/* We carved a number of pages */
-				carved_pages += r;
-				carve_again = true;
-				break;
-			}
-
-			if (carve_again) {
-				/* The list changed, we need to start over */
-				break;
-			}
-		}
-	} while (carve_again);
-
-	if (overlap_only_ram && (carved_pages != pages)) {
-		/*
-		 * The payload wanted to have RAM overlaps, but we overlapped
-		 * with an unallocated region. Error out.
-		 */
-		return EFI_NO_MAPPING;
-	}
-
-	/* Add our new map */
-        list_add_tail(&newlist->link, &efi_mem);
+	/* Make room for our new map */
+	efi_mem_carve_out(item, start, end);
 
-	/* And make sure memory is listed in descending order */
-	efi_mem_sort();
+	/* Add our new map and merge it with its neighbours */
+	efi_mem_insert(newlist);
+	efi_mem_merge(newlist);
 
 	/* Notify that the memory map was changed */
 	list_for_each_entry(evt, &efi_events, link) {
@@ -360,19 +463,14 @@ efi_status_t efi_add_memory_map(uint64_t start, uint64_t pages, int memory_type,
  */
 static efi_status_t efi_check_allocated(u64 addr, bool must_be_allocated)
 {
-	struct efi_mem_list *item;
-
-	list_for_each_entry(item, &efi_mem, link) {
-		u64 start = item->desc.physical_start;
-		u64 end = start + (item->desc.num_pages << EFI_PAGE_SHIFT);
-
-		if (addr >= start && addr < end) {
-			if (must_be_allocated ^
-			    (item->desc.type == EFI_CONVENTIONAL_MEMORY))
-				return EFI_SUCCESS;
-			else
-				return EFI_NOT_FOUND;
-		}
+	struct efi_mem_list *item = efi_mem_find(addr);
+
+	if (item && addr < desc_get_end(&item->desc)) {
+		if (must_be_allocated ^
+		    (item->desc.type == EFI_CONVENTIONAL_MEMORY))
+			return EFI_SUCCESS;
+		else
+			return EFI_NOT_FOUND;
 	}
 
 	return EFI_NOT_FOUND;
@@ -380,7 +478,7 @@ static efi_status_t efi_check_allocated(u64 addr, bool must_be_allocated)
 
 static uint64_t efi_find_free_memory(uint64_t len, uint64_t max_addr)
 {
-	struct list_head *lhandle;
+	struct efi_mem_list *lmem;
 
 	/*
 	 * Prealign input max address, so we simplify our matching
@@ -388,19 +486,16 @@ static uint64_t efi_find_free_memory(uint64_t len, uint64_t max_addr)
 	 */
 	max_addr &= ~EFI_PAGE_MASK;
 
-	list_for_each(lhandle, &efi_mem) {
-		struct efi_mem_list *lmem = list_entry(lhandle,
-			struct efi_mem_list, link);
+	/* Walk the free memory downwards, starting below max_addr */
+	for (lmem = efi_free_mem_find(max_addr); lmem;
+	     lmem = rb_entry_safe(rb_prev(&lmem->free_node),
+				  struct efi_mem_list, free_node)) {
 		struct efi_mem_desc *desc = &lmem->desc;
 		uint64_t desc_len = desc->num_pages << EFI_PAGE_SHIFT;
 		uint64_t desc_end = desc->physical_start + desc_len;
 		uint64_t curmax = min(max_addr, desc_end);
 		uint64_t ret = curmax - len;
 
-		/* We only take memory from free RAM */
-		if (desc->type != EFI_CONVENTIONAL_MEMORY)
-			continue;
-
 		/* Out of bounds for max_addr */
 		if ((ret + len) > max_addr)
 			continue;
@@ -515,14 +610,132 @@ efi_status_t efi_free_pages(uint64_t memory, efi_uintn_t pages)
 	}
 
 	ret = efi_add_memory_map(memory, pages, EFI_CONVENTIONAL_MEMORY, false);
-	/* Merging of adjacent free regions is missing */
-
 	if (ret != EFI_SUCCESS)
 		return EFI_NOT_FOUND;
 
 	return ret;
 }
 
+/**
+ * efi_pool_class() - get the pool page size class for an allocation
+ *
+ * @size:	size of the allocation, including the allocation header
+ * @slot_size:	on return the slot size of the class
+ * Return:	size class, or -1 if the allocation needs pages of its own
+ */
+static int efi_pool_class(u64 size, u32 *slot_size)
+{
+	u32 slot = EFI_POOL_MIN_SLOT;
+	int class;
+
+	for (class = 0; class < EFI_POOL_CLASSES; class++, slot <<= 1) {
+		/* Only use pages which hold at least two slots */
+		if ((EFI_PAGE_SIZE - EFI_POOL_PAGE_HDR) / slot < 2)
+			break;
+		if (size <= slot) {
+			*slot_size = slot;
+			return class;
+		}
+	}
+
+	return -1;
+}
+
+/**
+ * efi_pool_page_alloc() - allocate memory from a pool page
+ *
+ * @pool_type:	type of the pool from which memory is to be allocated
+ * @class:	size class
+ * @slot_size:	slot size of the class
+ * @allocp:	on return the allocation header
+ * Return:	status code
+ */
+static efi_status_t efi_pool_page_alloc(int pool_type, int class,
+					u32 slot_size,
+					struct efi_pool_allocation **allocp)
+{
+	struct list_head *head = &efi_pool_pages[pool_type][class];
+	struct efi_pool_page *page;
+	unsigned int slot, i;
+	efi_status_t r;
+	u64 addr;
+
+	if (!head->next)
+		INIT_LIST_HEAD(head);
+
+	if (list_empty(head)) {
+		r = efi_allocate_pages(EFI_ALLOCATE_ANY_PAGES, pool_type, 1,
+				       &addr);
+		if (r != EFI_SUCCESS)
+			return r;
+		page = (struct efi_pool_page *)(uintptr_t)addr;
+		memset(page, 0, sizeof(*page));
+		page->memory_type = pool_type;
+		page->class = class;
+		page->slot_size = slot_size;
+		page->num_slots = (EFI_PAGE_SIZE - EFI_POOL_PAGE_HDR) /
+				  slot_size;
+		page->checksum = pool_page_checksum(page);
+		list_add(&page->link, head);
+	} else {
+		page = list_first_entry(head, struct efi_pool_page, link);
+	}
+
+	/* Take the first free slot */
+	for (i = 0; page->map[i] == ~0U; i++)
+		;
+	slot = i * 32 + ffs(~page->map[i]) - 1;
+	page->map[i] |= 1U << (slot % 32);
+	if (++page->used == page->num_slots)
+		list_del(&page->link);
+
+	*allocp = (void *)page + EFI_POOL_PAGE_HDR + slot * slot_size;
+	(*allocp)->num_pages = 0;
+
+	return EFI_SUCCESS;
+}
+
+/**
+ * efi_pool_page_free() - free memory allocated from a pool page
+ *
+ * @alloc:	allocation header
+ * Return:	status code
+ */
+static efi_status_t efi_pool_page_free(struct efi_pool_allocation *alloc)
+{
+	struct efi_pool_page *page;
+	unsigned int slot;
+	uintptr_t offset;
+	u32 slot_size;
+	u32 bit;
+
+	page = (void *)((uintptr_t)alloc & ~(uintptr_t)EFI_PAGE_MASK);
+	if (page->checksum != pool_page_checksum(page))
+		return EFI_INVALID_PARAMETER;
+
+	offset = (uintptr_t)alloc - (uintptr_t)page - EFI_POOL_PAGE_HDR;
+	slot_size = page->slot_size;
+	slot = offset / slot_size;
+	bit = 1U << (slot % 32);
+	if (offset % slot_size || slot >= page->num_slots ||
+	    !(page->map[slot / 32] & bit))
+		return EFI_INVALID_PARAMETER;
+
+	page->map[slot / 32] &= ~bit;
+	if (page->used-- == page->num_slots) {
+		/* The page was full, so it is not on the list */
+		list_add(&page->link,
+			 &efi_pool_pages[page->memory_type][page->class]);
+	}
+	if (!page->used) {
+		list_del(&page->link);
+		page->checksum = 0;
+		return efi_free_pages((uintptr_t)page, 1);
+	}
+
+	return EFI_SUCCESS;
+}
+
 /**
  * efi_allocate_pool - allocate memory from pool
  *
@@ -538,6 +751,8 @@ efi_status_t efi_allocate_pool(int pool_type, efi_uintn_t size, void **buffer)
 	struct efi_pool_allocation *alloc;
 	u64 num_pages = efi_size_in_pages(size +
 					  sizeof(struct efi_pool_allocation));
+	u32 slot_size;
+	int class;
 
 	if (!buffer)
 		return EFI_INVALID_PARAMETER;
@@ -547,6 +762,18 @@ efi_status_t efi_allocate_pool(int pool_type, efi_uintn_t size, void **buffer)
 		return EFI_SUCCESS;
 	}
 
+	class = efi_pool_class((u64)size + sizeof(struct efi_pool_allocation),
+			       &slot_size);
+	if (class >= 0 && pool_type >= 0 && pool_type < EFI_MAX_MEMORY_TYPE &&
+	    pool_type != EFI_CONVENTIONAL_MEMORY) {
+		r = efi_pool_page_alloc(pool_type, class, slot_size, &alloc);
+		if (r != EFI_SUCCESS)
+			return r;
+		alloc->checksum = checksum(alloc);
+		*buffer = alloc->data;
+		return EFI_SUCCESS;
+	}
+
 	r = efi_allocate_pages(EFI_ALLOCATE_ANY_PAGES, pool_type, num_pages,
 			       &addr);
 	if (r == EFI_SUCCESS) {
@@ -580,7 +807,7 @@ efi_status_t efi_free_pool(void *buffer)
 	alloc = container_of(buffer, struct efi_pool_allocation, data);
 
 	/* Check that this memory was allocated by efi_allocate_pool() */
-	if (((uintptr_t)alloc & EFI_PAGE_MASK) ||
+	if ((alloc->num_pages && ((uintptr_t)alloc & EFI_PAGE_MASK)) ||
 	    alloc->checksum != checksum(alloc)) {
 		printf("%s: illegal free 0x%p\n", __func__, buffer);
 		return EFI_INVALID_PARAMETER;
@@ -588,6 +815,13 @@ efi_status_t efi_free_pool(void *buffer)
 	/* Avoid double free */
 	alloc->checksum = 0;
 
+	if (!alloc->num_pages) {
+		ret = efi_pool_page_free(alloc);
+		if (ret != EFI_SUCCESS)
+			printf("%s: illegal free 0x%p\n", __func__, buffer);
+		return ret;
+	}
+
 	ret = efi_free_pages((uintptr_t)alloc, alloc->num_pages);
 
 	return ret;
@@ -611,8 +845,7 @@ efi_status_t efi_get_memory_map(efi_uintn_t *memory_map_size,
 				uint32_t *descriptor_version)
 {
 	efi_uintn_t map_size = 0;
-	int map_entries = 0;
-	struct list_head *lhandle;
+	struct efi_mem_list *lmem;
 	efi_uintn_t provided_map_size;
 
 	if (!memory_map_size)
@@ -620,10 +853,7 @@ efi_status_t efi_get_memory_map(efi_uintn_t *memory_map_size,
 
 	provided_map_size = *memory_map_size;
 
-	list_for_each(lhandle, &efi_mem)
-		map_entries++;
-
-	map_size = map_entries * sizeof(struct efi_mem_desc);
+	map_size = efi_mem_entries * sizeof(struct efi_mem_desc);
 
 	*memory_map_size = map_size;
 
@@ -639,16 +869,9 @@ efi_status_t efi_get_memory_map(efi_uintn_t *memory_map_size,
 	if (!memory_map)
 		return EFI_INVALID_PARAMETER;
 
-	/* Copy list into array */
-	/* Return the list in ascending order */
-	memory_map = &memory_map[map_entries - 1];
-	list_for_each(lhandle, &efi_mem) {
-		struct efi_mem_list *lmem;
-
-		lmem = list_entry(lhandle, struct efi_mem_list, link);
-		*memory_map = lmem->desc;
-		memory_map--;
-	}
+	/* Copy the map into the array in ascending order */
+	for (lmem = efi_mem_first(); lmem; lmem = efi_mem_next(lmem))
+		*memory_map++ = lmem->desc;
 
 	if (map_key)
 		*map_key = efi_memory_map_key;
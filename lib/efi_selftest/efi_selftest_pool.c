@@ -0,0 +1,238 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * efi_selftest_pool
+ *
+ * This unit test checks the following boottime services:
+ * AllocatePool, FreePool, GetMemoryMap
+ *
+ * Many small pool allocations are made and freed. They must not add an entry
+ * to the memory map each, and the memory map must be back to its previous
+ * state afterwards. The number of allocations per second is reported.
+ */
+
+#include <efi_selftest.h>
+
+#define EFI_ST_NUM_ALLOCS	4096
+#define EFI_ST_MAX_SIZE		400
+/* Time for measuring the allocation rate, in units of 100 ns */
+#define EFI_ST_BENCH_TIME	1000000
+
+static struct efi_boot_services *boottime;
+static void **buffers;
+static struct efi_event *timer;
+
+/**
+ * setup() - setup unit test
+ *
+ * @handle:	handle of the loaded image
+ * @systable:	system table
+ * Return:	EFI_ST_SUCCESS for success
+ */
+static int setup(const efi_handle_t handle,
+		 const struct efi_system_table *systable)
+{
+	efi_status_t ret;
+
+	boottime = systable->boottime;
+
+	ret = boottime->allocate_pool(EFI_LOADER_DATA,
+				      EFI_ST_NUM_ALLOCS * sizeof(void *),
+				      (void **)&buffers);
+	if (ret != EFI_SUCCESS) {
+		efi_st_error("AllocatePool did not return EFI_SUCCESS\n");
+		return EFI_ST_FAILURE;
+	}
+	ret = boottime->create_event(EVT_TIMER, TPL_CALLBACK, NULL, NULL,
+				     &timer);
+	if (ret != EFI_SUCCESS) {
+		efi_st_error("could not create event\n");
+		return EFI_ST_FAILURE;
+	}
+
+	return EFI_ST_SUCCESS;
+}
+
+/**
+ * teardown() - tear down unit test
+ *
+ * Return:	EFI_ST_SUCCESS for success
+ */
+static int teardown(void)
+{
+	efi_status_t ret;
+
+	if (timer) {
+		ret = boottime->close_event(timer);
+		timer = NULL;
+		if (ret != EFI_SUCCESS) {
+			efi_st_error("could not close event\n");
+			return EFI_ST_FAILURE;
+		}
+	}
+	if (buffers) {
+		ret = boottime->free_pool(buffers);
+		buffers = NULL;
+		if (ret != EFI_SUCCESS) {
+			efi_st_error("FreePool did not return EFI_SUCCESS\n");
+			return EFI_ST_FAILURE;
+		}
+	}
+
+	return EFI_ST_SUCCESS;
+}
+
+/**
+ * map_entries() - get the number of memory map entries
+ *
+ * Return:	number of entries, 0 on error
+ */
+static efi_uintn_t map_entries(void)
+{
+	efi_uintn_t map_size = 0;
+	efi_uintn_t map_key;
+	efi_uintn_t desc_size;
+	u32 desc_version;
+	efi_status_t ret;
+
+	ret = boottime->get_memory_map(&map_size, NULL, &map_key, &desc_size,
+				       &desc_version);
+	if (ret != EFI_BUFFER_TOO_SMALL || !desc_size) {
+		efi_st_error
+			("GetMemoryMap did not return EFI_BUFFER_TOO_SMALL\n");
+		return 0;
+	}
+
+	return map_size / desc_size;
+}
+
+/**
+ * alloc_size() - size of the i-th allocation
+ *
+ * @i:		index of the allocation
+ * Return:	size in bytes
+ */
+static efi_uintn_t alloc_size(unsigned int i)
+{
+	return 1 + (i * 37) % EFI_ST_MAX_SIZE;
+}
+
+/**
+ * check_buffer() - check that a buffer still holds its fill pattern
+ *
+ * @i:		index of the allocation
+ * Return:	EFI_ST_SUCCESS for success
+ */
+static int check_buffer(unsigned int i)
+{
+	u8 *buf = buffers[i];
+	efi_uintn_t j;
+
+	for (j = 0; j < alloc_size(i); ++j) {
+		if (buf[j] != (u8)i) {
+			efi_st_error("Pool buffer %u was overwritten\n", i);
+			return EFI_ST_FAILURE;
+		}
+	}
+
+	return EFI_ST_SUCCESS;
+}
+
+/**
+ * execute() - execute unit test
+ *
+ * Return:	EFI_ST_SUCCESS for success
+ */
+static int execute(void)
+{
+	efi_uintn_t entries, entries_used, entries_after;
+	unsigned int i, j, count;
+	efi_status_t ret;
+
+	entries = map_entries();
+	if (!entries)
+		return EFI_ST_FAILURE;
+
+	/* Allocate small buffers of two memory types, alternately */
+	for (i = 0; i < EFI_ST_NUM_ALLOCS; ++i) {
+		ret = boottime->allocate_pool(i & 1 ? EFI_BOOT_SERVICES_DATA :
+					      EFI_LOADER_DATA, alloc_size(i),
+					      &buffers[i]);
+		if (ret != EFI_SUCCESS) {
+			efi_st_error("AllocatePool did not return EFI_SUCCESS\n");
+			return EFI_ST_FAILURE;
+		}
+		if ((uintptr_t)buffers[i] & 7) {
+			efi_st_error("Pool buffer is not 8 byte aligned\n");
+			return EFI_ST_FAILURE;
+		}
+		boottime->set_mem(buffers[i], alloc_size(i), (u8)i);
+	}
+
+	entries_used = map_entries();
+	if (entries_used > entries + EFI_ST_NUM_ALLOCS / 4) {
+		efi_st_error("Memory map grew from %u to %u entries\n",
+			     (unsigned int)entries, (unsigned int)entries_used);
+		return EFI_ST_FAILURE;
+	}
+
+	/* Free in an order unrelated to the order of allocation */
+	for (i = 0; i < EFI_ST_NUM_ALLOCS; ++i) {
+		j = (i * 1237) % EFI_ST_NUM_ALLOCS;
+		if (check_buffer(j) != EFI_ST_SUCCESS)
+			return EFI_ST_FAILURE;
+		ret = boottime->free_pool(buffers[j]);
+		if (ret != EFI_SUCCESS) {
+			efi_st_error("FreePool did not return EFI_SUCCESS\n");
+			return EFI_ST_FAILURE;
+		}
+	}
+
+	entries_after = map_entries();
+	if (entries_after != entries) {
+		efi_st_error("Memory map has %u entries, expected %u\n",
+			     (unsigned int)entries_after,
+			     (unsigned int)entries);
+		return EFI_ST_FAILURE;
+	}
+
+	/* Measure how many allocations can be made and freed per second */
+	ret = boottime->set_timer(timer, EFI_TIMER_RELATIVE,
+				  EFI_ST_BENCH_TIME);
+	if (ret != EFI_SUCCESS) {
+		efi_st_error("Could not set timer\n");
+		return EFI_ST_FAILURE;
+	}
+	count = 0;
+	do {
+		for (i = 0; i < 256; ++i) {
+			ret = boottime->allocate_pool(EFI_BOOT_SERVICES_DATA,
+						      alloc_size(i),
+						      &buffers[i]);
+			if (ret != EFI_SUCCESS) {
+				efi_st_error("AllocatePool did not return EFI_SUCCESS\n");
+				return EFI_ST_FAILURE;
+			}
+		}
+		for (i = 0; i < 256; ++i) {
+			ret = boottime->free_pool(buffers[i]);
+			if (ret != EFI_SUCCESS) {
+				efi_st_error("FreePool did not return EFI_SUCCESS\n");
+				return EFI_ST_FAILURE;
+			}
+		}
+		count += 256;
+	} while (boottime->check_event(timer) == EFI_NOT_READY);
+
+	efi_st_printf("%u pool allocations and frees in %u ms\n", count,
+		      EFI_ST_BENCH_TIME / 10000);
+
+	return EFI_ST_SUCCESS;
+}
+
+EFI_UNIT_TEST(pool) = {
+	.name = "pool allocation",
+	.phase = EFI_EXECUTE_BEFORE_BOOTTIME_EXIT,
+	.setup = setup,
+	.execute = execute,
+	.teardown = teardown,
+};
@@ -21,6 +21,7 @@
 #include <serial.h>
 #include <asm/sections.h>
 #include <linux/ctype.h>
+#include <linux/log2.h>
 #include <linux/lzo.h>
 
 DECLARE_GLOBAL_DATA_PTR;
@@ -314,7 +315,7 @@ int fdtdec_next_alias(const void *blob, const char *name, enum fdt_compat_id id,
 	/* snprintf() is not available */
 	assert(strlen(name) < MAX_STR_LEN);
 	sprintf(str, "%.*s%d", MAX_STR_LEN, name, *upto);
-	node = fdt_path_offset(blob, str);
+	node = fdtdec_path_offset(blob, str);
 	if (node < 0)
 		return node;
 	err = fdt_node_check_compatible(blob, node, compat_names[id]);
@@ -349,7 +350,7 @@ int fdtdec_add_aliases_for_id(const void *blob, const char *name,
 	int i, j;
 
 	/* find the alias node if present */
-	alias_node = fdt_path_offset(blob, "/aliases");
+	alias_node = fdtdec_path_offset(blob, "/aliases");
 
 	/*
 	 * start with nothing, and we can assume that the root node can't
@@ -380,7 +381,7 @@ int fdtdec_add_aliases_for_id(const void *blob, const char *name,
 		prop = fdt_get_property_by_offset(blob, offset, NULL);
 		path = fdt_string(blob, fdt32_to_cpu(prop->nameoff));
 		if (prop->len && 0 == strncmp(path, name, name_len))
-			node = fdt_path_offset(blob, prop->data);
+			node = fdtdec_path_offset(blob, prop->data);
 		if (node <= 0)
 			continue;
 
@@ -463,7 +464,7 @@ int fdtdec_get_alias_seq(const void *blob, const char *base, int offset,
 	find_name = fdt_get_name(blob, offset, &find_namelen);
 	debug("Looking for '%s' at %d, name %s\n", base, offset, find_name);
 
-	aliases = fdt_path_offset(blob, "/aliases");
+	aliases = fdtdec_path_offset(blob, "/aliases");
 	for (prop_offset = fdt_first_property_offset(blob, aliases);
 	     prop_offset > 0;
 	     prop_offset = fdt_next_property_offset(blob, prop_offset)) {
@@ -502,7 +503,7 @@ int fdtdec_get_alias_highest_id(const void *blob, const char *base)
 
 	debug("Looking for highest alias id for '%s'\n", base);
 
-	aliases = fdt_path_offset(blob, "/aliases");
+	aliases = fdtdec_path_offset(blob, "/aliases");
 	for (prop_offset = fdt_first_property_offset(blob, aliases);
 	     prop_offset > 0;
 	     prop_offset = fdt_next_property_offset(blob, prop_offset)) {
@@ -532,7 +533,7 @@ const char *fdtdec_get_chosen_prop(const void *blob, const char *name)
 
 	if (!blob)
 		return NULL;
-	chosen_node = fdt_path_offset(blob, "/chosen");
+	chosen_node = fdtdec_path_offset(blob, "/chosen");
 	return fdt_getprop(blob, chosen_node, name, NULL);
 }
 
@@ -543,7 +544,7 @@ int fdtdec_get_chosen_node(const void *blob, const char *name)
 	prop = fdtdec_get_chosen_prop(blob, name);
 	if (!prop)
 		return -FDT_ERR_NOTFOUND;
-	return fdt_path_offset(blob, prop);
+	return fdtdec_path_offset(blob, prop);
 }
 
 int fdtdec_check_fdt(void)
@@ -584,6 +585,210 @@ int fdtdec_prepare_fdt(void)
 	return 0;
 }
 
+#if CONFIG_IS_ENABLED(OF_LOOKUP_CACHE)
+/* Number of path lookups remembered */
+#define FDTDEC_CACHE_PATHS	64
+
+/**
+ * struct fdtdec_cache - Cached lookups in the control FDT
+ *
+ * The cache is dropped when the FDT moves, or when its structure block
+ * changes size, as it does when a node is added or removed or a property
+ * changes size, since the node offsets then move too. It is only built once
+ * the full malloc() area is available, so that the small early malloc() area
+ * is left for devices.
+ *
+ * @blob: FDT the lookups are for
+ * @struct_size: Size of the FDT's structure block
+ * @no_phandles: true if there was no room for the phandle table
+ * @phandle_mask: Number of slots in @phandles, less one
+ * @phandles: Hash table of node offsets by phandle, or NULL if not built
+ * @paths: Node offsets (or errors) by path, one slot per path hash
+ */
+struct fdtdec_cache {
+	const void *blob;
+	int struct_size;
+	bool no_phandles;
+	uint phandle_mask;
+	struct fdtdec_phandle {
+		u32 phandle;
+		int offset;
+	} *phandles;
+	struct fdtdec_path {
+		char *path;
+		int offset;
+		u32 name_hash;
+	} paths[FDTDEC_CACHE_PATHS];
+};
+
+static u32 fdtdec_hash(const char *str, int len)
+{
+	u32 hash = 5381;
+
+	while (len--)
+		hash = hash * 33 + *str++;
+
+	return hash;
+}
+
+static void fdtdec_cache_free(struct fdtdec_cache *cache)
+{
+	int i;
+
+	for (i = 0; i < FDTDEC_CACHE_PATHS; i++)
+		free(cache->paths[i].path);
+	free(cache->phandles);
+	free(cache);
+}
+
+/* Get the cache for @blob if it is the control FDT, dropping any stale one */
+static struct fdtdec_cache *fdtdec_cache_get(const void *blob)
+{
+	struct fdtdec_cache *cache = gd->fdt_cache;
+
+	if (!blob || blob != gd->fdt_blob ||
+	    !(gd->flags & GD_FLG_FULL_MALLOC_INIT))
+		return NULL;
+	if (cache && cache->blob == blob &&
+	    cache->struct_size == fdt_size_dt_struct(blob))
+		return cache;
+
+	if (cache)
+		fdtdec_cache_free(cache);
+	gd->fdt_cache = NULL;
+	cache = calloc(1, sizeof(*cache));
+	if (!cache)
+		return NULL;
+	cache->blob = blob;
+	cache->struct_size = fdt_size_dt_struct(blob);
+	gd->fdt_cache = cache;
+
+	return cache;
+}
+
+/* Find the slot holding @phandle, or the empty slot where it would go */
+static struct fdtdec_phandle *fdtdec_cache_phandle(struct fdtdec_cache *cache,
+						   u32 phandle)
+{
+	uint slot;
+
+	/* dtc numbers phandles from 1, so use them directly */
+	for (slot = phandle & cache->phandle_mask;
+	     cache->phandles[slot].phandle &&
+	     cache->phandles[slot].phandle != phandle;
+	     slot = (slot + 1) & cache->phandle_mask)
+		;
+
+	return &cache->phandles[slot];
+}
+
+static int fdtdec_cache_build_phandles(struct fdtdec_cache *cache)
+{
+	const void *blob = cache->blob;
+	struct fdtdec_phandle *entry;
+	uint count = 0, slots;
+	u32 phandle;
+	int offset;
+
+	for (offset = fdt_next_node(blob, -1, NULL); offset >= 0;
+	     offset = fdt_next_node(blob, offset, NULL)) {
+		if (fdt_get_phandle(blob, offset))
+			count++;
+	}
+	slots = roundup_pow_of_two(count * 2 + 1);
+	cache->phandles = calloc(slots, sizeof(*cache->phandles));
+	if (!cache->phandles)
+		return -ENOMEM;
+	cache->phandle_mask = slots - 1;
+
+	/* Keep the first node with each phandle, as libfdt would find */
+	for (offset = fdt_next_node(blob, -1, NULL); offset >= 0;
+	     offset = fdt_next_node(blob, offset, NULL)) {
+		phandle = fdt_get_phandle(blob, offset);
+		if (!phandle)
+			continue;
+		entry = fdtdec_cache_phandle(cache, phandle);
+		if (!entry->phandle) {
+			entry->phandle = phandle;
+			entry->offset = offset;
+		}
+	}
+
+	return 0;
+}
+
+int fdtdec_node_offset_by_phandle(const void *blob, uint32_t phandle)
+{
+	struct fdtdec_cache *cache = fdtdec_cache_get(blob);
+	struct fdtdec_phandle *entry;
+	int offset;
+
+	if (!cache || !phandle || phandle == (uint32_t)-1)
+		return fdt_node_offset_by_phandle(blob, phandle);
+	if (!cache->phandles && !cache->no_phandles &&
+	    fdtdec_cache_build_phandles(cache))
+		cache->no_phandles = true;
+	if (!cache->phandles)
+		return fdt_node_offset_by_phandle(blob, phandle);
+
+	entry = fdtdec_cache_phandle(cache, phandle);
+	if (entry->phandle && fdt_get_phandle(blob, entry->offset) == phandle)
+		return entry->offset;
+
+	/*
+	 * The phandle is missing, or has moved without the tree changing
+	 * size, e.g. with fdtdec_set_phandle(). Search the tree, and if the
+	 * table was wrong, drop it so that it is built again.
+	 */
+	offset = fdt_node_offset_by_phandle(blob, phandle);
+	if (entry->phandle || offset >= 0) {
+		fdtdec_cache_free(cache);
+		gd->fdt_cache = NULL;
+	}
+
+	return offset;
+}
+
+int fdtdec_path_offset(const void *blob, const char *path)
+{
+	struct fdtdec_cache *cache = fdtdec_cache_get(blob);
+	struct fdtdec_path *entry;
+	int offset, len, namelen;
+	const char *name;
+
+	if (!cache)
+		return fdt_path_offset(blob, path);
+
+	len = strlen(path);
+	entry = &cache->paths[fdtdec_hash(path, len) % FDTDEC_CACHE_PATHS];
+	if (entry->path && !strcmp(entry->path, path)) {
+		if (entry->offset < 0)
+			return entry->offset;
+
+		/* Check that the node is still there */
+		name = fdt_get_name(blob, entry->offset, &namelen);
+		if (name && fdtdec_hash(name, namelen) == entry->name_hash)
+			return entry->offset;
+	}
+
+	offset = fdt_path_offset(blob, path);
+	if (!entry->path || strcmp(entry->path, path)) {
+		free(entry->path);
+		entry->path = NULL;
+		entry->path = strdup(path);
+		if (!entry->path)
+			return offset;
+	}
+	entry->offset = offset;
+	if (offset >= 0) {
+		name = fdt_get_name(blob, offset, &namelen);
+		entry->name_hash = fdtdec_hash(name, namelen);
+	}
+
+	return offset;
+}
+#endif
+
 int fdtdec_lookup_phandle(const void *blob, int node, const char *prop_name)
 {
 	const u32 *phandle;
@@ -594,7 +799,8 @@ int fdtdec_lookup_phandle(const void *blob, int node, const char *prop_name)
 	if (!phandle)
 		return -FDT_ERR_NOTFOUND;
 
-	lookup = fdt_node_offset_by_phandle(blob, fdt32_to_cpu(*phandle));
+	lookup = fdtdec_node_offset_by_phandle(blob,
+					       fdt32_to_cpu(*phandle));
 	return lookup;
 }
 
@@ -725,8 +931,8 @@ int fdtdec_parse_phandle_with_args(const void *blob, int src_node,
 			 * below.
 			 */
 			if (cells_name || cur_index == index) {
-				node = fdt_node_offset_by_phandle(blob,
-								  phandle);
+				node = fdtdec_node_offset_by_phandle(blob,
+								     phandle);
 				if (!node) {
 					debug("%s: could not find phandle\n",
 					      fdt_get_name(blob, src_node,
@@ -851,7 +1057,7 @@ int fdtdec_get_config_int(const void *blob, const char *prop_name,
 	int config_node;
 
 	debug("%s: %s\n", __func__, prop_name);
-	config_node = fdt_path_offset(blob, "/config");
+	config_node = fdtdec_path_offset(blob, "/config");
 	if (config_node < 0)
 		return default_val;
 	return fdtdec_get_int(blob, config_node, prop_name, default_val);
@@ -863,7 +1069,7 @@ int fdtdec_get_config_bool(const void *blob, const char *prop_name)
 	const void *prop;
 
 	debug("%s: %s\n", __func__, prop_name);
-	config_node = fdt_path_offset(blob, "/config");
+	config_node = fdtdec_path_offset(blob, "/config");
 	if (config_node < 0)
 		return 0;
 	prop = fdt_get_property(blob, config_node, prop_name, NULL);
@@ -878,7 +1084,7 @@ char *fdtdec_get_config_string(const void *blob, const char *prop_name)
 	int len;
 
 	debug("%s: %s\n", __func__, prop_name);
-	nodeoffset = fdt_path_offset(blob, "/config");
+	nodeoffset = fdtdec_path_offset(blob, "/config");
 	if (nodeoffset < 0)
 		return NULL;
 
@@ -22,6 +22,22 @@ static void LZ4_wildCopy(void* dstPtr, const void* srcPtr, void* dstEnd)
     do { LZ4_copy8(d,s); d+=8; s+=8; } while (d<e);
 }
 
+static void LZ4_copy16(void* dst, const void* src)
+{
+    LZ4_copy8(dst, src);
+    LZ4_copy8((BYTE*)dst+8, (const BYTE*)src+8);
+}
+
+/* as LZ4_wildCopy, in 32-byte steps, so it may overwrite up to 31 bytes beyond dstEnd.
+ * Overlapping copies need the source to be at least 16 bytes behind. */
+static void LZ4_wildCopy32(void* dstPtr, const void* srcPtr, void* dstEnd)
+{
+    BYTE* d = (BYTE*)dstPtr;
+    const BYTE* s = (const BYTE*)srcPtr;
+    BYTE* e = (BYTE*)dstEnd;
+    do { LZ4_copy16(d,s); LZ4_copy16(d+16,s+16); d+=32; s+=32; } while (d<e);
+}
+
 
 /**************************************
 *  Common Constants
@@ -31,6 +47,7 @@ static void LZ4_wildCopy(void* dstPtr, const void* srcPtr, void* dstEnd)
 #define COPYLENGTH 8
 #define LASTLITERALS 5
 #define MFLIMIT (COPYLENGTH+MINMATCH)
+#define FASTLOOP_SAFE_DISTANCE 64
 static const int LZ4_minLength = (MFLIMIT+1);
 
 #define KB *(1 <<10)
@@ -96,6 +113,10 @@ FORCE_INLINE int LZ4_decompress_generic(
     const int safeDecode = (endOnInput==endOnInputSize);
     const int checkOffset = ((safeDecode) && (dictSize < (int)(64 KB)));
 
+    unsigned token;
+    size_t length;
+    const BYTE* match;
+
 
     /* Special cases */
     if ((partialDecoding) && (oexit> oend-MFLIMIT)) oexit = oend-MFLIMIT;                         /* targetOutputSize too high => decode everything */
@@ -103,13 +124,93 @@ FORCE_INLINE int LZ4_decompress_generic(
     if ((!endOnInput) && (unlikely(outputSize==0))) return (*ip==0?1:-1);
 
 
+    /* Fast loop : while far from both ends, copy in whole 16/32-byte steps.
+     * A sequence that gets too close is decoded again, or finished, by the
+     * main loop. */
+    if ((endOnInput) && (!partialDecoding) && (dict==noDict))
+    {
+        while ((oend-op >= FASTLOOP_SAFE_DISTANCE) && (iend-ip >= 32))
+        {
+            const BYTE* const seq = ip;
+            size_t offset;
+
+            /* get literal length */
+            token = *ip++;
+            if ((length=(token>>ML_BITS)) == RUN_MASK)
+            {
+                unsigned s;
+                do
+                {
+                    s = *ip++;
+                    length += s;
+                }
+                while (likely(ip<iend-RUN_MASK) && (s==255));
+                /* this also rules out the last sequence, whose literals end at iend */
+                if ((length > (size_t)(oend-op-32)) || (iend-ip < 32) || (length > (size_t)(iend-ip-32)))
+                {
+                    ip = seq;
+                    break;
+                }
+                cpy = op+length;
+                LZ4_wildCopy32(op, ip, cpy);
+            }
+            else
+            {
+                /* at most 14 literals, and at least 31 input bytes left */
+                cpy = op+length;
+                LZ4_copy16(op, ip);
+            }
+            ip += length; op = cpy;
+
+            /* get offset */
+            offset = LZ4_readLE16(ip); ip+=2;
+            match = op - offset;
+            if (unlikely(match < lowLimit)) goto _output_error;   /* Error : offset outside destination buffer */
+
+            /* get matchlength */
+            length = token & ML_MASK;
+            if (length == ML_MASK)
+            {
+                unsigned s;
+                do
+                {
+                    if (ip > iend-LASTLITERALS) goto _output_error;
+                    s = *ip++;
+                    length += s;
+                } while (s==255);
+                if (unlikely((size_t)(op+length)<(size_t)op)) goto _output_error;   /* overflow detection */
+            }
+            length += MINMATCH;
+
+            /* near the end, the main loop copies the match carefully */
+            if ((oend-op < FASTLOOP_SAFE_DISTANCE) || (length > (size_t)(oend-op-FASTLOOP_SAFE_DISTANCE)))
+                goto _copy_match;
+
+            /* copy repeated sequence */
+            cpy = op + length;
+            if (offset >= 16)
+                LZ4_wildCopy32(op, match, cpy);
+            else if (offset >= 8)
+                LZ4_wildCopy(op, match, cpy);
+            else
+            {
+                const size_t dec64 = dec64table[offset];
+                op[0] = match[0];
+                op[1] = match[1];
+                op[2] = match[2];
+                op[3] = match[3];
+                match += dec32table[offset];
+                LZ4_copy4(op+4, match);
+                op += 8; match -= dec64;
+                LZ4_wildCopy(op, match, cpy);
+            }
+            op = cpy;
+        }
+    }
+
     /* Main Loop */
     while (1)
     {
-        unsigned token;
-        size_t length;
-        const BYTE* match;
-
         /* get literal length */
         token = *ip++;
         if ((length=(token>>ML_BITS)) == RUN_MASK)
@@ -201,6 +302,7 @@ FORCE_INLINE int LZ4_decompress_generic(
         }
 
         /* copy repeated sequence */
+_copy_match:
         cpy = op + length;
         if (unlikely((op-match)<8))
         {
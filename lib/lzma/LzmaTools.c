@@ -32,9 +32,11 @@
 
 #include <linux/string.h>
 #include <malloc.h>
+#include <asm/unaligned.h>
 
 static void *SzAlloc(void *p, size_t size) { return malloc(size); }
 static void SzFree(void *p, void *address) { free(address); }
+static ISzAlloc lzma_alloc = { SzAlloc, SzFree };
 
 int lzmaBuffToBuffDecompress (unsigned char *outStream, SizeT *uncompressedSize,
                   unsigned char *inStream,  SizeT  length)
@@ -120,4 +122,89 @@ int lzmaBuffToBuffDecompress (unsigned char *outStream, SizeT *uncompressedSize,
     return res;
 }
 
+void lzma_stream_init(struct lzma_stream *ls, void *dst, SizeT dst_len)
+{
+    memset(ls, 0, sizeof(*ls));
+    LzmaDec_Construct(&ls->dec);
+    /* Decode straight into the destination, which is also the dictionary */
+    ls->dec.dic = dst;
+    ls->dec.dicBufSize = dst_len;
+}
+
+/* Set up the decoder once the whole header has arrived */
+static int lzma_stream_start(struct lzma_stream *ls)
+{
+    SRes res;
+
+    res = LzmaDec_AllocateProbs(&ls->dec, ls->header, LZMA_PROPS_SIZE,
+                                &lzma_alloc);
+    if (res != SZ_OK)
+        return res == SZ_ERROR_MEM ? -ENOMEM : -EINVAL;
+    LzmaDec_Init(&ls->dec);
+    ls->size = get_unaligned_le64(ls->header + LZMA_SIZE_OFFSET);
+    ls->limit = ls->dec.dicBufSize;
+    if (ls->size < ls->limit)
+        ls->limit = ls->size;
+
+    return 0;
+}
+
+int lzma_stream_feed(struct lzma_stream *ls, const void *src, SizeT len)
+{
+    const unsigned char *p = src;
+    ELzmaStatus status;
+    SizeT in_len;
+    bool full;
+    SRes res;
+    int ret;
+
+    if (ls->header_len < LZMA_HEADER_SIZE) {
+        in_len = min(len, (SizeT)(LZMA_HEADER_SIZE - ls->header_len));
+        memcpy(ls->header + ls->header_len, p, in_len);
+        ls->header_len += in_len;
+        p += in_len;
+        len -= in_len;
+        if (ls->header_len < LZMA_HEADER_SIZE)
+            return 0;
+        ret = lzma_stream_start(ls);
+        if (ret)
+            return ret;
+    }
+
+    while (len && !ls->done) {
+        /*
+         * Once the buffer is full, the only thing that may follow is the
+         * end mark
+         */
+        full = ls->dec.dicPos == ls->limit;
+        in_len = len;
+        res = LzmaDec_DecodeToDic(&ls->dec, ls->limit, p, &in_len,
+                                  full ? LZMA_FINISH_END : LZMA_FINISH_ANY,
+                                  &status);
+        p += in_len;
+        len -= in_len;
+        if (res != SZ_OK)
+            return full ? -ENOSPC : -EINVAL;
+        if (status == LZMA_STATUS_FINISHED_WITH_MARK ||
+            ls->dec.dicPos == ls->size)
+            ls->done = true;
+        else if (full && !in_len)
+            return -ENOSPC;
+    }
+
+    return 0;
+}
+
+int lzma_stream_finish(struct lzma_stream *ls, SizeT *dst_len)
+{
+    *dst_len = ls->dec.dicPos;
+    LzmaDec_FreeProbs(&ls->dec, &lzma_alloc);
+    if (!ls->done) {
+        debug("%s: LZMA data ends before the end of the stream\n", __func__);
+        return -EINVAL;
+    }
+
+    return 0;
+}
+
 #endif
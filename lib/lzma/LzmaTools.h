@@ -12,7 +12,67 @@
 #define __LZMA_TOOL_H__
 
 #include <lzma/LzmaTypes.h>
+#include <lzma/LzmaDec.h>
+
+/* Properties, then the uncompressed size (~0 if not known), then the data */
+#define LZMA_HEADER_SIZE	(LZMA_PROPS_SIZE + 8)
 
 extern int lzmaBuffToBuffDecompress (unsigned char *outStream, SizeT *uncompressedSize,
 			      unsigned char *inStream,  SizeT  length);
+
+/**
+ * struct lzma_stream - LZMA data being decompressed a piece at a time
+ *
+ * The output is written to one contiguous buffer, which also serves as the
+ * dictionary, so the only memory allocated is for the probability tables.
+ *
+ * @dec: Decoder state
+ * @header: Holds the header until it is complete
+ * @header_len: Number of bytes in @header
+ * @size: Uncompressed size from the header, ~0 if not known
+ * @limit: Most bytes to decode, the smaller of @size and the buffer size
+ * @done: true once the end of the data is reached
+ */
+struct lzma_stream {
+	CLzmaDec dec;
+	unsigned char header[LZMA_HEADER_SIZE];
+	unsigned int header_len;
+	u64 size;
+	SizeT limit;
+	bool done;
+};
+
+/**
+ * lzma_stream_init() - Start decompressing LZMA data a piece at a time
+ *
+ * @ls: Stream to set up
+ * @dst: Destination for uncompressed data
+ * @dst_len: Size of @dst
+ */
+void lzma_stream_init(struct lzma_stream *ls, void *dst, SizeT dst_len);
+
+/**
+ * lzma_stream_feed() - Decompress the next piece of an LZMA stream
+ *
+ * Any data after the end of the stream is ignored.
+ *
+ * @ls: Stream to decompress into
+ * @src: Next piece of the input
+ * @len: Length of @src, which may be of any size
+ * @return 0 if OK, -ENOSPC if the destination is too small, -ENOMEM if out
+ *	of memory, -EINVAL if the data is corrupt
+ */
+int lzma_stream_feed(struct lzma_stream *ls, const void *src, SizeT len);
+
+/**
+ * lzma_stream_finish() - Finish decompressing an LZMA stream
+ *
+ * This must be called once for each lzma_stream_init(), also after an error,
+ * to free the stream's memory.
+ *
+ * @ls: Stream to finish
+ * @dst_len: Returns the length of the uncompressed data
+ * @return 0 if OK, -EINVAL if the input stopped before the end of the stream
+ */
+int lzma_stream_finish(struct lzma_stream *ls, SizeT *dst_len);
 #endif
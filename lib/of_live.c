@@ -12,6 +12,8 @@
 #include <linux/libfdt.h>
 #include <of_live.h>
 #include <malloc.h>
+#include <mapmem.h>
+#include <u-boot/crc.h>
 #include <dm/of_access.h>
 #include <linux/err.h>
 
@@ -255,11 +257,14 @@ static void *unflatten_dt_node(const void *blob, void *mem, int *poffset,
  * pointers of the nodes so the normal device-tree walking functions
  * can be used.
  * @blob: The blob to expand
- * @mynodes: The device_node tree created by the call
+ * @mynodes: The device_node tree created by the call. Everything but the
+ *	property values is held in one allocation, starting with this node
+ * @sizep: If not NULL, returns the size of that allocation
  * @return 0 if OK, -ve on error
  */
 static int unflatten_device_tree(const void *blob,
-				 struct device_node **mynodes)
+				 struct device_node **mynodes,
+				 unsigned long *sizep)
 {
 	unsigned long size;
 	int start;
@@ -294,6 +299,8 @@ static int unflatten_device_tree(const void *blob,
 
 	/* Allocate memory for the expanded device tree */
 	mem = malloc(size + 4);
+	if (!mem)
+		return -ENOMEM;
 	memset(mem, '\0', size);
 
 	*(__be32 *)(mem + size) = cpu_to_be32(0xdeadbeef);
@@ -308,18 +315,301 @@ static int unflatten_device_tree(const void *blob,
 		      be32_to_cpup(mem + size));
 		return -ENOSPC;
 	}
+	if (sizep)
+		*sizep = size;
 
 	debug(" <- unflatten_device_tree()\n");
 
 	return 0;
 }
 
+#if CONFIG_IS_ENABLED(OF_LIVE_IMAGE)
+/* Strings which unflatten_dt_node() points to rather than copying */
+static const char *const of_live_strs[] = { "name", "<NULL>" };
+
+/**
+ * struct of_live_map - converting the pointers in a tree to or from offsets
+ *
+ * @tree: Start of the tree
+ * @size: Size of the tree
+ * @fdt: Flat tree holding the property names and values
+ * @fdt_size: Size of @fdt
+ * @encode: true to convert pointers to offsets, false for the reverse
+ * @last: Last node or property converted
+ * @depth: Depth of the node being converted
+ * @err: Set to -EINVAL if a pointer cannot be converted
+ */
+struct of_live_map {
+	void *tree;
+	ulong size;
+	const void *fdt;
+	ulong fdt_size;
+	bool encode;
+	void *last;
+	int depth;
+	int err;
+};
+
+/*
+ * Get a pointer to @len bytes at offset @off in @base, or to a nul-terminated
+ * string if @len is 0. Returns NULL if that does not fit in @size bytes.
+ */
+static void *of_live_map_check(const void *base, ulong size, ulong off,
+			       ulong len)
+{
+	if (off >= size || len > size - off)
+		return NULL;
+	if (!len && !memchr(base + off, '\0', size - off))
+		return NULL;
+
+	return (void *)base + off;
+}
+
+/*
+ * Convert the pointer in @fieldp and return what it points to. An image is
+ * not trusted, so when decoding, @len bytes must fit at the target, or a
+ * string if @len is 0.
+ */
+static void *of_live_map_ptr(struct of_live_map *map, void *fieldp, ulong len)
+{
+	ulong *field = fieldp;
+	ulong val, off;
+	void *ptr;
+	int i;
+
+	if (map->encode) {
+		ptr = (void *)*field;
+		if (!ptr) {
+			val = OF_LIVE_PTR_NULL;
+		} else if (ptr >= map->tree && ptr < map->tree + map->size) {
+			val = (ptr - map->tree) << OF_LIVE_PTR_SHIFT |
+				OF_LIVE_PTR_TREE;
+		} else if (ptr >= map->fdt && ptr < map->fdt + map->fdt_size) {
+			val = (ptr - map->fdt) << OF_LIVE_PTR_SHIFT |
+				OF_LIVE_PTR_FDT;
+		} else {
+			for (i = 0; i < ARRAY_SIZE(of_live_strs); i++) {
+				if (!strcmp(ptr, of_live_strs[i]))
+					break;
+			}
+			if (i == ARRAY_SIZE(of_live_strs))
+				map->err = -EINVAL;
+			val = i << OF_LIVE_PTR_SHIFT | OF_LIVE_PTR_STR;
+		}
+		*field = val;
+
+		return ptr;
+	}
+
+	val = *field;
+	off = val >> OF_LIVE_PTR_SHIFT;
+	switch (val & OF_LIVE_PTR_MASK) {
+	case OF_LIVE_PTR_TREE:
+		ptr = of_live_map_check(map->tree, map->size, off, len);
+		break;
+	case OF_LIVE_PTR_FDT:
+		ptr = of_live_map_check(map->fdt, map->fdt_size, off, len);
+		break;
+	case OF_LIVE_PTR_STR:
+		ptr = off < ARRAY_SIZE(of_live_strs) ?
+			(void *)of_live_strs[off] : NULL;
+		break;
+	default:
+		ptr = NULL;
+		break;
+	}
+	if (!ptr && val)
+		map->err = -EINVAL;
+	*field = (ulong)ptr;
+
+	return ptr;
+}
+
+/*
+ * Check a node or property before converting its pointers.
+ * unflatten_device_tree() lays out each node before its properties, those
+ * before its subnodes and the subnodes before the node's next sibling, which
+ * is the order in which they are visited here. Insisting on that order means
+ * that each one is visited once, so a bad image cannot make a loop.
+ */
+static bool of_live_map_next(struct of_live_map *map, void *ptr, ulong size,
+			     ulong align)
+{
+	if (!ptr || map->err)
+		return false;
+	if ((ulong)ptr & (align - 1) || ptr <= map->last ||
+	    ptr < map->tree || ptr + size > map->tree + map->size) {
+		map->err = -EINVAL;
+		return false;
+	}
+	map->last = ptr;
+
+	return true;
+}
+
+/* Convert the pointers in @np, its properties, subnodes and later siblings */
+static void of_live_map_node(struct of_live_map *map, struct device_node *np)
+{
+	struct device_node *parent;
+	struct property *pp;
+
+	if (!np)
+		return;
+	if (++map->depth > FDT_MAX_DEPTH)
+		map->err = -EINVAL;
+	for (; of_live_map_next(map, np, sizeof(*np), __alignof__(*np));
+	     np = of_live_map_ptr(map, &np->sibling, sizeof(*np))) {
+		of_live_map_ptr(map, &np->name, 0);
+		of_live_map_ptr(map, &np->type, 0);
+		of_live_map_ptr(map, &np->full_name, 0);
+
+		/* going up through the parents must end at the root */
+		parent = of_live_map_ptr(map, &np->parent, sizeof(*np));
+		if (parent ? (void *)parent < map->tree || parent >= np ||
+			     (ulong)parent & (__alignof__(*np) - 1) :
+			     (void *)np != map->tree)
+			map->err = -EINVAL;
+
+		for (pp = of_live_map_ptr(map, &np->properties, sizeof(*pp));
+		     of_live_map_next(map, pp, sizeof(*pp), __alignof__(*pp));
+		     pp = of_live_map_ptr(map, &pp->next, sizeof(*pp))) {
+			of_live_map_ptr(map, &pp->name, 0);
+			/* even an empty value points inside the tree or FDT */
+			if (pp->length < 0)
+				map->err = -EINVAL;
+			else
+				of_live_map_ptr(map, &pp->value,
+						max(pp->length, 1));
+		}
+		of_live_map_node(map, of_live_map_ptr(map, &np->child,
+						      sizeof(*np)));
+	}
+	map->depth--;
+}
+
+int of_live_image_make(const void *fdt_blob, void *buf, ulong *sizep)
+{
+	struct of_live_image *hdr = buf;
+	struct device_node *root;
+	struct of_live_map map;
+	ulong size;
+	int ret;
+
+	ret = unflatten_device_tree(fdt_blob, &root, &size);
+	if (ret)
+		return ret;
+	if (*sizep < sizeof(*hdr) + size) {
+		*sizep = sizeof(*hdr) + size;
+		free(root);
+		return -ENOSPC;
+	}
+
+	memset(&map, '\0', sizeof(map));
+	map.tree = root;
+	map.size = size;
+	map.fdt = fdt_blob;
+	map.fdt_size = fdt_totalsize(fdt_blob);
+	map.encode = true;
+	of_live_map_node(&map, root);
+	if (map.err) {
+		free(root);
+		return map.err;
+	}
+
+	memset(hdr, '\0', sizeof(*hdr));
+	hdr->magic = OF_LIVE_IMAGE_MAGIC;
+	hdr->version = OF_LIVE_IMAGE_VERSION;
+	hdr->ptr_size = sizeof(void *);
+	hdr->node_size = sizeof(struct device_node);
+	hdr->prop_size = sizeof(struct property);
+	hdr->size = size;
+	hdr->crc = crc32(0, (void *)root, size);
+	hdr->fdt_size = map.fdt_size;
+	hdr->fdt_crc = crc32(0, fdt_blob, map.fdt_size);
+	memcpy(hdr + 1, root, size);
+	free(root);
+	*sizep = sizeof(*hdr) + size;
+
+	return 0;
+}
+
+int of_live_image_load(const void *fdt_blob, const void *image,
+		       struct device_node **rootp)
+{
+	const struct of_live_image *hdr = image;
+	struct of_live_map map;
+	void *tree;
+
+	if (hdr->magic != OF_LIVE_IMAGE_MAGIC ||
+	    hdr->version != OF_LIVE_IMAGE_VERSION ||
+	    hdr->ptr_size != sizeof(void *) ||
+	    hdr->node_size != sizeof(struct device_node) ||
+	    hdr->prop_size != sizeof(struct property) ||
+	    hdr->size < sizeof(struct device_node))
+		return -EPROTONOSUPPORT;
+	if (hdr->fdt_size != fdt_totalsize(fdt_blob) ||
+	    hdr->fdt_crc != crc32(0, fdt_blob, hdr->fdt_size))
+		return -ESTALE;
+	if (hdr->crc != crc32(0, (void *)(hdr + 1), hdr->size))
+		return -EINVAL;
+
+	tree = malloc(hdr->size);
+	if (!tree)
+		return -ENOMEM;
+	memcpy(tree, hdr + 1, hdr->size);
+
+	memset(&map, '\0', sizeof(map));
+	map.tree = tree;
+	map.size = hdr->size;
+	map.fdt = fdt_blob;
+	map.fdt_size = hdr->fdt_size;
+	of_live_map_node(&map, tree);
+	if (map.err) {
+		free(tree);
+		return map.err;
+	}
+	*rootp = tree;
+
+	return 0;
+}
+
+__weak const void *board_of_live_image(void)
+{
+	if (!CONFIG_OF_LIVE_IMAGE_ADDR)
+		return NULL;
+
+	return map_sysmem(CONFIG_OF_LIVE_IMAGE_ADDR, 0);
+}
+
+/* Use the board's live-tree image, if it has one for this tree */
+static int of_live_use_image(const void *fdt_blob, struct device_node **rootp)
+{
+	const void *image = board_of_live_image();
+	int ret;
+
+	if (!image)
+		return -ENOENT;
+	ret = of_live_image_load(fdt_blob, image, rootp);
+	if (ret)
+		printf("Live-tree image not used (err=%d)\n", ret);
+
+	return ret;
+}
+#else
+static int of_live_use_image(const void *fdt_blob, struct device_node **rootp)
+{
+	return -ENOENT;
+}
+#endif
+
 int of_live_build(const void *fdt_blob, struct device_node **rootp)
 {
 	int ret;
 
 	debug("%s: start\n", __func__);
-	ret = unflatten_device_tree(fdt_blob, rootp);
+	ret = of_live_use_image(fdt_blob, rootp);
+	if (ret)
+		ret = unflatten_device_tree(fdt_blob, rootp, NULL);
 	if (ret) {
 		debug("Failed to create live tree: err=%d\n", ret);
 		return ret;
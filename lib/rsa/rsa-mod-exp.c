@@ -19,29 +19,65 @@
 #include <u-boot/rsa.h>
 #include <u-boot/rsa-mod-exp.h>
 
-#define UINT64_MULT32(v, multby)  (((uint64_t)(v)) * ((uint32_t)(multby)))
-
-#define get_unaligned_be32(a) fdt32_to_cpu(*(uint32_t *)a)
-#define put_unaligned_be32(a, b) (*(uint32_t *)(b) = cpu_to_fdt32(a))
-
 /* Default public exponent for backward compatibility */
 #define RSA_DEFAULT_PUBEXP	65537
 
+/*
+ * Numbers are held as little endian arrays of limbs. Where the compiler has
+ * a 128-bit type, 64-bit limbs halve the number of passes through the
+ * Montgomery inner loop and quarter the number of multiplications.
+ */
+#ifdef __SIZEOF_INT128__
+typedef uint64_t rsa_limb_t;
+typedef unsigned __int128 rsa_dlimb_t;
+#else
+typedef uint32_t rsa_limb_t;
+typedef uint64_t rsa_dlimb_t;
+#endif
+
+#define RSA_LIMB_BITS		((uint)sizeof(rsa_limb_t) * 8)
+
+/*
+ * Exponents of at least this many bits are processed in windows of
+ * RSA_WINDOW_BITS bits, using a table of odd powers of the base. Shorter
+ * exponents such as 65537 have so few bits set that this does not pay off.
+ */
+#define RSA_WINDOW_MIN_BITS	24
+#define RSA_WINDOW_BITS		3
+#define RSA_WINDOW_SIZE		(1 << (RSA_WINDOW_BITS - 1))
+
+/**
+ * struct rsa_mont_key - RSA modulus prepared for Montgomery arithmetic
+ *
+ * @len:	Number of limbs in @modulus and @rr
+ * @n0inv:	-1 / modulus[0] mod 2^RSA_LIMB_BITS
+ * @modulus:	Modulus, as little endian limb array
+ * @rr:		R^2 mod modulus where R = 2^(len * RSA_LIMB_BITS), as
+ *		little endian limb array
+ */
+struct rsa_mont_key {
+	uint len;
+	rsa_limb_t n0inv;
+	const rsa_limb_t *modulus;
+	const rsa_limb_t *rr;
+};
+
 /**
  * subtract_modulus() - subtract modulus from the given value
  *
  * @key:	Key containing modulus to subtract
- * @num:	Number to subtract modulus from, as little endian word array
+ * @num:	Number to subtract modulus from, as little endian limb array
  */
-static void subtract_modulus(const struct rsa_public_key *key, uint32_t num[])
+static void subtract_modulus(const struct rsa_mont_key *key, rsa_limb_t num[])
 {
-	int64_t acc = 0;
+	rsa_limb_t borrow = 0, n, m;
 	uint i;
 
 	for (i = 0; i < key->len; i++) {
-		acc += (uint64_t)num[i] - key->modulus[i];
-		num[i] = (uint32_t)acc;
-		acc >>= 32;
+		n = num[i];
+		m = key->modulus[i];
+		num[i] = n - m - borrow;
+		borrow = n < m || (n == m && borrow);
 	}
 }
 
@@ -49,11 +85,11 @@ static void subtract_modulus(const struct rsa_public_key *key, uint32_t num[])
  * greater_equal_modulus() - check if a value is >= modulus
  *
  * @key:	Key containing modulus to check
- * @num:	Number to check against modulus, as little endian word array
+ * @num:	Number to check against modulus, as little endian limb array
  * @return 0 if num < modulus, 1 if num >= modulus
  */
-static int greater_equal_modulus(const struct rsa_public_key *key,
-				 uint32_t num[])
+static int greater_equal_modulus(const struct rsa_mont_key *key,
+				 const rsa_limb_t num[])
 {
 	int i;
 
@@ -66,39 +102,40 @@ static int greater_equal_modulus(const struct rsa_public_key *key,
 
 	return 1;  /* equal */
 }
-
 /**
  * montgomery_mul_add_step() - Perform montgomery multiply-add step
  *
  * Operation: montgomery result[] += a * b[] / n0inv % modulus
  *
  * @key:	RSA key
- * @result:	Place to put result, as little endian word array
+ * @result:	Place to put result, as little endian limb array
  * @a:		Multiplier
- * @b:		Multiplicand, as little endian word array
+ * @b:		Multiplicand, as little endian limb array
  */
-static void montgomery_mul_add_step(const struct rsa_public_key *key,
-		uint32_t result[], const uint32_t a, const uint32_t b[])
+static void montgomery_mul_add_step(const struct rsa_mont_key *key,
+		rsa_limb_t result[], const rsa_limb_t a, const rsa_limb_t b[])
 {
-	uint64_t acc_a, acc_b;
-	uint32_t d0;
+	rsa_dlimb_t acc_a, acc_b;
+	rsa_limb_t d0;
 	uint i;
 
-	acc_a = (uint64_t)a * b[0] + result[0];
-	d0 = (uint32_t)acc_a * key->n0inv;
-	acc_b = (uint64_t)d0 * key->modulus[0] + (uint32_t)acc_a;
+	acc_a = (rsa_dlimb_t)a * b[0] + result[0];
+	d0 = (rsa_limb_t)acc_a * key->n0inv;
+	acc_b = (rsa_dlimb_t)d0 * key->modulus[0] + (rsa_limb_t)acc_a;
 	for (i = 1; i < key->len; i++) {
-		acc_a = (acc_a >> 32) + (uint64_t)a * b[i] + result[i];
-		acc_b = (acc_b >> 32) + (uint64_t)d0 * key->modulus[i] +
-				(uint32_t)acc_a;
-		result[i - 1] = (uint32_t)acc_b;
+		acc_a = (acc_a >> RSA_LIMB_BITS) + (rsa_dlimb_t)a * b[i] +
+				result[i];
+		acc_b = (acc_b >> RSA_LIMB_BITS) +
+				(rsa_dlimb_t)d0 * key->modulus[i] +
+				(rsa_limb_t)acc_a;
+		result[i - 1] = (rsa_limb_t)acc_b;
 	}
 
-	acc_a = (acc_a >> 32) + (acc_b >> 32);
+	acc_a = (acc_a >> RSA_LIMB_BITS) + (acc_b >> RSA_LIMB_BITS);
 
-	result[i - 1] = (uint32_t)acc_a;
+	result[i - 1] = (rsa_limb_t)acc_a;
 
-	if (acc_a >> 32)
+	if (acc_a >> RSA_LIMB_BITS)
 		subtract_modulus(key, result);
 }
 
@@ -108,12 +145,13 @@ static void montgomery_mul_add_step(const struct rsa_public_key *key,
  * Operation: montgomery result[] = a[] * b[] / n0inv % modulus
  *
  * @key:	RSA key
- * @result:	Place to put result, as little endian word array
- * @a:		Multiplier, as little endian word array
- * @b:		Multiplicand, as little endian word array
+ * @result:	Place to put result, as little endian limb array. This must
+ *		not overlap @a or @b
+ * @a:		Multiplier, as little endian limb array
+ * @b:		Multiplicand, as little endian limb array
  */
-static void montgomery_mul(const struct rsa_public_key *key,
-		uint32_t result[], uint32_t a[], const uint32_t b[])
+static void montgomery_mul(const struct rsa_mont_key *key,
+		rsa_limb_t result[], const rsa_limb_t a[], const rsa_limb_t b[])
 {
 	uint i;
 
@@ -124,179 +162,337 @@ static void montgomery_mul(const struct rsa_public_key *key,
 }
 
 /**
- * num_pub_exponent_bits() - Number of bits in the public exponent
+ * montgomery_sqr() - Square a number in place, in montgomery form
  *
  * @key:	RSA key
- * @num_bits:	Storage for the number of public exponent bits
+ * @num:	Number to square, as little endian limb array
+ * @tmp:	Scratch space of the same size
  */
-static int num_public_exponent_bits(const struct rsa_public_key *key,
-		int *num_bits)
+static void montgomery_sqr(const struct rsa_mont_key *key, rsa_limb_t num[],
+			   rsa_limb_t tmp[])
 {
-	uint64_t exponent;
-	int exponent_bits;
-	const uint max_bits = (sizeof(exponent) * 8);
-
-	exponent = key->exponent;
-	exponent_bits = 0;
+	montgomery_mul(key, tmp, num, num);
+	memcpy(num, tmp, key->len * sizeof(num[0]));
+}
 
-	if (!exponent) {
-		*num_bits = exponent_bits;
-		return 0;
-	}
+/**
+ * num_pub_exponent_bits() - Number of bits in the public exponent
+ *
+ * @exponent:	Public exponent
+ * @return number of bits, 0 if the exponent is 0
+ */
+static int num_public_exponent_bits(uint64_t exponent)
+{
+	int exponent_bits;
 
-	for (exponent_bits = 1; exponent_bits < max_bits + 1; ++exponent_bits)
-		if (!(exponent >>= 1)) {
-			*num_bits = exponent_bits;
-			return 0;
-		}
+	for (exponent_bits = 0; exponent; exponent >>= 1)
+		exponent_bits++;
 
-	return -EINVAL;
+	return exponent_bits;
 }
 
 /**
  * is_public_exponent_bit_set() - Check if a bit in the public exponent is set
  *
- * @key:	RSA key
+ * @exponent:	Public exponent
  * @pos:	The bit position to check
  */
-static int is_public_exponent_bit_set(const struct rsa_public_key *key,
-		int pos)
+static int is_public_exponent_bit_set(uint64_t exponent, int pos)
 {
-	return key->exponent & (1ULL << pos);
+	return (exponent >> pos) & 1;
 }
 
 /**
  * pow_mod() - in-place public exponentiation
  *
  * @key:	RSA key
- * @inout:	Big-endian word array containing value and result
+ * @exponent:	Public exponent
+ * @inout:	Little endian limb array containing value and result
+ * @return 0 if OK, -EINVAL if the exponent is not usable
  */
-static int pow_mod(const struct rsa_public_key *key, uint32_t *inout)
+static int pow_mod(const struct rsa_mont_key *key, uint64_t exponent,
+		   rsa_limb_t inout[])
 {
-	uint32_t *result, *ptr;
-	uint i;
-	int j, k;
-
-	/* Sanity check for stack size - key->len is in 32-bit words */
-	if (key->len > RSA_MAX_KEY_BITS / 32) {
-		debug("RSA key words %u exceeds maximum %d\n", key->len,
-		      RSA_MAX_KEY_BITS / 32);
-		return -EINVAL;
-	}
-
-	uint32_t val[key->len], acc[key->len], tmp[key->len];
-	uint32_t a_scaled[key->len];
-	result = tmp;  /* Re-use location. */
-
-	/* Convert from big endian byte array to little endian word array. */
-	for (i = 0, ptr = inout + key->len - 1; i < key->len; i++, ptr--)
-		val[i] = get_unaligned_be32(ptr);
-
-	if (0 != num_public_exponent_bits(key, &k))
-		return -EINVAL;
+	const uint len = key->len;
+	int i, j, k, win, windowed;
 
+	k = num_public_exponent_bits(exponent);
 	if (k < 2) {
 		debug("Public exponent is too short (%d bits, minimum 2)\n",
 		      k);
 		return -EINVAL;
 	}
 
-	if (!is_public_exponent_bit_set(key, 0)) {
+	if (!is_public_exponent_bit_set(exponent, 0)) {
 		debug("LSB of RSA public exponent must be set.\n");
 		return -EINVAL;
 	}
 
-	/* the bit at e[k-1] is 1 by definition, so start with: C := M */
-	montgomery_mul(key, acc, val, key->rr); /* acc = a * RR / R mod n */
-	/* retain scaled version for intermediate use */
-	memcpy(a_scaled, acc, key->len * sizeof(a_scaled[0]));
-
-	for (j = k - 2; j > 0; --j) {
-		montgomery_mul(key, tmp, acc, acc); /* tmp = acc^2 / R mod n */
+	windowed = k >= RSA_WINDOW_MIN_BITS;
+	rsa_limb_t acc[len], tmp[len];
+	/* a_scaled[i] = a^(2i + 1) * R mod n */
+	rsa_limb_t a_scaled[windowed ? RSA_WINDOW_SIZE : 1][len];
+
+	montgomery_mul(key, a_scaled[0], inout, key->rr);
+
+	if (!windowed) {
+		/* the bit at e[k-1] is 1 by definition, so start with C := M */
+		memcpy(acc, a_scaled[0], len * sizeof(acc[0]));
+		for (j = k - 2; j > 0; --j) {
+			montgomery_sqr(key, acc, tmp);
+			if (is_public_exponent_bit_set(exponent, j)) {
+				montgomery_mul(key, tmp, acc, a_scaled[0]);
+				memcpy(acc, tmp, len * sizeof(acc[0]));
+			}
+		}
 
-		if (is_public_exponent_bit_set(key, j)) {
-			/* acc = tmp * val / R mod n */
-			montgomery_mul(key, acc, tmp, a_scaled);
-		} else {
-			/* e[j] == 0, copy tmp back to acc for next operation */
-			memcpy(acc, tmp, key->len * sizeof(acc[0]));
+		/*
+		 * the bit at e[0] is always 1; multiplying by the unscaled
+		 * value also takes the result out of montgomery form
+		 */
+		montgomery_mul(key, tmp, acc, acc);
+		montgomery_mul(key, acc, tmp, inout);
+	} else {
+		montgomery_mul(key, tmp, a_scaled[0], a_scaled[0]);
+		for (i = 1; i < RSA_WINDOW_SIZE; i++)
+			montgomery_mul(key, a_scaled[i], a_scaled[i - 1], tmp);
+
+		/*
+		 * Left to right, in windows of up to RSA_WINDOW_BITS bits
+		 * which start and end with a set bit. The top bit is set, so
+		 * the first window always starts at e[k-1].
+		 */
+		for (i = k - 1; i >= 0;) {
+			if (!is_public_exponent_bit_set(exponent, i)) {
+				montgomery_sqr(key, acc, tmp);
+				i--;
+				continue;
+			}
+			j = i - RSA_WINDOW_BITS + 1;
+			if (j < 0)
+				j = 0;
+			while (!is_public_exponent_bit_set(exponent, j))
+				j++;
+			win = (exponent >> j) & ((1 << (i - j + 1)) - 1);
+			if (i == k - 1) {
+				memcpy(acc, a_scaled[win >> 1],
+				       len * sizeof(acc[0]));
+			} else {
+				for (; i >= j; i--)
+					montgomery_sqr(key, acc, tmp);
+				montgomery_mul(key, tmp, acc,
+					       a_scaled[win >> 1]);
+				memcpy(acc, tmp, len * sizeof(acc[0]));
+			}
+			i = j - 1;
 		}
-	}
 
-	/* the bit at e[0] is always 1 */
-	montgomery_mul(key, tmp, acc, acc); /* tmp = acc^2 / R mod n */
-	montgomery_mul(key, acc, tmp, val); /* acc = tmp * a / R mod M */
-	memcpy(result, acc, key->len * sizeof(result[0]));
+		/* multiply by 1 to take the result out of montgomery form */
+		memset(tmp, '\0', len * sizeof(tmp[0]));
+		tmp[0] = 1;
+		montgomery_mul(key, inout, acc, tmp);
+		memcpy(acc, inout, len * sizeof(acc[0]));
+	}
 
 	/* Make sure result < mod; result is at most 1x mod too large. */
-	if (greater_equal_modulus(key, result))
-		subtract_modulus(key, result);
+	if (greater_equal_modulus(key, acc))
+		subtract_modulus(key, acc);
+	memcpy(inout, acc, len * sizeof(inout[0]));
 
-	/* Convert to bigendian byte array */
-	for (i = key->len - 1, ptr = inout; (int)i >= 0; i--, ptr++)
-		put_unaligned_be32(result[i], ptr);
 	return 0;
 }
 
-static void rsa_convert_big_endian(uint32_t *dst, const uint32_t *src, int len)
+/**
+ * rsa_n0inv() - Work out -1 / m0 mod 2^RSA_LIMB_BITS
+ *
+ * The inverse is correct to 3 bits to start with, since m0 is odd, and
+ * each Newton step doubles the number of correct bits.
+ *
+ * @m0:		Lowest limb of the modulus, which must be odd
+ */
+static rsa_limb_t rsa_n0inv(rsa_limb_t m0)
+{
+	rsa_limb_t inv = m0;
+	uint bits;
+
+	for (bits = 3; bits < RSA_LIMB_BITS; bits *= 2)
+		inv *= 2 - m0 * inv;
+
+	return -inv;
+}
+
+/**
+ * rsa_convert_big_endian() - Convert a big endian byte array to limbs
+ *
+ * @dst:	Returns the number, as little endian limb array
+ * @src:	Number as big endian byte array
+ * @size:	Number of bytes in @src
+ * @len:	Number of limbs in @dst, enough to hold @size bytes
+ */
+static void rsa_convert_big_endian(rsa_limb_t dst[], const uint8_t *src,
+				   uint size, uint len)
 {
-	int i;
+	uint i;
+
+	memset(dst, '\0', len * sizeof(dst[0]));
+	for (i = 0; i < size; i++)
+		dst[i / sizeof(dst[0])] |= (rsa_limb_t)src[size - 1 - i] <<
+					   (8 * (i % sizeof(dst[0])));
+}
+
+/**
+ * rsa_convert_to_big_endian() - Convert limbs to a big endian byte array
+ *
+ * @dst:	Returns the number, as big endian byte array
+ * @src:	Number as little endian limb array
+ * @size:	Number of bytes to write to @dst
+ */
+static void rsa_convert_to_big_endian(uint8_t *dst, const rsa_limb_t src[],
+				      uint size)
+{
+	uint i;
+
+	for (i = 0; i < size; i++)
+		dst[size - 1 - i] = src[i / sizeof(src[0])] >>
+				    (8 * (i % sizeof(src[0])));
+}
+
+/**
+ * rsa_double_mod() - Double a number modulo the modulus, repeatedly
+ *
+ * @key:	RSA key, only the modulus is used
+ * @num:	Number to double, which must be less than the modulus, as
+ *		little endian limb array
+ * @count:	Number of times to double it
+ */
+static void rsa_double_mod(const struct rsa_mont_key *key, rsa_limb_t num[],
+			   uint count)
+{
+	rsa_limb_t carry;
+	uint i;
+
+	while (count--) {
+		carry = num[key->len - 1] >> (RSA_LIMB_BITS - 1);
+		for (i = key->len - 1; i > 0; i--)
+			num[i] = num[i] << 1 |
+				 num[i - 1] >> (RSA_LIMB_BITS - 1);
+		num[0] <<= 1;
+		if (carry || greater_equal_modulus(key, num))
+			subtract_modulus(key, num);
+	}
+}
+
+#ifndef CONFIG_SPL_BUILD
+/*
+ * R^2 for the last key which came without one. The same key usually
+ * checks several signatures in a row (the configuration and then each
+ * image), so this saves working it out again.
+ */
+static struct {
+	uint len;
+	rsa_limb_t modulus[RSA_MAX_KEY_BITS / RSA_LIMB_BITS];
+	rsa_limb_t rr[RSA_MAX_KEY_BITS / RSA_LIMB_BITS];
+} rsa_rr_cache;
+#endif
+
+/**
+ * rsa_get_rr() - Get R^2 mod modulus
+ *
+ * rsa,r-squared in the key node holds R^2 for R = 2^(32 * words). If the
+ * limbs are wider than that, it only needs doubling a few times. If the key
+ * node has no R^2 at all, it is worked out from scratch.
+ *
+ * @key:	RSA key, only the modulus is used
+ * @node_rr:	R^2 from the key node as big endian byte array, or NULL
+ * @words:	Key length in 32-bit words
+ * @rr:		Returns R^2, as little endian limb array
+ */
+static void rsa_get_rr(const struct rsa_mont_key *key, const void *node_rr,
+		       uint words, rsa_limb_t rr[])
+{
+	uint extra = key->len * RSA_LIMB_BITS - words * 32;
+
+	if (node_rr) {
+		rsa_convert_big_endian(rr, node_rr, words * 4, key->len);
+		rsa_double_mod(key, rr, 2 * extra);
+		return;
+	}
 
-	for (i = 0; i < len; i++)
-		dst[i] = fdt32_to_cpu(src[len - 1 - i]);
+#ifndef CONFIG_SPL_BUILD
+	if (rsa_rr_cache.len == key->len &&
+	    !memcmp(rsa_rr_cache.modulus, key->modulus,
+		    key->len * sizeof(rr[0]))) {
+		memcpy(rr, rsa_rr_cache.rr, key->len * sizeof(rr[0]));
+		return;
+	}
+#endif
+
+	memset(rr, '\0', key->len * sizeof(rr[0]));
+	rr[0] = 1;
+	rsa_double_mod(key, rr, 2 * key->len * RSA_LIMB_BITS);
+
+#ifndef CONFIG_SPL_BUILD
+	rsa_rr_cache.len = key->len;
+	memcpy(rsa_rr_cache.modulus, key->modulus, key->len * sizeof(rr[0]));
+	memcpy(rsa_rr_cache.rr, rr, key->len * sizeof(rr[0]));
+#endif
 }
 
 int rsa_mod_exp_sw(const uint8_t *sig, uint32_t sig_len,
 		struct key_prop *prop, uint8_t *out)
 {
-	struct rsa_public_key key;
+	struct rsa_mont_key key;
+	uint64_t exponent;
+	uint words;
 	int ret;
 
 	if (!prop) {
 		debug("%s: Skipping invalid prop", __func__);
 		return -EBADF;
 	}
-	key.n0inv = prop->n0inv;
-	key.len = prop->num_bits;
 
 	if (!prop->public_exponent)
-		key.exponent = RSA_DEFAULT_PUBEXP;
+		exponent = RSA_DEFAULT_PUBEXP;
 	else
-		key.exponent =
-			fdt64_to_cpu(*((uint64_t *)(prop->public_exponent)));
+		exponent = fdt64_to_cpu(*((uint64_t *)(prop->public_exponent)));
 
-	if (!key.len || !prop->modulus || !prop->rr) {
+	if (!prop->num_bits || !prop->modulus) {
 		debug("%s: Missing RSA key info", __func__);
 		return -EFAULT;
 	}
 
 	/* Sanity check for stack size */
-	if (key.len > RSA_MAX_KEY_BITS || key.len < RSA_MIN_KEY_BITS) {
+	if (prop->num_bits > RSA_MAX_KEY_BITS ||
+	    prop->num_bits < RSA_MIN_KEY_BITS) {
 		debug("RSA key bits %u outside allowed range %d..%d\n",
-		      key.len, RSA_MIN_KEY_BITS, RSA_MAX_KEY_BITS);
+		      prop->num_bits, RSA_MIN_KEY_BITS, RSA_MAX_KEY_BITS);
 		return -EFAULT;
 	}
-	key.len /= sizeof(uint32_t) * 8;
-	uint32_t key1[key.len], key2[key.len];
-
-	key.modulus = key1;
-	key.rr = key2;
-	rsa_convert_big_endian(key.modulus, (uint32_t *)prop->modulus, key.len);
-	rsa_convert_big_endian(key.rr, (uint32_t *)prop->rr, key.len);
-	if (!key.modulus || !key.rr) {
-		debug("%s: Out of memory", __func__);
-		return -ENOMEM;
+	words = prop->num_bits / 32;
+	if (sig_len != words * 4) {
+		debug("%s: Signature is of incorrect length %u\n", __func__,
+		      sig_len);
+		return -EINVAL;
 	}
+	key.len = (words * 32 + RSA_LIMB_BITS - 1) / RSA_LIMB_BITS;
 
-	uint32_t buf[sig_len / sizeof(uint32_t)];
+	rsa_limb_t modulus[key.len], rr[key.len], buf[key.len];
 
-	memcpy(buf, sig, sig_len);
+	rsa_convert_big_endian(modulus, prop->modulus, words * 4, key.len);
+	if (!(modulus[0] & 1)) {
+		debug("%s: RSA modulus must be odd\n", __func__);
+		return -EINVAL;
+	}
+	key.modulus = modulus;
+	key.n0inv = rsa_n0inv(modulus[0]);
+	rsa_get_rr(&key, prop->rr, words, rr);
+	key.rr = rr;
 
-	ret = pow_mod(&key, buf);
+	rsa_convert_big_endian(buf, sig, sig_len, key.len);
+	ret = pow_mod(&key, exponent, buf);
 	if (ret)
 		return ret;
-
-	memcpy(out, buf, sig_len);
+	rsa_convert_to_big_endian(out, buf, sig_len);
 
 	return 0;
 }
@@ -318,8 +514,12 @@ int zynq_pow_mod(u32 *keyptr, u32 *inout)
 	u32 *result, *ptr;
 	uint i;
 	struct rsa_public_key *key;
+	struct rsa_mont_key mkey;
 	u32 val[RSA2048_BYTES], acc[RSA2048_BYTES], tmp[RSA2048_BYTES];
 
+	/* zynq is 32-bit, so the key words can be used as limbs directly */
+	BUILD_BUG_ON(sizeof(rsa_limb_t) != sizeof(u32));
+
 	key = (struct rsa_public_key *)keyptr;
 
 	/* Sanity check for stack size - key->len is in 32-bit words */
@@ -329,21 +529,28 @@ int zynq_pow_mod(u32 *keyptr, u32 *inout)
 		return -EINVAL;
 	}
 
+	mkey.len = key->len;
+	mkey.n0inv = key->n0inv;
+	mkey.modulus = key->modulus;
+	mkey.rr = key->rr;
+
 	result = tmp;  /* Re-use location. */
 
 	for (i = 0, ptr = inout; i < key->len; i++, ptr++)
 		val[i] = *(ptr);
 
-	montgomery_mul(key, acc, val, key->rr);  /* axx = a * RR / R mod M */
+	montgomery_mul(&mkey, acc, val, mkey.rr);  /* axx = a * RR / R mod M */
 	for (i = 0; i < 16; i += 2) {
-		montgomery_mul(key, tmp, acc, acc); /* tmp = acc^2 / R mod M */
-		montgomery_mul(key, acc, tmp, tmp); /* acc = tmp^2 / R mod M */
+		/* tmp = acc^2 / R mod M, acc = tmp^2 / R mod M */
+		montgomery_mul(&mkey, tmp, acc, acc);
+		montgomery_mul(&mkey, acc, tmp, tmp);
 	}
-	montgomery_mul(key, result, acc, val);  /* result = XX * a / R mod M */
+	/* result = XX * a / R mod M */
+	montgomery_mul(&mkey, result, acc, val);
 
 	/* Make sure result < mod; result is at most 1x mod too large. */
-	if (greater_equal_modulus(key, result))
-		subtract_modulus(key, result);
+	if (greater_equal_modulus(&mkey, result))
+		subtract_modulus(&mkey, result);
 
 	for (i = 0, ptr = inout; i < key->len; i++, ptr++)
 		*ptr = result[i];
@@ -0,0 +1,317 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Decompressing zstd images into memory
+ *
+ * Images are decompressed straight into their destination buffer, so no
+ * window buffer is needed. Images made of several frames with known sizes
+ * are split by frame, so that the frames can be decompressed on different
+ * CPUs.
+ */
+
+#include <common.h>
+#include <malloc.h>
+#include <mp_work.h>
+#include <zstd.h>
+#include <asm/cache.h>
+#include <asm/unaligned.h>
+#include <linux/kernel.h>
+
+/* Most frames decompressed at the same time */
+#define ZSTD_MAX_JOBS		8
+
+/**
+ * struct zstd_frame - one frame of a multi-frame image
+ *
+ * @src:	Compressed frame
+ * @src_len:	Length of @src
+ * @dst:	Where the frame's data goes
+ * @dst_len:	Length of the frame's data
+ */
+struct zstd_frame {
+	const void *src;
+	size_t src_len;
+	void *dst;
+	size_t dst_len;
+};
+
+/**
+ * struct zstd_job - frames decompressed by one CPU
+ *
+ * @dctx:	Decompression context for this job
+ * @frames:	All frames of the image
+ * @first:	First frame to decompress
+ * @count:	Number of frames in @frames
+ * @stride:	Distance to the next frame to decompress
+ */
+struct zstd_job {
+	ZSTD_DCtx *dctx;
+	struct zstd_frame *frames;
+	int first;
+	int count;
+	int stride;
+};
+
+static int zstd_errno(size_t ret)
+{
+	switch (ZSTD_getErrorCode(ret)) {
+	case ZSTD_error_dstSize_tooSmall:
+		return -ENOSPC;
+	case ZSTD_error_memory_allocation:
+		return -ENOMEM;
+	default:
+		return -EINVAL;
+	}
+}
+
+/**
+ * zstd_find_frames() - Find the frames in an image
+ *
+ * Skippable frames and frames without data are left out.
+ *
+ * @src:	Image to look in
+ * @srcn:	Length of @src
+ * @dst:	Destination buffer for the uncompressed data
+ * @dstn:	Size of @dst
+ * @frames:	Returns the frames, or NULL to just count them
+ * @return number of frames, or -EINVAL if a frame has no recorded size or
+ *	the image cannot be split, -ENOSPC if the data does not fit in @dst
+ */
+static int zstd_find_frames(const void *src, size_t srcn, void *dst,
+			    size_t dstn, struct zstd_frame *frames)
+{
+	const u8 *p = src;
+	size_t frame_len, pos = 0;
+	unsigned long long size;
+	int count = 0;
+
+	while (srcn) {
+		frame_len = ZSTD_findFrameCompressedSize(p, srcn);
+		if (ZSTD_isError(frame_len))
+			return -EINVAL;
+		if ((get_unaligned_le32(p) & 0xfffffff0) ==
+		    ZSTD_MAGIC_SKIPPABLE_START)
+			size = 0;
+		else
+			size = ZSTD_getFrameContentSize(p, frame_len);
+		if (size >= ZSTD_CONTENTSIZE_ERROR)
+			return -EINVAL;
+		if (size > dstn - pos)
+			return -ENOSPC;
+		if (size) {
+			if (frames) {
+				frames[count].src = p;
+				frames[count].src_len = frame_len;
+				frames[count].dst = dst + pos;
+				frames[count].dst_len = size;
+			}
+			pos += size;
+			count++;
+		}
+		p += frame_len;
+		srcn -= frame_len;
+	}
+
+	return count;
+}
+
+static int zstd_frame_job(void *arg)
+{
+	struct zstd_job *job = arg;
+	struct zstd_frame *frame;
+	size_t ret;
+	int i;
+
+	for (i = job->first; i < job->count; i += job->stride) {
+		frame = &job->frames[i];
+		ret = ZSTD_decompressDCtx(job->dctx, frame->dst, frame->dst_len,
+					  frame->src, frame->src_len);
+		if (ZSTD_isError(ret))
+			return zstd_errno(ret);
+		if (ret != frame->dst_len)
+			return -EINVAL;
+	}
+
+	return 0;
+}
+
+/* Decompress each frame on its own, on as many CPUs as there are */
+static int zstd_decompress_frames(void *dst, size_t *dstn, const void *src,
+				  size_t srcn, int count)
+{
+	struct zstd_job jobs[ZSTD_MAX_JOBS];
+	struct mp_job mp_jobs[ZSTD_MAX_JOBS];
+	struct zstd_frame *frames;
+	size_t wsize, total = 0;
+	void *workspace;
+	int njobs, i, ret;
+
+	/* Without other CPUs one context does all the frames in turn */
+	njobs = CONFIG_IS_ENABLED(MP_WORK) ? min(count, ZSTD_MAX_JOBS) : 1;
+	wsize = ALIGN(ZSTD_DCtxWorkspaceBound(), ARCH_DMA_MINALIGN);
+	frames = malloc(count * sizeof(*frames));
+	workspace = memalign(ARCH_DMA_MINALIGN, njobs * wsize);
+	if (!frames || !workspace) {
+		ret = -ENOMEM;
+		goto out;
+	}
+
+	zstd_find_frames(src, srcn, dst, *dstn, frames);
+	for (i = 0; i < njobs; i++) {
+		jobs[i].dctx = ZSTD_initDCtx(workspace + i * wsize, wsize);
+		jobs[i].frames = frames;
+		jobs[i].first = i;
+		jobs[i].count = count;
+		jobs[i].stride = njobs;
+		mp_jobs[i].func = zstd_frame_job;
+		mp_jobs[i].arg = &jobs[i];
+	}
+	mp_work_run(mp_jobs, njobs);
+
+	ret = 0;
+	for (i = 0; i < njobs; i++) {
+		if (mp_jobs[i].ret && !ret)
+			ret = mp_jobs[i].ret;
+	}
+	if (!ret) {
+		for (i = 0; i < count; i++)
+			total += frames[i].dst_len;
+		*dstn = total;
+	}
+out:
+	free(workspace);
+	free(frames);
+
+	return ret;
+}
+
+int zstd_decompress(void *dst, size_t *dstn, const void *src, size_t srcn)
+{
+	ZSTD_DCtx *dctx;
+	size_t wsize, ret;
+	void *workspace;
+	int count;
+
+	/* Split the image by frame if possible, else leave it to the library */
+	count = zstd_find_frames(src, srcn, dst, *dstn, NULL);
+	if (count > 1)
+		return zstd_decompress_frames(dst, dstn, src, srcn, count);
+
+	wsize = ZSTD_DCtxWorkspaceBound();
+	workspace = malloc(wsize);
+	if (!workspace)
+		return -ENOMEM;
+	dctx = ZSTD_initDCtx(workspace, wsize);
+	ret = ZSTD_decompressDCtx(dctx, dst, *dstn, src, srcn);
+	free(workspace);
+	if (ZSTD_isError(ret))
+		return zstd_errno(ret);
+	*dstn = ret;
+
+	return 0;
+}
+
+int zstd_stream_init(struct zstd_stream *zs, void *dst, size_t dst_len)
+{
+	size_t wsize = ALIGN(ZSTD_DCtxWorkspaceBound(), ARCH_DMA_MINALIGN);
+
+	memset(zs, '\0', sizeof(*zs));
+	/* A compressed block is the largest unit the library takes at once */
+	zs->workspace = malloc(wsize + ZSTD_BLOCKSIZE_ABSOLUTEMAX);
+	if (!zs->workspace)
+		return -ENOMEM;
+	zs->dctx = ZSTD_initDCtx(zs->workspace, wsize);
+	zs->held = zs->workspace + wsize;
+	zs->between = true;
+	zs->dst = dst;
+	zs->dst_len = dst_len;
+
+	return 0;
+}
+
+/* Pass one complete unit of input (header, block, ...) to the library */
+static int zstd_stream_step(struct zstd_stream *zs, const void *src,
+			    size_t len)
+{
+	size_t ret;
+
+	ret = ZSTD_decompressContinue(zs->dctx, zs->dst + zs->pos,
+				      zs->dst_len - zs->pos, src, len);
+	if (ZSTD_isError(ret))
+		return zstd_errno(ret);
+	zs->pos += ret;
+	if (!ZSTD_nextSrcSizeToDecompress(zs->dctx)) {
+		zs->between = true;
+		zs->frames++;
+	}
+
+	return 0;
+}
+
+int zstd_stream_feed(struct zstd_stream *zs, const void *src, size_t len)
+{
+	const u8 *p = src;
+	size_t need, take;
+	int ret;
+
+	while (len) {
+		if (zs->between) {
+			ZSTD_decompressBegin(zs->dctx);
+			zs->between = false;
+		}
+		if (zs->skip) {
+			take = min(zs->skip, len);
+			zs->skip -= take;
+			p += take;
+			len -= take;
+			if (!zs->skip) {
+				zs->between = true;
+				zs->frames++;
+			}
+			continue;
+		}
+
+		need = ZSTD_nextSrcSizeToDecompress(zs->dctx);
+		if (need > ZSTD_BLOCKSIZE_ABSOLUTEMAX) {
+			/* only the data of a skippable frame can be this large */
+			if (ZSTD_nextInputType(zs->dctx) !=
+			    ZSTDnit_skippableFrame)
+				return -EINVAL;
+			zs->skip = need;
+			continue;
+		}
+
+		if (!zs->held_len && len >= need) {
+			ret = zstd_stream_step(zs, p, need);
+			p += need;
+			len -= need;
+		} else {
+			take = min(need - zs->held_len, len);
+			memcpy(zs->held + zs->held_len, p, take);
+			zs->held_len += take;
+			p += take;
+			len -= take;
+			if (zs->held_len < need)
+				break;
+			zs->held_len = 0;
+			ret = zstd_stream_step(zs, zs->held, need);
+		}
+		if (ret)
+			return ret;
+	}
+
+	return 0;
+}
+
+int zstd_stream_finish(struct zstd_stream *zs, size_t *dst_len)
+{
+	free(zs->workspace);
+	zs->workspace = NULL;
+	*dst_len = zs->pos;
+	if (!zs->between || !zs->frames) {
+		debug("%s: zstd data ends part way through a frame\n",
+		      __func__);
+		return -EINVAL;
+	}
+
+	return 0;
+}
@@ -352,6 +352,34 @@ int eth_send(void *packet, int length)
 	return ret;
 }
 
+/* Maximum number of packets processed by one call to eth_rx() */
+#define ETH_RX_BATCH	32
+
+/*
+ * Fetch everything the driver has ready in one call. Buffers are handed
+ * back one by one as they are processed; the driver tells the hardware
+ * about them once, on its next recv_batch() call.
+ */
+static int eth_rx_batch(struct udevice *current)
+{
+	struct eth_ops *ops = eth_get_ops(current);
+	uchar *packets[ETH_RX_BATCH];
+	int lengths[ETH_RX_BATCH];
+	int ret;
+	int i;
+
+	ret = ops->recv_batch(current, ETH_RECV_CHECK_DEVICE, packets, lengths,
+			      ETH_RX_BATCH);
+	for (i = 0; i < ret; i++) {
+		if (lengths[i] > 0)
+			net_process_received_packet(packets[i], lengths[i]);
+		if (ops->free_pkt)
+			ops->free_pkt(current, packets[i], lengths[i]);
+	}
+
+	return ret;
+}
+
 int eth_rx(void)
 {
 	struct udevice *current;
@@ -367,9 +395,19 @@ int eth_rx(void)
 	if (!eth_is_active(current))
 		return -EINVAL;
 
-	/* Process up to 32 packets at one time */
+	if (eth_get_ops(current)->recv_batch) {
+		ret = eth_rx_batch(current);
+		if (ret == -EAGAIN)
+			ret = 0;
+		if (ret < 0)
+			debug("%s: recv_batch() returned error %d\n", __func__,
+			      ret);
+		return ret;
+	}
+
+	/* Process up to ETH_RX_BATCH packets at one time */
 	flags = ETH_RECV_CHECK_DEVICE;
-	for (i = 0; i < 32; i++) {
+	for (i = 0; i < ETH_RX_BATCH; i++) {
 		ret = eth_get_ops(current)->recv(current, flags, &packet);
 		flags = 0;
 		if (ret > 0)
@@ -502,6 +540,8 @@ static int eth_post_probe(struct udevice *dev)
 			ops->send += gd->reloc_off;
 		if (ops->recv)
 			ops->recv += gd->reloc_off;
+		if (ops->recv_batch)
+			ops->recv_batch += gd->reloc_off;
 		if (ops->free_pkt)
 			ops->free_pkt += gd->reloc_off;
 		if (ops->stop)
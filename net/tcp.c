@@ -0,0 +1,673 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Minimal TCP client
+ *
+ * This is just enough TCP to pull a large file from a server quickly: one
+ * actively opened connection, a fixed receive window that is advertised in
+ * full (the data is consumed as soon as it arrives in order) and in-order
+ * reassembly of segments that arrive after a loss. The sending side only
+ * keeps a single segment in flight, which is all a request / response
+ * protocol needs from a client.
+ */
+
+#include <common.h>
+#include <malloc.h>
+#include <net.h>
+#include <net/tcp.h>
+
+/* Retransmission timeout in ms, doubled on each retry up to TCP_RTO_MAX */
+#define TCP_RTO			1000UL
+#define TCP_RTO_MAX		8000UL
+#define TCP_RETRIES		6
+
+/* Time in ms a single in-order segment may wait for its ACK */
+#define TCP_DELACK		20UL
+
+/* Number of disjoint out-of-order byte ranges kept in the window */
+#define TCP_OOO_MAX		8
+
+#define TCP_WINDOW		CONFIG_TCP_RX_WINDOW
+
+/* Default MSS if the peer does not send the option (RFC 1122) */
+#define TCP_DEFAULT_MSS		536
+
+struct tcp_range {
+	u32 start;
+	u32 end;
+};
+
+static enum tcp_state tcp_state;
+static tcp_rx_f *tcp_rx_handler;
+static tcp_event_f *tcp_event_handler;
+
+static struct in_addr tcp_remote_ip;
+static uchar tcp_remote_ethaddr[ARP_HLEN];
+static int tcp_remote_port;
+static int tcp_local_port;
+
+/* Send side: oldest unacknowledged and next sequence number */
+static u32 tcp_snd_una;
+static u32 tcp_snd_nxt;
+static int tcp_snd_mss;
+/* Copy of the data segment in flight, for retransmission */
+static uchar tcp_snd_buf[TCP_MSS];
+static u32 tcp_snd_seq;
+static int tcp_snd_len;
+static bool tcp_fin_sent;
+
+/* Receive side */
+static u32 tcp_rcv_nxt;
+static int tcp_rcv_wscale;
+static bool tcp_peer_fin;
+static u32 tcp_peer_fin_seq;
+/* Number of in-order segments received since we last sent an ACK */
+static int tcp_ack_due;
+
+/*
+ * Reassembly buffer covering the receive window: tcp_ring[tcp_ring_head]
+ * holds the byte at tcp_rcv_nxt. Only ranges listed in tcp_ooo[] (sorted,
+ * disjoint and not touching) contain valid data.
+ */
+static uchar *tcp_ring;
+static u32 tcp_ring_head;
+static struct tcp_range tcp_ooo[TCP_OOO_MAX];
+static int tcp_ooo_count;
+
+/* Timers, as get_timer() values */
+static ulong tcp_rto;
+static ulong tcp_rto_at;
+static ulong tcp_ack_at;
+static int tcp_retries;
+
+static inline bool tcp_seq_before(u32 a, u32 b)
+{
+	return (s32)(a - b) < 0;
+}
+
+/* Offset of a sequence number from the left edge of the receive window */
+static inline u32 tcp_rcv_off(u32 seq)
+{
+	return seq - tcp_rcv_nxt;
+}
+
+/* Window scale we use, so that the whole window can be advertised */
+static int tcp_wscale(void)
+{
+	int shift = 0;
+
+	while ((TCP_WINDOW >> shift) > 0xffff)
+		shift++;
+
+	return shift;
+}
+
+static uint tcp_checksum(struct ip_tcp_hdr *ip, int len)
+{
+	struct {
+		struct in_addr	src;
+		struct in_addr	dst;
+		u8		zero;
+		u8		proto;
+		u16		len;
+	} __attribute__((packed)) pseudo;
+	uint sum;
+
+	net_copy_ip(&pseudo.src, &ip->ip_src);
+	net_copy_ip(&pseudo.dst, &ip->ip_dst);
+	pseudo.zero = 0;
+	pseudo.proto = IPPROTO_TCP;
+	pseudo.len = htons(len);
+
+	sum = compute_ip_checksum(&pseudo, sizeof(pseudo));
+
+	return add_ip_checksums(sizeof(pseudo), sum,
+				compute_ip_checksum(&ip->tcp_src, len));
+}
+
+int tcp_set_tcp_header(uchar *pkt, struct in_addr dest, int dport, int sport,
+		       int payload_len, u8 action, u32 tcp_seq_num,
+		       u32 tcp_ack_num)
+{
+	struct ip_tcp_hdr *ip = (struct ip_tcp_hdr *)pkt;
+	uchar *opt = pkt + IP_TCP_HDR_SIZE;
+	int hdr_len = TCP_HDR_SIZE;
+	u32 win;
+
+	/* Only a SYN carries options, and it never carries data */
+	if (action & TCP_SYN) {
+		*opt++ = TCP_O_MSS;
+		*opt++ = 4;
+		*opt++ = TCP_MSS >> 8;
+		*opt++ = TCP_MSS & 0xff;
+		*opt++ = TCP_O_NOP;
+		*opt++ = TCP_O_WS;
+		*opt++ = 3;
+		*opt++ = tcp_wscale();
+		hdr_len += 8;
+	}
+
+	net_set_ip_header(pkt, dest, net_ip, IP_HDR_SIZE + hdr_len + payload_len,
+			  IPPROTO_TCP);
+
+	/* The window in a SYN is never scaled (RFC 7323) */
+	win = TCP_WINDOW >> ((action & TCP_SYN) ? 0 : tcp_rcv_wscale);
+
+	ip->tcp_src = htons(sport);
+	ip->tcp_dst = htons(dport);
+	ip->tcp_seq = htonl(tcp_seq_num);
+	ip->tcp_ack = htonl((action & TCP_ACK) ? tcp_ack_num : 0);
+	ip->tcp_hlen = (hdr_len / 4) << 4;
+	ip->tcp_flags = action;
+	ip->tcp_win = htons(min_t(u32, win, 0xffff));
+	ip->tcp_xsum = 0;
+	ip->tcp_urg = 0;
+	ip->tcp_xsum = tcp_checksum(ip, hdr_len + payload_len);
+
+	return IP_HDR_SIZE + hdr_len;
+}
+
+static void tcp_send_segment(u8 flags, u32 seq, const void *data, int len)
+{
+	uchar *pkt = net_tx_packet + net_eth_hdr_size() + IP_TCP_HDR_SIZE;
+
+	if (len)
+		memcpy(pkt, data, len);
+	if (flags & TCP_ACK)
+		tcp_ack_due = 0;
+
+	net_send_ip_packet(tcp_remote_ethaddr, tcp_remote_ip, tcp_remote_port,
+			   tcp_local_port, len, IPPROTO_TCP, flags, seq,
+			   tcp_rcv_nxt);
+}
+
+static void tcp_send_ack(void)
+{
+	tcp_send_segment(TCP_ACK, tcp_snd_nxt, NULL, 0);
+}
+
+static void tcp_timeout_handler(void);
+
+/* Arm the net_loop() timeout for whichever of our timers expires first */
+static void tcp_arm_timer(void)
+{
+	ulong now = get_timer(0);
+	ulong at = tcp_rto_at;
+
+	if (tcp_ack_due && (long)(tcp_ack_at - at) < 0)
+		at = tcp_ack_at;
+
+	net_set_timeout_handler((long)(at - now) > 0 ? at - now : 1,
+				tcp_timeout_handler);
+}
+
+/* The peer is alive; restart the retransmission timer */
+static void tcp_peer_alive(void)
+{
+	tcp_rto = TCP_RTO;
+	tcp_retries = 0;
+	tcp_rto_at = get_timer(0) + tcp_rto;
+}
+
+static void tcp_set_closed(enum tcp_event event)
+{
+	tcp_state = TCP_CLOSED;
+	net_set_timeout_handler(0, NULL);
+	tcp_event_handler(event);
+}
+
+static void tcp_retransmit(void)
+{
+	bool sent = false;
+	u32 off;
+
+	if (tcp_state == TCP_SYN_SENT) {
+		tcp_send_segment(TCP_SYN, tcp_snd_una, NULL, 0);
+		return;
+	}
+
+	if (tcp_seq_before(tcp_snd_una, tcp_snd_seq + tcp_snd_len)) {
+		off = tcp_snd_una - tcp_snd_seq;
+		tcp_send_segment(TCP_ACK | TCP_PUSH, tcp_snd_una,
+				 tcp_snd_buf + off, tcp_snd_len - off);
+		sent = true;
+	}
+	if (tcp_fin_sent && tcp_snd_una != tcp_snd_nxt) {
+		tcp_send_segment(TCP_FIN | TCP_ACK, tcp_snd_nxt - 1, NULL, 0);
+		sent = true;
+	}
+
+	/* Otherwise repeat our last ACK in case the peer is waiting for it */
+	if (!sent)
+		tcp_send_ack();
+}
+
+static void tcp_timeout_handler(void)
+{
+	ulong now = get_timer(0);
+
+	if (tcp_state == TCP_CLOSED)
+		return;
+
+	if (tcp_ack_due && (long)(now - tcp_ack_at) >= 0)
+		tcp_send_ack();
+
+	if ((long)(now - tcp_rto_at) >= 0) {
+		if (++tcp_retries > TCP_RETRIES) {
+			tcp_set_closed(TCP_EV_TIMEOUT);
+			return;
+		}
+		debug("TCP timeout, retry %d\n", tcp_retries);
+		tcp_rto = min(tcp_rto * 2, TCP_RTO_MAX);
+		tcp_rto_at = now + tcp_rto;
+		tcp_retransmit();
+	}
+
+	tcp_arm_timer();
+}
+
+int tcp_open(struct in_addr dest, int dport, tcp_rx_f *rx,
+	     tcp_event_f *event)
+{
+	u32 iss;
+
+	if (!tcp_ring) {
+		tcp_ring = malloc(TCP_WINDOW);
+		if (!tcp_ring)
+			return -ENOMEM;
+	}
+
+	tcp_remote_ip = dest;
+	tcp_remote_port = dport;
+	tcp_local_port = random_port();
+	memset(tcp_remote_ethaddr, 0, ARP_HLEN);
+	tcp_rx_handler = rx;
+	tcp_event_handler = event;
+
+	iss = (u32)get_ticks();
+	tcp_snd_una = iss;
+	tcp_snd_nxt = iss + 1;
+	tcp_snd_mss = TCP_DEFAULT_MSS;
+	tcp_snd_seq = tcp_snd_nxt;
+	tcp_snd_len = 0;
+	tcp_fin_sent = false;
+
+	tcp_rcv_nxt = 0;
+	tcp_rcv_wscale = 0;
+	tcp_peer_fin = false;
+	tcp_ack_due = 0;
+	tcp_ring_head = 0;
+	tcp_ooo_count = 0;
+
+	tcp_state = TCP_SYN_SENT;
+	tcp_send_segment(TCP_SYN, iss, NULL, 0);
+
+	tcp_peer_alive();
+	tcp_arm_timer();
+
+	return 0;
+}
+
+int tcp_send(const void *data, int len)
+{
+	if (tcp_state != TCP_ESTABLISHED && tcp_state != TCP_CLOSE_WAIT)
+		return -ENOTCONN;
+	if (tcp_snd_una != tcp_snd_nxt)
+		return -EBUSY;
+	if (len > tcp_snd_mss)
+		return -EMSGSIZE;
+
+	memcpy(tcp_snd_buf, data, len);
+	tcp_snd_seq = tcp_snd_nxt;
+	tcp_snd_len = len;
+	tcp_snd_nxt += len;
+	tcp_rto_at = get_timer(0) + tcp_rto;
+
+	tcp_send_segment(TCP_ACK | TCP_PUSH, tcp_snd_seq, data, len);
+
+	return 0;
+}
+
+void tcp_close(void)
+{
+	switch (tcp_state) {
+	case TCP_SYN_SENT:
+		tcp_state = TCP_CLOSED;
+		net_set_timeout_handler(0, NULL);
+		return;
+	case TCP_ESTABLISHED:
+		tcp_state = TCP_FIN_WAIT_1;
+		break;
+	case TCP_CLOSE_WAIT:
+		tcp_state = TCP_LAST_ACK;
+		break;
+	default:
+		return;
+	}
+
+	tcp_fin_sent = true;
+	tcp_send_segment(TCP_FIN | TCP_ACK, tcp_snd_nxt++, NULL, 0);
+}
+
+void tcp_abort(void)
+{
+	if (tcp_state == TCP_CLOSED)
+		return;
+
+	if (tcp_state != TCP_SYN_SENT)
+		tcp_send_segment(TCP_RST | TCP_ACK, tcp_snd_nxt, NULL, 0);
+	tcp_state = TCP_CLOSED;
+	net_set_timeout_handler(0, NULL);
+}
+
+enum tcp_state tcp_get_state(void)
+{
+	return tcp_state;
+}
+
+/* Look for the window scale and MSS options in a SYN */
+static bool tcp_parse_syn_options(struct ip_tcp_hdr *ip, int hdr_len)
+{
+	uchar *opt = (uchar *)ip + IP_TCP_HDR_SIZE;
+	uchar *end = (uchar *)ip + IP_HDR_SIZE + hdr_len;
+	bool wscale = false;
+
+	while (opt < end && *opt != TCP_O_END) {
+		if (*opt == TCP_O_NOP) {
+			opt++;
+			continue;
+		}
+		if (end - opt < 2 || opt[1] < 2 || opt[1] > end - opt)
+			break;
+		if (*opt == TCP_O_MSS && opt[1] == 4)
+			tcp_snd_mss = min_t(int, (opt[2] << 8) | opt[3],
+					    TCP_MSS);
+		else if (*opt == TCP_O_WS && opt[1] == 3)
+			wscale = true;
+		opt += opt[1];
+	}
+
+	return wscale;
+}
+
+static void tcp_rx_syn_sent(struct ip_tcp_hdr *ip, int hdr_len, u8 flags,
+			    u32 seq, u32 ack)
+{
+	if (!(flags & TCP_ACK) || ack != tcp_snd_nxt)
+		return;
+	if (flags & TCP_RST) {
+		tcp_set_closed(TCP_EV_RESET);
+		return;
+	}
+	if (!(flags & TCP_SYN))
+		return;
+
+	/* Our window is only scaled if both sides offered the option */
+	if (tcp_parse_syn_options(ip, hdr_len))
+		tcp_rcv_wscale = tcp_wscale();
+	tcp_rcv_nxt = seq + 1;
+	tcp_snd_una = ack;
+	tcp_state = TCP_ESTABLISHED;
+
+	tcp_peer_alive();
+	tcp_send_ack();
+	tcp_event_handler(TCP_EV_CONNECTED);
+}
+
+static void tcp_rx_ack(u32 ack)
+{
+	if (!tcp_seq_before(tcp_snd_una, ack) ||
+	    tcp_seq_before(tcp_snd_nxt, ack))
+		return;
+
+	tcp_snd_una = ack;
+	if (!tcp_fin_sent || ack != tcp_snd_nxt)
+		return;
+
+	/* Our FIN has been acknowledged */
+	switch (tcp_state) {
+	case TCP_FIN_WAIT_1:
+		tcp_state = TCP_FIN_WAIT_2;
+		break;
+	case TCP_CLOSING:
+	case TCP_LAST_ACK:
+		tcp_set_closed(TCP_EV_CLOSED);
+		break;
+	default:
+		break;
+	}
+}
+
+/* Advance the left edge of the window past data handed to the caller */
+static void tcp_rcv_advance(u32 len)
+{
+	tcp_rcv_nxt += len;
+	tcp_ring_head = (tcp_ring_head + len) % TCP_WINDOW;
+}
+
+/* Keep data that arrived after a hole until the hole is filled */
+static void tcp_ooo_insert(u32 seq, const uchar *data, u32 len)
+{
+	u32 pos = (tcp_ring_head + tcp_rcv_off(seq)) % TCP_WINDOW;
+	u32 part = min(len, TCP_WINDOW - pos);
+	u32 start = seq, end = seq + len;
+	int i, j;
+
+	memcpy(tcp_ring + pos, data, part);
+	memcpy(tcp_ring, data + part, len - part);
+
+	/* Skip ranges that end before this one starts */
+	for (i = 0; i < tcp_ooo_count; i++) {
+		if (tcp_rcv_off(tcp_ooo[i].end) >= tcp_rcv_off(start))
+			break;
+	}
+
+	/* Merge with any ranges that overlap or touch it */
+	for (j = i; j < tcp_ooo_count; j++) {
+		if (tcp_rcv_off(tcp_ooo[j].start) > tcp_rcv_off(end))
+			break;
+		if (tcp_rcv_off(tcp_ooo[j].start) < tcp_rcv_off(start))
+			start = tcp_ooo[j].start;
+		if (tcp_rcv_off(tcp_ooo[j].end) > tcp_rcv_off(end))
+			end = tcp_ooo[j].end;
+	}
+
+	if (i == j) {
+		/* No room: forget the data, the peer will send it again */
+		if (tcp_ooo_count == TCP_OOO_MAX)
+			return;
+		memmove(&tcp_ooo[i + 1], &tcp_ooo[i],
+			(tcp_ooo_count - i) * sizeof(*tcp_ooo));
+		tcp_ooo_count++;
+	} else {
+		memmove(&tcp_ooo[i + 1], &tcp_ooo[j],
+			(tcp_ooo_count - j) * sizeof(*tcp_ooo));
+		tcp_ooo_count -= j - i - 1;
+	}
+	tcp_ooo[i].start = start;
+	tcp_ooo[i].end = end;
+}
+
+/* Hand over buffered data that has become contiguous with the window edge */
+static int tcp_ooo_deliver(void)
+{
+	u32 len, part;
+	int ret;
+
+	while (tcp_ooo_count && tcp_state != TCP_CLOSED &&
+	       !tcp_seq_before(tcp_rcv_nxt, tcp_ooo[0].start)) {
+		if (tcp_seq_before(tcp_rcv_nxt, tcp_ooo[0].end)) {
+			len = tcp_ooo[0].end - tcp_rcv_nxt;
+			part = min(len, TCP_WINDOW - tcp_ring_head);
+			ret = tcp_rx_handler(tcp_ring + tcp_ring_head, part);
+			if (!ret && part < len)
+				ret = tcp_rx_handler(tcp_ring, len - part);
+			if (ret)
+				return ret;
+			tcp_rcv_advance(len);
+		}
+		tcp_ooo_count--;
+		memmove(&tcp_ooo[0], &tcp_ooo[1],
+			tcp_ooo_count * sizeof(*tcp_ooo));
+	}
+
+	return 0;
+}
+
+/* Process the peer's FIN once everything before it has been delivered */
+static bool tcp_check_fin(void)
+{
+	if (!tcp_peer_fin || tcp_rcv_nxt != tcp_peer_fin_seq)
+		return false;
+
+	tcp_peer_fin = false;
+	tcp_rcv_nxt++;
+	tcp_send_ack();
+
+	switch (tcp_state) {
+	case TCP_ESTABLISHED:
+		tcp_state = TCP_CLOSE_WAIT;
+		tcp_event_handler(TCP_EV_PEER_CLOSED);
+		break;
+	case TCP_FIN_WAIT_1:
+		tcp_state = TCP_CLOSING;
+		break;
+	case TCP_FIN_WAIT_2:
+		/* No TIME_WAIT: nothing will reuse this port pair soon */
+		tcp_set_closed(TCP_EV_CLOSED);
+		break;
+	default:
+		break;
+	}
+
+	return true;
+}
+
+static void tcp_rx_data(u32 seq, const uchar *data, u32 len, bool fin)
+{
+	bool filled = false;
+	u32 off;
+
+	if (tcp_state != TCP_ESTABLISHED && tcp_state != TCP_FIN_WAIT_1 &&
+	    tcp_state != TCP_FIN_WAIT_2) {
+		/* The peer has already closed; it missed our ACK of its FIN */
+		tcp_send_ack();
+		return;
+	}
+
+	if (fin) {
+		tcp_peer_fin = true;
+		tcp_peer_fin_seq = seq + len;
+	}
+
+	/* Drop what we already have */
+	if (tcp_seq_before(seq, tcp_rcv_nxt)) {
+		off = tcp_rcv_nxt - seq;
+		if (off >= len) {
+			len = 0;
+		} else {
+			data += off;
+			len -= off;
+		}
+		seq = tcp_rcv_nxt;
+	}
+
+	/* ...and what does not fit in the window */
+	off = tcp_rcv_off(seq);
+	if (off >= TCP_WINDOW)
+		len = 0;
+	else if (len > TCP_WINDOW - off)
+		len = TCP_WINDOW - off;
+
+	if (!len) {
+		if (!tcp_check_fin())
+			tcp_send_ack();
+		return;
+	}
+
+	if (off) {
+		/* A segment is missing; a duplicate ACK tells the peer */
+		tcp_ooo_insert(seq, data, len);
+		tcp_send_ack();
+		return;
+	}
+
+	if (tcp_rx_handler(data, len))
+		goto abort;
+	tcp_rcv_advance(len);
+	if (tcp_state == TCP_CLOSED)
+		return;
+
+	if (tcp_ooo_count) {
+		filled = true;
+		if (tcp_ooo_deliver())
+			goto abort;
+	}
+	if (tcp_state == TCP_CLOSED || tcp_check_fin())
+		return;
+
+	/* ACK every second segment, and at once when a hole was filled */
+	if (filled || ++tcp_ack_due >= 2) {
+		tcp_send_ack();
+	} else {
+		tcp_ack_at = get_timer(0) + TCP_DELACK;
+		tcp_arm_timer();
+	}
+	return;
+
+abort:
+	tcp_abort();
+}
+
+void tcp_receive(struct ip_tcp_hdr *ip, int len)
+{
+	int hdr_len = (ip->tcp_hlen >> 4) * 4;
+	u8 flags = ip->tcp_flags;
+	u32 seq, ack;
+
+	if (len < IP_TCP_HDR_SIZE || hdr_len < TCP_HDR_SIZE ||
+	    IP_HDR_SIZE + hdr_len > len)
+		return;
+
+	if (tcp_state == TCP_CLOSED ||
+	    net_read_ip(&ip->ip_src).s_addr != tcp_remote_ip.s_addr ||
+	    ntohs(ip->tcp_src) != tcp_remote_port ||
+	    ntohs(ip->tcp_dst) != tcp_local_port)
+		return;
+
+	if (tcp_checksum(ip, len - IP_HDR_SIZE)) {
+		debug("TCP checksum bad\n");
+		return;
+	}
+
+	seq = ntohl(ip->tcp_seq);
+	ack = ntohl(ip->tcp_ack);
+
+	if (tcp_state == TCP_SYN_SENT) {
+		tcp_rx_syn_sent(ip, hdr_len, flags, seq, ack);
+		return;
+	}
+
+	if (flags & TCP_RST) {
+		if (tcp_rcv_off(seq) < TCP_WINDOW)
+			tcp_set_closed(TCP_EV_RESET);
+		return;
+	}
+
+	/* A repeated SYN means our ACK of it was lost */
+	if (flags & TCP_SYN) {
+		tcp_send_ack();
+		return;
+	}
+	if (!(flags & TCP_ACK))
+		return;
+
+	tcp_peer_alive();
+	tcp_rx_ack(ack);
+	if (tcp_state == TCP_CLOSED)
+		return;
+
+	len -= IP_HDR_SIZE + hdr_len;
+	if (len || (flags & TCP_FIN))
+		tcp_rx_data(seq, (uchar *)ip + IP_HDR_SIZE + hdr_len, len,
+			    flags & TCP_FIN);
+}
@@ -142,6 +142,24 @@ static char tftp_filename[MAX_LEN];
 static unsigned short tftp_block_size = TFTP_BLOCK_SIZE;
 static unsigned short tftp_block_size_option = TFTP_MTU_BLOCKSIZE;
 
+/*
+ * RFC 7440 windowsize: the number of blocks the server sends before it
+ * waits for an ACK. We only acknowledge the last block of each window, or
+ * the last block received in order when some of the window went missing.
+ */
+#ifdef CONFIG_TFTP_WINDOWSIZE
+#define TFTP_WINDOWSIZE CONFIG_TFTP_WINDOWSIZE
+#else
+#define TFTP_WINDOWSIZE 1
+#endif
+
+static unsigned short tftp_window_size = 1;
+static unsigned short tftp_window_size_option = TFTP_WINDOWSIZE;
+/* blocks received in order since the last ACK */
+static unsigned short tftp_window_pos;
+/* how far ahead of the last good block the last unexpected one was */
+static unsigned short tftp_window_gap;
+
 static inline int store_block(int block, uchar *src, unsigned int len)
 {
 	ulong offset = block * tftp_block_size + tftp_block_wrap_offset;
@@ -201,6 +219,8 @@ static void new_transfer(void)
 	tftp_prev_block = 0;
 	tftp_block_wrap = 0;
 	tftp_block_wrap_offset = 0;
+	tftp_window_pos = 0;
+	tftp_window_gap = 0;
 #ifdef CONFIG_CMD_TFTPPUT
 	tftp_put_final_block_sent = 0;
 #endif
@@ -353,6 +373,15 @@ static void tftp_send(void)
 		/* try for more effic. blk size */
 		pkt += sprintf((char *)pkt, "blksize%c%d%c",
 				0, tftp_block_size_option, 0);
+		/*
+		 * and for more than one block per ACK, unless the request
+		 * timed out: some servers and firewalls drop requests with
+		 * options they don't know
+		 */
+		if (tftp_state == STATE_SEND_RRQ && tftp_window_size_option > 1 &&
+		    !timeout_count)
+			pkt += sprintf((char *)pkt, "windowsize%c%d%c",
+					0, tftp_window_size_option, 0);
 		len = pkt - xp;
 		break;
 
@@ -497,6 +526,13 @@ static void tftp_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 				debug("Blocksize ack: %s, %d\n",
 				      (char *)pkt + i + 8, tftp_block_size);
 			}
+			if (strcmp((char *)pkt + i, "windowsize") == 0) {
+				tftp_window_size = (unsigned short)
+					simple_strtoul((char *)pkt + i + 11,
+						       NULL, 10);
+				debug("Windowsize ack: %s, %d\n",
+				      (char *)pkt + i + 11, tftp_window_size);
+			}
 #ifdef CONFIG_TFTP_TSIZE
 			if (strcmp((char *)pkt+i, "tsize") == 0) {
 				tftp_tsize = simple_strtoul((char *)pkt + i + 6,
@@ -521,6 +557,31 @@ static void tftp_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 		len -= 2;
 		tftp_cur_block = ntohs(*(__be16 *)pkt);
 
+		/*
+		 * Within a window, a block which is not the next one means
+		 * some went missing. Acknowledge the last block we got in
+		 * order so that the server resends from there, and drop the
+		 * rest of the window. That is done once per window: a gap
+		 * that is not larger than the previous one means the server
+		 * started sending again.
+		 */
+		if (tftp_state == STATE_DATA && tftp_window_size > 1 &&
+		    tftp_cur_block != tftp_prev_block &&
+		    tftp_cur_block != ((tftp_prev_block + 1) &
+				       (TFTP_SEQUENCE_SIZE - 1))) {
+			unsigned short gap = tftp_cur_block - tftp_prev_block;
+
+			debug("Got block %lu, expected %lu\n", tftp_cur_block,
+			      (tftp_prev_block + 1) & (TFTP_SEQUENCE_SIZE - 1));
+			tftp_cur_block = tftp_prev_block;
+			if (!tftp_window_gap || gap <= tftp_window_gap) {
+				tftp_window_pos = 0;
+				tftp_send();
+			}
+			tftp_window_gap = gap;
+			break;
+		}
+
 		update_block_number();
 
 		if (tftp_state == STATE_SEND_RRQ)
@@ -559,10 +620,15 @@ static void tftp_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 		}
 
 		/*
-		 *	Acknowledge the block just received, which will prompt
-		 *	the remote for the next one.
+		 *	Acknowledge the block just received if it ends the
+		 *	window, which will prompt the remote for the next one.
 		 */
-		tftp_send();
+		tftp_window_gap = 0;
+		if (++tftp_window_pos >= tftp_window_size ||
+		    len < tftp_block_size) {
+			tftp_window_pos = 0;
+			tftp_send();
+		}
 
 		if (len < tftp_block_size)
 			tftp_complete();
@@ -601,6 +667,8 @@ static void tftp_timeout_handler(void)
 	} else {
 		puts("T ");
 		net_set_timeout_handler(timeout_ms, tftp_timeout_handler);
+		/* ACK the last block received in order to restart the window */
+		tftp_window_pos = 0;
 		if (tftp_state != STATE_RECV_WRQ)
 			tftp_send();
 	}
@@ -639,6 +707,10 @@ void tftp_start(enum proto_t protocol)
 	if (ep != NULL)
 		tftp_block_size_option = simple_strtol(ep, NULL, 10);
 
+	ep = env_get("tftpwindowsize");
+	if (ep != NULL)
+		tftp_window_size_option = simple_strtol(ep, NULL, 10);
+
 	ep = env_get("tftptimeout");
 	if (ep != NULL)
 		timeout_ms = simple_strtol(ep, NULL, 10);
@@ -660,8 +732,11 @@ void tftp_start(enum proto_t protocol)
 	}
 #endif
 
-	debug("TFTP blocksize = %i, timeout = %ld ms\n",
-	      tftp_block_size_option, timeout_ms);
+	if (!tftp_window_size_option)
+		tftp_window_size_option = 1;
+
+	debug("TFTP blocksize = %i, windowsize = %i, timeout = %ld ms\n",
+	      tftp_block_size_option, tftp_window_size_option, timeout_ms);
 
 	tftp_remote_ip = net_server_ip;
 	if (!net_parse_bootfile(&tftp_remote_ip, tftp_filename, MAX_LEN)) {
@@ -762,6 +837,7 @@ void tftp_start(enum proto_t protocol)
 	memset(net_server_ethaddr, 0, 6);
 	/* Revert tftp_block_size to dflt */
 	tftp_block_size = TFTP_BLOCK_SIZE;
+	tftp_window_size = 1;
 #ifdef CONFIG_TFTP_TSIZE
 	tftp_tsize = 0;
 	tftp_tsize_num_hash = 0;
@@ -794,6 +870,7 @@ void tftp_start_server(void)
 
 	/* Revert tftp_block_size to dflt */
 	tftp_block_size = TFTP_BLOCK_SIZE;
+	tftp_window_size = 1;
 	tftp_cur_block = 0;
 	tftp_our_port = WELL_KNOWN_PORT;
 
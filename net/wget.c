@@ -0,0 +1,476 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * HTTP/1.1 download over TCP
+ *
+ * The response body is written to memory or a block device as each segment
+ * arrives, so nothing but the response header is ever buffered here.
+ */
+
+#include <common.h>
+#include <blk.h>
+#include <efi_loader.h>
+#include <env.h>
+#include <lmb.h>
+#include <malloc.h>
+#include <mapmem.h>
+#include <memalign.h>
+#include <net.h>
+#include <net/tcp.h>
+#include <net/wget.h>
+
+DECLARE_GLOBAL_DATA_PTR;
+
+#define HTTP_PORT		80
+#define HASHES_PER_LINE		65
+/* Bytes per '#' of progress */
+#define WGET_HASH_BYTES		(64 << 10)
+/* Longest response header (or chunk size line) we accept */
+#define WGET_HDR_MAX		2048
+/* Data collected before each write when loading to a block device */
+#define WGET_BLK_BUF_SIZE	(256 << 10)
+
+enum wget_state {
+	WGET_HEADER,		/* Response status line and header */
+	WGET_BODY,		/* Body up to Content-Length or close */
+	WGET_CHUNK_SIZE,	/* Size line of a chunk */
+	WGET_CHUNK_DATA,	/* Data of a chunk */
+	WGET_CHUNK_END,		/* CRLF after the data of a chunk */
+	WGET_TRAILER,		/* Trailer after the last chunk */
+	WGET_DONE,
+};
+
+static enum wget_state wget_state;
+static struct in_addr wget_server_ip;
+static int wget_server_port;
+static char wget_path[128];
+
+/* Header, or a chunk framing line, collected so far */
+static char wget_hdr[WGET_HDR_MAX + 1];
+static int wget_hdr_len;
+
+static bool wget_has_length;
+static ulong wget_length;
+static ulong wget_chunk_left;
+
+static ulong wget_load_addr;
+static ulong wget_load_size;
+
+static struct blk_desc *wget_blk_desc;
+static lbaint_t wget_blk_start;
+static lbaint_t wget_blk_next;
+static uchar *wget_blk_buf;
+static ulong wget_blk_buf_size;
+static ulong wget_blk_fill;
+
+static ulong wget_hashes;
+static ulong wget_time_start;
+
+void wget_set_blk_target(struct blk_desc *desc, lbaint_t start)
+{
+	wget_blk_desc = desc;
+	wget_blk_start = start;
+}
+
+static void wget_fail(const char *msg)
+{
+	printf("\nwget: %s\n", msg);
+	net_set_state(NETLOOP_FAIL);
+}
+
+static int wget_blk_flush(void)
+{
+	struct blk_desc *desc = wget_blk_desc;
+	lbaint_t cnt = DIV_ROUND_UP(wget_blk_fill, desc->blksz);
+
+	if (!wget_blk_fill)
+		return 0;
+
+	if (wget_blk_next + cnt > desc->lba) {
+		wget_fail("file does not fit on the device");
+		return -ENOSPC;
+	}
+
+	memset(wget_blk_buf + wget_blk_fill, 0,
+	       cnt * desc->blksz - wget_blk_fill);
+	if (blk_dwrite(desc, wget_blk_next, cnt, wget_blk_buf) != cnt) {
+		wget_fail("write to block device failed");
+		return -EIO;
+	}
+	wget_blk_next += cnt;
+	wget_blk_fill = 0;
+
+	return 0;
+}
+
+static int wget_store(const uchar *data, ulong len)
+{
+	ulong part;
+	void *ptr;
+	int ret;
+
+	if (wget_blk_desc) {
+		for (; len; data += part, len -= part) {
+			part = min(len, wget_blk_buf_size - wget_blk_fill);
+			memcpy(wget_blk_buf + wget_blk_fill, data, part);
+			wget_blk_fill += part;
+			net_boot_file_size += part;
+			if (wget_blk_fill == wget_blk_buf_size) {
+				ret = wget_blk_flush();
+				if (ret)
+					return ret;
+			}
+		}
+	} else {
+		if (wget_load_size && net_boot_file_size + len > wget_load_size) {
+			wget_fail("trying to overwrite reserved memory...");
+			return -EFBIG;
+		}
+		ptr = map_sysmem(wget_load_addr + net_boot_file_size, len);
+		memcpy(ptr, data, len);
+		unmap_sysmem(ptr);
+		net_boot_file_size += len;
+	}
+
+	while (wget_hashes < net_boot_file_size / WGET_HASH_BYTES) {
+		putc('#');
+		if (++wget_hashes % HASHES_PER_LINE == 0)
+			puts("\n\t ");
+	}
+
+	return 0;
+}
+
+/* The whole body has arrived */
+static void wget_done(void)
+{
+	ulong time;
+
+	wget_state = WGET_DONE;
+	tcp_close();
+
+	if (wget_blk_desc && wget_blk_flush())
+		return;
+
+	time = get_timer(wget_time_start);
+	if (time > 0) {
+		puts("\n\t ");	/* Line up with "Loading: " */
+		print_size(net_boot_file_size / time * 1000, "/s");
+	}
+	puts("\ndone\n");
+	net_set_state(NETLOOP_SUCCESS);
+}
+
+/*
+ * Collect the next line of the header or of the chunk framing. This
+ * returns the number of bytes used; *complete is set once the line ends.
+ */
+static ulong wget_collect_line(const uchar *data, ulong len, bool *complete)
+{
+	const uchar *nl = memchr(data, '\n', len);
+	ulong part = nl ? nl - data + 1 : len;
+	ulong room = WGET_HDR_MAX - wget_hdr_len;
+
+	memcpy(wget_hdr + wget_hdr_len, data, min(part, room));
+	wget_hdr_len += min(part, room);
+	wget_hdr[wget_hdr_len] = '\0';
+	*complete = nl != NULL;
+
+	return part;
+}
+
+static const char *wget_header_value(const char *line, const char *name)
+{
+	int len = strlen(name);
+
+	if (strncasecmp(line, name, len) || line[len] != ':')
+		return NULL;
+	for (line += len + 1; *line == ' ' || *line == '\t'; line++)
+		;
+
+	return line;
+}
+
+static int wget_parse_header(void)
+{
+	const char *line, *val;
+	char *eol;
+	int status;
+
+	if (strncmp(wget_hdr, "HTTP/1.", 7) || wget_hdr[8] != ' ') {
+		wget_fail("bad response from server");
+		return -EPROTO;
+	}
+	status = simple_strtoul(wget_hdr + 9, NULL, 10);
+	eol = strstr(wget_hdr, "\r\n");
+	*eol = '\0';
+	if (status != 200) {
+		printf("\nwget: server returned '%s'\n", wget_hdr + 9);
+		net_set_state(NETLOOP_FAIL);
+		return -ENOENT;
+	}
+
+	wget_state = WGET_BODY;
+	wget_has_length = false;
+	for (line = eol + 2; *line != '\r'; line = eol + 2) {
+		eol = strstr(line, "\r\n");
+		if (!eol)
+			break;
+		*eol = '\0';
+
+		val = wget_header_value(line, "Content-Length");
+		if (val) {
+			wget_has_length = true;
+			wget_length = simple_strtoul(val, NULL, 10);
+		}
+		val = wget_header_value(line, "Transfer-Encoding");
+		if (val && !strncasecmp(val, "chunked", 7))
+			wget_state = WGET_CHUNK_SIZE;
+	}
+
+	/* The length of a chunked body is only known at the end */
+	if (wget_state == WGET_CHUNK_SIZE)
+		wget_has_length = false;
+
+	return 0;
+}
+
+/* Take the response header from the start of the stream */
+static ulong wget_rx_header(const uchar *data, ulong len, int *ret)
+{
+	ulong used = 0, part;
+	bool complete;
+
+	*ret = 0;
+	while (used < len) {
+		part = wget_collect_line(data + used, len - used, &complete);
+		used += part;
+		if (!complete)
+			break;
+
+		/* An empty line ends the header */
+		if (wget_hdr_len >= 4 &&
+		    !strcmp(wget_hdr + wget_hdr_len - 4, "\r\n\r\n")) {
+			*ret = wget_parse_header();
+			wget_hdr_len = 0;
+			break;
+		}
+	}
+
+	if (wget_hdr_len == WGET_HDR_MAX) {
+		wget_fail("response header too long");
+		*ret = -E2BIG;
+	}
+
+	return used;
+}
+
+/* Take one line of the chunk framing */
+static ulong wget_rx_chunk_line(const uchar *data, ulong len, int *ret)
+{
+	bool complete;
+	ulong part;
+	char *end;
+
+	*ret = 0;
+	part = wget_collect_line(data, len, &complete);
+	if (!complete)
+		return part;
+
+	wget_hdr_len = 0;
+	switch (wget_state) {
+	case WGET_CHUNK_SIZE:
+		wget_chunk_left = simple_strtoul(wget_hdr, &end, 16);
+		if (end == wget_hdr) {
+			wget_fail("bad chunk size");
+			*ret = -EPROTO;
+		} else {
+			wget_state = wget_chunk_left ? WGET_CHUNK_DATA :
+				     WGET_TRAILER;
+		}
+		break;
+	case WGET_CHUNK_END:
+		if (strcmp(wget_hdr, "\r\n")) {
+			wget_fail("bad chunk end");
+			*ret = -EPROTO;
+		}
+		wget_state = WGET_CHUNK_SIZE;
+		break;
+	case WGET_TRAILER:
+		if (!strcmp(wget_hdr, "\r\n"))
+			wget_state = WGET_DONE;
+		break;
+	default:
+		break;
+	}
+
+	return part;
+}
+
+static int wget_rx(const uchar *data, unsigned int len)
+{
+	ulong part;
+	int ret = 0;
+
+	for (; len && !ret && wget_state != WGET_DONE;
+	     data += part, len -= part) {
+		switch (wget_state) {
+		case WGET_HEADER:
+			part = wget_rx_header(data, len, &ret);
+			/* An empty body may be complete already */
+			if (!ret && wget_state == WGET_BODY &&
+			    wget_has_length && !wget_length)
+				wget_state = WGET_DONE;
+			break;
+		case WGET_BODY:
+			part = len;
+			if (wget_has_length)
+				part = min(part, wget_length - net_boot_file_size);
+			ret = wget_store(data, part);
+			if (wget_has_length && net_boot_file_size == wget_length)
+				wget_state = WGET_DONE;
+			break;
+		case WGET_CHUNK_DATA:
+			part = min_t(ulong, len, wget_chunk_left);
+			ret = wget_store(data, part);
+			wget_chunk_left -= part;
+			if (!wget_chunk_left)
+				wget_state = WGET_CHUNK_END;
+			break;
+		default:
+			part = wget_rx_chunk_line(data, len, &ret);
+			break;
+		}
+	}
+
+	if (ret)
+		return ret;
+	if (wget_state == WGET_DONE)
+		wget_done();
+
+	return 0;
+}
+
+static void wget_send_request(void)
+{
+	char host[24];
+	int len;
+
+	ip_to_string(wget_server_ip, host);
+	if (wget_server_port != HTTP_PORT)
+		sprintf(host + strlen(host), ":%d", wget_server_port);
+
+	len = snprintf(wget_hdr, sizeof(wget_hdr),
+		       "GET %s%s HTTP/1.1\r\n"
+		       "Host: %s\r\n"
+		       "User-Agent: U-Boot\r\n"
+		       "Connection: close\r\n\r\n",
+		       wget_path[0] == '/' ? "" : "/", wget_path, host);
+
+	if (tcp_send(wget_hdr, len)) {
+		tcp_abort();
+		wget_fail("request too long");
+	}
+}
+
+static void wget_event(enum tcp_event event)
+{
+	if (wget_state == WGET_DONE)
+		return;
+
+	switch (event) {
+	case TCP_EV_CONNECTED:
+		wget_send_request();
+		break;
+	case TCP_EV_PEER_CLOSED:
+		/* Without a length the body ends when the server closes */
+		if (wget_state == WGET_BODY && !wget_has_length) {
+			wget_done();
+		} else {
+			tcp_close();
+			wget_fail("connection closed by server");
+		}
+		break;
+	case TCP_EV_RESET:
+		wget_fail("connection reset by server");
+		break;
+	case TCP_EV_TIMEOUT:
+		wget_fail("server not responding");
+		break;
+	default:
+		break;
+	}
+}
+
+static int wget_init_load_addr(void)
+{
+#ifdef CONFIG_LMB
+	struct lmb lmb;
+	phys_size_t max_size;
+
+	lmb_init_and_reserve(&lmb, gd->bd, (void *)gd->fdt_blob);
+
+	max_size = lmb_get_free_size(&lmb, image_load_addr);
+	if (!max_size)
+		return -1;
+
+	wget_load_size = max_size;
+#endif
+	wget_load_addr = image_load_addr;
+	return 0;
+}
+
+void wget_start(void)
+{
+	char *ep;
+
+	wget_server_ip = net_server_ip;
+	if (!net_parse_bootfile(&wget_server_ip, wget_path,
+				sizeof(wget_path))) {
+		puts("*** ERROR: no file name given\n");
+		net_set_state(NETLOOP_FAIL);
+		return;
+	}
+
+	wget_server_port = HTTP_PORT;
+	ep = env_get("httpdstp");
+	if (ep)
+		wget_server_port = simple_strtol(ep, NULL, 10);
+
+	printf("Using %s device\n", eth_get_name());
+	printf("HTTP from server %pI4; our IP address is %pI4\n",
+	       &wget_server_ip, &net_ip);
+	printf("Filename '%s'.\n", wget_path);
+
+	wget_state = WGET_HEADER;
+	wget_hdr_len = 0;
+	wget_hashes = 0;
+	net_boot_file_size = 0;
+
+	if (wget_blk_desc) {
+		wget_blk_buf_size = WGET_BLK_BUF_SIZE / wget_blk_desc->blksz *
+				    wget_blk_desc->blksz;
+		if (!wget_blk_buf)
+			wget_blk_buf = malloc_cache_aligned(WGET_BLK_BUF_SIZE);
+		if (!wget_blk_buf) {
+			wget_fail("out of memory");
+			return;
+		}
+		wget_blk_next = wget_blk_start;
+		wget_blk_fill = 0;
+		printf("Write to block: 0x" LBAF "\n", wget_blk_start);
+	} else {
+		if (wget_init_load_addr()) {
+			wget_fail("trying to overwrite reserved memory...");
+			return;
+		}
+		printf("Load address: 0x%lx\n", wget_load_addr);
+#ifdef CONFIG_CMD_BOOTEFI
+		efi_set_bootdev("Net", "", wget_path);
+#endif
+	}
+	puts("Loading: *\b");
+
+	wget_time_start = get_timer(0);
+	if (tcp_open(wget_server_ip, wget_server_port, wget_rx, wget_event))
+		wget_fail("out of memory");
+}
@@ -7,9 +7,11 @@
 #include <bootm.h>
 #include <command.h>
 #include <gzip.h>
+#include <hexdump.h>
 #include <lz4.h>
 #include <malloc.h>
 #include <mapmem.h>
+#include <zstd.h>
 #include <asm/io.h>
 
 #include <u-boot/zlib.h>
@@ -119,6 +121,86 @@ static const char lz4_compressed[] =
 	"\x9d\x12\x8c\x9d";
 static const unsigned long lz4_compressed_size = 276;
 
+/*
+ * Long enough for the decoder's fast loop, with long literal runs and
+ * matches at offsets 1, 2, 10 and 350:
+ * (for i in $(seq 40); do cat /tmp/plain.txt; done
+ *  printf 'a%.0s' $(seq 300); printf 'ab%.0s' $(seq 150)
+ *  printf 'abcdefghij%.0s' $(seq 30)
+ *  for i in $(seq 40); do cat /tmp/plain.txt; done) > /tmp/pattern.txt
+ * lz4 -9 /tmp/pattern.txt /tmp/pattern.lz4
+ */
+static const char lz4_pattern[] =
+	"\x04\x22\x4d\x18\x64\x40\xa7\x91\x01\x00\x00\xff\x19\x49\x20\x61"
+	"\x6d\x20\x61\x20\x68\x69\x67\x68\x6c\x79\x20\x63\x6f\x6d\x70\x72"
+	"\x65\x73\x73\x61\x62\x6c\x65\x20\x62\x69\x74\x20\x6f\x66\x20\x74"
+	"\x65\x78\x74\x2e\x0a\x28\x00\x3d\xf1\x25\x54\x68\x65\x72\x65\x20"
+	"\x61\x72\x65\x20\x6d\x61\x6e\x79\x20\x6c\x69\x6b\x65\x20\x6d\x65"
+	"\x2c\x20\x62\x75\x74\x20\x74\x68\x69\x73\x20\x6f\x6e\x65\x20\x69"
+	"\x73\x20\x6d\x69\x6e\x65\x2e\x0a\x49\x66\x20\x49\x20\x77\x32\x00"
+	"\xd1\x6e\x79\x20\x73\x68\x6f\x72\x74\x65\x72\x2c\x20\x74\x45\x00"
+	"\xf4\x0b\x77\x6f\x75\x6c\x64\x6e\x27\x74\x20\x62\x65\x20\x6d\x75"
+	"\x63\x68\x20\x73\x65\x6e\x73\x65\x20\x69\x6e\x0a\x7f\x00\x50\x69"
+	"\x6e\x67\x20\x6d\x12\x00\x00\x32\x00\xf0\x11\x20\x66\x69\x72\x73"
+	"\x74\x20\x70\x6c\x61\x63\x65\x2e\x20\x41\x74\x20\x6c\x65\x61\x73"
+	"\x74\x20\x77\x69\x74\x68\x20\x6c\x7a\x6f\x2c\x63\x00\xf5\x14\x77"
+	"\x61\x79\x2c\x0a\x77\x68\x69\x63\x68\x20\x61\x70\x70\x65\x61\x72"
+	"\x73\x20\x74\x6f\x20\x62\x65\x68\x61\x76\x65\x20\x70\x6f\x6f\x72"
+	"\x6c\x79\x4e\x00\x30\x61\x63\x65\xd7\x00\x01\x95\x00\x01\xdd\x00"
+	"\x20\x0a\x6d\xf2\x00\x5f\x67\x65\x73\x2e\x0a\x5e\x01\xff\xff\xff"
+	"\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff"
+	"\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff"
+	"\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff"
+	"\xff\xff\x74\x1f\x61\x01\x00\xff\x1a\x1f\x62\x02\x00\xff\x1a\x8f"
+	"\x63\x64\x65\x66\x67\x68\x69\x6a\x0a\x00\xff\x10\x0f\x34\x3a\xff"
+	"\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff"
+	"\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff"
+	"\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff"
+	"\xff\xff\xff\xff\xff\xce\x50\x67\x65\x73\x2e\x0a\x00\x00\x00\x00"
+	"\x1d\x4a\xa0\x25";
+static const unsigned long lz4_pattern_size = 420;
+
+#if CONFIG_IS_ENABLED(ZSTD)
+/* zstd -19 /tmp/plain.txt -o /tmp/plain.zst */
+static const char zstd_compressed[] =
+	"\x28\xb5\x2f\xfd\x64\x5e\x00\xad\x05\x00\x42\x4e\x26\x17\x90\x3b"
+	"\x07\x04\x5a\x13\x8b\xa7\x65\x34\x12\x21\x6d\xb0\x39\xbb\xae\xe8"
+	"\xba\xc9\xcd\x5e\x02\x49\xd0\x2b\xa9\xfa\x96\x92\xe7\x1f\x19\x19"
+	"\x7c\x8f\xf1\x9d\x54\x37\xfc\xd6\x0a\xf3\x0c\x93\x56\xc7\x52\x4f"
+	"\x0a\x62\x3e\xd1\xa5\x83\x17\x31\xab\x5d\x8f\x57\xf3\xcc\x3b\x58"
+	"\xf8\x91\x8c\xf1\x2a\x5c\x89\xdd\xf2\x9b\x15\xb7\x92\x5b\xbe\xba"
+	"\xab\xd5\xd1\x34\xdf\xf0\x02\x0e\x61\xcd\x7b\xd6\x01\xfc\xc2\xa7"
+	"\xd4\xd1\x3d\x26\x9c\x10\x49\xb8\x5b\xcd\xba\x7c\xf7\xac\x4b\xad"
+	"\xb7\x31\x1c\xbc\xf9\xcb\x62\x8e\x2e\x9b\x0f\xd3\x87\x57\x45\x12"
+	"\x16\xfa\x3a\x79\xde\x65\xf8\xcc\x48\xd5\x43\xa6\xbd\xc3\x91\x29"
+	"\x65\x29\xa7\x5b\x9a\x08\x08\x00\x60\x13\x00\x63\xa3\x8e\x28\x94"
+	"\x79\x41\x2a\x78\xc2\x91\x70\x9f\xaa\x6a\x21\x7a\xa1\xaa\x0c\xe4"
+	"\xf4\x6e\xfa";
+static const unsigned long zstd_compressed_size = 195;
+
+/*
+ * for i in $(seq 160); do cat /tmp/plain.txt; done > /tmp/big.txt
+ * zstd -19 /tmp/big.txt -o /tmp/big.zst
+ */
+static const char zstd_bench_frame[] =
+	"\x28\xb5\x2f\xfd\x64\xc0\xd9\xd5\x05\x00\x52\x4e\x26\x17\x80\x6d"
+	"\x0e\x00\x10\x12\x93\xa0\xe5\x3f\xd1\x9e\x20\xf2\xc4\x30\xe6\x6f"
+	"\x74\x95\x0d\xd7\x03\xc0\xa0\x5f\x50\xf5\x0c\x50\x9c\x8f\xa0\xb4"
+	"\x9e\x73\x8d\xff\xa0\xfa\x61\xb7\xd6\x87\x6f\x1a\xb4\x42\x52\x41"
+	"\x80\x20\x21\x24\xb8\x69\x59\x6d\x42\x5e\xc5\x2f\x2f\xe1\xe1\x08"
+	"\xae\xc6\xab\x2f\x15\x5f\xad\x5b\xfa\xcc\x4b\x4b\xa0\xa5\xaf\xed"
+	"\x6a\x85\x38\xcc\x3f\xbc\x41\x4b\x96\xe3\xa0\xb5\xf0\xbe\xcf\x29"
+	"\xf5\xdf\x21\x17\x56\x0a\x60\x78\x4b\x66\x4d\xbf\x39\x6b\xaa\xf5"
+	"\x3a\x87\x85\x33\x9f\xc9\x65\xa9\x21\xf3\x1f\xfa\xef\xca\x00\x86"
+	"\x8d\xbe\x56\x9c\x37\x0f\x7f\x1d\xa8\xfa\xd7\x30\x87\x58\x5a\x6a"
+	"\x49\x65\x34\x43\x17\x01\x09\x00\x5f\xd9\xb0\xd5\x0e\x36\x11\x30"
+	"\x36\xca\xa2\xa8\x57\x33\x42\x51\x60\x84\x91\x70\x1d\xa1\xb2\x20"
+	"\x7a\xa1\xaa\x0c\xc5\xfc\xb8\x38";
+static const unsigned long zstd_bench_frame_size = 200;
+
+/* Frames in the zstd benchmark, each 56000 bytes uncompressed */
+#define ZSTD_BENCH_FRAMES	64
+#endif
 
 #define TEST_BUFFER_SIZE	512
 
@@ -294,6 +376,42 @@ static int uncompress_using_lz4(struct unit_test_state *uts,
 	return (ret != 0);
 }
 
+#if CONFIG_IS_ENABLED(ZSTD)
+static int compress_using_zstd(struct unit_test_state *uts,
+			       void *in, unsigned long in_size,
+			       void *out, unsigned long out_max,
+			       unsigned long *out_size)
+{
+	/* There is no zstd compression in u-boot, so fake it. */
+	ut_asserteq(in_size, strlen(plain));
+	ut_asserteq(0, memcmp(plain, in, in_size));
+
+	if (zstd_compressed_size > out_max)
+		return -1;
+
+	memcpy(out, zstd_compressed, zstd_compressed_size);
+	if (out_size)
+		*out_size = zstd_compressed_size;
+
+	return 0;
+}
+
+static int uncompress_using_zstd(struct unit_test_state *uts,
+				 void *in, unsigned long in_size,
+				 void *out, unsigned long out_max,
+				 unsigned long *out_size)
+{
+	size_t output_size = out_max;
+	int ret;
+
+	ret = zstd_decompress(out, &output_size, in, in_size);
+	if (out_size)
+		*out_size = output_size;
+
+	return ret;
+}
+#endif
+
 #define errcheck(statement) if (!(statement)) { \
 	fprintf(stderr, "\tFailed: %s\n", #statement); \
 	ret = 1; \
@@ -426,6 +544,48 @@ static int compression_test_lzma(struct unit_test_state *uts)
 }
 COMPRESSION_TEST(compression_test_lzma, 0);
 
+/* Decompress LZMA data fed in pieces, with enough room and with too little */
+static int compression_test_lzma_stream(struct unit_test_state *uts)
+{
+	const ulong plain_size = strlen(plain);
+	struct lzma_stream ls;
+	SizeT out_size, pos, piece;
+	char *out;
+
+	out = malloc(plain_size + 1);
+	ut_assertnonnull(out);
+
+	/* Feed pieces of every size from 1 byte up */
+	memset(out, 'A', plain_size + 1);
+	lzma_stream_init(&ls, out, plain_size);
+	for (pos = 0, piece = 1; pos < lzma_compressed_size;
+	     pos += piece, piece++) {
+		piece = min(piece, lzma_compressed_size - pos);
+		ut_assertok(lzma_stream_feed(&ls, lzma_compressed + pos,
+					     piece));
+	}
+	ut_assertok(lzma_stream_finish(&ls, &out_size));
+	ut_asserteq(plain_size, out_size);
+	ut_asserteq_mem(plain, out, plain_size);
+	ut_asserteq('A', out[plain_size]);
+
+	lzma_stream_init(&ls, out, plain_size - 1);
+	ut_asserteq(-ENOSPC, lzma_stream_feed(&ls, lzma_compressed,
+					      lzma_compressed_size));
+	ut_asserteq(-EINVAL, lzma_stream_finish(&ls, &out_size));
+
+	/* Stopping part way through is an error */
+	lzma_stream_init(&ls, out, plain_size);
+	ut_assertok(lzma_stream_feed(&ls, lzma_compressed,
+				     lzma_compressed_size / 2));
+	ut_asserteq(-EINVAL, lzma_stream_finish(&ls, &out_size));
+
+	free(out);
+
+	return 0;
+}
+COMPRESSION_TEST(compression_test_lzma_stream, 0);
+
 static int compression_test_lzo(struct unit_test_state *uts)
 {
 	return run_test(uts, "lzo", compress_using_lzo, uncompress_using_lzo);
@@ -438,6 +598,161 @@ static int compression_test_lz4(struct unit_test_state *uts)
 }
 COMPRESSION_TEST(compression_test_lz4, 0);
 
+/* Check the fast loop and the careful tail of the LZ4 decoder agree */
+static int compression_test_lz4_pattern(struct unit_test_state *uts)
+{
+	const ulong len = strlen(plain);
+	const ulong size = len * 80 + 900;
+	size_t out_size;
+	char *expect, *out, *p;
+	int i;
+
+	expect = malloc(size);
+	out = malloc(size);
+	ut_assertnonnull(expect);
+	ut_assertnonnull(out);
+	p = expect;
+	for (i = 0; i < 40; i++, p += len)
+		memcpy(p, plain, len);
+	memset(p, 'a', 300);
+	p += 300;
+	for (i = 0; i < 150; i++, p += 2)
+		memcpy(p, "ab", 2);
+	for (i = 0; i < 30; i++, p += 10)
+		memcpy(p, "abcdefghij", 10);
+	for (i = 0; i < 40; i++, p += len)
+		memcpy(p, plain, len);
+
+	out_size = size;
+	ut_assertok(ulz4fn(lz4_pattern, lz4_pattern_size, out, &out_size));
+	ut_asserteq(size, out_size);
+	ut_asserteq_mem(expect, out, size);
+
+	/* one byte short must fail without writing past the end */
+	out[size - 1] = 0x55;
+	out_size = size - 1;
+	ut_assert(ulz4fn(lz4_pattern, lz4_pattern_size, out, &out_size) < 0);
+	ut_asserteq(0x55, out[size - 1]);
+
+	free(out);
+	free(expect);
+
+	return 0;
+}
+COMPRESSION_TEST(compression_test_lz4_pattern, 0);
+
+#if CONFIG_IS_ENABLED(ZSTD)
+static int compression_test_zstd(struct unit_test_state *uts)
+{
+	return run_test(uts, "zstd", compress_using_zstd,
+			uncompress_using_zstd);
+}
+COMPRESSION_TEST(compression_test_zstd, 0);
+
+/* A skippable frame with four bytes of data */
+static const char zstd_skippable[] =
+	"\x50\x2a\x4d\x18\x04\x00\x00\x00\xde\xad\xbe\xef";
+
+/* Two frames with a skippable frame between them, in one go and in pieces */
+static int compression_test_zstd_frames(struct unit_test_state *uts)
+{
+	const ulong plain_size = strlen(plain);
+	const ulong skip_size = sizeof(zstd_skippable) - 1;
+	ulong in_size = zstd_compressed_size * 2 + skip_size;
+	struct zstd_stream zs;
+	size_t out_size, pos, piece;
+	char *in, *out;
+
+	in = malloc(in_size);
+	out = malloc(plain_size * 2 + 1);
+	ut_assertnonnull(in);
+	ut_assertnonnull(out);
+	memcpy(in, zstd_compressed, zstd_compressed_size);
+	memcpy(in + zstd_compressed_size, zstd_skippable, skip_size);
+	memcpy(in + zstd_compressed_size + skip_size, zstd_compressed,
+	       zstd_compressed_size);
+
+	out_size = plain_size * 2;
+	ut_assertok(zstd_decompress(out, &out_size, in, in_size));
+	ut_asserteq(plain_size * 2, out_size);
+	ut_asserteq_mem(plain, out, plain_size);
+	ut_asserteq_mem(plain, out + plain_size, plain_size);
+
+	out_size = plain_size * 2 - 1;
+	ut_asserteq(-ENOSPC, zstd_decompress(out, &out_size, in, in_size));
+
+	/* Feed pieces of every size from 1 byte up */
+	memset(out, 'A', plain_size * 2 + 1);
+	ut_assertok(zstd_stream_init(&zs, out, plain_size * 2));
+	for (pos = 0, piece = 1; pos < in_size; pos += piece, piece++) {
+		piece = min(piece, in_size - pos);
+		ut_assertok(zstd_stream_feed(&zs, in + pos, piece));
+	}
+	ut_assertok(zstd_stream_finish(&zs, &out_size));
+	ut_asserteq(plain_size * 2, out_size);
+	ut_asserteq_mem(plain, out, plain_size);
+	ut_asserteq_mem(plain, out + plain_size, plain_size);
+	ut_asserteq('A', out[plain_size * 2]);
+
+	/* Stopping part way through a frame is an error */
+	ut_assertok(zstd_stream_init(&zs, out, plain_size * 2));
+	ut_assertok(zstd_stream_feed(&zs, in, in_size - 1));
+	ut_asserteq(-EINVAL, zstd_stream_finish(&zs, &out_size));
+
+	free(out);
+	free(in);
+
+	return 0;
+}
+COMPRESSION_TEST(compression_test_zstd_frames, 0);
+
+/*
+ * Time a multi-frame image, split by frame and as one stream. This uses many
+ * copies of one frame, since real kernel images are too large to carry here.
+ */
+static int compression_test_zstd_bench(struct unit_test_state *uts)
+{
+	const ulong in_size = zstd_bench_frame_size * ZSTD_BENCH_FRAMES;
+	const ulong size = 56000 * ZSTD_BENCH_FRAMES;
+	ulong start, frames_us, stream_us;
+	struct zstd_stream zs;
+	size_t out_size;
+	char *in, *out;
+	int i;
+
+	in = malloc(in_size);
+	out = malloc(size);
+	ut_assertnonnull(in);
+	ut_assertnonnull(out);
+	for (i = 0; i < ZSTD_BENCH_FRAMES; i++)
+		memcpy(in + i * zstd_bench_frame_size, zstd_bench_frame,
+		       zstd_bench_frame_size);
+
+	start = timer_get_us();
+	out_size = size;
+	ut_assertok(zstd_decompress(out, &out_size, in, in_size));
+	frames_us = timer_get_us() - start;
+	ut_asserteq(size, out_size);
+	for (i = 0; i < size; i += strlen(plain))
+		ut_asserteq_mem(plain, out + i, strlen(plain));
+
+	start = timer_get_us();
+	ut_assertok(zstd_stream_init(&zs, out, size));
+	ut_assertok(zstd_stream_feed(&zs, in, in_size));
+	ut_assertok(zstd_stream_finish(&zs, &out_size));
+	stream_us = timer_get_us() - start;
+	ut_asserteq(size, out_size);
+
+	printf("zstd: %lu bytes in %lu us by frame, %lu us as a stream\n",
+	       size, frames_us, stream_us);
+	free(out);
+	free(in);
+
+	return 0;
+}
+COMPRESSION_TEST(compression_test_zstd_bench, 0);
+#endif
+
 static int compress_using_none(struct unit_test_state *uts,
 			       void *in, unsigned long in_size,
 			       void *out, unsigned long out_max,
@@ -528,6 +843,14 @@ static int compression_test_bootm_lz4(struct unit_test_state *uts)
 }
 COMPRESSION_TEST(compression_test_bootm_lz4, 0);
 
+#if CONFIG_IS_ENABLED(ZSTD)
+static int compression_test_bootm_zstd(struct unit_test_state *uts)
+{
+	return run_bootm_test(uts, IH_COMP_ZSTD, compress_using_zstd);
+}
+COMPRESSION_TEST(compression_test_bootm_zstd, 0);
+#endif
+
 static int compression_test_bootm_none(struct unit_test_state *uts)
 {
 	return run_bootm_test(uts, IH_COMP_NONE, compress_using_none);
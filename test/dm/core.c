@@ -11,6 +11,7 @@
 #include <fdtdec.h>
 #include <malloc.h>
 #include <dm/device-internal.h>
+#include <dm/lists.h>
 #include <dm/root.h>
 #include <dm/util.h>
 #include <dm/test.h>
@@ -904,3 +905,195 @@ static int dm_test_inactive_child(struct unit_test_state *uts)
 	return 0;
 }
 DM_TEST(dm_test_inactive_child, DM_TESTF_SCAN_PDATA);
+
+/* Check that looking up drivers finds the first match in the linker list */
+static int dm_test_lists_lookup(struct unit_test_state *uts)
+{
+	struct driver *driver = ll_entry_start(struct driver, driver);
+	const int n_ents = ll_entry_count(struct driver, driver);
+	const struct udevice_id *of_id, *found_id, *id;
+	struct driver *drv, *first;
+
+	for (drv = driver; drv != driver + n_ents; drv++) {
+		for (first = driver; strcmp(first->name, drv->name); first++)
+			;
+		ut_asserteq_ptr(first, lists_driver_lookup_name(drv->name));
+
+		for (of_id = drv->of_match; of_id && of_id->compatible;
+		     of_id++) {
+			for (first = driver; first <= drv; first++) {
+				for (id = first->of_match;
+				     id && id->compatible &&
+				     strcmp(id->compatible, of_id->compatible);
+				     id++)
+					;
+				if (id && id->compatible)
+					break;
+			}
+			ut_asserteq_ptr(first, lists_driver_lookup_compatible(
+					of_id->compatible, &found_id));
+			ut_asserteq_ptr(id, found_id);
+		}
+	}
+	ut_assertnull(lists_driver_lookup_name("no-such-driver"));
+	ut_assertnull(lists_driver_lookup_compatible("denx,no-such-device",
+						     &found_id));
+
+	return 0;
+}
+DM_TEST(dm_test_lists_lookup, 0);
+
+#if CONFIG_IS_ENABLED(DM_LAZY_BIND)
+/* Check that nodes are only bound when their uclass or node is looked up */
+static int dm_test_lazy_bind(struct unit_test_state *uts)
+{
+	struct udevice *root = dm_root(), *bus, *dev;
+	uint deferred, bound;
+	struct uclass *uc;
+	ofnode node;
+	int count;
+
+	ut_assertok(dm_lazy_init());
+	ut_assertok(dm_scan_fdt(gd->fdt_blob, false));
+	dm_lazy_stats(&deferred, &bound);
+	ut_assert(deferred > 0);
+	ut_asserteq(0, bound);
+	ut_asserteq(-ENODEV, device_find_child_by_name(root, "some-bus",
+						       &bus));
+	ut_asserteq(-ENODEV, device_find_child_by_name(root, "a-test", &dev));
+
+	/* Only the bus is bound */
+	ut_assertok(uclass_get(UCLASS_TEST_BUS, &uc));
+	ut_assertok(device_find_child_by_name(root, "some-bus", &bus));
+	ut_asserteq(-ENODEV, device_find_child_by_name(root, "a-test", &dev));
+
+	/* Looking up a node binds it */
+	ut_assertok(device_find_global_by_ofnode(ofnode_path("/a-test"),
+						 &dev));
+	ut_asserteq_str("a-test", dev->name);
+	ut_asserteq_ptr(root, dev->parent);
+
+	/* A node bound some other way is not bound again on demand */
+	node = ofnode_path("/b-test");
+	ut_assertok(lists_bind_fdt(root, node, &dev, false));
+	ut_asserteq_str("b-test", dev->name);
+
+	/* Looking up the uclass binds the rest of its top-level devices */
+	ut_assertok(uclass_get(UCLASS_TEST_FDT, &uc));
+	ut_assertok(device_find_child_by_name(root, "d-test", &dev));
+	count = 0;
+	uclass_foreach_dev(dev, uc) {
+		if (ofnode_equal(dev_ofnode(dev), node))
+			count++;
+	}
+	ut_asserteq(1, count);
+
+	/* The bus scans its subnodes when probed, and they are bound at once */
+	ut_asserteq(-ENODEV, device_find_child_by_name(bus, "c-test@5",
+						       &dev));
+	ut_assertok(device_probe(bus));
+	ut_assertok(device_find_child_by_name(bus, "c-test@5", &dev));
+
+	dm_lazy_bind_all();
+	dm_lazy_stats(&deferred, &bound);
+	ut_asserteq(deferred, bound);
+
+	return 0;
+}
+DM_TEST(dm_test_lazy_bind, 0);
+#endif
+
+#if CONFIG_IS_ENABLED(DM_UCLASS_INDEX)
+#define INDEX_TEST_DEVS		1000
+
+/* Check that each device is found by its sequence number, node and phandle */
+static int dm_test_index_lookup(struct unit_test_state *uts,
+				struct udevice **devs, int count)
+{
+	struct udevice *dev;
+	int i;
+
+	for (i = 0; i < count; i++) {
+		if (devs[i]->seq != -1) {
+			ut_assertok(uclass_find_device_by_seq(UCLASS_TEST,
+							      devs[i]->seq,
+							      false, &dev));
+			ut_asserteq_ptr(devs[i], dev);
+		}
+		if (dev_of_valid(devs[i])) {
+			ut_assertok(uclass_find_device_by_ofnode(UCLASS_TEST,
+					dev_ofnode(devs[i]), &dev));
+			ut_asserteq_ptr(devs[i], dev);
+		}
+		/* Each node's "phandle" property refers back to the node */
+		if (dev_read_phandle(devs[i]) > 0) {
+			ut_assertok(uclass_find_device_by_phandle(UCLASS_TEST,
+					devs[i], "phandle", &dev));
+			ut_asserteq_ptr(devs[i], dev);
+		}
+	}
+	ut_asserteq(-ENODEV, uclass_find_device_by_seq(UCLASS_TEST, DM_MAX_SEQ,
+						       false, &dev));
+
+	return 0;
+}
+
+/* Check the uclass lookup tables and time them against searching the list */
+static int dm_test_uclass_index(struct unit_test_state *uts)
+{
+	struct udevice **devs, *dev;
+	ulong start, indexed, listed;
+	struct hlist_head *index;
+	struct uclass *uc;
+	ofnode node;
+	int i, seq, ret;
+
+	/* Bind a device to each top-level node, then probe the rest */
+	devs = calloc(INDEX_TEST_DEVS, sizeof(*devs));
+	ut_assertnonnull(devs);
+	node = ofnode_first_subnode(ofnode_path("/"));
+	for (i = 0; i < INDEX_TEST_DEVS; i++) {
+		ut_assertok(device_bind_ofnode(dm_root(),
+					       DM_GET_DRIVER(test_drv),
+					       "index-test", NULL, node,
+					       &devs[i]));
+		if (ofnode_valid(node))
+			node = ofnode_next_subnode(node);
+		else
+			ut_assertok(device_probe(devs[i]));
+	}
+	ut_assertok(uclass_get(UCLASS_TEST, &uc));
+	ut_assertnonnull(uc->index);
+
+	start = timer_get_us();
+	ut_assertok(dm_test_index_lookup(uts, devs, INDEX_TEST_DEVS));
+	indexed = timer_get_us() - start;
+
+	/* Without the tables the list is searched, with the same results */
+	index = uc->index;
+	uc->index = NULL;
+	start = timer_get_us();
+	ret = dm_test_index_lookup(uts, devs, INDEX_TEST_DEVS);
+	listed = timer_get_us() - start;
+	uc->index = index;
+	ut_assertok(ret);
+	printf("%d devices: lookups took %lu us with the index, %lu us without\n",
+	       INDEX_TEST_DEVS, indexed, listed);
+
+	/* Removed and unbound devices drop out of the tables */
+	seq = devs[INDEX_TEST_DEVS - 1]->seq;
+	ut_assertok(device_remove(devs[INDEX_TEST_DEVS - 1], DM_REMOVE_NORMAL));
+	ut_asserteq(-ENODEV, uclass_find_device_by_seq(UCLASS_TEST, seq, false,
+						       &dev));
+	for (i = 0; i < INDEX_TEST_DEVS; i += 2) {
+		ut_assertok(device_remove(devs[i], DM_REMOVE_NORMAL));
+		ut_assertok(device_unbind(devs[i]));
+		devs[i / 2] = devs[i + 1];
+	}
+	ut_assertok(dm_test_index_lookup(uts, devs, INDEX_TEST_DEVS / 2));
+	free(devs);
+
+	return 0;
+}
+DM_TEST(dm_test_uclass_index, 0);
+#endif
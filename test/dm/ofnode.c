@@ -2,6 +2,10 @@
 
 #include <common.h>
 #include <dm.h>
+#include <hexdump.h>
+#include <malloc.h>
+#include <of_live.h>
+#include <u-boot/crc.h>
 #include <dm/of_extra.h>
 #include <dm/test.h>
 #include <test/ut.h>
@@ -113,3 +117,195 @@ static int dm_test_ofnode_read_chosen(struct unit_test_state *uts)
 	return 0;
 }
 DM_TEST(dm_test_ofnode_read_chosen, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
+
+#if CONFIG_IS_ENABLED(OF_LIVE_IMAGE)
+/* Check a live tree against the flat tree it was made from */
+static int check_live_image_node(struct unit_test_state *uts, const void *fdt,
+				 int offset, const struct device_node *np)
+{
+	const struct device_node *child;
+	const struct property *pp;
+	const char *name;
+	const void *val;
+	int len;
+
+	ut_asserteq(fdt_get_phandle(fdt, offset), np->phandle);
+	for (pp = np->properties; pp; pp = pp->next) {
+		val = fdt_getprop(fdt, offset, pp->name, &len);
+		/* "name" is made up if the flat tree does not have it */
+		if (!val && !strcmp("name", pp->name))
+			continue;
+		ut_assertnonnull(val);
+		ut_asserteq(len, pp->length);
+		ut_asserteq_mem(val, pp->value, len);
+	}
+
+	child = np->child;
+	fdt_for_each_subnode(offset, fdt, offset) {
+		ut_assertnonnull(child);
+		ut_asserteq_ptr(np, child->parent);
+		name = fdt_get_name(fdt, offset, NULL);
+		ut_asserteq_str(name, strrchr(child->full_name, '/') + 1);
+		ut_assertok(check_live_image_node(uts, fdt, offset, child));
+		child = child->sibling;
+	}
+	ut_assertnull(child);
+
+	return 0;
+}
+
+/*
+ * Change the pointer at offset @field in the tree of @image to @val, which is
+ * an offset in the tree, and check that the image is rejected although its
+ * CRC is correct
+ */
+static int check_live_image_ptr(struct unit_test_state *uts, const void *fdt,
+				struct of_live_image *hdr, ulong field,
+				ulong val)
+{
+	struct device_node *root;
+	void *tree = hdr + 1;
+	ulong *ptr = tree + field;
+	ulong old = *ptr;
+
+	*ptr = val << OF_LIVE_PTR_SHIFT | OF_LIVE_PTR_TREE;
+	hdr->crc = crc32(0, tree, hdr->size);
+	ut_asserteq(-EINVAL, of_live_image_load(fdt, hdr, &root));
+	*ptr = old;
+	hdr->crc = crc32(0, tree, hdr->size);
+
+	return 0;
+}
+
+static int dm_test_ofnode_live_image(struct unit_test_state *uts)
+{
+	const void *fdt = gd->fdt_blob;
+	struct device_node *root;
+	struct of_live_image *hdr;
+	ulong size = 0, child;
+	void *image, *tree;
+	char *copy;
+
+	ut_asserteq(-ENOSPC, of_live_image_make(fdt, NULL, &size));
+	image = malloc(size);
+	ut_assertnonnull(image);
+	ut_assertok(of_live_image_make(fdt, image, &size));
+
+	ut_assertok(of_live_image_load(fdt, image, &root));
+	ut_asserteq_str("", root->name);
+	ut_assertnull(root->parent);
+	ut_assertok(check_live_image_node(uts, fdt, 0, root));
+	free(root);
+
+	/* The image cannot be used with another flat tree */
+	copy = malloc(fdt_totalsize(fdt));
+	ut_assertnonnull(copy);
+	memcpy(copy, fdt, fdt_totalsize(fdt));
+	copy[fdt_off_dt_struct(copy) + 4] ^= 1;
+	ut_asserteq(-ESTALE, of_live_image_load(copy, image, &root));
+	free(copy);
+
+	/*
+	 * Nor can an image whose pointers form a loop or lead outside it,
+	 * even with a good CRC. The root node comes first in the tree.
+	 */
+	hdr = image;
+	tree = hdr + 1;
+	child = *(ulong *)(tree + offsetof(struct device_node, child)) >>
+		OF_LIVE_PTR_SHIFT;
+	ut_assertok(check_live_image_ptr(uts, fdt, hdr,
+			child + offsetof(struct device_node, sibling), child));
+	ut_assertok(check_live_image_ptr(uts, fdt, hdr,
+			child + offsetof(struct device_node, sibling), 0));
+	ut_assertok(check_live_image_ptr(uts, fdt, hdr,
+			child + offsetof(struct device_node, parent), child));
+	ut_assertok(check_live_image_ptr(uts, fdt, hdr,
+			offsetof(struct device_node, properties), child + 1));
+	ut_assertok(check_live_image_ptr(uts, fdt, hdr,
+			offsetof(struct device_node, child), hdr->size - 8));
+	ut_assertok(of_live_image_load(fdt, image, &root));
+	free(root);
+
+	/* Nor can a damaged image */
+	((char *)image)[size - 1] ^= 1;
+	ut_asserteq(-EINVAL, of_live_image_load(fdt, image, &root));
+	free(image);
+
+	return 0;
+}
+DM_TEST(dm_test_ofnode_live_image, 0);
+#endif
+
+#if CONFIG_IS_ENABLED(OF_LOOKUP_CACHE)
+/* Check cached lookups in the control FDT against libfdt */
+static int check_fdt_lookups(struct unit_test_state *uts)
+{
+	static const char *const paths[] = {
+		"/", "/aliases", "/chosen", "/some-bus/c-test@5", "eth0",
+		"mmc0", "/no-such-node", "no-such-alias",
+	};
+	const void *fdt = gd->fdt_blob;
+	int offset, phandle, found, i, pass;
+
+	/* The second pass uses the cached results */
+	for (pass = 0; pass < 2; pass++) {
+		for (offset = fdt_next_node(fdt, -1, NULL); offset >= 0;
+		     offset = fdt_next_node(fdt, offset, NULL)) {
+			phandle = fdt_get_phandle(fdt, offset);
+			if (!phandle)
+				continue;
+			found = fdt_node_offset_by_phandle(fdt, phandle);
+			ut_asserteq(found,
+				    fdtdec_node_offset_by_phandle(fdt, phandle));
+		}
+		for (i = 0; i < ARRAY_SIZE(paths); i++)
+			ut_asserteq(fdt_path_offset(fdt, paths[i]),
+				    fdtdec_path_offset(fdt, paths[i]));
+	}
+	ut_asserteq(-FDT_ERR_NOTFOUND,
+		    fdtdec_node_offset_by_phandle(fdt, 0x7ffffff0));
+
+	return 0;
+}
+
+static int dm_test_ofnode_lookup_cache(struct unit_test_state *uts)
+{
+	const void *fdt = gd->fdt_blob;
+	int size = fdt_totalsize(fdt) + 256;
+	int offset, phandle;
+	void *copy;
+
+	ut_assertok(check_fdt_lookups(uts));
+
+	/* Use a copy which can be changed */
+	copy = malloc(size);
+	ut_assertnonnull(copy);
+	ut_assertok(fdt_open_into(fdt, copy, size));
+	gd->fdt_blob = copy;
+	ut_assertok(check_fdt_lookups(uts));
+
+	/* Adding a node moves the ones after it */
+	ut_assert(fdt_add_subnode(copy, 0, "lookup-test") >= 0);
+	ut_assertok(check_fdt_lookups(uts));
+
+	/* Changing a phandle in place leaves the tree the same size */
+	offset = fdt_path_offset(copy, "eth3");
+	ut_assert(offset >= 0);
+	phandle = fdt_get_phandle(copy, offset);
+	ut_assert(phandle > 0);
+	ut_asserteq(offset, fdtdec_node_offset_by_phandle(copy, phandle));
+	ut_assertok(fdt_setprop_inplace_u32(copy, offset, "phandle",
+					    0x12345678));
+	ut_asserteq(-FDT_ERR_NOTFOUND,
+		    fdtdec_node_offset_by_phandle(copy, phandle));
+	ut_asserteq(offset, fdtdec_node_offset_by_phandle(copy, 0x12345678));
+	ut_assertok(check_fdt_lookups(uts));
+
+	gd->fdt_blob = fdt;
+	free(copy);
+	ut_assertok(check_fdt_lookups(uts));
+
+	return 0;
+}
+DM_TEST(dm_test_ofnode_lookup_cache, 0);
+#endif
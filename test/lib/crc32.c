@@ -0,0 +1,110 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Tests for the CRC32 implementation
+ */
+
+#include <common.h>
+#include <malloc.h>
+#include <u-boot/crc.h>
+#include <test/lib.h>
+#include <test/test.h>
+#include <test/ut.h>
+
+#define CRC32_TEST_SIZE		512
+#define CRC32_BENCH_SIZE	(1 << 20)
+#define CRC32_BENCH_LOOPS	16
+
+/* Bit at a time reference implementation of crc32_no_comp() */
+static u32 crc32_ref(u32 crc, const u8 *p, uint len)
+{
+	int i;
+
+	while (len--) {
+		crc ^= *p++;
+		for (i = 0; i < 8; i++)
+			crc = (crc >> 1) ^ (crc & 1 ? 0xedb88320 : 0);
+	}
+
+	return crc;
+}
+
+static void crc32_test_fill(u8 *buf, uint len)
+{
+	u32 x = 0x12345678;
+
+	while (len--) {
+		x = x * 1103515245 + 12345;
+		*buf++ = x >> 24;
+	}
+}
+
+/* Check well-known CRC values */
+static int lib_test_crc32_known(struct unit_test_state *uts)
+{
+	const char *fox = "The quick brown fox jumps over the lazy dog";
+
+	ut_asserteq(0, crc32(0, NULL, 0));
+	ut_asserteq(0xcbf43926, crc32(0, (u8 *)"123456789", 9));
+	ut_asserteq(0x414fa339, crc32(0, (u8 *)fox, strlen(fox)));
+	ut_asserteq(0x2dfd2d88, crc32_no_comp(0, (u8 *)"123456789", 9));
+	ut_asserteq(0x340bc6d9,
+		    crc32_no_comp(0xffffffff, (u8 *)"123456789", 9));
+
+	return 0;
+}
+
+LIB_TEST(lib_test_crc32_known, 0);
+
+/* Compare against the reference for all alignments and short lengths */
+static int lib_test_crc32_align(struct unit_test_state *uts)
+{
+	u8 buf[CRC32_TEST_SIZE + 8];
+	uint offset, len, split;
+	u32 crc;
+
+	crc32_test_fill(buf, sizeof(buf));
+	for (offset = 0; offset < 8; offset++) {
+		for (len = 0; len <= CRC32_TEST_SIZE; len++) {
+			crc = crc32_no_comp(0xffffffff, buf + offset, len);
+			ut_asserteq(crc32_ref(0xffffffff, buf + offset, len),
+				    crc);
+		}
+	}
+
+	/* a CRC computed in pieces must match the CRC of the whole */
+	crc = crc32(0, buf, CRC32_TEST_SIZE);
+	for (split = 0; split <= CRC32_TEST_SIZE; split++)
+		ut_asserteq(crc, crc32(crc32(0, buf, split), buf + split,
+				       CRC32_TEST_SIZE - split));
+	ut_asserteq(crc, crc32_wd(0, buf, CRC32_TEST_SIZE, 37));
+
+	return 0;
+}
+
+LIB_TEST(lib_test_crc32_align, 0);
+
+/* Check a large buffer and print the throughput */
+static int lib_test_crc32_speed(struct unit_test_state *uts)
+{
+	ulong start, us;
+	u32 crc = 0;
+	u8 *buf;
+	int i;
+
+	buf = malloc(CRC32_BENCH_SIZE);
+	ut_assertnonnull(buf);
+	crc32_test_fill(buf, CRC32_BENCH_SIZE);
+	ut_asserteq(crc32_ref(0, buf, CRC32_BENCH_SIZE),
+		    crc32_no_comp(0, buf, CRC32_BENCH_SIZE));
+
+	start = timer_get_us();
+	for (i = 0; i < CRC32_BENCH_LOOPS; i++)
+		crc = crc32(crc, buf, CRC32_BENCH_SIZE);
+	us = timer_get_us() - start;
+	printf("crc32: %u MiB in %lu us\n", CRC32_BENCH_LOOPS, us);
+	free(buf);
+
+	return 0;
+}
+
+LIB_TEST(lib_test_crc32_speed, 0);
@@ -656,3 +656,90 @@ static int lib_test_lmb_get_free_size(struct unit_test_state *uts)
 
 DM_TEST(lib_test_lmb_get_free_size,
 	DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
+
+/*
+ * Fill the reserved regions up to the configured limit, always inserting in
+ * the middle of the table, then look them all up, allocate from the gaps and
+ * free everything. The time taken by each phase is printed as a benchmark.
+ */
+static int lib_test_lmb_many_regions(struct unit_test_state *uts)
+{
+	const unsigned long count = CONFIG_LMB_RESERVED_REGIONS;
+	const phys_size_t page = 0x1000;
+	const phys_addr_t ram = 0x40000000;
+	const phys_size_t ram_size = (2 * count + 4) * page;
+	ulong start, reserve_us, lookup_us, free_us;
+	struct lmb *lmb;
+	unsigned long i, n;
+	phys_addr_t a;
+	long ret;
+
+	/* struct lmb may be too large for the stack */
+	lmb = malloc(sizeof(*lmb));
+	ut_assertnonnull(lmb);
+	lmb_init(lmb);
+
+	ret = lmb_add(lmb, ram, ram_size);
+	ut_asserteq(ret, 0);
+
+	/* reserve every other page, working from both ends to the middle */
+	start = timer_get_us();
+	for (i = 0; i < count; i++) {
+		n = (i & 1) ? count - 1 - i / 2 : i / 2;
+		ret = lmb_reserve(lmb, ram + 2 * n * page, page);
+		ut_asserteq(ret, 0);
+	}
+	reserve_us = timer_get_us() - start;
+	ut_asserteq(lmb->reserved.cnt, count);
+	ut_asserteq(lmb->reserved.region[0].base, ram);
+	ut_asserteq(lmb->reserved.region[count - 1].base,
+		    ram + 2 * (count - 1) * page);
+
+	/* the table is full, but coalescing still works */
+	ret = lmb_reserve(lmb, ram + (2 * count + 1) * page, page);
+	ut_asserteq(ret, -1);
+	ret = lmb_reserve(lmb, ram + page, page);
+	ut_asserteq(ret, 2);
+	ut_asserteq(lmb->reserved.cnt, count - 1);
+	ret = lmb_free(lmb, ram + page, page);
+	ut_asserteq(ret, 0);
+	ut_asserteq(lmb->reserved.cnt, count);
+
+	start = timer_get_us();
+	for (n = 0; n < count; n++) {
+		ut_asserteq(lmb_is_reserved(lmb, ram + 2 * n * page), 1);
+		ut_asserteq(lmb_is_reserved(lmb, ram + (2 * n + 1) * page), 0);
+		if (n < count - 1)
+			ut_asserteq(lmb_get_free_size(lmb,
+						      ram + (2 * n + 1) * page),
+				    page);
+	}
+	lookup_us = timer_get_us() - start;
+	ut_asserteq(lmb_get_free_size(lmb, ram + (2 * count - 1) * page),
+		    5 * page);
+
+	/* allocating needs a free entry, then goes to the top of RAM */
+	a = lmb_alloc(lmb, page, page);
+	ut_asserteq(a, 0);
+	ret = lmb_free(lmb, ram, page);
+	ut_asserteq(ret, 0);
+	a = lmb_alloc(lmb, page, page);
+	ut_asserteq(a, ram + ram_size - page);
+	ut_asserteq(lmb->reserved.cnt, count);
+
+	start = timer_get_us();
+	for (n = 1; n < count; n++) {
+		ret = lmb_free(lmb, ram + 2 * n * page, page);
+		ut_asserteq(ret, 0);
+	}
+	free_us = timer_get_us() - start;
+	ASSERT_LMB(lmb, ram, ram_size, 1, a, page, 0, 0, 0, 0);
+
+	printf("%lu regions: reserve %lu us, lookup %lu us, free %lu us\n",
+	       count, reserve_us, lookup_us, free_us);
+	free(lmb);
+
+	return 0;
+}
+
+DM_TEST(lib_test_lmb_many_regions, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
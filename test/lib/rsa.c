@@ -0,0 +1,262 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Tests for software RSA modular exponentiation
+ *
+ * The modulus is a random odd number rather than a real key, which is all
+ * that Montgomery multiplication needs.
+ */
+
+#include <common.h>
+#include <hexdump.h>
+#include <u-boot/rsa.h>
+#include <u-boot/rsa-mod-exp.h>
+#include <test/lib.h>
+#include <test/test.h>
+#include <test/ut.h>
+
+#define RSA_TEST_BITS	2048
+#define RSA_TEST_BYTES	(RSA_TEST_BITS / 8)
+#define RSA_TEST_EXP	0xfedcba9876543211ULL
+
+static const u8 rsa_test_modulus[RSA_TEST_BYTES] = {
+	0xf3, 0x11, 0x0f, 0x9f, 0xc3, 0xac, 0x41, 0x7e,
+	0x4d, 0x25, 0x3a, 0x32, 0x12, 0x9c, 0xf7, 0x24,
+	0x60, 0x61, 0x29, 0xb2, 0xa0, 0x2b, 0xe6, 0x00,
+	0x04, 0x21, 0x8b, 0xf6, 0x51, 0x47, 0xe0, 0x54,
+	0x6d, 0x15, 0x67, 0x33, 0x32, 0x93, 0x31, 0xdf,
+	0xe1, 0x5c, 0xdd, 0xbf, 0x91, 0x70, 0xcb, 0x1a,
+	0x4c, 0x6d, 0x6a, 0xa9, 0x08, 0xa8, 0x07, 0x26,
+	0xa8, 0xe0, 0xef, 0x2e, 0xc5, 0xe8, 0x69, 0x24,
+	0xd3, 0x9b, 0x3e, 0x7f, 0xdc, 0x51, 0x45, 0x57,
+	0xf9, 0xf0, 0x92, 0x59, 0x9b, 0xbd, 0xe9, 0x10,
+	0x44, 0x6f, 0x1a, 0xd3, 0x3e, 0x30, 0x84, 0x67,
+	0x8f, 0xd2, 0xf8, 0x56, 0xa0, 0xf9, 0xa1, 0xc0,
+	0xba, 0xf6, 0x92, 0xa0, 0x14, 0xfb, 0xda, 0xf5,
+	0x50, 0x95, 0xaa, 0xda, 0xb5, 0xf9, 0x0c, 0x31,
+	0xec, 0xad, 0xf3, 0xee, 0x73, 0xf4, 0x33, 0x94,
+	0x7e, 0xfc, 0x1d, 0xcd, 0x2b, 0x24, 0xab, 0x90,
+	0x3d, 0x30, 0xcf, 0xba, 0x35, 0x53, 0x3f, 0x53,
+	0x59, 0xd3, 0xbb, 0xc6, 0x35, 0xfb, 0x09, 0xc1,
+	0x52, 0x61, 0xf7, 0x98, 0x27, 0xad, 0xc2, 0xa2,
+	0x22, 0x72, 0xbf, 0x4c, 0x4c, 0x9c, 0xea, 0x46,
+	0x18, 0x41, 0xcd, 0x91, 0x79, 0x19, 0xf7, 0xc7,
+	0xea, 0x3b, 0xd2, 0x88, 0x7c, 0x9d, 0xf1, 0xad,
+	0xf9, 0xd7, 0x6f, 0xfb, 0x12, 0x56, 0x21, 0x46,
+	0x20, 0x92, 0xdd, 0xdd, 0x4b, 0xf4, 0x75, 0xac,
+	0xd1, 0x0b, 0xf3, 0xd5, 0x14, 0xfb, 0xbd, 0x8c,
+	0xb4, 0x29, 0x96, 0x91, 0xee, 0xb1, 0x31, 0x6b,
+	0xf4, 0x8f, 0xd3, 0x2f, 0xae, 0xd0, 0x02, 0xe1,
+	0xe2, 0x92, 0x87, 0x76, 0x41, 0xaa, 0x9f, 0xa9,
+	0xd5, 0x26, 0xca, 0x59, 0xe0, 0x16, 0x56, 0x38,
+	0x8d, 0x72, 0x72, 0x23, 0xe4, 0x72, 0x7a, 0xce,
+	0xfb, 0x7c, 0x23, 0x60, 0x72, 0xde, 0x2f, 0x0a,
+	0xdd, 0x28, 0x35, 0xf2, 0xbc, 0xe8, 0xa7, 0x93
+};
+
+static const u8 rsa_test_rr[RSA_TEST_BYTES] = {
+	0x65, 0x59, 0x38, 0xe3, 0xce, 0x7d, 0x40, 0x76,
+	0x04, 0x03, 0xb9, 0xf0, 0xf6, 0x95, 0x47, 0xd4,
+	0x4f, 0xfb, 0x7a, 0x8b, 0x86, 0xe0, 0xe4, 0x7a,
+	0xcd, 0x01, 0xd5, 0x24, 0x0b, 0xb9, 0x70, 0xbc,
+	0xfc, 0x5e, 0xe3, 0x59, 0x30, 0xea, 0xc6, 0x6a,
+	0x02, 0x68, 0x13, 0xa4, 0x69, 0xd7, 0x33, 0x9c,
+	0xa6, 0x56, 0xcb, 0xe5, 0x19, 0xb4, 0x56, 0x18,
+	0xcb, 0x06, 0x36, 0x55, 0x5e, 0x67, 0xfd, 0x46,
+	0x1d, 0xd3, 0x06, 0x8b, 0xeb, 0x49, 0x40, 0xdd,
+	0xa5, 0x94, 0x2b, 0xa0, 0xfc, 0x0d, 0x9e, 0x26,
+	0x43, 0x3f, 0xc5, 0x19, 0x81, 0x7e, 0x0d, 0xe8,
+	0x98, 0x82, 0xd6, 0x62, 0x9b, 0x61, 0xa7, 0xd2,
+	0xde, 0x46, 0x81, 0xeb, 0x1b, 0xdd, 0x9e, 0x97,
+	0xf0, 0x70, 0xd3, 0x11, 0x72, 0x24, 0x0d, 0xc8,
+	0x94, 0xbf, 0xf9, 0x54, 0xd2, 0x14, 0x49, 0x3f,
+	0x82, 0xff, 0x88, 0x3a, 0x8d, 0x44, 0x01, 0x9a,
+	0x69, 0x41, 0x0c, 0x2b, 0x18, 0x91, 0x4f, 0x31,
+	0x70, 0x21, 0x2e, 0x71, 0x3a, 0xd3, 0xc2, 0xa2,
+	0x25, 0xeb, 0xf7, 0x2f, 0xf2, 0x44, 0x46, 0xc0,
+	0x69, 0x7a, 0xed, 0xfb, 0x98, 0xe9, 0x82, 0xe5,
+	0x9e, 0xf2, 0x31, 0x17, 0x67, 0xe4, 0x05, 0x94,
+	0xb3, 0xbb, 0x4d, 0xd8, 0xba, 0x50, 0x25, 0x66,
+	0xc9, 0xc2, 0x51, 0x5c, 0x08, 0x4a, 0xc0, 0xfc,
+	0x88, 0x04, 0x7b, 0xe8, 0x09, 0x97, 0x82, 0xf9,
+	0x9e, 0x3d, 0x60, 0x66, 0xe8, 0x6a, 0x76, 0xd0,
+	0xa9, 0x82, 0x2f, 0x92, 0xbe, 0xa0, 0xb0, 0x7d,
+	0xf6, 0x7a, 0xf2, 0x5b, 0x07, 0x52, 0x15, 0x9f,
+	0x00, 0x0f, 0x4e, 0x5b, 0x46, 0xc3, 0xad, 0x10,
+	0x7c, 0x44, 0x0e, 0xdc, 0xef, 0x24, 0x59, 0x3d,
+	0x6a, 0xd2, 0xd3, 0x9b, 0x47, 0x7e, 0x61, 0xb6,
+	0xb7, 0x03, 0x22, 0x99, 0x08, 0x00, 0x87, 0x1e,
+	0x47, 0x8a, 0x5d, 0x97, 0x1b, 0x46, 0xa6, 0xaf
+};
+
+static const u8 rsa_test_in[RSA_TEST_BYTES] = {
+	0x89, 0x95, 0x6c, 0x2b, 0x92, 0xff, 0xd4, 0x49,
+	0x7f, 0xf5, 0x86, 0xed, 0x48, 0x45, 0xcb, 0x0f,
+	0x32, 0x0e, 0x32, 0xfe, 0x96, 0x03, 0xb2, 0x76,
+	0x01, 0x3e, 0x18, 0x2c, 0x11, 0xbb, 0xf8, 0xde,
+	0xe7, 0x94, 0xbd, 0x24, 0x0f, 0x3d, 0x4d, 0xa3,
+	0x98, 0x57, 0xbc, 0x73, 0x85, 0x22, 0x45, 0xe8,
+	0x7e, 0x65, 0x4a, 0xb5, 0x8e, 0x68, 0x05, 0xbf,
+	0x38, 0x88, 0x6e, 0x29, 0x42, 0x61, 0x30, 0xda,
+	0x25, 0xca, 0x76, 0xb7, 0x8b, 0xfb, 0xd5, 0xd3,
+	0x7c, 0x3a, 0xd9, 0xc9, 0xaf, 0xac, 0xe6, 0xad,
+	0xb0, 0x4b, 0xe7, 0x44, 0xd2, 0x67, 0xfc, 0xaa,
+	0xdc, 0x62, 0x88, 0x48, 0xbd, 0x25, 0xb4, 0x52,
+	0xeb, 0xdd, 0xd6, 0xef, 0x96, 0x2c, 0xb4, 0x67,
+	0x0a, 0x3a, 0xef, 0xe6, 0x91, 0x05, 0xe4, 0xb6,
+	0xfb, 0xae, 0x50, 0x66, 0xba, 0xbb, 0x71, 0x15,
+	0x9e, 0x88, 0x0f, 0x4c, 0x0f, 0xd7, 0x15, 0x21,
+	0xb3, 0x15, 0xa4, 0x1d, 0x4c, 0xe1, 0x4a, 0x41,
+	0xa1, 0x8a, 0x67, 0x4b, 0x2e, 0xea, 0xcc, 0x03,
+	0x5f, 0xd5, 0x9a, 0x92, 0xc5, 0x70, 0xbd, 0xa3,
+	0xae, 0xb8, 0x8e, 0x76, 0x5c, 0xdd, 0x9b, 0x5b,
+	0xb5, 0x5e, 0x81, 0xf3, 0xb5, 0xfe, 0xa9, 0x65,
+	0x7c, 0xff, 0xab, 0xd2, 0x41, 0x1b, 0xcf, 0x5f,
+	0x0f, 0xce, 0x4f, 0xf3, 0x86, 0xef, 0x5c, 0xae,
+	0xf6, 0x86, 0xc9, 0xea, 0x63, 0xfa, 0xfa, 0xbb,
+	0x0f, 0x2e, 0x40, 0xbf, 0x5b, 0x6d, 0xc8, 0x35,
+	0x3b, 0x4c, 0x5e, 0x60, 0xab, 0xc3, 0xfb, 0x9b,
+	0xca, 0x0e, 0x53, 0x92, 0x59, 0xe6, 0xb8, 0x69,
+	0xf2, 0x45, 0x41, 0xf8, 0xdd, 0x02, 0xa9, 0x14,
+	0x33, 0x56, 0x1b, 0xc8, 0x95, 0x4c, 0xca, 0x37,
+	0x61, 0x0a, 0xb2, 0xe4, 0x08, 0x10, 0x70, 0xbd,
+	0x95, 0x75, 0x2a, 0x29, 0x87, 0xa9, 0x0e, 0xee,
+	0x2c, 0x23, 0xf1, 0xfe, 0x18, 0xce, 0xa3, 0x36
+};
+
+/* rsa_test_in ^ 65537 mod rsa_test_modulus */
+static const u8 rsa_test_out_f4[RSA_TEST_BYTES] = {
+	0x0c, 0x08, 0xe7, 0x0e, 0xba, 0x12, 0xd2, 0x29,
+	0x8f, 0xf1, 0x0e, 0x59, 0xe8, 0x4b, 0x6d, 0x46,
+	0x68, 0x85, 0x32, 0xf3, 0x36, 0x1b, 0x19, 0xcd,
+	0xec, 0x45, 0xdf, 0x39, 0xbc, 0xb5, 0xf2, 0xca,
+	0x75, 0xe7, 0x63, 0x3d, 0x1d, 0x2b, 0x02, 0x54,
+	0x4e, 0x97, 0x15, 0x2d, 0xcd, 0xb9, 0x5c, 0xfd,
+	0x77, 0x38, 0x91, 0x4e, 0x8c, 0xf7, 0x2a, 0x53,
+	0x21, 0x55, 0x09, 0x54, 0x5d, 0xe4, 0xf5, 0x31,
+	0x36, 0x7d, 0x93, 0x86, 0x67, 0x90, 0xc5, 0x5a,
+	0x0c, 0xd3, 0x3b, 0xba, 0x6d, 0x8f, 0x82, 0x4e,
+	0xf9, 0x74, 0x2e, 0xec, 0x73, 0xca, 0x06, 0xf3,
+	0x71, 0x49, 0x9a, 0x61, 0x00, 0xeb, 0x43, 0x37,
+	0x2b, 0x95, 0xb2, 0xa5, 0x28, 0xe1, 0x93, 0x6d,
+	0x53, 0x24, 0x68, 0x93, 0xf9, 0xa1, 0x75, 0xdf,
+	0x0b, 0x18, 0x0b, 0x43, 0x0b, 0x3d, 0x4c, 0xb4,
+	0x0c, 0x85, 0xbe, 0x1e, 0x03, 0xa3, 0x69, 0xff,
+	0xd9, 0x33, 0x1e, 0x91, 0x4d, 0x25, 0x48, 0x22,
+	0x19, 0x04, 0x32, 0x39, 0xa4, 0x09, 0x86, 0xfe,
+	0xf6, 0x31, 0xb9, 0xc7, 0xe1, 0xb2, 0xaf, 0xdb,
+	0xf3, 0xe6, 0x5a, 0x65, 0xdb, 0x13, 0x34, 0xaf,
+	0x0e, 0x6a, 0x7e, 0xbe, 0x7f, 0x8e, 0xce, 0x4d,
+	0x45, 0xf5, 0x11, 0x7a, 0x92, 0x65, 0x29, 0x35,
+	0x25, 0x23, 0x27, 0xc2, 0x68, 0x5c, 0x3f, 0x51,
+	0x61, 0x48, 0x40, 0x53, 0x3f, 0xff, 0x4c, 0x8c,
+	0x96, 0x57, 0xf1, 0xe3, 0x5c, 0xc9, 0x8a, 0x24,
+	0x73, 0xb3, 0xf2, 0x92, 0xc1, 0xa6, 0xb0, 0x65,
+	0x46, 0x2d, 0x25, 0xf2, 0xfc, 0x42, 0xae, 0x3e,
+	0xd7, 0x4c, 0x1e, 0xbe, 0xf0, 0x56, 0x95, 0xd5,
+	0x66, 0x2f, 0xe3, 0x14, 0x4d, 0x30, 0x2d, 0x3a,
+	0xb3, 0x59, 0xbc, 0x16, 0xdf, 0x8a, 0x28, 0xae,
+	0xfd, 0x7c, 0x32, 0x16, 0xb8, 0x78, 0xe3, 0xe9,
+	0x36, 0xd1, 0x40, 0x02, 0xf7, 0xd6, 0xb9, 0xa5
+};
+
+/* rsa_test_in ^ RSA_TEST_EXP mod rsa_test_modulus */
+static const u8 rsa_test_out_exp[RSA_TEST_BYTES] = {
+	0xb8, 0x6b, 0xf0, 0x10, 0x6a, 0x93, 0x91, 0x89,
+	0x49, 0xef, 0x66, 0x50, 0xe1, 0xd5, 0x9e, 0x93,
+	0x65, 0x13, 0xf6, 0x8b, 0x33, 0xcc, 0xf5, 0x6c,
+	0x6f, 0xca, 0x41, 0x7f, 0x98, 0x37, 0x69, 0xdc,
+	0x7e, 0x3f, 0x12, 0x28, 0x6c, 0x06, 0x47, 0x98,
+	0x28, 0x60, 0x8d, 0xbc, 0x4d, 0xc8, 0x81, 0x0b,
+	0x35, 0x92, 0xc8, 0xee, 0x49, 0xca, 0x6b, 0x03,
+	0x43, 0xab, 0x7c, 0xc5, 0x6c, 0xec, 0xa4, 0xb7,
+	0x12, 0x13, 0x15, 0xb5, 0x18, 0x6c, 0xe6, 0x13,
+	0xca, 0x4b, 0x89, 0xd5, 0xd3, 0xb7, 0x9a, 0xe0,
+	0x32, 0x9f, 0x5a, 0x61, 0xbc, 0x2d, 0x4c, 0x0f,
+	0x9a, 0x7d, 0x3d, 0xa4, 0xae, 0xfc, 0xe5, 0x2a,
+	0x6f, 0x94, 0x6d, 0x41, 0x05, 0xb0, 0xf3, 0x72,
+	0x5a, 0xe7, 0xcd, 0x56, 0xd3, 0xd4, 0x0d, 0x78,
+	0xf3, 0x4b, 0x04, 0x4d, 0xf0, 0xe1, 0xcb, 0x6d,
+	0xa2, 0x36, 0x9b, 0xe5, 0xe7, 0x2e, 0xb3, 0x1c,
+	0xaa, 0xaa, 0xcc, 0x9a, 0x80, 0x2f, 0xdc, 0x88,
+	0x24, 0x24, 0xb6, 0xef, 0x55, 0x92, 0x81, 0x09,
+	0xde, 0x17, 0x06, 0x7b, 0xd5, 0xce, 0xd6, 0x45,
+	0x3d, 0xb9, 0x1f, 0xb1, 0x27, 0xc9, 0x81, 0xd1,
+	0xd4, 0x5e, 0xc5, 0x18, 0xe7, 0x04, 0x7f, 0x7f,
+	0xbd, 0x03, 0xbd, 0x36, 0xdf, 0x73, 0x49, 0x7c,
+	0x41, 0xb3, 0x7e, 0xcc, 0xea, 0xb8, 0x95, 0xf7,
+	0xde, 0x8c, 0x96, 0xa8, 0xc8, 0xed, 0xf2, 0x08,
+	0x9c, 0xbe, 0xc4, 0x6e, 0x49, 0xb5, 0xe2, 0xe9,
+	0x90, 0x67, 0x48, 0x16, 0x6e, 0x6a, 0x0f, 0x6f,
+	0x01, 0xbd, 0x94, 0x75, 0xc1, 0xe2, 0x2f, 0x64,
+	0x6e, 0x26, 0x45, 0x6f, 0xbf, 0x13, 0x3f, 0xa6,
+	0x4e, 0x73, 0x38, 0x19, 0x40, 0x5a, 0x49, 0x23,
+	0x4b, 0xb0, 0x13, 0xe3, 0xb3, 0x25, 0x3b, 0x1e,
+	0xa2, 0x7b, 0x71, 0x97, 0x32, 0xa5, 0x2a, 0x33,
+	0x78, 0x8a, 0xfd, 0xd2, 0x4e, 0x40, 0xcf, 0x8e
+};
+
+static int rsa_test_mod_exp(struct unit_test_state *uts, u64 exp,
+			    bool with_rr, const u8 *expect)
+{
+	struct key_prop prop;
+	u8 out[RSA_TEST_BYTES];
+	fdt64_t exp_be;
+
+	memset(&prop, '\0', sizeof(prop));
+	exp_be = cpu_to_fdt64(exp);
+	prop.public_exponent = &exp_be;
+	prop.num_bits = RSA_TEST_BITS;
+	prop.modulus = rsa_test_modulus;
+	if (with_rr)
+		prop.rr = rsa_test_rr;
+
+	ut_assertok(rsa_mod_exp_sw(rsa_test_in, RSA_TEST_BYTES, &prop, out));
+	ut_asserteq_mem(expect, out, RSA_TEST_BYTES);
+
+	return 0;
+}
+
+/* Short exponent, bit by bit */
+static int lib_test_rsa_f4(struct unit_test_state *uts)
+{
+	ut_assertok(rsa_test_mod_exp(uts, 65537, true, rsa_test_out_f4));
+	ut_assertok(rsa_test_mod_exp(uts, 65537, false, rsa_test_out_f4));
+
+	return 0;
+}
+
+LIB_TEST(lib_test_rsa_f4, 0);
+
+/* Long exponent, in windows */
+static int lib_test_rsa_window(struct unit_test_state *uts)
+{
+	ut_assertok(rsa_test_mod_exp(uts, RSA_TEST_EXP, true,
+				     rsa_test_out_exp));
+	ut_assertok(rsa_test_mod_exp(uts, RSA_TEST_EXP, false,
+				     rsa_test_out_exp));
+
+	return 0;
+}
+
+LIB_TEST(lib_test_rsa_window, 0);
+
+/* An even modulus cannot be used */
+static int lib_test_rsa_even(struct unit_test_state *uts)
+{
+	struct key_prop prop;
+	u8 modulus[RSA_TEST_BYTES];
+	u8 out[RSA_TEST_BYTES];
+
+	memcpy(modulus, rsa_test_modulus, RSA_TEST_BYTES);
+	modulus[RSA_TEST_BYTES - 1] &= ~1;
+	memset(&prop, '\0', sizeof(prop));
+	prop.num_bits = RSA_TEST_BITS;
+	prop.modulus = modulus;
+
+	ut_asserteq(-EINVAL, rsa_mod_exp_sw(rsa_test_in, RSA_TEST_BYTES, &prop,
+					    out));
+
+	return 0;
+}
+
+LIB_TEST(lib_test_rsa_even, 0);
@@ -0,0 +1,215 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Tests for SHA-1, SHA-256, SHA-384 and SHA-512
+ *
+ * The input is hashed in pieces of varying size, so that both partial blocks
+ * and runs of whole blocks reach the block functions.
+ */
+
+#include <common.h>
+#include <hexdump.h>
+#include <u-boot/sha1.h>
+#include <u-boot/sha256.h>
+#include <u-boot/sha512.h>
+#include <test/lib.h>
+#include <test/test.h>
+#include <test/ut.h>
+
+#define SHA_TEST_SIZE	1000
+
+/* Piece sizes used to split the input, repeated as needed */
+static const uint __maybe_unused sha_test_pieces[] = {
+	1, 63, 64, 200, 5, 128, 3
+};
+
+static void __maybe_unused sha_test_fill(u8 *buf)
+{
+	int i;
+
+	for (i = 0; i < SHA_TEST_SIZE; i++)
+		buf[i] = i * 7 + 3;
+}
+
+#ifdef CONFIG_SHA1
+static const u8 sha1_abc[SHA1_SUM_LEN] = {
+	0xa9, 0x99, 0x3e, 0x36, 0x47, 0x06, 0x81, 0x6a, 0xba, 0x3e,
+	0x25, 0x71, 0x78, 0x50, 0xc2, 0x6c, 0x9c, 0xd0, 0xd8, 0x9d
+};
+
+static const u8 sha1_long[SHA1_SUM_LEN] = {
+	0x42, 0x31, 0xa8, 0xa5, 0x0a, 0x10, 0xfa, 0x97, 0x58, 0xdb,
+	0x8e, 0xc7, 0x1f, 0xde, 0xf8, 0x55, 0xb7, 0x51, 0x04, 0x8a
+};
+
+static int lib_test_sha1(struct unit_test_state *uts)
+{
+	u8 buf[SHA_TEST_SIZE];
+	u8 out[SHA1_SUM_LEN];
+	sha1_context ctx;
+	uint pos, len, i;
+
+	sha1_csum((u8 *)"abc", 3, out);
+	ut_asserteq_mem(sha1_abc, out, SHA1_SUM_LEN);
+
+	sha_test_fill(buf);
+	sha1_csum(buf, SHA_TEST_SIZE, out);
+	ut_asserteq_mem(sha1_long, out, SHA1_SUM_LEN);
+
+	sha1_starts(&ctx);
+	for (pos = 0, i = 0; pos < SHA_TEST_SIZE; pos += len, i++) {
+		len = min(sha_test_pieces[i % ARRAY_SIZE(sha_test_pieces)],
+			  SHA_TEST_SIZE - pos);
+		sha1_update(&ctx, buf + pos, len);
+	}
+	sha1_finish(&ctx, out);
+	ut_asserteq_mem(sha1_long, out, SHA1_SUM_LEN);
+
+	return 0;
+}
+
+LIB_TEST(lib_test_sha1, 0);
+#endif
+
+#ifdef CONFIG_SHA256
+static const u8 sha256_abc[SHA256_SUM_LEN] = {
+	0xba, 0x78, 0x16, 0xbf, 0x8f, 0x01, 0xcf, 0xea,
+	0x41, 0x41, 0x40, 0xde, 0x5d, 0xae, 0x22, 0x23,
+	0xb0, 0x03, 0x61, 0xa3, 0x96, 0x17, 0x7a, 0x9c,
+	0xb4, 0x10, 0xff, 0x61, 0xf2, 0x00, 0x15, 0xad
+};
+
+static const u8 sha256_long[SHA256_SUM_LEN] = {
+	0x1e, 0x9b, 0xc3, 0x8c, 0xbf, 0x86, 0x0b, 0x9e,
+	0xc3, 0x19, 0x18, 0xb0, 0x65, 0xf9, 0xb5, 0x24,
+	0x76, 0xc5, 0x49, 0xa7, 0x82, 0xe0, 0xe7, 0x99,
+	0x0b, 0xed, 0x8c, 0xe3, 0x86, 0x8d, 0x23, 0x71
+};
+
+static int lib_test_sha256(struct unit_test_state *uts)
+{
+	u8 buf[SHA_TEST_SIZE];
+	u8 out[SHA256_SUM_LEN];
+	sha256_context ctx;
+	uint pos, len, i;
+
+	sha256_csum_wd((u8 *)"abc", 3, out, CHUNKSZ_SHA256);
+	ut_asserteq_mem(sha256_abc, out, SHA256_SUM_LEN);
+
+	sha_test_fill(buf);
+	sha256_csum_wd(buf, SHA_TEST_SIZE, out, CHUNKSZ_SHA256);
+	ut_asserteq_mem(sha256_long, out, SHA256_SUM_LEN);
+
+	sha256_starts(&ctx);
+	for (pos = 0, i = 0; pos < SHA_TEST_SIZE; pos += len, i++) {
+		len = min(sha_test_pieces[i % ARRAY_SIZE(sha_test_pieces)],
+			  SHA_TEST_SIZE - pos);
+		sha256_update(&ctx, buf + pos, len);
+	}
+	sha256_finish(&ctx, out);
+	ut_asserteq_mem(sha256_long, out, SHA256_SUM_LEN);
+
+	return 0;
+}
+
+LIB_TEST(lib_test_sha256, 0);
+#endif
+
+#ifdef CONFIG_SHA384
+static const u8 sha384_abc[SHA384_SUM_LEN] = {
+	0xcb, 0x00, 0x75, 0x3f, 0x45, 0xa3, 0x5e, 0x8b,
+	0xb5, 0xa0, 0x3d, 0x69, 0x9a, 0xc6, 0x50, 0x07,
+	0x27, 0x2c, 0x32, 0xab, 0x0e, 0xde, 0xd1, 0x63,
+	0x1a, 0x8b, 0x60, 0x5a, 0x43, 0xff, 0x5b, 0xed,
+	0x80, 0x86, 0x07, 0x2b, 0xa1, 0xe7, 0xcc, 0x23,
+	0x58, 0xba, 0xec, 0xa1, 0x34, 0xc8, 0x25, 0xa7
+};
+
+static const u8 sha384_long[SHA384_SUM_LEN] = {
+	0x94, 0xc3, 0x8d, 0xb5, 0x21, 0xca, 0x73, 0x3b,
+	0x89, 0x04, 0xc2, 0xd1, 0x4b, 0x6e, 0x82, 0xd3,
+	0x3d, 0xcf, 0xcc, 0x26, 0xe1, 0x31, 0x8c, 0x57,
+	0x9d, 0xbe, 0xe1, 0xfc, 0x2f, 0x47, 0x20, 0x19,
+	0x03, 0x4e, 0x79, 0x22, 0x63, 0xb9, 0xd4, 0x6e,
+	0x90, 0xe7, 0x00, 0xde, 0x2f, 0x6e, 0x7e, 0x91
+};
+
+static int lib_test_sha384(struct unit_test_state *uts)
+{
+	u8 buf[SHA_TEST_SIZE];
+	u8 out[SHA384_SUM_LEN];
+	sha384_context ctx;
+	uint pos, len, i;
+
+	sha384_csum_wd((u8 *)"abc", 3, out, CHUNKSZ_SHA384);
+	ut_asserteq_mem(sha384_abc, out, SHA384_SUM_LEN);
+
+	sha_test_fill(buf);
+	sha384_csum_wd(buf, SHA_TEST_SIZE, out, CHUNKSZ_SHA384);
+	ut_asserteq_mem(sha384_long, out, SHA384_SUM_LEN);
+
+	sha384_starts(&ctx);
+	for (pos = 0, i = 0; pos < SHA_TEST_SIZE; pos += len, i++) {
+		len = min(sha_test_pieces[i % ARRAY_SIZE(sha_test_pieces)],
+			  SHA_TEST_SIZE - pos);
+		sha384_update(&ctx, buf + pos, len);
+	}
+	sha384_finish(&ctx, out);
+	ut_asserteq_mem(sha384_long, out, SHA384_SUM_LEN);
+
+	return 0;
+}
+
+LIB_TEST(lib_test_sha384, 0);
+#endif
+
+#ifdef CONFIG_SHA512
+static const u8 sha512_abc[SHA512_SUM_LEN] = {
+	0xdd, 0xaf, 0x35, 0xa1, 0x93, 0x61, 0x7a, 0xba,
+	0xcc, 0x41, 0x73, 0x49, 0xae, 0x20, 0x41, 0x31,
+	0x12, 0xe6, 0xfa, 0x4e, 0x89, 0xa9, 0x7e, 0xa2,
+	0x0a, 0x9e, 0xee, 0xe6, 0x4b, 0x55, 0xd3, 0x9a,
+	0x21, 0x92, 0x99, 0x2a, 0x27, 0x4f, 0xc1, 0xa8,
+	0x36, 0xba, 0x3c, 0x23, 0xa3, 0xfe, 0xeb, 0xbd,
+	0x45, 0x4d, 0x44, 0x23, 0x64, 0x3c, 0xe8, 0x0e,
+	0x2a, 0x9a, 0xc9, 0x4f, 0xa5, 0x4c, 0xa4, 0x9f
+};
+
+static const u8 sha512_long[SHA512_SUM_LEN] = {
+	0x00, 0xe3, 0x6f, 0xcc, 0xf1, 0x93, 0xe5, 0x96,
+	0x97, 0xa9, 0x2b, 0x5a, 0xb2, 0x46, 0x66, 0xce,
+	0x63, 0x26, 0xd7, 0xfa, 0x16, 0xbf, 0x10, 0x83,
+	0x2d, 0x09, 0x91, 0xdd, 0xc5, 0x91, 0x11, 0x2e,
+	0x9d, 0xfa, 0x6a, 0x63, 0x69, 0x50, 0xed, 0x9c,
+	0x4d, 0x67, 0x34, 0x4a, 0x76, 0x06, 0x54, 0xc2,
+	0xff, 0x77, 0x85, 0xe1, 0xd6, 0x00, 0x94, 0xd6,
+	0x51, 0x03, 0x87, 0x35, 0xb5, 0xdc, 0xca, 0xbd
+};
+
+static int lib_test_sha512(struct unit_test_state *uts)
+{
+	u8 buf[SHA_TEST_SIZE];
+	u8 out[SHA512_SUM_LEN];
+	sha512_context ctx;
+	uint pos, len, i;
+
+	sha512_csum_wd((u8 *)"abc", 3, out, CHUNKSZ_SHA512);
+	ut_asserteq_mem(sha512_abc, out, SHA512_SUM_LEN);
+
+	sha_test_fill(buf);
+	sha512_csum_wd(buf, SHA_TEST_SIZE, out, CHUNKSZ_SHA512);
+	ut_asserteq_mem(sha512_long, out, SHA512_SUM_LEN);
+
+	sha512_starts(&ctx);
+	for (pos = 0, i = 0; pos < SHA_TEST_SIZE; pos += len, i++) {
+		len = min(sha_test_pieces[i % ARRAY_SIZE(sha_test_pieces)],
+			  SHA_TEST_SIZE - pos);
+		sha512_update(&ctx, buf + pos, len);
+	}
+	sha512_finish(&ctx, out);
+	ut_asserteq_mem(sha512_long, out, SHA512_SUM_LEN);
+
+	return 0;
+}
+
+LIB_TEST(lib_test_sha512, 0);
+#endif
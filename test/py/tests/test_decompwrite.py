@@ -0,0 +1,209 @@
+# SPDX-License-Identifier: GPL-2.0+
+
+# Test the gzwrite and decompwrite commands, which decompress an image from
+# memory to a block device.
+
+import os
+import random
+import shutil
+import pytest
+import u_boot_utils
+
+"""
+These tests write to a 4 MiB host block device, backed by a file which is
+filled with FILL before each test, then check the contents of that file.
+"""
+
+DISK_SIZE = 4 << 20
+BLOCK_SIZE = 512
+FILL = b'\xa5'
+
+# Address where the compressed image is loaded
+LOAD_ADDR = 0x1000000
+
+# Tool, its arguments and the suffix of the file it writes, for each format
+COMPRESSORS = {
+    'gzip': ('gzip', ['-9', '-n', '-k', '-f'], '.gz'),
+    'lz4': ('lz4', ['-9', '-f', '-m', '-q'], '.lz4'),
+    'lzma': ('xz', ['--format=lzma', '-k', '-f'], '.lzma'),
+    'bzip2': ('bzip2', ['-9', '-k', '-f'], '.bz2'),
+    'zstd': ('zstd', ['-19', '-q', '-f'], '.zst'),
+}
+
+def make_data(size):
+    """Make some test data, mostly text with some random runs.
+
+    Args:
+        size: Number of bytes to make.
+
+    Returns:
+        The data, which is always the same for a given size.
+    """
+    rnd = random.Random(size)
+    words = [bytes(rnd.randrange(ord('a'), ord('z') + 1)
+                   for i in range(rnd.randrange(2, 10))) for j in range(256)]
+    out = bytearray()
+    while len(out) < size:
+        if rnd.randrange(8):
+            out += rnd.choice(words) + b' '
+        else:
+            out += rnd.getrandbits(512).to_bytes(64, 'little')
+    return bytes(out[:size])
+
+class DecompWriteImage(object):
+    """An image to decompress and the host block device to write it to."""
+
+    def __init__(self, u_boot_console, fmt, size):
+        """Compress some data and set up the block device.
+
+        Args:
+            u_boot_console: A U-Boot console.
+            fmt: Compression format, a key of COMPRESSORS.
+            size: Number of bytes of data to compress.
+        """
+        cons = u_boot_console
+        tool, args, suffix = COMPRESSORS[fmt]
+        if fmt == 'zstd' and not cons.config.buildconfig.get('config_zstd'):
+            pytest.skip('zstd is not enabled')
+        if not shutil.which(tool):
+            pytest.skip('%s is not installed' % tool)
+
+        self.cons = cons
+        self.data = make_data(size)
+        plain = os.path.join(cons.config.result_dir, 'decompwrite.bin')
+        with open(plain, 'wb') as fd:
+            fd.write(self.data)
+        u_boot_utils.run_and_log(cons, [tool] + args + [plain])
+        self.image = plain + suffix
+        self.size = os.path.getsize(self.image)
+
+        self.disk = os.path.join(cons.config.result_dir, 'decompwrite.img')
+        with open(self.disk, 'wb') as fd:
+            fd.write(FILL * DISK_SIZE)
+        cons.run_command('host bind 0 %s' % self.disk)
+        cons.run_command('host load hostfs - %x %s' % (LOAD_ADDR, self.image))
+
+    def write(self, cmd, length=None, args=''):
+        """Run a command to write the image to the device.
+
+        Args:
+            cmd: Command to run, e.g. 'decompwrite'.
+            length: Length of the image to pass, or None for all of it.
+            args: Any further arguments, e.g. the write-buffer size.
+
+        Returns:
+            True if the command succeeded, False if it failed.
+        """
+        if length is None:
+            length = self.size
+        self.cons.run_command('%s host 0 %x %x %s' % (cmd, LOAD_ADDR, length,
+                                                     args))
+        return self.cons.run_command('echo $?').endswith('0')
+
+    def read_disk(self):
+        """Read the contents of the device."""
+        with open(self.disk, 'rb') as fd:
+            disk = fd.read()
+        assert len(disk) == DISK_SIZE
+        return disk
+
+    def check(self, offset=0):
+        """Check that the data was written, padded with zeroes to a block.
+
+        Args:
+            offset: Offset in bytes where the data should start.
+        """
+        disk = self.read_disk()
+        assert disk[:offset] == FILL * offset
+        end = offset + len(self.data)
+        assert disk[offset:end] == self.data
+        pad = -end % BLOCK_SIZE
+        assert disk[end:end + pad] == b'\0' * pad
+        end += pad
+        assert disk[end:] == FILL * (DISK_SIZE - end)
+
+    def check_unchanged(self):
+        """Check that nothing was written."""
+        assert self.read_disk() == FILL * DISK_SIZE
+
+    def check_partial(self):
+        """Check that each block holds the data or was not written."""
+        disk = self.read_disk()
+        padded = self.data + b'\0' * (-len(self.data) % BLOCK_SIZE)
+        for pos in range(0, DISK_SIZE, BLOCK_SIZE):
+            block = disk[pos:pos + BLOCK_SIZE]
+            if block != FILL * BLOCK_SIZE:
+                assert block == padded[pos:pos + BLOCK_SIZE]
+
+@pytest.mark.boardspec('sandbox')
+@pytest.mark.buildconfigspec('cmd_unzip')
+@pytest.mark.parametrize('fmt', sorted(COMPRESSORS))
+def test_decompwrite(u_boot_console, fmt):
+    """Test writing each format, with an odd size and several buffers."""
+
+    img = DecompWriteImage(u_boot_console, fmt, (3 << 20) + 1234)
+    assert img.write('decompwrite')
+    img.check()
+
+    # A small write buffer and a start offset
+    img = DecompWriteImage(u_boot_console, fmt, (1 << 20) + 100)
+    assert img.write('decompwrite', args='10000 20000')
+    img.check(offset=0x20000)
+
+@pytest.mark.boardspec('sandbox')
+@pytest.mark.buildconfigspec('cmd_unzip')
+def test_gzwrite(u_boot_console):
+    """Test that gzwrite writes gzip images and only those."""
+
+    img = DecompWriteImage(u_boot_console, 'gzip', (2 << 20) + 4321)
+    assert img.write('gzwrite', args='10000 400')
+    img.check(offset=0x400)
+
+    img = DecompWriteImage(u_boot_console, 'lz4', 1 << 20)
+    assert not img.write('gzwrite')
+    img.check_unchanged()
+
+    # An abbreviated command name must still be gzwrite
+    assert not img.write('gzw')
+    img.check_unchanged()
+
+@pytest.mark.boardspec('sandbox')
+@pytest.mark.buildconfigspec('cmd_unzip')
+@pytest.mark.parametrize('fmt', sorted(COMPRESSORS))
+def test_decompwrite_truncated(u_boot_console, fmt):
+    """Test that a truncated image is rejected."""
+
+    img = DecompWriteImage(u_boot_console, fmt, 1 << 20)
+    assert not img.write('decompwrite', length=img.size - 64)
+    img.check_partial()
+
+@pytest.mark.boardspec('sandbox')
+@pytest.mark.buildconfigspec('cmd_unzip')
+@pytest.mark.parametrize('fmt', ['gzip', 'bzip2'])
+def test_decompwrite_outsize(u_boot_console, fmt):
+    """Test the expected-size argument, with and without a size in the image.
+    """
+
+    size = (1 << 20) + 10
+    img = DecompWriteImage(u_boot_console, fmt, size)
+    assert not img.write('decompwrite', args='100000 0 %x' % (size + 1))
+    img.check_partial()
+    assert not img.write('decompwrite', args='100000 0 %x' % (size - 1))
+    img.check_partial()
+    assert img.write('decompwrite', args='100000 0 %x' % size)
+    img.check()
+
+@pytest.mark.boardspec('sandbox')
+@pytest.mark.buildconfigspec('cmd_unzip')
+@pytest.mark.parametrize('fmt', ['gzip', 'lz4', 'bzip2'])
+def test_decompwrite_too_big(u_boot_console, fmt):
+    """Test that an image larger than the device is rejected."""
+
+    img = DecompWriteImage(u_boot_console, fmt, DISK_SIZE + (1 << 20))
+    assert not img.write('decompwrite')
+
+    # Nothing may be written if the image records its size
+    if fmt == 'gzip':
+        img.check_unchanged()
+    else:
+        img.check_partial()
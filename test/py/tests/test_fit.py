@@ -458,3 +458,116 @@ def test_fit(u_boot_console):
         # Go back to the original U-Boot with the correct dtb.
         cons.config.dtb = old_dtb
         cons.restart_uboot()
+
+# A FIT with just a hashed kernel, used to check FIT_STREAM_VERIFY
+stream_its = '''
+/dts-v1/;
+
+/ {
+        description = "Kernel with a hash checked while loading";
+        #address-cells = <1>;
+
+        images {
+                kernel@1 {
+                        data = /incbin/("%(kernel)s");
+                        type = "kernel";
+                        arch = "sandbox";
+                        os = "linux";
+                        compression = "%(compression)s";
+                        load = <0x40000>;
+                        entry = <0x8>;
+                        hash@1 {
+                                algo = "sha256";
+                        };
+                };
+        };
+        configurations {
+                default = "conf@1";
+                conf@1 {
+                        kernel = "kernel@1";
+                };
+        };
+};
+'''
+
+@pytest.mark.boardspec('sandbox')
+@pytest.mark.buildconfigspec('fit_stream_verify')
+@pytest.mark.requiredtool('dtc')
+def test_fit_stream_verify(u_boot_console):
+    """Check that bootm refuses a kernel whose hash is checked while loading
+
+    With CONFIG_FIT_STREAM_VERIFY the kernel hash is not checked when the FIT
+    is found but while the kernel is copied or decompressed. Make sure that a
+    corrupted kernel is still never started.
+    """
+    cons = u_boot_console
+    mkimage = cons.config.build_dir + '/tools/mkimage'
+    fit_addr = 0x1000
+
+    def make_fname(leaf):
+        return os.path.join(cons.config.build_dir, leaf)
+
+    def make_fit(kernel, compression):
+        its = make_fname('test-stream.its')
+        fit = make_fname('test-stream.fit')
+        with open(its, 'w') as fd:
+            print(stream_its % {'kernel': kernel,
+                                'compression': compression}, file=fd)
+        util.run_and_log(cons, [mkimage, '-f', its, fit])
+        return fit
+
+    def corrupt(fit, payload, offset):
+        """Flip one byte of the kernel payload in a FIT
+
+        Args:
+            fit: Filename of FIT to corrupt
+            payload: Kernel data as stored in the FIT
+            offset: Offset within the payload of the byte to change
+        Returns:
+            Filename of the corrupted FIT
+        """
+        with open(fit, 'rb') as fd:
+            data = bytearray(fd.read())
+        pos = data.find(payload)
+        assert pos != -1, 'Kernel data not found in FIT'
+        data[pos + offset] ^= 0x20
+        bad_fit = make_fname('test-stream-bad.fit')
+        with open(bad_fit, 'wb') as fd:
+            fd.write(data)
+        return bad_fit
+
+    def boot(fit):
+        cons.run_command('host load hostfs 0 %x %s' % (fit_addr, fit))
+        return cons.run_command('bootm %x' % fit_addr)
+
+    kernel = make_fname('test-stream-kernel.bin')
+    with open(kernel, 'w') as fd:
+        for i in range(100):
+            fd.write('this kernel %d is unlikely to boot\n' % i)
+    util.run_and_log(cons, ['gzip', '-f', '-k', kernel])
+
+    with cons.log.section('Uncompressed kernel'):
+        with open(kernel, 'rb') as fd:
+            payload = fd.read()
+        fit = make_fit(kernel, 'none')
+        output = boot(fit)
+        assert 'Bad Data Hash' not in output
+        assert 'Transferring control to Linux' in output
+
+        output = boot(corrupt(fit, payload, len(payload) // 2))
+        assert 'Bad Data Hash' in output
+        assert 'Transferring control to Linux' not in output
+
+    with cons.log.section('gzip kernel'):
+        with open(kernel + '.gz', 'rb') as fd:
+            payload = fd.read()
+        fit = make_fit(kernel + '.gz', 'gzip')
+        output = boot(fit)
+        assert 'Bad Data Hash' not in output
+        assert 'Transferring control to Linux' in output
+
+        # Change the modification time in the gzip header, which does not
+        # stop the data from decompressing
+        output = boot(corrupt(fit, payload, 4))
+        assert 'Bad Data Hash' in output
+        assert 'Transferring control to Linux' not in output